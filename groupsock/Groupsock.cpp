@@ -53,6 +53,36 @@ Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_
     fLastSentTTL = (unsigned)ttl;
   }
 
+  return setSourcePortIfNecessary();
+}
+
+Boolean OutputSocket::write(netAddressBits address, portNumBits portNum, u_int8_t ttl,
+			    unsigned char* buffer1, unsigned buffer1Size,
+			    unsigned char* buffer2, unsigned buffer2Size) {
+#ifdef HAVE_SCATTER_GATHER_SEND
+  struct in_addr destAddr; destAddr.s_addr = address;
+  if ((unsigned)ttl == fLastSentTTL) {
+    // Optimization: Don't do a 'set TTL' system call again
+    if (!writeSocket(env(), socketNum(), destAddr, portNum, buffer1, buffer1Size, buffer2, buffer2Size)) return False;
+  } else {
+    if (!writeSocket(env(), socketNum(), destAddr, portNum, ttl, buffer1, buffer1Size, buffer2, buffer2Size)) return False;
+    fLastSentTTL = (unsigned)ttl;
+  }
+
+  return setSourcePortIfNecessary();
+#else
+  // We can't send from two buffers at once, so copy them into a single buffer first:
+  unsigned char* buffer = new unsigned char[buffer1Size + buffer2Size];
+  memcpy(buffer, buffer1, buffer1Size);
+  memcpy(&buffer[buffer1Size], buffer2, buffer2Size);
+  Boolean result = write(address, portNum, ttl, buffer, buffer1Size + buffer2Size);
+  delete[] buffer;
+
+  return result;
+#endif
+}
+
+Boolean OutputSocket::setSourcePortIfNecessary() {
   if (sourcePortNum() == 0) {
     // Now that we've sent a packet, we can find out what the
     // kernel chose as our ephemeral source port number:
@@ -303,6 +333,47 @@ Boolean Groupsock::output(UsageEnvironment& env, unsigned char* buffer, unsigned
   return False;
 }
 
+Boolean Groupsock::output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+			  unsigned char* payload, unsigned payloadSize) {
+  if (members().IsEmpty()) {
+    // Common case: Send the header and payload together, to each destination:
+    Boolean writeSuccess = True;
+    for (destRecord* dests = fDests; dests != NULL; dests = dests->fNext) {
+      if (!write(dests->fGroupEId.groupAddress().s_addr, dests->fGroupEId.portNum(), dests->fGroupEId.ttl(),
+		 header, headerSize, payload, payloadSize)) {
+	writeSuccess = False;
+	break;
+      }
+    }
+
+    if (writeSuccess) {
+      statsOutgoing.countPacket(headerSize + payloadSize);
+      statsGroupOutgoing.countPacket(headerSize + payloadSize);
+
+      if (DebugLevel >= 3) {
+	env << *this << ": wrote " << headerSize + payloadSize << " bytes, ttl " << (unsigned)ttl() << "\n";
+      }
+      return True;
+    }
+
+    if (DebugLevel >= 0) { // this is a fatal error
+      UsageEnvironment::MsgString msg = strDup(env.getResultMsg());
+      env.setResultMsg("Groupsock write failed: ", msg);
+      delete[] (char*)msg;
+    }
+    return False;
+  }
+
+  // Otherwise, copy the header and payload into a single buffer, and output that (and relay it to our members):
+  unsigned char* buffer = new unsigned char[headerSize + payloadSize];
+  memcpy(buffer, header, headerSize);
+  memcpy(&buffer[headerSize], payload, payloadSize);
+  Boolean result = output(env, buffer, headerSize + payloadSize);
+  delete[] buffer;
+
+  return result;
+}
+
 Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			      unsigned& bytesRead,
 			      struct sockaddr_in& fromAddressAndPort) {
@@ -314,6 +385,36 @@ Boolean Groupsock::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   int maxBytesToRead = bufferMaxSize - TunnelEncapsulationTrailerMaxSize;
   int numBytes = readSocket(env(), socketNum(),
 			    buffer, maxBytesToRead, fromAddressAndPort);
+  return handleReadResult(numBytes, buffer, bytesRead, fromAddressAndPort);
+}
+
+Boolean Groupsock::handleRead(unsigned char* buffer1, unsigned buffer1MaxSize,
+			      unsigned char* buffer2, unsigned buffer2MaxSize,
+			      unsigned& bytesRead,
+			      struct sockaddr_in& fromAddressAndPort) {
+#ifdef HAVE_SCATTER_GATHER_SEND
+  if (fMembers.IsEmpty()) {
+    // Common case: We don't relay incoming data to any members, so we don't need it in one piece.
+    // Read it directly into the two buffers:
+    bytesRead = 0;
+    int numBytes = readSocket(env(), socketNum(),
+			      buffer1, buffer1MaxSize,
+			      buffer2, buffer2MaxSize - TunnelEncapsulationTrailerMaxSize, fromAddressAndPort);
+    return handleReadResult(numBytes, NULL, bytesRead, fromAddressAndPort);
+  }
+#endif
+
+  // Otherwise, read the data (in one piece) into "buffer2", and then move its start into "buffer1":
+  if (!handleRead(buffer2, buffer2MaxSize, bytesRead, fromAddressAndPort)) return False;
+
+  unsigned numBytesInBuffer1 = bytesRead < buffer1MaxSize ? bytesRead : buffer1MaxSize;
+  memcpy(buffer1, buffer2, numBytesInBuffer1);
+  memmove(buffer2, &buffer2[numBytesInBuffer1], bytesRead - numBytesInBuffer1);
+  return True;
+}
+
+Boolean Groupsock::handleReadResult(int numBytes, unsigned char* buffer, unsigned& bytesRead,
+				    struct sockaddr_in& fromAddressAndPort) {
   if (numBytes < 0) {
     if (DebugLevel >= 0) { // this is a fatal error
       UsageEnvironment::MsgString msg = strDup(env().getResultMsg());
@@ -27,6 +27,9 @@ extern "C" int initializeWinsockIfNecessary();
 #include <stdarg.h>
 #include <time.h>
 #include <fcntl.h>
+#ifdef HAVE_SCATTER_GATHER_SEND
+#include <sys/uio.h>
+#endif
 #define initializeWinsockIfNecessary() 1
 #endif
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
@@ -281,13 +284,8 @@ int setupStreamSocket(UsageEnvironment& env,
   return newSocket;
 }
 
-int readSocket(UsageEnvironment& env,
-	       int socket, unsigned char* buffer, unsigned bufferSize,
-	       struct sockaddr_in& fromAddress) {
-  SOCKLEN_T addressSize = sizeof fromAddress;
-  int bytesRead = recvfrom(socket, (char*)buffer, bufferSize, 0,
-			   (struct sockaddr*)&fromAddress,
-			   &addressSize);
+static int checkReadResult(UsageEnvironment& env, int bytesRead, struct sockaddr_in& fromAddress) {
+  // Used to implement the versions of "readSocket()" below:
   if (bytesRead < 0) {
     //##### HACK to work around bugs in Linux and Windows:
     int err = env.getErrno();
@@ -317,11 +315,38 @@ int readSocket(UsageEnvironment& env,
   return bytesRead;
 }
 
-Boolean writeSocket(UsageEnvironment& env,
-		    int socket, struct in_addr address, portNumBits portNum,
-		    u_int8_t ttlArg,
-		    unsigned char* buffer, unsigned bufferSize) {
-  // Before sending, set the socket's TTL:
+int readSocket(UsageEnvironment& env,
+	       int socket, unsigned char* buffer, unsigned bufferSize,
+	       struct sockaddr_in& fromAddress) {
+  SOCKLEN_T addressSize = sizeof fromAddress;
+  int bytesRead = recvfrom(socket, (char*)buffer, bufferSize, 0,
+			   (struct sockaddr*)&fromAddress,
+			   &addressSize);
+  return checkReadResult(env, bytesRead, fromAddress);
+}
+
+#ifdef HAVE_SCATTER_GATHER_SEND
+int readSocket(UsageEnvironment& env,
+	       int socket, unsigned char* buffer1, unsigned buffer1Size,
+	       unsigned char* buffer2, unsigned buffer2Size,
+	       struct sockaddr_in& fromAddress) {
+  struct iovec iov[2];
+  iov[0].iov_base = buffer1; iov[0].iov_len = buffer1Size;
+  iov[1].iov_base = buffer2; iov[1].iov_len = buffer2Size;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof msg);
+  msg.msg_name = &fromAddress;
+  msg.msg_namelen = sizeof fromAddress;
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  int bytesRead = recvmsg(socket, &msg, 0);
+  return checkReadResult(env, bytesRead, fromAddress);
+}
+#endif
+
+static Boolean setMulticastTTL(UsageEnvironment& env, int socket, u_int8_t ttlArg) {
 #if defined(__WIN32__) || defined(_WIN32)
 #define TTL_TYPE int
 #else
@@ -334,6 +359,16 @@ Boolean writeSocket(UsageEnvironment& env,
     return False;
   }
 
+  return True;
+}
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    u_int8_t ttlArg,
+		    unsigned char* buffer, unsigned bufferSize) {
+  // Before sending, set the socket's TTL:
+  if (!setMulticastTTL(env, socket, ttlArg)) return False;
+
   return writeSocket(env, socket, address, portNum, buffer, bufferSize);
 }
 
@@ -357,6 +392,51 @@ Boolean writeSocket(UsageEnvironment& env,
   return False;
 }
 
+#ifdef HAVE_SCATTER_GATHER_SEND
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    u_int8_t ttlArg,
+		    unsigned char* buffer1, unsigned buffer1Size,
+		    unsigned char* buffer2, unsigned buffer2Size) {
+  // Before sending, set the socket's TTL:
+  if (!setMulticastTTL(env, socket, ttlArg)) return False;
+
+  return writeSocket(env, socket, address, portNum, buffer1, buffer1Size, buffer2, buffer2Size);
+}
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum,
+		    unsigned char* buffer1, unsigned buffer1Size,
+		    unsigned char* buffer2, unsigned buffer2Size) {
+  do {
+    MAKE_SOCKADDR_IN(dest, address.s_addr, portNum);
+    struct iovec iov[2];
+    iov[0].iov_base = buffer1; iov[0].iov_len = buffer1Size;
+    iov[1].iov_base = buffer2; iov[1].iov_len = buffer2Size;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_name = &dest;
+    msg.msg_namelen = sizeof dest;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    unsigned totSize = buffer1Size + buffer2Size;
+    int bytesSent = sendmsg(socket, &msg, 0);
+    if (bytesSent != (int)totSize) {
+      char tmpBuf[100];
+      sprintf(tmpBuf, "writeSocket(%d), sendmsg() error: wrote %d bytes instead of %u: ", socket, bytesSent, totSize);
+      socketErr(env, tmpBuf);
+      break;
+    }
+
+    return True;
+  } while (0);
+
+  return False;
+}
+#endif
+
 void ignoreSigPipeOnSocket(int socketNum) {
   #ifdef USE_SIGNALS
   #ifdef SO_NOSIGPIPE
@@ -47,12 +47,19 @@ public:
 		unsigned char* buffer, unsigned bufferSize) {
     return write(addressAndPort.sin_addr.s_addr, addressAndPort.sin_port, ttl, buffer, bufferSize);
   }
+  Boolean write(netAddressBits address, portNumBits portNum/*in network order*/, u_int8_t ttl,
+		unsigned char* buffer1, unsigned buffer1Size,
+		unsigned char* buffer2, unsigned buffer2Size);
+      // sends "buffer1" followed by "buffer2", as a single datagram
 
 protected:
   OutputSocket(UsageEnvironment& env, Port port);
 
   portNumBits sourcePortNum() const {return fSourcePort.num();}
 
+private:
+  Boolean setSourcePortIfNecessary();
+
 private: // redefined virtual function
   virtual Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
 			     unsigned& bytesRead,
@@ -129,6 +136,10 @@ public:
 
   virtual Boolean output(UsageEnvironment& env, unsigned char* buffer, unsigned bufferSize,
 			 DirectedNetInterface* interfaceNotToFwdBackTo = NULL);
+  Boolean output(UsageEnvironment& env, unsigned char* header, unsigned headerSize,
+		 unsigned char* payload, unsigned payloadSize);
+      // Outputs a packet that consists of "header" followed by "payload", without (if possible)
+      // first copying them into a single buffer.
 
   DirectedNetInterfaceSet& members() { return fMembers; }
 
@@ -151,10 +162,21 @@ public: // redefined virtual functions
 			     unsigned& bytesRead,
 			     struct sockaddr_in& fromAddressAndPort);
 
+public:
+  Boolean handleRead(unsigned char* buffer1, unsigned buffer1MaxSize,
+		     unsigned char* buffer2, unsigned buffer2MaxSize,
+		     unsigned& bytesRead,
+		     struct sockaddr_in& fromAddressAndPort);
+      // A version of "handleRead()" that reads the data into "buffer1", and then (any data that doesn't fit) into "buffer2".
+      // ("buffer2" should be big enough to hold any incoming packet by itself.)
+
 protected:
   destRecord* lookupDestRecordFromDestination(struct sockaddr_in const& destAddrAndPort) const;
 
 private:
+  Boolean handleReadResult(int numBytes, unsigned char* buffer, unsigned& bytesRead,
+			   struct sockaddr_in& fromAddressAndPort);
+      // used to implement the versions of "handleRead()"; "buffer" is used only for relaying the data to our members
   void removeDestinationFrom(destRecord*& dests, unsigned sessionId);
     // used to implement (the public) "removeDestination()", and "changeDestinationParameters()"
   int outputToAllMembersExcept(DirectedNetInterface* exceptInterface,
@@ -43,6 +43,32 @@ Boolean writeSocket(UsageEnvironment& env,
 		    unsigned char* buffer, unsigned bufferSize);
     // An optimized version of "writeSocket" that omits the "setsockopt()" call to set the TTL.
 
+// On most platforms, data that's split across more than one buffer can be sent using a single
+// (scatter-gather) "sendmsg()" call, rather than first being copied into a single buffer.
+// (Similarly, a datagram can be read into more than one buffer, using a single "recvmsg()" call.)
+// (Define NO_SCATTER_GATHER_SEND to turn this off.)
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(VXWORKS) && !defined(NO_SCATTER_GATHER_SEND)
+#define HAVE_SCATTER_GATHER_SEND 1
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    u_int8_t ttlArg,
+		    unsigned char* buffer1, unsigned buffer1Size,
+		    unsigned char* buffer2, unsigned buffer2Size);
+
+Boolean writeSocket(UsageEnvironment& env,
+		    int socket, struct in_addr address, portNumBits portNum/*network byte order*/,
+		    unsigned char* buffer1, unsigned buffer1Size,
+		    unsigned char* buffer2, unsigned buffer2Size);
+    // Versions of "writeSocket" that send "buffer1" followed by "buffer2", as a single datagram.
+
+int readSocket(UsageEnvironment& env,
+	       int socket, unsigned char* buffer1, unsigned buffer1Size,
+	       unsigned char* buffer2, unsigned buffer2Size,
+	       struct sockaddr_in& fromAddress);
+    // A version of "readSocket" that reads a datagram into "buffer1", and then (any data that didn't fit) into "buffer2".
+#endif
+
 void ignoreSigPipeOnSocket(int socketNum);
 
 unsigned getSendBufferSize(UsageEnvironment& env, int socket);
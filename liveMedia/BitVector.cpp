@@ -19,6 +19,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "BitVector.hh"
+#include <stdlib.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 BitVector::BitVector(unsigned char* baseBytePtr,
 		     unsigned baseBitOffset,
@@ -140,6 +146,160 @@ unsigned BitVector::get_expGolomb() {
 }
 
 
+////////// BitReader //////////
+
+static unsigned numLeadingZeroBits(u_int64_t word) {
+  // Returns the number of leading 0 bits in "word" (64, if it's 0)
+  if (word == 0) return 64;
+#if defined(__GNUC__)
+  return __builtin_clzll(word);
+#else
+  unsigned result = 0;
+  while ((word&0x8000000000000000ULL) == 0) { word <<= 1; ++result; }
+  return result;
+#endif
+}
+
+BitReader::BitReader(unsigned char const* baseBytePtr,
+		     unsigned baseBitOffset,
+		     unsigned totNumBits) {
+  setup(baseBytePtr, baseBitOffset, totNumBits);
+}
+
+void BitReader::setup(unsigned char const* baseBytePtr,
+		      unsigned baseBitOffset,
+		      unsigned totNumBits) {
+  fNextBytePtr = baseBytePtr + baseBitOffset/8;
+  fLimitBytePtr = baseBytePtr + (baseBitOffset + totNumBits + 7)/8;
+  fCache = 0;
+  fNumCachedBits = 0;
+  fTotNumBits = totNumBits;
+  fCurBitIndex = 0;
+
+  // If our data doesn't begin on a byte boundary, then drop the initial bits of the first byte:
+  unsigned const numInitialBitsToDrop = baseBitOffset%8;
+  if (numInitialBitsToDrop > 0 && totNumBits > 0) {
+    refill();
+    fCache <<= numInitialBitsToDrop;
+    fNumCachedBits -= numInitialBitsToDrop;
+  }
+}
+
+void BitReader::refill() {
+  // Top up the cache, so that it contains at least 57 bits (or else all of the remaining data):
+  if (fNumCachedBits > 56) return;
+
+  if (fLimitBytePtr - fNextBytePtr >= 8) {
+    // Load the next 8 bytes (big-endian) at once, and keep as many whole bytes as fit.  (Any of the following byte's bits
+    // that also land in the cache are harmless: they'll be ORed in again, at the same position, by the next refill.)
+    u_int64_t word
+      = ((u_int64_t)fNextBytePtr[0]<<56) | ((u_int64_t)fNextBytePtr[1]<<48)
+      | ((u_int64_t)fNextBytePtr[2]<<40) | ((u_int64_t)fNextBytePtr[3]<<32)
+      | ((u_int64_t)fNextBytePtr[4]<<24) | ((u_int64_t)fNextBytePtr[5]<<16)
+      | ((u_int64_t)fNextBytePtr[6]<<8) | (u_int64_t)fNextBytePtr[7];
+    fCache |= word >> fNumCachedBits;
+    unsigned const numBytesKept = (63 - fNumCachedBits)/8;
+    fNextBytePtr += numBytesKept;
+    fNumCachedBits += 8*numBytesKept;
+  } else {
+    // We're near the end of the data; load it a byte at a time:
+    while (fNumCachedBits <= 56 && fNextBytePtr < fLimitBytePtr) {
+      fCache |= (u_int64_t)(*fNextBytePtr++) << (56 - fNumCachedBits);
+      fNumCachedBits += 8;
+    }
+  }
+}
+
+unsigned BitReader::takeBits(unsigned numBits) {
+  if (fNumCachedBits < numBits) refill();
+
+  unsigned result = (unsigned)(fCache >> (64 - numBits));
+  fCache <<= numBits;
+  fNumCachedBits -= numBits;
+  fCurBitIndex += numBits;
+  return result;
+}
+
+unsigned BitReader::getBits(unsigned numBits) {
+  if (numBits == 0) return 0;
+  if (numBits > MAX_LENGTH) {
+    numBits = MAX_LENGTH;
+  }
+
+  unsigned const numBitsAvailable = numBitsRemaining();
+  if (numBits <= numBitsAvailable) return takeBits(numBits);
+
+  // We're reading past the end of the data; as with "BitVector", the overflowing (low-order) bits are 0:
+  if (numBitsAvailable == 0) return 0;
+  return takeBits(numBitsAvailable) << (numBits - numBitsAvailable);
+}
+
+unsigned BitReader::get1Bit() {
+  if (fCurBitIndex >= fTotNumBits) return 0; /* overflow */
+
+  return takeBits(1);
+}
+
+void BitReader::skipBits(unsigned numBits) {
+  if (numBits > numBitsRemaining()) { /* overflow */
+    numBits = numBitsRemaining();
+  }
+  fCurBitIndex += numBits;
+
+  if (numBits < fNumCachedBits) {
+    fCache <<= numBits;
+    fNumCachedBits -= numBits;
+  } else {
+    // Discard the cache, and skip over whole bytes of the data, then over any remaining bits:
+    numBits -= fNumCachedBits;
+    fNextBytePtr += numBits/8;
+    fCache = 0;
+    fNumCachedBits = 0;
+
+    numBits %= 8;
+    if (numBits > 0) {
+      refill();
+      fCache <<= numBits;
+      fNumCachedBits -= numBits;
+    }
+  }
+}
+
+unsigned BitReader::get_expGolomb() {
+  // A code consists of N 0 bits, a 1 bit, then N more bits.  If it lies entirely within the cache (the usual case),
+  // we can decode it in one step, after counting the leading 0 bits:
+  if (fNumCachedBits < 32) refill();
+  unsigned numBitsAvailable = numBitsRemaining();
+  if (numBitsAvailable > fNumCachedBits) numBitsAvailable = fNumCachedBits;
+
+  unsigned const numLeadingZeros = numLeadingZeroBits(fCache);
+  if (2*numLeadingZeros < numBitsAvailable) {
+    unsigned const codeLength = 2*numLeadingZeros + 1; // <= 63, so the code's value fits in 32 bits
+    unsigned result = (unsigned)(fCache >> (64 - codeLength)) - 1;
+    fCache <<= codeLength;
+    fNumCachedBits -= codeLength;
+    fCurBitIndex += codeLength;
+    return result;
+  }
+
+  // Otherwise (the code is very long, or runs past the end of the data), decode it the same way that "BitVector" does:
+  unsigned numLeadingZeroBits = 0;
+  unsigned codeStart = 1;
+
+  while (get1Bit() == 0 && fCurBitIndex < fTotNumBits) {
+    ++numLeadingZeroBits;
+    codeStart *= 2;
+  }
+
+  return codeStart - 1 + getBits(numLeadingZeroBits);
+}
+
+int BitReader::get_signedExpGolomb() {
+  // Code values 0, 1, 2, 3, 4, ... map to 0, 1, -1, 2, -2, ...:
+  unsigned codeNum = get_expGolomb();
+  return (codeNum&1) != 0 ? (int)((codeNum>>1) + 1) : -(int)(codeNum>>1);
+}
+
 void shiftBits(unsigned char* toBasePtr, unsigned toBitOffset,
 	       unsigned char const* fromBasePtr, unsigned fromBitOffset,
 	       unsigned numBits) {
@@ -172,3 +332,56 @@ void shiftBits(unsigned char* toBasePtr, unsigned toBitOffset,
     }
   }
 }
+
+unsigned char* findTwoZerosAndByte(unsigned char* from, unsigned char* limit,
+				   unsigned char minByte, unsigned char maxByte) {
+  unsigned char* p = from;
+  unsigned char const byteRange = maxByte - minByte;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  // Test a block of positions at a time: a sequence begins at position i iff p[i] == 0, p[i+1] == 0 and
+  // (unsigned)(p[i+2] - minByte) <= byteRange:
+#if defined(__AVX2__)
+  unsigned const blockSize = 32;
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const minBytes = _mm256_set1_epi8((char)minByte);
+  __m256i const byteRanges = _mm256_set1_epi8((char)byteRange);
+#else
+  unsigned const blockSize = 16;
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const minBytes = _mm_set1_epi8((char)minByte);
+  __m128i const byteRanges = _mm_set1_epi8((char)byteRange);
+#endif
+  while (limit - p >= (int)blockSize + 2) {
+#if defined(__AVX2__)
+    __m256i b0 = _mm256_loadu_si256((__m256i const*)p);
+    __m256i b1 = _mm256_loadu_si256((__m256i const*)(p+1));
+    __m256i b2 = _mm256_sub_epi8(_mm256_loadu_si256((__m256i const*)(p+2)), minBytes);
+    __m256i b2InRange = _mm256_cmpeq_epi8(_mm256_min_epu8(b2, byteRanges), b2);
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(b0, zero),
+										      _mm256_cmpeq_epi8(b1, zero)),
+								     b2InRange));
+#else
+    __m128i b0 = _mm_loadu_si128((__m128i const*)p);
+    __m128i b1 = _mm_loadu_si128((__m128i const*)(p+1));
+    __m128i b2 = _mm_sub_epi8(_mm_loadu_si128((__m128i const*)(p+2)), minBytes);
+    __m128i b2InRange = _mm_cmpeq_epi8(_mm_min_epu8(b2, byteRanges), b2);
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+									      _mm_cmpeq_epi8(b1, zero)),
+							     b2InRange));
+#endif
+    if (mask != 0) return p + __builtin_ctz(mask);
+    p += blockSize;
+  }
+#endif
+
+  // Scalar code (also used to test the last few positions).  Each test can rule out up to 3 positions at once:
+  while (limit - p >= 3) {
+    Boolean lastByteIsInRange = (unsigned char)(p[2] - minByte) <= byteRange;
+    if (p[2] != 0 && !lastByteIsInRange) p += 3;
+    else if (p[1] != 0) p += 2;
+    else if (p[0] != 0 || !lastByteIsInRange) ++p;
+    else return p;
+  }
+  return NULL;
+}
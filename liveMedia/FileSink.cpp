@@ -25,12 +25,17 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "FileSink.hh"
 #include "GroupsockHelper.hh"
 #include "OutputFile.hh"
+#include "MultiFramedRTPSource.hh"
+#ifdef HAVE_SCATTER_GATHER_SEND
+#include <sys/uio.h> // for "writev()"
+#endif
 
 ////////// FileSink //////////
 
 FileSink::FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 		   char const* perFrameFileNamePrefix)
-  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0) {
+  : MediaSink(env), fOutFid(fid), fBufferSize(bufferSize), fSamePresentationTimeCounter(0),
+    fWriteFrameSlices(False) {
   fBuffer = new unsigned char[bufferSize];
   if (perFrameFileNamePrefix != NULL) {
     fPerFrameFileNamePrefix = strDup(perFrameFileNamePrefix);
@@ -65,7 +70,9 @@ FileSink* FileSink::createNew(UsageEnvironment& env, char const* fileName,
       perFrameFileNamePrefix = NULL;
     }
 
-    return new FileSink(env, fid, bufferSize, perFrameFileNamePrefix);
+    FileSink* sink = new FileSink(env, fid, bufferSize, perFrameFileNamePrefix);
+    sink->setWriteFrameSlices(); // we don't examine the frame data, so we can write it directly from incoming packets
+    return sink;
   } while (0);
 
   return NULL;
@@ -74,6 +81,10 @@ FileSink* FileSink::createNew(UsageEnvironment& env, char const* fileName,
 Boolean FileSink::continuePlaying() {
   if (fSource == NULL) return False;
 
+  if (fWriteFrameSlices && fSource->isMultiFramedRTPSource()) {
+    ((MultiFramedRTPSource*)fSource)->setDeliverFrameSlices(True);
+  }
+
   fSource->getNextFrame(fBuffer, fBufferSize,
 			afterGettingFrame, this,
 			onSourceClosure, this);
@@ -81,6 +92,15 @@ Boolean FileSink::continuePlaying() {
   return True;
 }
 
+void FileSink::stopPlaying() {
+  if (fWriteFrameSlices && fSource != NULL && fSource->isMultiFramedRTPSource()) {
+    // Restore our source's normal behavior, in case it later gets used by some other sink:
+    ((MultiFramedRTPSource*)fSource)->setDeliverFrameSlices(False);
+  }
+
+  MediaSink::stopPlaying();
+}
+
 void FileSink::afterGettingFrame(void* clientData, unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime,
@@ -124,6 +144,50 @@ void FileSink::addData(unsigned char const* data, unsigned dataSize,
   }
 }
 
+void FileSink::addFrameSlices(FrameSlices const& frameSlices, struct timeval presentationTime) {
+  addData(NULL, 0, presentationTime); // opens a new file for this frame, if necessary
+  if (fOutFid == NULL) return;
+
+#ifdef HAVE_SCATTER_GATHER_SEND
+  // Flush any data that we've already written using "fwrite()" (e.g., by a subclass), so that it comes first:
+  fflush(fOutFid);
+
+  unsigned const maxIovecs = 64;
+  struct iovec iov[maxIovecs];
+  for (unsigned i = 0; i < frameSlices.numSlices(); ) {
+    unsigned numIovecs = 0;
+    for (; numIovecs < maxIovecs && i < frameSlices.numSlices(); ++numIovecs, ++i) {
+      iov[numIovecs].iov_base = (char*)frameSlices.sliceData(i);
+      iov[numIovecs].iov_len = frameSlices.sliceSize(i);
+    }
+
+    struct iovec* iovPtr = iov;
+    while (numIovecs > 0) {
+      int numBytesWritten = writev(fileno(fOutFid), iovPtr, numIovecs);
+      if (numBytesWritten < 0) {
+	// The output file has failed; close it, so that our caller will treat this as a closure:
+	fclose(fOutFid); fOutFid = NULL;
+	return;
+      }
+
+      // In case the write was only partial, skip over what was written, and try again:
+      while (numIovecs > 0 && (unsigned)numBytesWritten >= iovPtr->iov_len) {
+	numBytesWritten -= iovPtr->iov_len;
+	++iovPtr; --numIovecs;
+      }
+      if (numIovecs > 0) {
+	iovPtr->iov_base = (char*)iovPtr->iov_base + numBytesWritten;
+	iovPtr->iov_len -= numBytesWritten;
+      }
+    }
+  }
+#else
+  for (unsigned i = 0; i < frameSlices.numSlices(); ++i) {
+    fwrite(frameSlices.sliceData(i), 1, frameSlices.sliceSize(i), fOutFid);
+  }
+#endif
+}
+
 void FileSink::afterGettingFrame(unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime) {
@@ -133,7 +197,11 @@ void FileSink::afterGettingFrame(unsigned frameSize,
             << numTruncatedBytes << " bytes of trailing data was dropped!  Correct this by increasing the \"bufferSize\" parameter in the \"createNew()\" call to at least "
             << fBufferSize + numTruncatedBytes << "\n";
   }
-  addData(fBuffer, frameSize, presentationTime);
+  if (fWriteFrameSlices && fSource != NULL && fSource->isMultiFramedRTPSource()) {
+    addFrameSlices(((MultiFramedRTPSource*)fSource)->frameSlices(), presentationTime);
+  } else {
+    addData(fBuffer, frameSize, presentationTime);
+  }
 
   if (fOutFid == NULL || fflush(fOutFid) == EOF) {
     // The output file has closed.  Handle this the same way as if the input source had closed:
@@ -79,9 +79,9 @@ Boolean H264VideoRTPSink::sourceIsCompatibleWithUs(MediaSource& source) {
 }
 
 char const* H264VideoRTPSink::auxSDPLine() {
-  // Generate a new "a=fmtp:" line each time, using our SPS and PPS (if we have them),
-  // otherwise parameters from our framer source (in case they've changed since the last time that
-  // we were called):
+  // Generate a new "a=fmtp:" line, using our SPS and PPS (if we have them),
+  // otherwise parameters from our framer source - but only if they've changed since the last time that
+  // we generated one:
   H264or5VideoStreamFramer* framerSource = NULL;
   u_int8_t* vpsDummy = NULL; unsigned vpsDummySize = 0;
   u_int8_t* sps = fSPS; unsigned spsSize = fSPSSize;
@@ -91,9 +91,14 @@ char const* H264VideoRTPSink::auxSDPLine() {
     if (fOurFragmenter == NULL) return NULL; // we don't yet have a fragmenter (and therefore not a source)
     framerSource = (H264or5VideoStreamFramer*)(fOurFragmenter->inputSource());
     if (framerSource == NULL) return NULL; // we don't yet have a source
+    if (fFmtpSDPLine != NULL && framerSource->parameterSetsVersion() == fFmtpSDPLineParameterSetsVersion) {
+      return fFmtpSDPLine; // our source's SPS and PPS haven't changed
+    }
 
     framerSource->getVPSandSPSandPPS(vpsDummy, vpsDummySize, sps, spsSize, pps, ppsSize);
     if (sps == NULL || pps == NULL) return NULL; // our source isn't ready
+  } else if (fFmtpSDPLine != NULL) {
+    return fFmtpSDPLine; // our own SPS and PPS never change
   }
 
   // Set up the "a=fmtp:" SDP line for this stream:
@@ -127,5 +132,6 @@ char const* H264VideoRTPSink::auxSDPLine() {
   delete[] pps_base64;
 
   delete[] fFmtpSDPLine; fFmtpSDPLine = fmtp;
+  fFmtpSDPLineParameterSetsVersion = framerSource == NULL ? 0 : framerSource->parameterSetsVersion();
   return fFmtpSDPLine;
 }
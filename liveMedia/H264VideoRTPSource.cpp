@@ -167,21 +167,21 @@ unsigned H264BufferedPacket
     // The first two bytes are NALU size:
     if (dataSize < 2) break;
     resultNALUSize = (framePtr[0]<<8)|framePtr[1];
-    framePtr += 2;
+    framePtr += 2; dataSize -= 2;
     break;
   }
   case 26: { // MTAP16
     // The first two bytes are NALU size.  The next three are the DOND and TS offset:
     if (dataSize < 5) break;
     resultNALUSize = (framePtr[0]<<8)|framePtr[1];
-    framePtr += 5;
+    framePtr += 5; dataSize -= 5;
     break;
   }
   case 27: { // MTAP24
     // The first two bytes are NALU size.  The next four are the DOND and TS offset:
     if (dataSize < 6) break;
     resultNALUSize = (framePtr[0]<<8)|framePtr[1];
-    framePtr += 6;
+    framePtr += 6; dataSize -= 6;
     break;
   }
   default: {
@@ -190,6 +190,7 @@ unsigned H264BufferedPacket
   }
   }
 
+  // (Don't let a bad NALU size take us beyond the end of the packet:)
   return (resultNALUSize <= dataSize) ? resultNALUSize : dataSize;
 }
 
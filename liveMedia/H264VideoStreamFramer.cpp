@@ -21,13 +21,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H264VideoStreamFramer.hh"
 
 H264VideoStreamFramer* H264VideoStreamFramer
-::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean includeStartCodeInOutput) {
-  return new H264VideoStreamFramer(env, inputSource, True, includeStartCodeInOutput);
+::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean includeStartCodeInOutput,
+	    Boolean inputIsAccessUnitDelimited) {
+  return new H264VideoStreamFramer(env, inputSource, !inputIsAccessUnitDelimited/*createParser*/, includeStartCodeInOutput,
+				   inputIsAccessUnitDelimited);
 }
 
 H264VideoStreamFramer
-::H264VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource, Boolean createParser, Boolean includeStartCodeInOutput)
-  : H264or5VideoStreamFramer(264, env, inputSource, createParser, includeStartCodeInOutput) {
+::H264VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource, Boolean createParser, Boolean includeStartCodeInOutput,
+			Boolean inputIsAccessUnitDelimited)
+  : H264or5VideoStreamFramer(264, env, inputSource, createParser, includeStartCodeInOutput, inputIsAccessUnitDelimited) {
 }
 
 H264VideoStreamFramer::~H264VideoStreamFramer() {
@@ -37,6 +37,17 @@ public:
     virtual ~H264or5Fragmenter();
     
     Boolean lastFragmentCompletedNALUnit() const { return fLastFragmentCompletedNALUnit; }
+    Boolean lastFragmentEndedAccessUnit() const { return fLastFragmentEndedAccessUnit; }
+
+    void setDeliverByReference(Boolean deliverByReference) { fDeliverByReference = deliverByReference; }
+        // If set, we deliver (to "fTo") only the NAL or FU header bytes of each fragment; the rest of the
+        // fragment is left in our input buffer, and is described by "fragmentPayload()"/"fragmentPayloadSize()".
+    unsigned char* fragmentPayload() const { return fFragmentPayload; }
+    unsigned fragmentPayloadSize() const { return fFragmentPayloadSize; }
+
+    void setUseAggregation(Boolean useAggregation) { fUseAggregation = useAggregation; }
+        // If set, we deliver consecutive small NAL units from the same access unit together,
+        // as a single aggregation packet (STAP-A for H.264; AP for H.265).
     
 private: // redefined virtual functions:
     virtual void doGetNextFrame();
@@ -51,6 +62,10 @@ private:
                             unsigned numTruncatedBytes,
                             struct timeval presentationTime,
                             unsigned durationInMicroseconds);
+    static void onSourceClosure(void* clientData);
+    void onSourceClosure1();
+    Boolean aggregateNALUnit();
+    void deliverAggregationPacket();
     void reset();
     
 private:
@@ -62,6 +77,24 @@ private:
     unsigned fCurDataOffset;
     unsigned fSaveNumTruncatedBytes;
     Boolean fLastFragmentCompletedNALUnit;
+    Boolean fLastFragmentEndedAccessUnit;
+    Boolean fDeliverByReference;
+    unsigned char* fFragmentPayload;
+    unsigned fFragmentPayloadSize;
+
+    // Parameters of the NAL unit that's currently in our input buffer:
+    struct timeval fInputPresentationTime;
+    unsigned fInputDurationInMicroseconds;
+    Boolean fInputNALUnitEndsAccessUnit;
+
+    // State of the aggregation packet (if any) that we're currently building in "fTo":
+    Boolean fUseAggregation;
+    unsigned fAggregationPacketSize; // 0 iff we're not building an aggregation packet
+    unsigned fNumAggregatedNALUnits;
+    struct timeval fAggregationPresentationTime;
+    unsigned fAggregationDurationInMicroseconds;
+    Boolean fAggregationEndsAccessUnit;
+    Boolean fInputSourceHasClosed; // while we were building an aggregation packet
 };
 
 
@@ -74,7 +107,7 @@ H264or5VideoRTPSink
                       u_int8_t const* sps, unsigned spsSize,
                       u_int8_t const* pps, unsigned ppsSize)
 : VideoRTPSink(env, RTPgs, rtpPayloadFormat, 90000, hNumber == 264 ? "H264" : "H265"),
-fHNumber(hNumber), fOurFragmenter(NULL), fFmtpSDPLine(NULL)
+fHNumber(hNumber), fOurFragmenter(NULL), fFmtpSDPLine(NULL), fFmtpSDPLineParameterSetsVersion(0), fUseScatterGather(False), fUseAggregation(False)
 {
     if (vps != NULL)
     {
@@ -136,6 +169,8 @@ Boolean H264or5VideoRTPSink::continuePlaying()
     {
         fOurFragmenter->reassignInputSource(fSource);
     }
+    ((H264or5Fragmenter*)fOurFragmenter)->setDeliverByReference(fUseScatterGather);
+    ((H264or5Fragmenter*)fOurFragmenter)->setUseAggregation(fUseAggregation);
     fSource = fOurFragmenter;
     
     // Then call the parent class's implementation:
@@ -151,17 +186,18 @@ void H264or5VideoRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*
     // Set the RTP 'M' (marker) bit iff
     // 1/ The most recently delivered fragment was the end of (or the only fragment of) an NAL unit, and
     // 2/ This NAL unit was the last NAL unit of an 'access unit' (i.e. video frame).
+    // (Our fragmenter records (2) for each NAL unit that it reads from its source, which
+    // relies on this source being a "H264or5VideoStreamFramer".)
     if (fOurFragmenter != NULL)
     {
-        H264or5VideoStreamFramer* framerSource = (H264or5VideoStreamFramer*)(fOurFragmenter->inputSource());
-        
-        // This relies on our fragmenter's source being a "H264or5VideoStreamFramer".
-        if (((H264or5Fragmenter*)fOurFragmenter)->lastFragmentCompletedNALUnit()
-            && framerSource != NULL && framerSource->pictureEndMarker())
+        H264or5Fragmenter* fragmenter = (H264or5Fragmenter*)fOurFragmenter;
+        if (fragmenter->fragmentPayloadSize() > 0)
         {
-            setMarkerBit();
-            framerSource->pictureEndMarker() = False;
+            // The rest of this fragment is still in the fragmenter's buffer; send it from there:
+            setExternalPayload(fragmenter->fragmentPayload(), fragmenter->fragmentPayloadSize());
         }
+
+        if (fragmenter->lastFragmentEndedAccessUnit()) setMarkerBit();
     }
     
     setTimestamp(framePresentationTime);
@@ -181,7 +217,8 @@ H264or5Fragmenter::H264or5Fragmenter(int hNumber,
                                      unsigned inputBufferMax, unsigned maxOutputPacketSize)
 : FramedFilter(env, inputSource),
 fHNumber(hNumber),
-fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize) {
+fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize),
+fDeliverByReference(False), fUseAggregation(False) {
     fInputBuffer = new unsigned char[fInputBufferSize];
     reset();
 }
@@ -195,6 +232,13 @@ void H264or5Fragmenter::doGetNextFrame()
 {
     if (fNumValidDataBytes == 1)
     {
+        if (fInputSourceHasClosed)
+        {
+            // Our source closed while we were building our last aggregation packet (which we've now delivered):
+            handleClosure();
+            return;
+        }
+
         // We have no NAL unit data currently in the buffer.  Read a new one:
         fInputSource->getNextFrame(&fInputBuffer[1], fInputBufferSize - 1,
                                    afterGettingFrame, this,
@@ -224,6 +268,15 @@ void H264or5Fragmenter::doGetNextFrame()
         }
         
         fLastFragmentCompletedNALUnit = True; // by default
+        fFragmentPayload = NULL; fFragmentPayloadSize = 0; // by default
+        unsigned const nalHeaderSize = fHNumber == 264 ? 1 : 2;
+
+        // If we're aggregating small NAL units, then try that first.  (If this NAL unit gets added to an
+        // aggregation packet, then we've either delivered that packet, or are reading another NAL unit.)
+        if (fUseAggregation && fCurDataOffset == 1 && aggregateNALUnit()) return;
+
+        fPresentationTime = fInputPresentationTime;
+        fDurationInMicroseconds = fInputDurationInMicroseconds;
         
         if (fCurDataOffset == 1)
         {   
@@ -233,8 +286,18 @@ void H264or5Fragmenter::doGetNextFrame()
             	// case 1
 				//printf("H264or5Fragmenter::%s case1\n", __FUNCTION__);
 				
-                memmove(fTo, &fInputBuffer[1], fNumValidDataBytes - 1);
-                fFrameSize = fNumValidDataBytes - 1;
+                if (fDeliverByReference && fNumValidDataBytes - 1 > nalHeaderSize)
+                {
+                    memmove(fTo, &fInputBuffer[1], nalHeaderSize);
+                    fFrameSize = nalHeaderSize;
+                    fFragmentPayload = &fInputBuffer[1 + nalHeaderSize];
+                    fFragmentPayloadSize = fNumValidDataBytes - 1 - nalHeaderSize;
+                }
+                else
+                {
+                    memmove(fTo, &fInputBuffer[1], fNumValidDataBytes - 1);
+                    fFrameSize = fNumValidDataBytes - 1;
+                }
                 fCurDataOffset = fNumValidDataBytes;
             }
             else
@@ -258,8 +321,20 @@ void H264or5Fragmenter::doGetNextFrame()
                     fInputBuffer[1] = fInputBuffer[2]; // Payload header (2nd byte)
                     fInputBuffer[2] = 0x80 | nal_unit_type; // FU header (with S bit)
                 }
-                memmove(fTo, fInputBuffer, fMaxSize);
-                fFrameSize = fMaxSize;
+                if (fDeliverByReference)
+                {
+                    // Deliver just the payload and FU headers; the NAL unit data that follows is sent from our buffer:
+                    unsigned const numHeaderBytes = nalHeaderSize + 1;
+                    memmove(fTo, fInputBuffer, numHeaderBytes);
+                    fFrameSize = numHeaderBytes;
+                    fFragmentPayload = &fInputBuffer[numHeaderBytes];
+                    fFragmentPayloadSize = fMaxSize - numHeaderBytes;
+                }
+                else
+                {
+                    memmove(fTo, fInputBuffer, fMaxSize);
+                    fFrameSize = fMaxSize;
+                }
                 fCurDataOffset += fMaxSize - 1;
                 fLastFragmentCompletedNALUnit = False;
             }
@@ -305,8 +380,18 @@ void H264or5Fragmenter::doGetNextFrame()
                 fNumTruncatedBytes = fSaveNumTruncatedBytes;
             }
             
-            memmove(fTo, &fInputBuffer[fCurDataOffset - numExtraHeaderBytes], numBytesToSend);
-            fFrameSize = numBytesToSend;
+            if (fDeliverByReference)
+            {
+                memmove(fTo, &fInputBuffer[fCurDataOffset - numExtraHeaderBytes], numExtraHeaderBytes);
+                fFrameSize = numExtraHeaderBytes;
+                fFragmentPayload = &fInputBuffer[fCurDataOffset];
+                fFragmentPayloadSize = numBytesToSend - numExtraHeaderBytes;
+            }
+            else
+            {
+                memmove(fTo, &fInputBuffer[fCurDataOffset - numExtraHeaderBytes], numBytesToSend);
+                fFrameSize = numBytesToSend;
+            }
             fCurDataOffset += numBytesToSend - numExtraHeaderBytes;
         }
         
@@ -315,6 +400,7 @@ void H264or5Fragmenter::doGetNextFrame()
             // We're done with this data.  Reset the pointers for receiving new data:
             fNumValidDataBytes = fCurDataOffset = 1;
         }
+        fLastFragmentEndedAccessUnit = fLastFragmentCompletedNALUnit && fInputNALUnitEndsAccessUnit;
         
         // Complete delivery to the client:
         FramedSource::afterGetting(this);
@@ -345,16 +431,155 @@ void H264or5Fragmenter::afterGettingFrame1(unsigned frameSize,
 {
     fNumValidDataBytes += frameSize;
     fSaveNumTruncatedBytes = numTruncatedBytes;
-    fPresentationTime = presentationTime;
-    fDurationInMicroseconds = durationInMicroseconds;
+    fInputPresentationTime = presentationTime;
+    fInputDurationInMicroseconds = durationInMicroseconds;
+
+    // Note whether this NAL unit ends an access unit, and clear our source's flag, ready for the next NAL unit.
+    // (This relies on our source being a "H264or5VideoStreamFramer".)
+    H264or5VideoStreamFramer* framerSource = (H264or5VideoStreamFramer*)fInputSource;
+    fInputNALUnitEndsAccessUnit = framerSource->pictureEndMarker();
+    framerSource->pictureEndMarker() = False;
     
     // Deliver data to the client:
     doGetNextFrame();
 }
 
+void H264or5Fragmenter::onSourceClosure(void* clientData)
+{
+    ((H264or5Fragmenter*)clientData)->onSourceClosure1();
+}
+
+void H264or5Fragmenter::onSourceClosure1()
+{
+    if (fAggregationPacketSize > 0)
+    {
+        // Deliver the aggregation packet that we'd been building, and signal closure after that:
+        fInputSourceHasClosed = True;
+        deliverAggregationPacket();
+    }
+    else
+    {
+        handleClosure();
+    }
+}
+
+Boolean H264or5Fragmenter::aggregateNALUnit()
+{
+    unsigned const nalUnitSize = fNumValidDataBytes - 1;
+    unsigned char const* nalUnit = &fInputBuffer[1];
+    unsigned const payloadHeaderSize = fHNumber == 264 ? 1 : 2; // the same size as a NAL header
+    unsigned const minNALUnitSize = payloadHeaderSize + 1;
+
+    if (fAggregationPacketSize == 0)
+    {
+        // Begin a new aggregation packet only if this NAL unit doesn't end its access unit, and if
+        // there'd be room (after it) for another small NAL unit:
+        if (fInputNALUnitEndsAccessUnit || nalUnitSize < minNALUnitSize
+            || payloadHeaderSize + 2 + nalUnitSize + 2 + minNALUnitSize > fMaxSize) return False;
+
+        // Begin the payload header with this NAL unit's header, but with the aggregation packet type:
+        if (fHNumber == 264)
+        {
+            fTo[0] = (nalUnit[0] & 0xE0) | 24; // STAP-A
+        }
+        else
+        {   // 265
+            fTo[0] = (nalUnit[0] & 0x81) | (48 << 1); // AP
+            fTo[1] = nalUnit[1];
+        }
+        fAggregationPacketSize = payloadHeaderSize;
+        fNumAggregatedNALUnits = 0;
+        fAggregationPresentationTime = fInputPresentationTime;
+        fAggregationDurationInMicroseconds = 0;
+    }
+    else if (nalUnitSize < minNALUnitSize || fAggregationPacketSize + 2 + nalUnitSize > fMaxSize
+             || fInputPresentationTime.tv_sec != fAggregationPresentationTime.tv_sec
+             || fInputPresentationTime.tv_usec != fAggregationPresentationTime.tv_usec)
+    {
+        // This NAL unit doesn't fit in (or doesn't belong in) our aggregation packet.  Deliver the packet
+        // now, leaving this NAL unit in our input buffer, to be delivered next time:
+        deliverAggregationPacket();
+        return True;
+    }
+    else
+    {
+        // Update the payload header to cover this NAL unit as well:
+        if (fHNumber == 264)
+        {
+            // The F bit is the OR of the NAL units' F bits; NRI is the maximum of their NRIs:
+            u_int8_t nri = fTo[0] & 0x60;
+            if ((nalUnit[0] & 0x60) > nri) nri = nalUnit[0] & 0x60;
+            fTo[0] = ((fTo[0] | nalUnit[0]) & 0x80) | nri | 24;
+        }
+        else
+        {   // 265
+            // The F bit is the OR of the NAL units' F bits; LayerId and TID are the minimum of theirs:
+            unsigned layerId = ((fTo[0] & 0x01) << 5) | (fTo[1] >> 3);
+            unsigned tid = fTo[1] & 0x07;
+            unsigned nalLayerId = ((nalUnit[0] & 0x01) << 5) | (nalUnit[1] >> 3);
+            if (nalLayerId < layerId) layerId = nalLayerId;
+            if ((unsigned)(nalUnit[1] & 0x07) < tid) tid = nalUnit[1] & 0x07;
+            fTo[0] = ((fTo[0] | nalUnit[0]) & 0x80) | (48 << 1) | (layerId >> 5);
+            fTo[1] = ((layerId & 0x1F) << 3) | tid;
+        }
+    }
+
+    // Append this NAL unit (preceded by its 2-byte size) to the aggregation packet:
+    fTo[fAggregationPacketSize++] = nalUnitSize >> 8;
+    fTo[fAggregationPacketSize++] = nalUnitSize;
+    memmove(&fTo[fAggregationPacketSize], nalUnit, nalUnitSize);
+    fAggregationPacketSize += nalUnitSize;
+    ++fNumAggregatedNALUnits;
+    fAggregationDurationInMicroseconds += fInputDurationInMicroseconds;
+    fAggregationEndsAccessUnit = fInputNALUnitEndsAccessUnit;
+    fNumValidDataBytes = fCurDataOffset = 1;
+
+    if (!fAggregationEndsAccessUnit && fAggregationPacketSize + 2 + minNALUnitSize <= fMaxSize)
+    {
+        // There's room for more.  Read the next NAL unit:
+        fInputSource->getNextFrame(&fInputBuffer[1], fInputBufferSize - 1,
+                                   afterGettingFrame, this,
+                                   onSourceClosure, this);
+    }
+    else
+    {
+        deliverAggregationPacket();
+    }
+    return True;
+}
+
+void H264or5Fragmenter::deliverAggregationPacket()
+{
+    if (fNumAggregatedNALUnits == 1)
+    {
+        // There's no point in aggregating just one NAL unit; deliver it by itself instead:
+        unsigned const headerSize = (fHNumber == 264 ? 1 : 2) + 2;
+        memmove(fTo, &fTo[headerSize], fAggregationPacketSize - headerSize);
+        fFrameSize = fAggregationPacketSize - headerSize;
+    }
+    else
+    {
+        fFrameSize = fAggregationPacketSize;
+    }
+    fPresentationTime = fAggregationPresentationTime;
+    fDurationInMicroseconds = fAggregationDurationInMicroseconds;
+    fLastFragmentCompletedNALUnit = True;
+    fLastFragmentEndedAccessUnit = fAggregationEndsAccessUnit;
+    fFragmentPayload = NULL; fFragmentPayloadSize = 0;
+    fAggregationPacketSize = 0;
+
+    // Complete delivery to the client:
+    FramedSource::afterGetting(this);
+}
+
 void H264or5Fragmenter::reset()
 {
     fNumValidDataBytes = fCurDataOffset = 1;
     fSaveNumTruncatedBytes = 0;
     fLastFragmentCompletedNALUnit = True;
+    fLastFragmentEndedAccessUnit = False;
+    fFragmentPayload = NULL; fFragmentPayloadSize = 0;
+    fInputNALUnitEndsAccessUnit = False;
+    fAggregationPacketSize = 0;
+    fInputSourceHasClosed = False;
 }
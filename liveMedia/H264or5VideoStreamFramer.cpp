@@ -51,9 +51,9 @@ private:
 
   void analyze_video_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale);
   void analyze_seq_parameter_set_data(unsigned& num_units_in_tick, unsigned& time_scale);
-  void profile_tier_level(BitVector& bv, unsigned max_sub_layers_minus1);
-  void analyze_vui_parameters(BitVector& bv, unsigned& num_units_in_tick, unsigned& time_scale);
-  void analyze_hrd_parameters(BitVector& bv);
+  void profile_tier_level(BitReader& bv, unsigned max_sub_layers_minus1);
+  void analyze_vui_parameters(BitReader& bv, unsigned& num_units_in_tick, unsigned& time_scale);
+  void analyze_hrd_parameters(BitReader& bv);
   void analyze_sei_data(u_int8_t nal_unit_type);
   void analyze_sei_payload(unsigned payloadType, unsigned payloadSize, u_int8_t* payload);
 
@@ -61,6 +61,7 @@ private:
   int fHNumber; // 264 or 265
   unsigned fOutputStartCodeSize;
   Boolean fHaveSeenFirstStartCode, fHaveSeenFirstByteOfNALUnit;
+  Boolean fHaveAnalyzedVPS, fHaveAnalyzedSPS;
   u_int8_t fFirstByteOfNALUnit;
   double fParsedFrameRate;
   // variables set & used in the specification:
@@ -72,56 +73,80 @@ private:
 
 ////////// H264or5VideoStreamFramer implementation //////////
 
+#ifndef H264_OR_5_ACCESS_UNIT_BUFFER_INITIAL_SIZE
+#define H264_OR_5_ACCESS_UNIT_BUFFER_INITIAL_SIZE 300000 // used only if the input is 'access unit delimited'; grows if needed
+#endif
+
 H264or5VideoStreamFramer
 ::H264or5VideoStreamFramer(int hNumber, UsageEnvironment& env, FramedSource* inputSource,
-			   Boolean createParser, Boolean includeStartCodeInOutput)
+			   Boolean createParser, Boolean includeStartCodeInOutput,
+			   Boolean inputIsAccessUnitDelimited)
   : MPEGVideoStreamFramer(env, inputSource),
     fHNumber(hNumber),
     fLastSeenVPS(NULL), fLastSeenVPSSize(0),
     fLastSeenSPS(NULL), fLastSeenSPSSize(0),
-    fLastSeenPPS(NULL), fLastSeenPPSSize(0) {
-  fParser = createParser
+    fLastSeenPPS(NULL), fLastSeenPPSSize(0), fParameterSetsVersion(0),
+    fInputIsAccessUnitDelimited(inputIsAccessUnitDelimited), fOutputStartCodeSize(includeStartCodeInOutput ? 4 : 0),
+    fAccessUnitBuffer(NULL), fAccessUnitBufferSize(0), fNextNALUnit(NULL), fAccessUnitEnd(NULL),
+    fAccessUnitDurationInMicroseconds(0) {
+  fParser = createParser && !inputIsAccessUnitDelimited
     ? new H264or5VideoStreamParser(hNumber, this, inputSource, includeStartCodeInOutput)
     : NULL;
+  if (inputIsAccessUnitDelimited) {
+    fAccessUnitBufferSize = H264_OR_5_ACCESS_UNIT_BUFFER_INITIAL_SIZE;
+    fAccessUnitBuffer = new unsigned char[fAccessUnitBufferSize];
+  }
   fNextPresentationTime = fPresentationTimeBase;
   fFrameRate = 25.0; // We assume a frame rate of 25 fps, unless we learn otherwise (from parsing a VPS or SPS NAL unit)
 }
 
 H264or5VideoStreamFramer::~H264or5VideoStreamFramer() {
+  delete[] fAccessUnitBuffer;
   delete[] fLastSeenPPS;
   delete[] fLastSeenSPS;
   delete[] fLastSeenVPS;
 }
 
+static unsigned parameterSetsVersionCounter = 0; // shared by all framers, so that each version number is unique
+
+static Boolean saveCopyOfNALUnit(u_int8_t*& savedCopy, unsigned& savedCopySize, u_int8_t* from, unsigned size) {
+  // Returns True iff the saved copy changed:
+  if (from == NULL) return False;
+  if (savedCopy != NULL && size == savedCopySize && memcmp(savedCopy, from, size) == 0) return False; // unchanged
+
+  if (savedCopy == NULL || size != savedCopySize) {
+    delete[] savedCopy;
+    savedCopy = new u_int8_t[size];
+  }
+  memmove(savedCopy, from, size);
+
+  savedCopySize = size;
+  return True;
+}
+
 #define VPS_MAX_SIZE 1000 // larger than the largest possible VPS (Video Parameter Set) NAL unit
 
-void H264or5VideoStreamFramer::saveCopyOfVPS(u_int8_t* from, unsigned size) {
-  if (from == NULL) return;
-  delete[] fLastSeenVPS;
-  fLastSeenVPS = new u_int8_t[size];
-  memmove(fLastSeenVPS, from, size);
+Boolean H264or5VideoStreamFramer::saveCopyOfVPS(u_int8_t* from, unsigned size) {
+  if (!saveCopyOfNALUnit(fLastSeenVPS, fLastSeenVPSSize, from, size)) return False;
 
-  fLastSeenVPSSize = size;
+  fParameterSetsVersion = ++parameterSetsVersionCounter;
+  return True;
 }
 
 #define SPS_MAX_SIZE 1000 // larger than the largest possible SPS (Sequence Parameter Set) NAL unit
 
-void H264or5VideoStreamFramer::saveCopyOfSPS(u_int8_t* from, unsigned size) {
-  if (from == NULL) return;
-  delete[] fLastSeenSPS;
-  fLastSeenSPS = new u_int8_t[size];
-  memmove(fLastSeenSPS, from, size);
+Boolean H264or5VideoStreamFramer::saveCopyOfSPS(u_int8_t* from, unsigned size) {
+  if (!saveCopyOfNALUnit(fLastSeenSPS, fLastSeenSPSSize, from, size)) return False;
 
-  fLastSeenSPSSize = size;
+  fParameterSetsVersion = ++parameterSetsVersionCounter;
+  return True;
 }
 
-void H264or5VideoStreamFramer::saveCopyOfPPS(u_int8_t* from, unsigned size) {
-  if (from == NULL) return;
-  delete[] fLastSeenPPS;
-  fLastSeenPPS = new u_int8_t[size];
-  memmove(fLastSeenPPS, from, size);
+Boolean H264or5VideoStreamFramer::saveCopyOfPPS(u_int8_t* from, unsigned size) {
+  if (!saveCopyOfNALUnit(fLastSeenPPS, fLastSeenPPSSize, from, size)) return False;
 
-  fLastSeenPPSSize = size;
+  fParameterSetsVersion = ++parameterSetsVersionCounter;
+  return True;
 }
 
 Boolean H264or5VideoStreamFramer::isVPS(u_int8_t nal_unit_type) {
@@ -143,6 +168,130 @@ Boolean H264or5VideoStreamFramer::isVCL(u_int8_t nal_unit_type) {
     : (nal_unit_type <= 31);
 }
 
+void H264or5VideoStreamFramer::doGetNextFrame() {
+  if (!fInputIsAccessUnitDelimited) {
+    // Normal case: Parse the input stream:
+    MPEGVideoStreamFramer::doGetNextFrame();
+  } else if (fNextNALUnit < fAccessUnitEnd) {
+    // We still have NAL unit(s) from the most recently read 'access unit':
+    deliverNALUnitFromAccessUnit();
+  } else {
+    // Read the next 'access unit':
+    fInputSource->getNextFrame(fAccessUnitBuffer, fAccessUnitBufferSize,
+			       afterGettingAccessUnit, this,
+			       FramedSource::handleClosure, this);
+  }
+}
+
+void H264or5VideoStreamFramer::doStopGettingFrames() {
+  fNextNALUnit = fAccessUnitEnd = NULL; // discard any undelivered NAL units
+  MPEGVideoStreamFramer::doStopGettingFrames();
+}
+
+void H264or5VideoStreamFramer
+::afterGettingAccessUnit(void* clientData, unsigned frameSize,
+			 unsigned numTruncatedBytes,
+			 struct timeval presentationTime,
+			 unsigned durationInMicroseconds) {
+  H264or5VideoStreamFramer* source = (H264or5VideoStreamFramer*)clientData;
+  source->afterGettingAccessUnit1(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void H264or5VideoStreamFramer
+::afterGettingAccessUnit1(unsigned frameSize, unsigned numTruncatedBytes,
+			  struct timeval presentationTime,
+			  unsigned durationInMicroseconds) {
+  if (numTruncatedBytes > 0) {
+    // Our buffer was too small for this 'access unit'.  We can't recover the truncated data, but enlarge the buffer,
+    // so that this doesn't happen again:
+    envir() << "H264or5VideoStreamFramer: Input 'access unit' (of size " << frameSize + numTruncatedBytes
+	    << " bytes) was truncated; enlarging our buffer\n";
+    unsigned newBufferSize = 2*(frameSize + numTruncatedBytes);
+    unsigned char* newBuffer = new unsigned char[newBufferSize];
+    memmove(newBuffer, fAccessUnitBuffer, frameSize);
+    delete[] fAccessUnitBuffer;
+    fAccessUnitBuffer = newBuffer;
+    fAccessUnitBufferSize = newBufferSize;
+  }
+
+  fAccessUnitPresentationTime = presentationTime;
+  fAccessUnitDurationInMicroseconds = durationInMicroseconds;
+  fAccessUnitEnd = &fAccessUnitBuffer[frameSize];
+
+  // Skip over any data that precedes the first start code:
+  unsigned char* firstStartCode = findTwoZerosAndByte(fAccessUnitBuffer, fAccessUnitEnd, 0x01, 0x01);
+  fNextNALUnit = firstStartCode == NULL ? fAccessUnitEnd : skipStartCodes(firstStartCode);
+
+  if (fNextNALUnit < fAccessUnitEnd) {
+    deliverNALUnitFromAccessUnit();
+  } else {
+    // This 'access unit' contained no NAL units, so try again:
+    doGetNextFrame();
+  }
+}
+
+unsigned char* H264or5VideoStreamFramer::skipStartCodes(unsigned char* ptr) {
+  // "ptr" points to a 0x000001 start code.  Skip over it - and any (0x00000001 or 0x000001) start codes that
+  // immediately follow it - returning a pointer to the start of the next (non-empty) NAL unit, or "fAccessUnitEnd":
+  ptr += 3;
+  while (1) {
+    if (fAccessUnitEnd - ptr >= 3 && ptr[0] == 0 && ptr[1] == 0 && ptr[2] == 1) {
+      ptr += 3;
+    } else if (fAccessUnitEnd - ptr >= 4 && ptr[0] == 0 && ptr[1] == 0 && ptr[2] == 0 && ptr[3] == 1) {
+      ptr += 4;
+    } else {
+      break;
+    }
+  }
+  return ptr;
+}
+
+void H264or5VideoStreamFramer::deliverNALUnitFromAccessUnit() {
+  // The NAL unit ends at the next 0x00000001 or 0x000001 start code (or at the end of the 'access unit'):
+  unsigned char* nalUnit = fNextNALUnit;
+  unsigned char* nalUnitEnd = findTwoZerosAndByte(nalUnit, fAccessUnitEnd, 0x01, 0x01);
+  if (nalUnitEnd == NULL) {
+    nalUnitEnd = fNextNALUnit = fAccessUnitEnd;
+  } else {
+    fNextNALUnit = skipStartCodes(nalUnitEnd);
+    if (nalUnitEnd[-1] == 0) --nalUnitEnd; // the start code is 0x00000001
+  }
+  unsigned nalUnitSize = nalUnitEnd - nalUnit;
+
+  // Save a copy of this NAL unit if it's a parameter set, in case the downstream object wants to see it.
+  // (Unlike when parsing the input stream, we don't analyze parameter sets or SEIs, because we already know
+  // each 'access unit''s presentation time.)
+  u_int8_t nal_unit_type = fHNumber == 264 ? nalUnit[0]&0x1F : (nalUnit[0]&0x7E)>>1;
+  if (isVPS(nal_unit_type)) {
+    saveCopyOfVPS(nalUnit, nalUnitSize);
+  } else if (isSPS(nal_unit_type)) {
+    saveCopyOfSPS(nalUnit, nalUnitSize);
+  } else if (isPPS(nal_unit_type)) {
+    saveCopyOfPPS(nalUnit, nalUnitSize);
+  }
+
+  fFrameSize = fNumTruncatedBytes = 0;
+  if (fOutputStartCodeSize > 0 && fMaxSize >= fOutputStartCodeSize) {
+    // Include a start code in the output:
+    fTo[0] = fTo[1] = fTo[2] = 0; fTo[3] = 1;
+    fFrameSize = fOutputStartCodeSize;
+  }
+  if (nalUnitSize > fMaxSize - fFrameSize) {
+    fNumTruncatedBytes = nalUnitSize - (fMaxSize - fFrameSize);
+    nalUnitSize = fMaxSize - fFrameSize;
+  }
+  memmove(&fTo[fFrameSize], nalUnit, nalUnitSize);
+  fFrameSize += nalUnitSize;
+
+  // The last NAL unit in the 'access unit' ends it:
+  fPictureEndMarker = fNextNALUnit >= fAccessUnitEnd;
+  fPresentationTime = fAccessUnitPresentationTime;
+  fDurationInMicroseconds = fPictureEndMarker ? fAccessUnitDurationInMicroseconds : 0;
+
+  // Complete delivery to the client.  (Because we're not a 'leaf' source, we can call this directly.)
+  afterGetting(this);
+}
+
 
 ////////// H264or5VideoStreamParser implementation //////////
 
@@ -150,7 +299,8 @@ H264or5VideoStreamParser
 ::H264or5VideoStreamParser(int hNumber, H264or5VideoStreamFramer* usingSource,
 			   FramedSource* inputSource, Boolean includeStartCodeInOutput)
   : MPEGVideoStreamParser(usingSource, inputSource),
-    fHNumber(hNumber), fOutputStartCodeSize(includeStartCodeInOutput ? 4 : 0), fHaveSeenFirstStartCode(False), fHaveSeenFirstByteOfNALUnit(False), fParsedFrameRate(0.0),
+    fHNumber(hNumber), fOutputStartCodeSize(includeStartCodeInOutput ? 4 : 0), fHaveSeenFirstStartCode(False), fHaveSeenFirstByteOfNALUnit(False),
+    fHaveAnalyzedVPS(False), fHaveAnalyzedSPS(False), fParsedFrameRate(0.0),
     cpb_removal_delay_length_minus1(23), dpb_output_delay_length_minus1(23),
     CpbDpbDelaysPresentFlag(0), pic_struct_present_flag(0),
     DeltaTfiDivisor(2.0) {
@@ -311,7 +461,7 @@ public:
 #define DEBUG_TAB do {} while (0)
 #endif
 
-void H264or5VideoStreamParser::profile_tier_level(BitVector& bv, unsigned max_sub_layers_minus1) {
+void H264or5VideoStreamParser::profile_tier_level(BitReader& bv, unsigned max_sub_layers_minus1) {
   bv.skipBits(96);
 
   unsigned i;
@@ -334,7 +484,7 @@ void H264or5VideoStreamParser::profile_tier_level(BitVector& bv, unsigned max_su
 }
 
 void H264or5VideoStreamParser
-::analyze_vui_parameters(BitVector& bv,
+::analyze_vui_parameters(BitReader& bv,
 			 unsigned& num_units_in_tick, unsigned& time_scale) {
   Boolean aspect_ratio_info_present_flag = bv.get1BitBoolean();
   DEBUG_PRINT(aspect_ratio_info_present_flag);
@@ -418,7 +568,7 @@ void H264or5VideoStreamParser
   DEBUG_PRINT(pic_struct_present_flag);
 }
 
-void H264or5VideoStreamParser::analyze_hrd_parameters(BitVector& bv) {
+void H264or5VideoStreamParser::analyze_hrd_parameters(BitReader& bv) {
   DEBUG_TAB;
   unsigned cpb_cnt_minus1 = bv.get_expGolomb();
   DEBUG_PRINT(cpb_cnt_minus1);
@@ -455,7 +605,7 @@ void H264or5VideoStreamParser
   unsigned vpsSize;
   removeEmulationBytes(vps, sizeof vps, vpsSize);
 
-  BitVector bv(vps, 0, 8*vpsSize);
+  BitReader bv(vps, 0, 8*vpsSize);
 
   // Assert: fHNumber == 265 (because this function is called only when parsing H.265)
   unsigned i;
@@ -508,7 +658,7 @@ void H264or5VideoStreamParser
   unsigned spsSize;
   removeEmulationBytes(sps, sizeof sps, spsSize);
 
-  BitVector bv(sps, 0, 8*spsSize);
+  BitReader bv(sps, 0, 8*spsSize);
 
   if (fHNumber == 264) {
     bv.skipBits(8); // forbidden_zero_bit; nal_ref_idc; nal_unit_type
@@ -885,7 +1035,7 @@ void H264or5VideoStreamParser::analyze_sei_data(u_int8_t nal_unit_type) {
 void H264or5VideoStreamParser
 ::analyze_sei_payload(unsigned payloadType, unsigned payloadSize, u_int8_t* payload) {
   if (payloadType == 1/* pic_timing, for both H.264 and H.265 */) {
-    BitVector bv(payload, 0, 8*payloadSize);
+    BitReader bv(payload, 0, 8*payloadSize);
 
     DEBUG_TAB;
     if (CpbDpbDelaysPresentFlag) {
@@ -1002,20 +1152,33 @@ unsigned H264or5VideoStreamParser::parse() {
 	fFirstByteOfNALUnit = next4Bytes>>24;
 	fHaveSeenFirstByteOfNALUnit = True;
       }
-      while (next4Bytes != 0x00000001 && (next4Bytes&0xFFFFFF00) != 0x00000100) {
-	// We save at least some of "next4Bytes".
-	if ((unsigned)(next4Bytes&0xFF) > 1) {
-	  // Common case: 0x00000001 or 0x000001 definitely doesn't begin anywhere in "next4Bytes", so we save all of it:
-	  save4Bytes(next4Bytes);
-	  skipBytes(4);
+      while (1) {
+	// Scan the data that we've already read for the next start code, and save everything before it in bulk:
+	unsigned char* ptr = nextToParse();
+	unsigned const numBytesAvailable = numBufferedBytes();
+	unsigned char* startCode = findStartCode(ptr, ptr + numBytesAvailable);
+	unsigned numBytesToSave;
+	if (startCode != NULL) {
+	  numBytesToSave = startCode - ptr;
+	  if (numBytesToSave > 0 && startCode[-1] == 0) {
+	    --numBytesToSave; // the start code is 0x00000001
+	  } else if (numBytesToSave + 4 > numBytesAvailable) {
+	    // We can't yet tell whether this 0x000001 (at the very end of the data) begins a 0x00000001,
+	    // so save only the bytes before it, and read more data:
+	    startCode = NULL;
+	  }
 	} else {
-	  // Save the first byte, and continue testing the rest:
-	  saveByte(next4Bytes>>24);
-	  skipBytes(1);
+	  // Any of the last 3 bytes might begin a start code, so save only the bytes before them:
+	  numBytesToSave = numBytesAvailable > 3 ? numBytesAvailable - 3 : 0;
 	}
+	saveBytes(ptr, numBytesToSave);
+	skipBytes(numBytesToSave);
+	if (startCode != NULL) break;
+
 	setParseState(); // ensures forward progress
-	next4Bytes = test4Bytes();
+	(void)test4Bytes(); // causes more data to be read
       }
+      next4Bytes = test4Bytes();
       // Assert: next4Bytes starts with 0x00000001 or 0x000001, and we've saved all previous bytes (forming a complete NAL unit).
       // Skip over these remaining bytes, up until the start of the next NAL unit:
       if (next4Bytes == 0x00000001) {
@@ -1044,12 +1207,15 @@ unsigned H264or5VideoStreamParser::parse() {
 
     // Now that we have found (& copied) a NAL unit, process it if it's of special interest to us:
     if (isVPS(nal_unit_type)) { // Video parameter set
-      // First, save a copy of this NAL unit, in case the downstream object wants to see it:
-      usingSource()->saveCopyOfVPS(fStartOfFrame + fOutputStartCodeSize, curFrameSize() - fOutputStartCodeSize);
+      // First, save a copy of this NAL unit, in case the downstream object wants to see it.
+      // (Encoders often repeat parameter sets before each IDR picture; we note whether this one has changed.)
+      Boolean isVPSNew = usingSource()->saveCopyOfVPS(fStartOfFrame + fOutputStartCodeSize, curFrameSize() - fOutputStartCodeSize)
+	|| !fHaveAnalyzedVPS;
 
-      if (fParsedFrameRate == 0.0) {
-	// We haven't yet parsed a frame rate from the stream.
+      if (fParsedFrameRate == 0.0 && isVPSNew) {
+	// We haven't yet parsed a frame rate from the stream (and haven't already analyzed this same NAL unit).
 	// So parse this NAL unit to check whether frame rate information is present:
+	fHaveAnalyzedVPS = True;
 	unsigned num_units_in_tick, time_scale;
 	analyze_video_parameter_set_data(num_units_in_tick, time_scale);
 	if (time_scale > 0 && num_units_in_tick > 0) {
@@ -1065,12 +1231,14 @@ unsigned H264or5VideoStreamParser::parse() {
 	}
       }
     } else if (isSPS(nal_unit_type)) { // Sequence parameter set
-      // First, save a copy of this NAL unit, in case the downstream object wants to see it:
-      usingSource()->saveCopyOfSPS(fStartOfFrame + fOutputStartCodeSize, curFrameSize() - fOutputStartCodeSize);
+      // First, save a copy of this NAL unit (noting whether it has changed), in case the downstream object wants to see it:
+      Boolean isSPSNew = usingSource()->saveCopyOfSPS(fStartOfFrame + fOutputStartCodeSize, curFrameSize() - fOutputStartCodeSize)
+	|| !fHaveAnalyzedSPS;
 
-      if (fParsedFrameRate == 0.0) {
+      if (fParsedFrameRate == 0.0 && isSPSNew) {
 	// We haven't yet parsed a frame rate from the stream.
 	// So parse this NAL unit to check whether frame rate information is present:
+	fHaveAnalyzedSPS = True;
 	unsigned num_units_in_tick, time_scale;
 	analyze_seq_parameter_set_data(num_units_in_tick, time_scale);
 	if (time_scale > 0 && num_units_in_tick > 0) {
@@ -1165,16 +1333,47 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
   unsigned toSize = 0;
   unsigned i = 0;
   while (i < fromSize && toSize+1 < toMaxSize) {
-    if (i+2 < fromSize && from[i] == 0 && from[i+1] == 0 && from[i+2] == 3) {
+    // Copy - in bulk - everything up until the next 0x000003 (or the end of the data):
+    u_int8_t* emulationSequence = findTwoZerosAndByte(&from[i], &from[fromSize], 0x03, 0x03);
+    unsigned numBytesToCopy = (emulationSequence == NULL ? fromSize : (unsigned)(emulationSequence - from)) - i;
+    if (numBytesToCopy > toMaxSize-1 - toSize) numBytesToCopy = toMaxSize-1 - toSize;
+    memmove(&to[toSize], &from[i], numBytesToCopy);
+    toSize += numBytesToCopy;
+    i += numBytesToCopy;
+
+    if (&from[i] == emulationSequence && toSize+1 < toMaxSize) {
+      // Copy the 0x0000, but not the 0x03:
       to[toSize] = to[toSize+1] = 0;
       toSize += 2;
       i += 3;
-    } else {
-      to[toSize] = from[i];
-      toSize += 1;
-      i += 1;
     }
   }
 
   return toSize;
 }
+
+unsigned addH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
+				  u_int8_t* from, unsigned fromSize) {
+  unsigned toSize = 0;
+  unsigned i = 0;
+  while (i < fromSize) {
+    // Copy - in bulk - everything up until (and including) the next 0x0000 that's followed by 0x00, 0x01, 0x02 or 0x03:
+    u_int8_t* zeros = findTwoZerosAndByte(&from[i], &from[fromSize], 0x00, 0x03);
+    unsigned numBytesToCopy = (zeros == NULL ? fromSize : (unsigned)(zeros - from) + 2) - i;
+    if (numBytesToCopy > toMaxSize - toSize) numBytesToCopy = toMaxSize - toSize;
+    memmove(&to[toSize], &from[i], numBytesToCopy);
+    toSize += numBytesToCopy;
+    i += numBytesToCopy;
+    if (i < fromSize && &from[i] != zeros + 2) return toSize; // there was no room to copy everything
+    if (zeros == NULL) break;
+
+    // Follow the 0x0000 with an emulation byte:
+    if (toSize == toMaxSize) return toSize;
+    to[toSize++] = 0x03;
+  }
+
+  // If the data ends with 0x00, then it also needs a final emulation byte (so that it can't be confused with a start code):
+  if (fromSize > 0 && from[fromSize-1] == 0 && toSize < toMaxSize) to[toSize++] = 0x03;
+
+  return toSize;
+}
@@ -101,9 +101,9 @@ Boolean H265VideoRTPSink::sourceIsCompatibleWithUs(MediaSource& source) {
 }
 
 char const* H265VideoRTPSink::auxSDPLine() {
-  // Generate a new "a=fmtp:" line each time, using our VPS, SPS and PPS (if we have them),
-  // otherwise parameters from our framer source (in case they've changed since the last time that
-  // we were called):
+  // Generate a new "a=fmtp:" line, using our VPS, SPS and PPS (if we have them),
+  // otherwise parameters from our framer source - but only if they've changed since the last time that
+  // we generated one:
   H264or5VideoStreamFramer* framerSource = NULL;
   u_int8_t* vps = fVPS; unsigned vpsSize = fVPSSize;
   u_int8_t* sps = fSPS; unsigned spsSize = fSPSSize;
@@ -113,11 +113,16 @@ char const* H265VideoRTPSink::auxSDPLine() {
     if (fOurFragmenter == NULL) return NULL; // we don't yet have a fragmenter (and therefore not a source)
     framerSource = (H264or5VideoStreamFramer*)(fOurFragmenter->inputSource());
     if (framerSource == NULL) return NULL; // we don't yet have a source
+    if (fFmtpSDPLine != NULL && framerSource->parameterSetsVersion() == fFmtpSDPLineParameterSetsVersion) {
+      return fFmtpSDPLine; // our source's VPS, SPS and PPS haven't changed
+    }
 
     framerSource->getVPSandSPSandPPS(vps, vpsSize, sps, spsSize, pps, ppsSize);
     if (vps == NULL || sps == NULL || pps == NULL) {
       return NULL; // our source isn't ready
     }
+  } else if (fFmtpSDPLine != NULL) {
+    return fFmtpSDPLine; // our own VPS, SPS and PPS never change
   }
 
   // Set up the "a=fmtp:" SDP line for this stream.
@@ -178,5 +183,6 @@ char const* H265VideoRTPSink::auxSDPLine() {
   delete[] sprop_pps;
 
   delete[] fFmtpSDPLine; fFmtpSDPLine = fmtp;
+  fFmtpSDPLineParameterSetsVersion = framerSource == NULL ? 0 : framerSource->parameterSetsVersion();
   return fFmtpSDPLine;
 }
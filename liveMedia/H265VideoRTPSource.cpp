@@ -200,7 +200,7 @@ unsigned H265BufferedPacket
     // The next 2 bytes are the NAL unit size:
     if (dataSize < 2) break;
     resultNALUSize = (framePtr[0]<<8)|framePtr[1];
-    framePtr += 2;
+    framePtr += 2; dataSize -= 2;
     break;
   }
   default: {
@@ -209,6 +209,7 @@ unsigned H265BufferedPacket
   }
   }
 
+  // (Don't let a bad NALU size take us beyond the end of the packet:)
   return (resultNALUSize <= dataSize) ? resultNALUSize : dataSize;
 }
 
@@ -21,13 +21,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H265VideoStreamFramer.hh"
 
 H265VideoStreamFramer* H265VideoStreamFramer
-::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean includeStartCodeInOutput) {
-  return new H265VideoStreamFramer(env, inputSource, True, includeStartCodeInOutput);
+::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean includeStartCodeInOutput,
+	    Boolean inputIsAccessUnitDelimited) {
+  return new H265VideoStreamFramer(env, inputSource, !inputIsAccessUnitDelimited/*createParser*/, includeStartCodeInOutput,
+				   inputIsAccessUnitDelimited);
 }
 
 H265VideoStreamFramer
-::H265VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource, Boolean createParser, Boolean includeStartCodeInOutput)
-  : H264or5VideoStreamFramer(265, env, inputSource, createParser, includeStartCodeInOutput) {
+::H265VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource, Boolean createParser, Boolean includeStartCodeInOutput,
+			Boolean inputIsAccessUnitDelimited)
+  : H264or5VideoStreamFramer(265, env, inputSource, createParser, includeStartCodeInOutput, inputIsAccessUnitDelimited) {
 }
 
 H265VideoStreamFramer::~H265VideoStreamFramer() {
@@ -0,0 +1,102 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// An RTP sink that sends the pre-built packet payloads read (by a "RTPHintFileSource") from an
+// 'RTP hint' file - with its own SSRC, sequence numbers and timestamps.
+// Implementation
+
+#include "HintedRTPSink.hh"
+
+HintedRTPSink* HintedRTPSink
+::createNew(UsageEnvironment& env, Groupsock* RTPgs,
+	    RTPHintFileSource const& hintFileSource, unsigned char rtpPayloadTypeIfDynamic) {
+  unsigned char rtpPayloadType = hintFileSource.rtpPayloadType();
+  if (rtpPayloadType >= 96) rtpPayloadType = rtpPayloadTypeIfDynamic;
+
+  return new HintedRTPSink(env, RTPgs, rtpPayloadType, hintFileSource);
+}
+
+HintedRTPSink
+::HintedRTPSink(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadType,
+		RTPHintFileSource const& hintFileSource)
+  : MultiFramedRTPSink(env, RTPgs, rtpPayloadType,
+		       hintFileSource.rtpTimestampFrequency(), hintFileSource.rtpPayloadFormatName(),
+		       hintFileSource.numChannels()),
+    fSDPMediaType(strDup(hintFileSource.sdpMediaType())), fAuxSDPLine(NULL) {
+  char const* auxSDPLine = hintFileSource.auxSDPLine();
+  if (auxSDPLine != NULL) {
+    // The file's SDP line(s) name the payload type that was used when it was made; substitute our own:
+    unsigned fileRTPPayloadType = hintFileSource.rtpPayloadType();
+    char prefix[20], ourPrefix[20];
+    sprintf(prefix, ":%u ", fileRTPPayloadType);
+    sprintf(ourPrefix, ":%u ", rtpPayloadType);
+    unsigned prefixLen = strlen(prefix), ourPrefixLen = strlen(ourPrefix);
+
+    unsigned numOccurrences = 0;
+    for (char const* p = strstr(auxSDPLine, prefix); p != NULL; p = strstr(p + prefixLen, prefix)) ++numOccurrences;
+    fAuxSDPLine = new char[strlen(auxSDPLine) + numOccurrences*ourPrefixLen + 1];
+
+    char* to = fAuxSDPLine;
+    char const* from = auxSDPLine;
+    for (char const* p = strstr(from, prefix); p != NULL; p = strstr(from, prefix)) {
+      memmove(to, from, p - from); to += p - from;
+      memmove(to, ourPrefix, ourPrefixLen); to += ourPrefixLen;
+      from = p + prefixLen;
+    }
+    strcpy(to, from);
+  }
+}
+
+HintedRTPSink::~HintedRTPSink() {
+  delete[] fSDPMediaType;
+  delete[] fAuxSDPLine;
+}
+
+Boolean HintedRTPSink::continuePlaying() {
+  // Have our source leave each payload in its buffer, so that we can send it from there, without copying it:
+  ((RTPHintFileSource*)fSource)->setDeliverByReference(True);
+
+  return MultiFramedRTPSink::continuePlaying();
+}
+
+void HintedRTPSink::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
+					   unsigned char* /*frameStart*/,
+					   unsigned /*numBytesInFrame*/,
+					   struct timeval framePresentationTime,
+					   unsigned /*numRemainingBytes*/) {
+  RTPHintFileSource* hintFileSource = (RTPHintFileSource*)fSource;
+  if (hintFileSource->curPayloadSize() > 0) {
+    setExternalPayload(hintFileSource->curPayload(), hintFileSource->curPayloadSize());
+  }
+  if (hintFileSource->curPacketHasMarkerBit()) setMarkerBit();
+
+  setTimestamp(framePresentationTime);
+}
+
+Boolean HintedRTPSink
+::frameCanAppearAfterPacketStart(unsigned char const* /*frameStart*/,
+				 unsigned /*numBytesInFrame*/) const {
+  return False; // each of our source's 'frames' is a complete packet payload
+}
+
+char const* HintedRTPSink::sdpMediaType() const {
+  return fSDPMediaType;
+}
+
+char const* HintedRTPSink::auxSDPLine() {
+  return fAuxSDPLine;
+}
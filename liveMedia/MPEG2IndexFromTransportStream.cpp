@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MPEG2IndexFromTransportStream.hh"
+#include "MPEG2TransportStreamPSIParser.hh"
 
 ////////// IndexRecord definition //////////
 
@@ -46,7 +47,7 @@ enum RecordType {
 class IndexRecord {
 public:
   IndexRecord(u_int8_t startOffset, u_int8_t size,
-	      unsigned long transportPacketNumber, float pcr);
+	      unsigned long transportPacketNumber, float pcr, u_int32_t pcrCount);
   virtual ~IndexRecord();
 
   RecordType& recordType() { return fRecordType; }
@@ -54,6 +55,7 @@ public:
   u_int8_t startOffset() const { return fStartOffset; }
   u_int8_t& size() { return fSize; }
   float pcr() const { return fPCR; }
+  u_int32_t pcrCount() const { return fPCRCount; }
   unsigned long transportPacketNumber() const { return fTransportPacketNumber; }
 
   IndexRecord* next() const { return fNext; }
@@ -70,6 +72,7 @@ private:
   u_int8_t fSize; // in bytes, following "fStartOffset".
   // Note: fStartOffset + fSize <= TRANSPORT_PACKET_SIZE
   float fPCR;
+  u_int32_t fPCRCount; // the number of PCRs that had been seen (by the parser) when we were made
   unsigned long fTransportPacketNumber;
 };
 
@@ -112,56 +115,40 @@ MPEG2IFrameIndexFromTransportStream::createNew(UsageEnvironment& env,
   return new MPEG2IFrameIndexFromTransportStream(env, inputSource);
 }
 
-// The largest expected frame size (in bytes):
-#define MAX_FRAME_SIZE 400000
-
-// Make our parse buffer twice as large as this, to ensure that at least one
-// complete frame will fit inside it:
-#define PARSE_BUFFER_SIZE (2*MAX_FRAME_SIZE)
-
-// The PID used for the PAT (as defined in the MPEG Transport Stream standard):
-#define PAT_PID 0
-
 MPEG2IFrameIndexFromTransportStream
 ::MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource)
   : FramedFilter(env, inputSource),
-    fIsH264(False), fIsH265(False),
-    fInputTransportPacketCounter((unsigned)-1), fClosureNumber(0), fLastContinuityCounter(~0),
-    fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
-    fPMT_PID(0x10), fVideo_PID(0xE0), // default values
-    fParseBufferSize(PARSE_BUFFER_SIZE),
-    fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0),
-    fHeadIndexRecord(NULL), fTailIndexRecord(NULL) {
-  fParseBuffer = new unsigned char[fParseBufferSize];
+    fParser(&env), fClosureNumber(0) {
 }
 
 MPEG2IFrameIndexFromTransportStream::~MPEG2IFrameIndexFromTransportStream() {
-  delete fHeadIndexRecord;
-  delete[] fParseBuffer;
 }
 
 void MPEG2IFrameIndexFromTransportStream::doGetNextFrame() {
-  // Begin by trying to deliver an index record (for an already-parsed frame)
-  // to the client:
-  if (deliverIndexRecord()) return;
+  while (1) {
+    // Begin by trying to deliver an index record (for an already-parsed frame)
+    // to the client:
+    unsigned char record[11];
+    if (fParser.getNextIndexRecord(fMaxSize < 11 ? record : fTo)) {
+      fFrameSize = fMaxSize < 11 ? 0 : 11;
+
+      // Complete delivery to the client:
+      afterGetting(this);
+      return;
+    }
 
-  // No more index records are left to deliver, so try to parse a new frame:
-  if (parseFrame()) { // success - try again
-    doGetNextFrame();
-    return;
+    // No more index records are left to deliver, so try to parse a new frame:
+    if (!fParser.parseFrame()) break;
+    // success - try again
   }
 
   // We need to read some more Transport Stream packets.  Check whether we have room:
-  if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-    // There's no room left.  Compact the buffer, and check again:
-    compactParseBuffer();
-    if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-      envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
-      // Treat this as if the input source ended:
-      handleInputClosure1();
-      return;
-    }
+  if (!fParser.makeRoomForPacket()) {
+    envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
+    // Treat this as if the input source ended:
+    handleInputClosure1();
+    return;
   }
 
   // Arrange to read a new Transport Stream packet:
@@ -181,44 +168,109 @@ void MPEG2IFrameIndexFromTransportStream
 			     presentationTime, durationInMicroseconds);
 }
 
-#define TRANSPORT_SYNC_BYTE 0x47
-
 void MPEG2IFrameIndexFromTransportStream
 ::afterGettingFrame1(unsigned frameSize,
-		     unsigned numTruncatedBytes,
-		     struct timeval presentationTime,
-		     unsigned durationInMicroseconds) {
-  if (frameSize < TRANSPORT_PACKET_SIZE || fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
-    if (fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
-      envir() << "Bad TS sync byte: 0x" << fInputBuffer[0] << "\n";
-    }
+		     unsigned /*numTruncatedBytes*/,
+		     struct timeval /*presentationTime*/,
+		     unsigned /*durationInMicroseconds*/) {
+  if (!fParser.addTransportPacket(fInputBuffer, frameSize)) {
     // Handle this as if the source ended:
     handleInputClosure1();
     return;
   }
 
+  // Try again:
+  doGetNextFrame();
+}
+
+void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
+  MPEG2IFrameIndexFromTransportStream* source
+    = (MPEG2IFrameIndexFromTransportStream*)clientData;
+  source->handleInputClosure1();
+}
+
+void MPEG2IFrameIndexFromTransportStream::handleInputClosure1() {
+  if (++fClosureNumber == 1 && fParser.addEndOfInputCode()) {
+    // This is the first time we saw EOF, and there's still data remaining to be
+    // parsed.  (A Picture Header code has been appended to the end of the unparsed data,
+    // so that all of it will get parsed.)  Try again:
+    doGetNextFrame();
+  } else {
+    // Handle closure in the regular way:
+    handleClosure();
+  }
+}
+
+
+////////// MPEG2TransportStreamIndexParser implementation //////////
+
+// The largest expected frame size (in bytes):
+#define MAX_FRAME_SIZE 400000
+
+// Make our parse buffer twice as large as this, to ensure that at least one
+// complete frame will fit inside it:
+#define PARSE_BUFFER_SIZE (2*MAX_FRAME_SIZE)
+
+// The PID used for the PAT (as defined in the MPEG Transport Stream standard):
+#define PAT_PID 0
+
+#define TRANSPORT_SYNC_BYTE 0x47
+
+MPEG2TransportStreamIndexParser
+::MPEG2TransportStreamIndexParser(UsageEnvironment* env, Boolean keepPCRValues)
+  : fEnv(env), fHaveSeenPMT(False),
+    fInputTransportPacketCounter((unsigned)-1), fLastContinuityCounter(~0),
+    fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
+    fNumPCRs(0), fPCRValues(NULL), fPCRValuesSize(0),
+    fParseBufferSize(PARSE_BUFFER_SIZE),
+    fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0),
+    fHeadIndexRecord(NULL), fTailIndexRecord(NULL) {
+  fStreamState.PMT_PID = 0x10; fStreamState.video_PID = 0xE0; // default values
+  fStreamState.isH264 = fStreamState.isH265 = False;
+  if (keepPCRValues) {
+    fPCRValuesSize = 1024;
+    fPCRValues = new float[fPCRValuesSize];
+  }
+  fParseBuffer = new unsigned char[fParseBufferSize];
+}
+
+MPEG2TransportStreamIndexParser::~MPEG2TransportStreamIndexParser() {
+  delete fHeadIndexRecord;
+  delete[] fParseBuffer;
+  delete[] fPCRValues;
+}
+
+Boolean MPEG2TransportStreamIndexParser
+::addTransportPacket(unsigned char const* pkt, unsigned size,
+		     unsigned vesStart, unsigned vesEnd, Boolean ignorePCR) {
+  if (size < TRANSPORT_PACKET_SIZE || pkt[0] != TRANSPORT_SYNC_BYTE) {
+    if (pkt[0] != TRANSPORT_SYNC_BYTE && fEnv != NULL) {
+      *fEnv << "Bad TS sync byte: 0x" << pkt[0] << "\n";
+    }
+    return False;
+  }
+
   ++fInputTransportPacketCounter;
 
   // Figure out how much of this Transport Packet contains PES data:
-  u_int8_t adaptation_field_control = (fInputBuffer[3]&0x30)>>4;
+  u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
   u_int8_t totalHeaderSize
-    = adaptation_field_control <= 1 ? 4 : 5 + fInputBuffer[4];
+    = adaptation_field_control <= 1 ? 4 : 5 + pkt[4];
   if ((adaptation_field_control == 2 && totalHeaderSize != TRANSPORT_PACKET_SIZE) ||
       (adaptation_field_control == 3 && totalHeaderSize >= TRANSPORT_PACKET_SIZE)) {
-    envir() << "Bad \"adaptation_field_length\": " << fInputBuffer[4] << "\n";
-    doGetNextFrame();
-    return;
+    if (fEnv != NULL) *fEnv << "Bad \"adaptation_field_length\": " << pkt[4] << "\n";
+    return True;
   }
 
   // Check for a PCR:
-  if (totalHeaderSize > 5 && (fInputBuffer[5]&0x10) != 0) {
+  if (totalHeaderSize > 5 && (pkt[5]&0x10) != 0 && !ignorePCR) {
     // There's a PCR:
     u_int32_t pcrBaseHigh
-      = (fInputBuffer[6]<<24)|(fInputBuffer[7]<<16)
-      |(fInputBuffer[8]<<8)|fInputBuffer[9];
+      = (pkt[6]<<24)|(pkt[7]<<16)
+      |(pkt[8]<<8)|pkt[9];
     float pcr = pcrBaseHigh/45000.0f;
-    if ((fInputBuffer[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
-    unsigned short pcrExt = ((fInputBuffer[10]&0x01)<<8) | fInputBuffer[11];
+    if ((pkt[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
+    unsigned short pcrExt = ((pkt[10]&0x01)<<8) | pkt[11];
     pcr += pcrExt/27000000.0f;
 
     if (!fHaveSeenFirstPCR) {
@@ -227,65 +279,73 @@ void MPEG2IFrameIndexFromTransportStream
     } else if (pcr < fLastPCR) {
       // The PCR timestamp has gone backwards.  Display a warning about this
       // (because it indicates buggy Transport Stream data), and compensate for it.
-      envir() << "\nWarning: At about " << fLastPCR-fFirstPCR
+      if (fEnv != NULL) {
+	*fEnv << "\nWarning: At about " << fLastPCR-fFirstPCR
 	      << " seconds into the file, the PCR timestamp decreased - from "
 	      << fLastPCR << " to " << pcr << "\n";
+      }
       fFirstPCR -= (fLastPCR - pcr);
     }
     fLastPCR = pcr;
+
+    if (fPCRValues != NULL) {
+      if (fNumPCRs == fPCRValuesSize) {
+	float* newPCRValues = new float[2*fPCRValuesSize];
+	memmove(newPCRValues, fPCRValues, fNumPCRs*sizeof (float));
+	delete[] fPCRValues;
+	fPCRValues = newPCRValues;
+	fPCRValuesSize *= 2;
+      }
+      fPCRValues[fNumPCRs] = pcr;
+    }
+    ++fNumPCRs;
   }
 
   // Get the PID from the packet, and check for special tables: the PAT and PMT:
-  u_int16_t PID = ((fInputBuffer[1]&0x1F)<<8) | fInputBuffer[2];
+  u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+  Boolean payloadUnitStartIndicator = (pkt[1]&0x40) != 0;
   if (PID == PAT_PID) {
-    analyzePAT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
-  } else if (PID == fPMT_PID) {
-    analyzePMT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    if (payloadUnitStartIndicator) analyzePAT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+  } else if (PID == fStreamState.PMT_PID) {
+    if (payloadUnitStartIndicator) analyzePMT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
   }
 
   // Ignore transport packets for non-video programs,
   // or packets with no data, or packets that duplicate the previous packet:
-  u_int8_t continuity_counter = fInputBuffer[3]&0x0F;
-  if ((PID != fVideo_PID) ||
+  u_int8_t continuity_counter = pkt[3]&0x0F;
+  if ((PID != fStreamState.video_PID) ||
       !(adaptation_field_control == 1 || adaptation_field_control == 3) ||
       continuity_counter == fLastContinuityCounter) {
-    doGetNextFrame();
-    return;
+    return True;
   }
   fLastContinuityCounter = continuity_counter;
 
   // Also, if this is the start of a PES packet, then skip over the PES header:
-  Boolean payload_unit_start_indicator = (fInputBuffer[1]&0x40) != 0;
+  Boolean payload_unit_start_indicator = (pkt[1]&0x40) != 0;
   if (payload_unit_start_indicator && totalHeaderSize < TRANSPORT_PACKET_SIZE - 8 
-      && fInputBuffer[totalHeaderSize] == 0x00 && fInputBuffer[totalHeaderSize+1] == 0x00
-      && fInputBuffer[totalHeaderSize+2] == 0x01) {
-    u_int8_t PES_header_data_length = fInputBuffer[totalHeaderSize+8];
+      && pkt[totalHeaderSize] == 0x00 && pkt[totalHeaderSize+1] == 0x00
+      && pkt[totalHeaderSize+2] == 0x01) {
+    u_int8_t PES_header_data_length = pkt[totalHeaderSize+8];
     totalHeaderSize += 9 + PES_header_data_length;
     if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) {
-      envir() << "Unexpectedly large PES header size: " << PES_header_data_length << "\n";
-      // Handle this as if the source ended:
-      handleInputClosure1();
-      return;
+      if (fEnv != NULL) *fEnv << "Unexpectedly large PES header size: " << PES_header_data_length << "\n";
+      return False;
     }
   }
 
-  // The remaining data is Video Elementary Stream data.  Add it to our parse buffer:
+  // The remaining data is Video Elementary Stream data (of which we want just the part
+  // from "vesStart" to "vesEnd").  Add it to our parse buffer:
   unsigned vesSize = TRANSPORT_PACKET_SIZE - totalHeaderSize;
-  memmove(&fParseBuffer[fParseBufferDataEnd], &fInputBuffer[totalHeaderSize], vesSize);
+  if (vesEnd < vesSize) vesSize = vesEnd;
+  if (vesStart >= vesSize) return True;
+  totalHeaderSize += vesStart; vesSize -= vesStart;
+  memmove(&fParseBuffer[fParseBufferDataEnd], &pkt[totalHeaderSize], vesSize);
   fParseBufferDataEnd += vesSize;
 
   // And add a new index record noting where it came from:
   addToTail(new IndexRecord(totalHeaderSize, vesSize, fInputTransportPacketCounter,
-			    fLastPCR - fFirstPCR));
-
-  // Try again:
-  doGetNextFrame();
-}
-
-void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
-  MPEG2IFrameIndexFromTransportStream* source
-    = (MPEG2IFrameIndexFromTransportStream*)clientData;
-  source->handleInputClosure1();
+			    fLastPCR - fFirstPCR, fNumPCRs));
+  return True;
 }
 
 #define VIDEO_SEQUENCE_START_CODE 0xB3		// MPEG-1 or 2
@@ -295,132 +355,126 @@ void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
 #define PICTURE_START_CODE 0x00			// MPEG-1 or 2
 #define VOP_START_CODE 0xB6			// MPEG-4
 
-void MPEG2IFrameIndexFromTransportStream::handleInputClosure1() {
-  if (++fClosureNumber == 1 && fParseBufferDataEnd > fParseBufferFrameStart
+Boolean MPEG2TransportStreamIndexParser::addEndOfInputCode() {
+  if (fParseBufferDataEnd > fParseBufferFrameStart
       && fParseBufferDataEnd <= fParseBufferSize - 4) {
-    // This is the first time we saw EOF, and there's still data remaining to be
-    // parsed.  Hack: Append a Picture Header code to the end of the unparsed
-    // data, and try again.  This should use up all of the unparsed data.
+    // There's still data remaining to be parsed.  Hack: Append a Picture Header code
+    // to the end of the unparsed data.  This should use up all of the unparsed data.
     fParseBuffer[fParseBufferDataEnd++] = 0;
     fParseBuffer[fParseBufferDataEnd++] = 0;
     fParseBuffer[fParseBufferDataEnd++] = 1;
     fParseBuffer[fParseBufferDataEnd++] = PICTURE_START_CODE;
-
-    // Try again:
-    doGetNextFrame();
-  } else {
-    // Handle closure in the regular way:
-    handleClosure();
+    return True;
   }
+
+  return False;
 }
 
-void MPEG2IFrameIndexFromTransportStream
-::analyzePAT(unsigned char* pkt, unsigned size) {
-  // Get the PMT_PID:
-  while (size >= 17) { // The table is large enough
-    u_int16_t program_number = (pkt[9]<<8) | pkt[10];
-    if (program_number != 0) {
-      fPMT_PID = ((pkt[11]&0x1F)<<8) | pkt[12];
-      return;
-    }
+void MPEG2TransportStreamIndexParser
+::getPCRState(float& firstPCR, float& lastPCR, Boolean& haveSeenFirstPCR) const {
+  firstPCR = fFirstPCR;
+  lastPCR = fLastPCR;
+  haveSeenFirstPCR = fHaveSeenFirstPCR;
+}
 
-    pkt += 4; size -= 4;
-  }
+void MPEG2TransportStreamIndexParser
+::setPCRState(float firstPCR, float lastPCR, Boolean haveSeenFirstPCR) {
+  fFirstPCR = firstPCR;
+  fLastPCR = lastPCR;
+  fHaveSeenFirstPCR = haveSeenFirstPCR;
 }
 
-void MPEG2IFrameIndexFromTransportStream
-::analyzePMT(unsigned char* pkt, unsigned size) {
-  // Scan the "elementary_PID"s in the map, until we see the first video stream.
-
-  // First, get the "section_length", to get the table's size:
-  u_int16_t section_length = ((pkt[2]&0x0F)<<8) | pkt[3];
-  if ((unsigned)(4+section_length) < size) size = (4+section_length);
-
-  // Then, skip any descriptors following the "program_info_length":
-  if (size < 22) return; // not enough data
-  unsigned program_info_length = ((pkt[11]&0x0F)<<8) | pkt[12];
-  pkt += 13; size -= 13;
-  if (size < program_info_length) return; // not enough data
-  pkt += program_info_length; size -= program_info_length;
-
-  // Look at each ("stream_type","elementary_PID") pair, looking for a video stream:
-  while (size >= 9) {
-    u_int8_t stream_type = pkt[0];
-    u_int16_t elementary_PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+void MPEG2TransportStreamIndexParser::packPCR(unsigned char* record, float pcr) {
+  // The PCR is stored as 24 bits (integer part; little endian) + 8 bits (fractional part)
+  unsigned pcr_int = (unsigned)pcr;
+  u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
+  record[3] = (unsigned char)(pcr_int);
+  record[4] = (unsigned char)(pcr_int>>8);
+  record[5] = (unsigned char)(pcr_int>>16);
+  record[6] = (unsigned char)(pcr_frac);
+}
+
+void MPEG2TransportStreamIndexParser
+::analyzePAT(unsigned char const* payload, unsigned payloadSize) {
+  // Get the PMT_PID:
+  (void)parsePAT(payload, payloadSize, fStreamState.PMT_PID);
+}
+
+void MPEG2TransportStreamIndexParser
+::analyzePMT(unsigned char const* payload, unsigned payloadSize) {
+  // Scan the "elementary_PID"s in the map, until we see the first video stream:
+  PMTStreamIterator iter(payload, payloadSize);
+  u_int8_t stream_type; u_int16_t elementary_PID;
+  while (iter.next(stream_type, elementary_PID)) {
     if (stream_type == 1 || stream_type == 2 ||
 	stream_type == 0x1B/*H.264 video*/ || stream_type == 0x24/*H.265 video*/) {
-      if (stream_type == 0x1B) fIsH264 = True;
-      else if (stream_type == 0x24) fIsH265 = True;
-      fVideo_PID = elementary_PID;
+      if (stream_type == 0x1B) fStreamState.isH264 = True;
+      else if (stream_type == 0x24) fStreamState.isH265 = True;
+      fStreamState.video_PID = elementary_PID;
+      fHaveSeenPMT = True;
       return;
     }
-
-    u_int16_t ES_info_length = ((pkt[3]&0x0F)<<8) | pkt[4];
-    pkt += 5; size -= 5;
-    if (size < ES_info_length) return; // not enough data
-    pkt += ES_info_length; size -= ES_info_length;
   }
 }
 
-Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
-  IndexRecord* head = fHeadIndexRecord;
-  if (head == NULL) return False;
+Boolean MPEG2TransportStreamIndexParser
+::getNextIndexRecord(unsigned char* to, u_int32_t* pcrCount) {
+  while (1) {
+    IndexRecord* head = fHeadIndexRecord;
+    if (head == NULL) return False;
 
-  // Check whether the head record has been parsed yet:
-  if (head->recordType() == RECORD_UNPARSED) return False;
+    // Check whether the head record has been parsed yet:
+    if (head->recordType() == RECORD_UNPARSED) return False;
 
-  // Remove the head record (the one whose data we'll be delivering):
-  IndexRecord* next = head->next();
-  head->unlink();
-  if (next == head) {
-    fHeadIndexRecord = fTailIndexRecord = NULL;
-  } else {
-    fHeadIndexRecord = next;
-  }
+    // Remove the head record (the one whose data we'll be delivering):
+    IndexRecord* next = head->next();
+    head->unlink();
+    if (next == head) {
+      fHeadIndexRecord = fTailIndexRecord = NULL;
+    } else {
+      fHeadIndexRecord = next;
+    }
 
-  if (head->recordType() == RECORD_JUNK) {
-    // Don't actually deliver the data to the client:
-    delete head;
-    // Try to deliver the next record instead:
-    return deliverIndexRecord();
-  }
+    if (head->recordType() == RECORD_JUNK) {
+      // Don't actually deliver the data to the client:
+      delete head;
+      // Try to deliver the next record instead:
+      continue;
+    }
 
-  // Deliver data from the head record:
+    // Deliver data from the head record:
 #ifdef DEBUG
-  envir() << "delivering: " << *head << "\n";
+    if (fEnv != NULL) *fEnv << "delivering: " << *head << "\n";
 #endif
-  if (fMaxSize < 11) {
-    fFrameSize = 0;
-  } else {
-    fTo[0] = (u_int8_t)(head->recordType());
-    fTo[1] = head->startOffset();
-    fTo[2] = head->size();
-    // Deliver the PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part)
-    float pcr = head->pcr();
-    unsigned pcr_int = (unsigned)pcr;
-    u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
-    fTo[3] = (unsigned char)(pcr_int);
-    fTo[4] = (unsigned char)(pcr_int>>8);
-    fTo[5] = (unsigned char)(pcr_int>>16);
-    fTo[6] = (unsigned char)(pcr_frac);
+    to[0] = (u_int8_t)(head->recordType());
+    to[1] = head->startOffset();
+    to[2] = head->size();
+    packPCR(to, head->pcr());
     // Deliver the transport packet number (in little-endian order):
     unsigned long tpn = head->transportPacketNumber();
-    fTo[7] = (unsigned char)(tpn);
-    fTo[8] = (unsigned char)(tpn>>8);
-    fTo[9] = (unsigned char)(tpn>>16);
-    fTo[10] = (unsigned char)(tpn>>24);
-    fFrameSize = 11;
+    to[7] = (unsigned char)(tpn);
+    to[8] = (unsigned char)(tpn>>8);
+    to[9] = (unsigned char)(tpn>>16);
+    to[10] = (unsigned char)(tpn>>24);
+    if (pcrCount != NULL) *pcrCount = head->pcrCount();
+
+    // Free the (former) head record (as we're now done with it):
+    delete head;
+    return True;
   }
+}
 
-  // Free the (former) head record (as we're now done with it):
-  delete head;
+Boolean MPEG2TransportStreamIndexParser::makeRoomForPacket() {
+  if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
+    // There's no room left.  Compact the buffer, and check again:
+    compactParseBuffer();
+    if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) return False;
+  }
 
-  // Complete delivery to the client:
-  afterGetting(this);
   return True;
 }
 
-Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
+Boolean MPEG2TransportStreamIndexParser::parseFrame() {
   // At this point, we have a queue of >=0 (unparsed) index records, representing
   // the data in the parse buffer from "fParseBufferFrameStart"
   // to "fParseBufferDataEnd".  We now parse through this data, looking for
@@ -448,12 +502,12 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
   }
 
   unsigned char curCode = p[3];
-  if (fIsH264) curCode &= 0x1F; // nal_unit_type
-  else if (fIsH265) curCode = (curCode&0x7E)>>1;
+  if (fStreamState.isH264) curCode &= 0x1F; // nal_unit_type
+  else if (fStreamState.isH265) curCode = (curCode&0x7E)>>1;
 
   RecordType curRecordType;
   unsigned char nextCode;
-  if (fIsH264) {
+  if (fStreamState.isH264) {
     switch (curCode) {
     case 1: // Coded slice of a non-IDR picture
       curRecordType = RECORD_NAL_H264_NON_IFRAME;
@@ -480,7 +534,7 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
       if (!parseToNextCode(nextCode)) return False;
       break;
     }
-  } else if (fIsH265) {
+  } else if (fStreamState.isH265) {
     switch (curCode) {
     case 19: // Coded slice segment of an IDR picture
     case 20: // Coded slice segment of an IDR picture
@@ -556,7 +610,7 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
   // to "fParseBufferParseEnd". Tag the corresponding index records to note this:
   unsigned frameSize = fParseBufferParseEnd - fParseBufferFrameStart + numInitialBadBytes;
 #ifdef DEBUG
-  envir() << "parsed " << recordTypeStr[curRecordType] << "; length "
+  if (fEnv != NULL) *fEnv << "parsed " << recordTypeStr[curRecordType] << "; length "
 	  << frameSize << "\n";
 #endif
   for (IndexRecord* r = fHeadIndexRecord; ; r = r->next()) {
@@ -577,25 +631,25 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
       u_int8_t newSize = r->size() - frameSize;
       r->size() = frameSize;
 #ifdef DEBUG
-      envir() << "tagged record (modified): " << *r << "\n";
+      if (fEnv != NULL) *fEnv << "tagged record (modified): " << *r << "\n";
 #endif
 
       IndexRecord* newRecord
-	= new IndexRecord(newOffset, newSize, r->transportPacketNumber(), r->pcr());
+	= new IndexRecord(newOffset, newSize, r->transportPacketNumber(), r->pcr(), r->pcrCount());
       newRecord->addAfter(r);
       if (fTailIndexRecord == r) fTailIndexRecord = newRecord;
 #ifdef DEBUG
-      envir() << "added extra record: " << *newRecord << "\n";
+      if (fEnv != NULL) *fEnv << "added extra record: " << *newRecord << "\n";
 #endif
     } else {
 #ifdef DEBUG
-      envir() << "tagged record: " << *r << "\n";
+      if (fEnv != NULL) *fEnv << "tagged record: " << *r << "\n";
 #endif
     }
     frameSize -= r->size();
     if (frameSize == 0) break;
     if (r == fTailIndexRecord) { // this shouldn't happen
-      envir() << "!!!!!Internal consistency error!!!!!\n";
+      if (fEnv != NULL) *fEnv << "!!!!!Internal consistency error!!!!!\n";
       return False;
     }
   }
@@ -607,7 +661,7 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
   return True;
 }
 
-Boolean MPEG2IFrameIndexFromTransportStream
+Boolean MPEG2TransportStreamIndexParser
 ::parseToNextCode(unsigned char& nextCode) {
   unsigned char const* p = &fParseBuffer[fParseBufferParseEnd];
   unsigned char const* end = &fParseBuffer[fParseBufferDataEnd];
@@ -626,9 +680,9 @@ Boolean MPEG2IFrameIndexFromTransportStream
   return False; // no luck this time
 }
 
-void MPEG2IFrameIndexFromTransportStream::compactParseBuffer() {
+void MPEG2TransportStreamIndexParser::compactParseBuffer() {
 #ifdef DEBUG
-  envir() << "Compacting parse buffer: [" << fParseBufferFrameStart
+  if (fEnv != NULL) *fEnv << "Compacting parse buffer: [" << fParseBufferFrameStart
 	  << "," << fParseBufferParseEnd << "," << fParseBufferDataEnd << "]";
 #endif
   memmove(&fParseBuffer[0], &fParseBuffer[fParseBufferFrameStart],
@@ -637,14 +691,14 @@ void MPEG2IFrameIndexFromTransportStream::compactParseBuffer() {
   fParseBufferParseEnd -= fParseBufferFrameStart;
   fParseBufferFrameStart = 0;
 #ifdef DEBUG
-  envir() << "-> [" << fParseBufferFrameStart
+  if (fEnv != NULL) *fEnv << "-> [" << fParseBufferFrameStart
 	  << "," << fParseBufferParseEnd << "," << fParseBufferDataEnd << "]\n";
 #endif
 }
 
-void MPEG2IFrameIndexFromTransportStream::addToTail(IndexRecord* newIndexRecord) {
+void MPEG2TransportStreamIndexParser::addToTail(IndexRecord* newIndexRecord) {
 #ifdef DEBUG
-  envir() << "adding new: " << *newIndexRecord << "\n";
+  if (fEnv != NULL) *fEnv << "adding new: " << *newIndexRecord << "\n";
 #endif
   if (fTailIndexRecord == NULL) {
     fHeadIndexRecord = fTailIndexRecord = newIndexRecord;
@@ -657,10 +711,10 @@ void MPEG2IFrameIndexFromTransportStream::addToTail(IndexRecord* newIndexRecord)
 ////////// IndexRecord implementation //////////
 
 IndexRecord::IndexRecord(u_int8_t startOffset, u_int8_t size,
-			 unsigned long transportPacketNumber, float pcr)
+			 unsigned long transportPacketNumber, float pcr, u_int32_t pcrCount)
   : fNext(this), fPrev(this), fRecordType(RECORD_UNPARSED),
     fStartOffset(startOffset), fSize(size),
-    fPCR(pcr), fTransportPacketNumber(transportPacketNumber) {
+    fPCR(pcr), fPCRCount(pcrCount), fTransportPacketNumber(transportPacketNumber) {
 }
 
 IndexRecord::~IndexRecord() {
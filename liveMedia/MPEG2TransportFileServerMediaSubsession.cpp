@@ -45,10 +45,11 @@ MPEG2TransportFileServerMediaSubsession
 					  MPEG2TransportStreamIndexFile* indexFile,
 					  Boolean reuseFirstSource)
   : FileServerMediaSubsession(env, fileName, reuseFirstSource),
-    fIndexFile(indexFile), fDuration(0.0), fClientSessionHashTable(NULL) {
+    fIndexFile(indexFile), fDuration(0.0), fClientSessionHashTable(NULL), fTrickPlayTracks(NULL) {
   if (fIndexFile != NULL) { // we support 'trick play'
     fDuration = fIndexFile->getPlayingDuration();
     fClientSessionHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
+    fTrickPlayTracks = HashTable::create(ONE_WORD_HASH_KEYS);
   }
 }
 
@@ -65,7 +66,30 @@ MPEG2TransportFileServerMediaSubsession
       delete client;
     }
     delete fClientSessionHashTable;
+
+    // Close any precomputed 'trick play' tracks that we opened:
+    while (1) {
+      MPEG2TransportStreamTrickPlayTrack* track
+	= (MPEG2TransportStreamTrickPlayTrack*)(fTrickPlayTracks->RemoveNext());
+      if (track == NULL) break;
+      Medium::close(track);
+    }
+    delete fTrickPlayTracks;
+  }
+}
+
+MPEG2TransportStreamTrickPlayTrack* MPEG2TransportFileServerMediaSubsession::lookupTrickPlayTrack(int scale) {
+  if (fTrickPlayTracks == NULL) return NULL;
+
+  MPEG2TransportStreamTrickPlayTrack* track
+    = (MPEG2TransportStreamTrickPlayTrack*)(fTrickPlayTracks->Lookup((char const*)(long)scale));
+  if (track == NULL) {
+    // We haven't opened this track yet.  (If it doesn't exist, we'll check again next time, in case it gets generated.)
+    track = MPEG2TransportStreamTrickPlayTrack::createNew(envir(), fFileName, fIndexFile, scale);
+    if (track != NULL) fTrickPlayTracks->Add((char const*)(long)scale, track);
   }
+
+  return track;
 }
 
 #define TRANSPORT_PACKET_SIZE 188
@@ -144,6 +168,7 @@ void MPEG2TransportFileServerMediaSubsession
     ClientTrickPlayState* client = lookupClient(clientSessionId);
     if (client != NULL) {
       client->updateStateOnPlayChange(False);
+      client->handleStreamDeletion();
     }
   }
 
@@ -152,7 +177,7 @@ void MPEG2TransportFileServerMediaSubsession
 }
 
 ClientTrickPlayState* MPEG2TransportFileServerMediaSubsession::newClientTrickPlayState() {
-  return new ClientTrickPlayState(fIndexFile);
+  return new ClientTrickPlayState(fIndexFile, this);
 }
 
 FramedSource* MPEG2TransportFileServerMediaSubsession
@@ -222,11 +247,13 @@ ClientTrickPlayState* MPEG2TransportFileServerMediaSubsession
 
 ////////// ClientTrickPlayState implementation //////////
 
-ClientTrickPlayState::ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile)
+ClientTrickPlayState::ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile,
+					   MPEG2TransportFileServerMediaSubsession* subsession)
   : fIndexFile(indexFile),
     fOriginalTransportStreamSource(NULL),
     fTrickModeFilter(NULL), fTrickPlaySource(NULL),
     fFramer(NULL),
+    fSubsession(subsession), fTrickPlayTrack(NULL), fTrickPlayTrackSource(NULL),
     fScale(1.0f), fNextScale(1.0f), fNPT(0.0f),
     fTSRecordNum(0), fIxRecordNum(0) {
 }
@@ -250,6 +277,11 @@ unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double stream
 
     fFramer->clearPIDStatusTable();
   }
+  if (fTrickPlayTrackSource != NULL) {
+    // We're streaming from a precomputed 'trick play' track, so seek within that also:
+    fTrickPlayTrack->seekSource(fTrickPlayTrackSource, fNPT);
+    fFramer->clearPIDStatusTable();
+  }
 
   unsigned long numTSRecordsToStream = 0;
   float pcrLimit = 0.0;
@@ -273,8 +305,15 @@ unsigned long ClientTrickPlayState::updateStateFromNPT(double npt, double stream
 	// We'll be streaming from the trick play stream.  
 	// It'd be difficult to figure out how many Transport Packets we need to stream, so instead set a PCR
 	// limit in the trick play stream.  (We rely upon the fact that PCRs in the trick play stream start at 0.0)
-	int direction = fNextScale < 0.0 ? -1 : 1;
-	pcrLimit = (float)(streamDuration/(fNextScale*direction));
+	MPEG2TransportStreamTrickPlayTrack* track
+	  = fSubsession == NULL ? NULL : fSubsession->lookupTrickPlayTrack(int(fNextScale));
+	if (track != NULL) {
+	  // A precomputed track's PCRs start at 0.0 at the start of the track (not where we begin streaming it):
+	  pcrLimit = track->pcrLimit(fNPT, streamDuration);
+	} else {
+	  int direction = fNextScale < 0.0 ? -1 : 1;
+	  pcrLimit = (float)(streamDuration/(fNextScale*direction));
+	}
       }
     }
   }
@@ -289,14 +328,17 @@ void ClientTrickPlayState::updateStateOnScaleChange() {
 
   // Change our source objects to reflect the change in scale:
   // First, close the existing trick play source (if any):
-  if (fTrickPlaySource != NULL) {
-    fTrickModeFilter->forgetInputSource();
-        // so that the underlying Transport Stream source doesn't get deleted by:
-    Medium::close(fTrickPlaySource);
-    fTrickPlaySource = NULL;
-    fTrickModeFilter = NULL;
+  closeTrickPlaySource();
+
+  if (fNextScale != 1.0f && fSubsession != NULL
+      && (fTrickPlayTrack = fSubsession->lookupTrickPlayTrack(int(fNextScale))) != NULL) {
+    // There's a precomputed 'trick play' track for this scale, so stream (sequentially) from that:
+    fTrickPlayTrackSource
+      = fTrickPlayTrack->createSource(fNPT, TRANSPORT_PACKETS_PER_NETWORK_PACKET*TRANSPORT_PACKET_SIZE);
   }
-  if (fNextScale != 1.0f) {
+  if (fTrickPlayTrackSource != NULL) {
+    fFramer->changeInputSource(fTrickPlayTrackSource);
+  } else if (fNextScale != 1.0f) {
     // Create a new trick play filter from the original Transport Stream source:
     UsageEnvironment& env = fIndexFile->envir(); // alias
     fTrickModeFilter = MPEG2TransportStreamTrickModeFilter
@@ -317,7 +359,12 @@ void ClientTrickPlayState::updateStateOnScaleChange() {
 
 void ClientTrickPlayState::updateStateOnPlayChange(Boolean reverseToPreviousVSH) {
   updateTSRecordNum();
-  if (fTrickPlaySource == NULL) {
+  if (fTrickPlayTrackSource != NULL) {
+    // We were streaming from a precomputed 'trick play' track.  Get the npt from this, and use the
+    // (original) index file to look up the corresponding transport and index record numbers:
+    fNPT = fTrickPlayTrack->currentNPT(fTrickPlayTrackSource, reverseToPreviousVSH);
+    fIndexFile->lookupTSPacketNumFromNPT(fNPT, fTSRecordNum, fIxRecordNum);
+  } else if (fTrickPlaySource == NULL) {
     // We were in regular (1x) play. Use the index file to look up the
     // index record number and npt from the current transport number:
     fIndexFile->lookupPCRFromTSPacketNum(fTSRecordNum, reverseToPreviousVSH, fNPT, fIxRecordNum);
@@ -337,6 +384,14 @@ void ClientTrickPlayState::updateStateOnPlayChange(Boolean reverseToPreviousVSH)
   }
 }
 
+void ClientTrickPlayState::handleStreamDeletion() {
+  // Our framer is about to be closed.  Make sure that it's reading from the original Transport Stream source
+  // (which it will close), and close any trick play source that we created:
+  closeTrickPlaySource();
+  if (fFramer != NULL) fFramer->changeInputSource(fOriginalTransportStreamSource);
+  fScale = fNextScale = 1.0f;
+}
+
 void ClientTrickPlayState::setSource(MPEG2TransportStreamFramer* framer) {
   fFramer = framer;
   fOriginalTransportStreamSource = (ByteStreamFileSource*)(framer->inputSource());
@@ -346,6 +401,21 @@ void ClientTrickPlayState::updateTSRecordNum(){
   if (fFramer != NULL) fTSRecordNum += (unsigned long)(fFramer->tsPacketCount());
 }
 
+void ClientTrickPlayState::closeTrickPlaySource() {
+  if (fTrickPlaySource != NULL) {
+    fTrickModeFilter->forgetInputSource();
+        // so that the underlying Transport Stream source doesn't get deleted by:
+    Medium::close(fTrickPlaySource);
+    fTrickPlaySource = NULL;
+    fTrickModeFilter = NULL;
+  }
+  if (fTrickPlayTrackSource != NULL) {
+    Medium::close(fTrickPlayTrackSource);
+    fTrickPlayTrackSource = NULL;
+    fTrickPlayTrack = NULL;
+  }
+}
+
 void ClientTrickPlayState::reseekOriginalTransportStreamSource() {
   u_int64_t tsRecordNum64 = (u_int64_t)fTSRecordNum;
   fOriginalTransportStreamSource->seekToByteAbsolute(tsRecordNum64*TRANSPORT_PACKET_SIZE);
@@ -0,0 +1,480 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Demultiplexer for a MPEG Transport Stream
+// Implementation
+
+#include "MPEG2TransportStreamDemuxedElementaryStream.hh"
+#include "MPEG2TransportStreamPSIParser.hh"
+#include <GroupsockHelper.hh> // for "gettimeofday()"
+
+#define TRANSPORT_PACKET_SIZE 188
+#define TRANSPORT_SYNC_BYTE 0x47
+#define NO_PID 0x1FFF
+
+// The kinds of stream that an output can deliver:
+#define EXPLICIT_PID_STREAM 0
+#define VIDEO_STREAM 1
+#define AUDIO_STREAM 2
+
+static Boolean isVideoStreamType(u_int8_t streamType) {
+  return streamType == 0x01 || streamType == 0x02 || streamType == 0x10
+    || streamType == 0x1B || streamType == 0x24;
+}
+
+static Boolean isAudioStreamType(u_int8_t streamType) {
+  return streamType == 0x03 || streamType == 0x04 || streamType == 0x0F
+    || streamType == 0x11 || streamType == 0x81;
+}
+
+////////// MPEG2TransportStreamDemux //////////
+
+MPEG2TransportStreamDemux* MPEG2TransportStreamDemux
+::createNew(UsageEnvironment& env, FramedSource* inputSource, Boolean reclaimWhenLastESDies) {
+  return new MPEG2TransportStreamDemux(env, inputSource, reclaimWhenLastESDies);
+}
+
+MPEG2TransportStreamDemux
+::MPEG2TransportStreamDemux(UsageEnvironment& env, FramedSource* inputSource, Boolean reclaimWhenLastESDies)
+  : Medium(env),
+    fInputSource(inputSource), fReclaimWhenLastESDies(reclaimWhenLastESDies), fNumOutstandingESs(0),
+    fPMT_PID(NO_PID), fHaveSeenPTS(False), fLastPTS(0), fLastPTSTime(0.0),
+    fInputBuffer(new unsigned char[MPEG2_TRANSPORT_STREAM_DEMUX_INPUT_BUFFER_SIZE]),
+    fInputDataStart(0), fInputDataEnd(0), fNumPendingReads(0),
+    fIsReadingInput(False), fIsProcessingInput(False), fInputHasClosed(False) {
+  memset(fOutput, 0, sizeof fOutput);
+  memset(fPIDTable, 0, sizeof fPIDTable);
+}
+
+MPEG2TransportStreamDemux::~MPEG2TransportStreamDemux() {
+  Medium::close(fInputSource);
+  delete[] fInputBuffer;
+}
+
+MPEG2TransportStreamDemuxedElementaryStream* MPEG2TransportStreamDemux
+::newElementaryStream(u_int16_t PID, Boolean deliverPESPackets) {
+  if (PID >= NO_PID || fPIDTable[PID] != 0) return NULL; // we deliver each PID (at most) once
+
+  return newOutput(PID, EXPLICIT_PID_STREAM, deliverPESPackets);
+}
+
+MPEG2TransportStreamDemuxedElementaryStream* MPEG2TransportStreamDemux
+::newVideoStream(Boolean deliverPESPackets) {
+  return newOutput(NO_PID, VIDEO_STREAM, deliverPESPackets);
+}
+
+MPEG2TransportStreamDemuxedElementaryStream* MPEG2TransportStreamDemux
+::newAudioStream(Boolean deliverPESPackets) {
+  return newOutput(NO_PID, AUDIO_STREAM, deliverPESPackets);
+}
+
+MPEG2TransportStreamDemuxedElementaryStream* MPEG2TransportStreamDemux
+::newOutput(u_int16_t PID, u_int8_t streamKind, Boolean deliverPESPackets) {
+  u_int8_t i;
+  for (i = 0; i < MAX_DEMUXED_ELEMENTARY_STREAMS; ++i) {
+    if (fOutput[i].es == NULL) break;
+  }
+  if (i == MAX_DEMUXED_ELEMENTARY_STREAMS) return NULL;
+
+  OutputDescriptor_t& out = fOutput[i];
+  memset(&out, 0, sizeof out);
+  out.es = new MPEG2TransportStreamDemuxedElementaryStream(envir(), i, *this);
+  out.PID = PID;
+  out.streamKind = streamKind;
+  out.deliverPESPackets = deliverPESPackets;
+  out.isAwaitingPESStart = True;
+  if (PID != NO_PID) fPIDTable[PID] = i+1;
+
+  ++fNumOutstandingESs;
+  return out.es;
+}
+
+void MPEG2TransportStreamDemux::noteElementaryStreamDeletion(u_int8_t outputIndex) {
+  stopGettingFrames(outputIndex);
+
+  OutputDescriptor_t& out = fOutput[outputIndex];
+  if (out.PID != NO_PID) fPIDTable[out.PID] = 0;
+  out.es = NULL;
+
+  if (--fNumOutstandingESs == 0 && fReclaimWhenLastESDies) {
+    Medium::close(this);
+  }
+}
+
+void MPEG2TransportStreamDemux::getNextFrame(u_int8_t outputIndex,
+					     unsigned char* to, unsigned maxSize,
+					     FramedSource::afterGettingFunc* afterGettingFunc,
+					     void* afterGettingClientData,
+					     FramedSource::onCloseFunc* onCloseFunc,
+					     void* onCloseClientData) {
+  if (fInputHasClosed) {
+    // There'll be no more data for anyone:
+    if (onCloseFunc != NULL) (*onCloseFunc)(onCloseClientData);
+    return;
+  }
+
+  OutputDescriptor_t& out = fOutput[outputIndex];
+  out.to = to; out.maxSize = maxSize;
+  out.fAfterGettingFunc = afterGettingFunc;
+  out.afterGettingClientData = afterGettingClientData;
+  out.fOnCloseFunc = onCloseFunc;
+  out.onCloseClientData = onCloseClientData;
+  out.isCurrentlyActive = True;
+  if (!out.isCurrentlyAwaitingData) {
+    out.isCurrentlyAwaitingData = True;
+    ++fNumPendingReads;
+  }
+
+  continueReadProcessing();
+}
+
+void MPEG2TransportStreamDemux::stopGettingFrames(u_int8_t outputIndex) {
+  OutputDescriptor_t& out = fOutput[outputIndex];
+
+  if (out.isCurrentlyAwaitingData && fNumPendingReads > 0) --fNumPendingReads;
+
+  out.isCurrentlyActive = out.isCurrentlyAwaitingData = False;
+  out.frameSize = out.numTruncatedBytes = 0;
+  out.isAwaitingPESStart = True;
+}
+
+void MPEG2TransportStreamDemux::flushInput() {
+  if (fIsReadingInput) {
+    fInputSource->stopGettingFrames();
+    fIsReadingInput = False;
+  }
+  fInputDataStart = fInputDataEnd = 0;
+
+  // Any frames that were in progress are now incomplete, so discard them:
+  for (unsigned i = 0; i < MAX_DEMUXED_ELEMENTARY_STREAMS; ++i) {
+    OutputDescriptor_t& out = fOutput[i];
+    out.frameSize = out.numTruncatedBytes = 0;
+    out.isAwaitingPESStart = True;
+    out.haveSeenPacket = False;
+  }
+}
+
+void MPEG2TransportStreamDemux::handleClosure(void* clientData) {
+  MPEG2TransportStreamDemux* demux = (MPEG2TransportStreamDemux*)clientData;
+
+  demux->fIsReadingInput = False;
+  demux->fInputHasClosed = True;
+  if (!demux->fIsProcessingInput) demux->handleEndOfInput();
+      // otherwise, we were called from within our own read, and "continueReadProcessing()" will do this
+}
+
+void MPEG2TransportStreamDemux::handleEndOfInput() {
+  // First, deliver any frames that are still in progress.  (Their readers will be told of the
+  // closure - by "getNextFrame()" - if they then ask for more.)
+  unsigned i;
+  for (i = 0; i < MAX_DEMUXED_ELEMENTARY_STREAMS; ++i) {
+    OutputDescriptor_t& out = fOutput[i];
+    if (out.isCurrentlyAwaitingData && !out.isAwaitingPESStart) deliverFrame(i);
+  }
+
+  // Then, tell all remaining pending readers that our source has closed.
+  // Note that we need to make a copy of our readers' close functions
+  // (etc.) before we start calling any of them, in case one of them
+  // ends up deleting this.
+  struct {
+    FramedSource::onCloseFunc* fOnCloseFunc;
+    void* onCloseClientData;
+  } savedPending[MAX_DEMUXED_ELEMENTARY_STREAMS];
+  unsigned numPending = 0;
+  for (i = 0; i < MAX_DEMUXED_ELEMENTARY_STREAMS; ++i) {
+    OutputDescriptor_t& out = fOutput[i];
+    if (out.isCurrentlyAwaitingData && out.fOnCloseFunc != NULL) {
+      savedPending[numPending].fOnCloseFunc = out.fOnCloseFunc;
+      savedPending[numPending].onCloseClientData = out.onCloseClientData;
+      ++numPending;
+    }
+    out.isCurrentlyActive = out.isCurrentlyAwaitingData = False;
+  }
+  fNumPendingReads = 0;
+
+  for (i = 0; i < numPending; ++i) {
+    (*savedPending[i].fOnCloseFunc)(savedPending[i].onCloseClientData);
+  }
+}
+
+void MPEG2TransportStreamDemux
+::afterGettingInput(void* clientData, unsigned frameSize,
+		    unsigned /*numTruncatedBytes*/,
+		    struct timeval /*presentationTime*/,
+		    unsigned /*durationInMicroseconds*/) {
+  MPEG2TransportStreamDemux* demux = (MPEG2TransportStreamDemux*)clientData;
+  demux->afterGettingInput1(frameSize);
+}
+
+void MPEG2TransportStreamDemux::afterGettingInput1(unsigned frameSize) {
+  fIsReadingInput = False;
+  fInputDataEnd += frameSize;
+
+  continueReadProcessing();
+}
+
+void MPEG2TransportStreamDemux::continueReadProcessing() {
+  // Note that a reader can call "getNextFrame()" again from within the delivery of its frame, so
+  // we can be called while we're already processing our input; if so, there's nothing more to do here.
+  if (fIsReadingInput || fIsProcessingInput || fInputHasClosed) return;
+  fIsProcessingInput = True;
+
+  while (fNumPendingReads > 0) {
+    // Handle each complete Transport Stream packet that we've already read:
+    while (fInputDataEnd - fInputDataStart >= TRANSPORT_PACKET_SIZE) {
+      unsigned char* pkt = &fInputBuffer[fInputDataStart];
+      if (pkt[0] != TRANSPORT_SYNC_BYTE) {
+	// We've lost sync.  Skip ahead to the next 'sync byte', and try again from there:
+	unsigned char* syncByte
+	  = (unsigned char*)memchr(&pkt[1], TRANSPORT_SYNC_BYTE, fInputDataEnd - fInputDataStart - 1);
+	fInputDataStart = syncByte == NULL ? fInputDataEnd : syncByte - fInputBuffer;
+	continue;
+      }
+
+      if (!handlePacket(pkt)) {
+	// This packet's reader hasn't yet asked for its next frame, so we have to wait for it:
+	fIsProcessingInput = False;
+	return;
+      }
+      fInputDataStart += TRANSPORT_PACKET_SIZE;
+      if (fNumPendingReads == 0) break;
+    }
+    if (fNumPendingReads == 0) break;
+
+    // We need more input.  Move any remaining (partial packet) data to the start of our buffer, then read after it:
+    unsigned numRemainingBytes = fInputDataEnd - fInputDataStart;
+    memmove(fInputBuffer, &fInputBuffer[fInputDataStart], numRemainingBytes);
+    fInputDataStart = 0; fInputDataEnd = numRemainingBytes;
+
+    fIsReadingInput = True;
+    fInputSource->getNextFrame(&fInputBuffer[fInputDataEnd],
+			       MPEG2_TRANSPORT_STREAM_DEMUX_INPUT_BUFFER_SIZE - fInputDataEnd,
+			       afterGettingInput, this,
+			       handleClosure, this);
+    if (fIsReadingInput) break; // we'll continue (from "afterGettingInput()") once the data arrives
+
+    // Otherwise, our input source delivered (or closed) immediately.  Handle this here, rather than
+    // recursively, so that a synchronous source can't make our stack grow with each read:
+    if (fInputHasClosed) {
+      fIsProcessingInput = False;
+      handleEndOfInput(); // note: this may end up deleting "this"
+      return;
+    }
+  }
+
+  fIsProcessingInput = False;
+}
+
+Boolean MPEG2TransportStreamDemux::handlePacket(unsigned char const* pkt) {
+  u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+  Boolean payloadUnitStartIndicator = (pkt[1]&0x40) != 0;
+  u_int8_t adaptationFieldControl = (pkt[3]&0x30)>>4;
+  if ((adaptationFieldControl&0x1) == 0) return True; // this packet has no payload
+
+  unsigned payloadOffset = 4;
+  if (adaptationFieldControl == 3) payloadOffset += 1 + pkt[4];
+  if (payloadOffset >= TRANSPORT_PACKET_SIZE) return True; // bad adaptation_field_length
+  unsigned char const* payload = &pkt[payloadOffset];
+  unsigned payloadSize = TRANSPORT_PACKET_SIZE - payloadOffset;
+
+  if (PID == 0x0000) {
+    if (payloadUnitStartIndicator) analyzePAT(payload, payloadSize);
+    return True;
+  } else if (PID == fPMT_PID) {
+    if (payloadUnitStartIndicator) analyzePMT(payload, payloadSize);
+    return True;
+  }
+
+  u_int8_t outputIndexPlus1 = fPIDTable[PID];
+  if (outputIndexPlus1 == 0) return True; // we're not delivering this PID
+  u_int8_t outputIndex = outputIndexPlus1 - 1;
+  OutputDescriptor_t& out = fOutput[outputIndex];
+
+  if (!out.isCurrentlyActive) {
+    // Our reader isn't reading (yet, or any more), so discard this packet.  (When it begins reading, it'll start
+    // with the next complete PES packet.)
+    out.isAwaitingPESStart = True;
+    out.haveSeenPacket = False;
+    return True;
+  }
+  if (!out.isCurrentlyAwaitingData) return False; // we need to wait for our reader before we can handle this packet
+
+  // Check the 'continuity_counter', to detect (and discard) duplicate packets, and to detect lost packets:
+  u_int8_t continuityCounter = pkt[3]&0x0F;
+  Boolean discontinuityIndicator = adaptationFieldControl == 3 && pkt[4] > 0 && (pkt[5]&0x80) != 0;
+  Boolean packetsWereLost = False;
+  if (out.haveSeenPacket && !discontinuityIndicator) {
+    if (continuityCounter == out.lastContinuityCounter) return True; // a duplicate packet
+    packetsWereLost = continuityCounter != ((out.lastContinuityCounter+1)&0x0F);
+  }
+  if (packetsWereLost) {
+    // Any frame that's in progress is now incomplete, so discard it:
+    out.frameSize = out.numTruncatedBytes = 0;
+    out.isAwaitingPESStart = True;
+  }
+
+  if (payloadUnitStartIndicator) {
+    if (!out.isAwaitingPESStart) {
+      // This packet begins a new PES packet, so the frame that's in progress is now complete:
+      deliverFrame(outputIndex);
+
+      // Before we can begin the next frame, our reader needs to have asked for it:
+      if (!out.isCurrentlyAwaitingData) return False;
+    }
+    out.haveSeenPacket = True; out.lastContinuityCounter = continuityCounter;
+
+    startFrame(outputIndex, payload, payloadSize);
+  } else {
+    out.haveSeenPacket = True; out.lastContinuityCounter = continuityCounter;
+
+    if (!out.isAwaitingPESStart) addToFrame(outputIndex, payload, payloadSize);
+  }
+
+  return True;
+}
+
+void MPEG2TransportStreamDemux::analyzePAT(unsigned char const* payload, unsigned payloadSize) {
+  // Look for the first program (other than the 'network' PID) in the PAT:
+  (void)parsePAT(payload, payloadSize, fPMT_PID);
+}
+
+void MPEG2TransportStreamDemux::analyzePMT(unsigned char const* payload, unsigned payloadSize) {
+  // Look at each elementary stream that's listed in the PMT:
+  PMTStreamIterator iter(payload, payloadSize);
+  u_int8_t stream_type; u_int16_t elementary_PID;
+  while (iter.next(stream_type, elementary_PID)) {
+    u_int8_t outputIndexPlus1 = fPIDTable[elementary_PID];
+    if (outputIndexPlus1 != 0) {
+      // We already deliver this PID; note its stream type:
+      fOutput[outputIndexPlus1-1].streamType = stream_type;
+      continue;
+    }
+
+    // Bind this PID to the first (if any) of our 'video' or 'audio' outputs that's still waiting for a stream of its kind:
+    u_int8_t streamKind = isVideoStreamType(stream_type) ? VIDEO_STREAM
+      : isAudioStreamType(stream_type) ? AUDIO_STREAM : EXPLICIT_PID_STREAM;
+    if (streamKind == EXPLICIT_PID_STREAM) continue;
+    for (u_int8_t j = 0; j < MAX_DEMUXED_ELEMENTARY_STREAMS; ++j) {
+      OutputDescriptor_t& out = fOutput[j];
+      if (out.es != NULL && out.PID == NO_PID && out.streamKind == streamKind) {
+	out.PID = elementary_PID;
+	out.streamType = stream_type;
+	fPIDTable[elementary_PID] = j+1;
+	break;
+      }
+    }
+  }
+}
+
+void MPEG2TransportStreamDemux
+::startFrame(u_int8_t outputIndex, unsigned char const* payload, unsigned payloadSize) {
+  OutputDescriptor_t& out = fOutput[outputIndex];
+  out.frameSize = out.numTruncatedBytes = 0;
+  out.isAwaitingPESStart = True; // until we know that this is a valid PES packet
+
+  if (payloadSize < 6 || payload[0] != 0x00 || payload[1] != 0x00 || payload[2] != 0x01) return;
+  u_int8_t stream_id = payload[3];
+  unsigned PES_packet_length = (payload[4]<<8) | payload[5];
+
+  // Some kinds of PES packet have no optional header (and so no PTS):
+  unsigned headerSize = 6;
+  if (stream_id != 0xBC && stream_id != 0xBE && stream_id != 0xBF && stream_id != 0xF0 && stream_id != 0xF1
+      && stream_id != 0xF2 && stream_id != 0xF8 && stream_id != 0xFF) {
+    if (payloadSize < 9) return;
+    headerSize = 9 + payload[8];
+    if (headerSize > payloadSize) return; // we assume that the PES header fits within the first Transport Stream packet
+
+    if ((payload[7]&0x80) != 0 && payload[8] >= 5) {
+      // Convert the PTS to a presentation time.  All of our outputs share the same time base, so that they stay in sync:
+      u_int64_t PTS = ((u_int64_t)(payload[9]&0x0E)<<29) | (payload[10]<<22) | ((payload[11]&0xFE)<<14)
+	| (payload[12]<<7) | (payload[13]>>1);
+      if (!fHaveSeenPTS) {
+	struct timeval timeNow;
+	gettimeofday(&timeNow, NULL);
+	fLastPTSTime = timeNow.tv_sec + timeNow.tv_usec/1000000.0;
+	fHaveSeenPTS = True;
+      } else {
+	// Allow for the PTS (a 33-bit number) wrapping around, and for PTSs (e.g., of different streams) that go backwards:
+	int64_t PTSDelta = (int64_t)((PTS - fLastPTS)&0x1FFFFFFFFULL);
+	if (PTSDelta >= 0x100000000LL) PTSDelta -= 0x200000000LL;
+	fLastPTSTime += PTSDelta/90000.0;
+      }
+      fLastPTS = PTS;
+
+      out.presentationTime.tv_sec = (long)fLastPTSTime;
+      out.presentationTime.tv_usec = (long)((fLastPTSTime - out.presentationTime.tv_sec)*1000000.0);
+    } // otherwise, we keep the previous presentation time
+  }
+  if (out.presentationTime.tv_sec == 0 && out.presentationTime.tv_usec == 0) {
+    gettimeofday(&out.presentationTime, NULL);
+  }
+
+  // Then, copy whatever we deliver (the whole PES packet, or just its elementary stream data) from this packet:
+  unsigned PESPacketSize = PES_packet_length == 0 ? 0 : 6 + PES_packet_length;
+  if (!out.deliverPESPackets) {
+    if (PESPacketSize != 0) {
+      if (PESPacketSize <= headerSize) return; // there's no elementary stream data
+      PESPacketSize -= headerSize;
+    }
+    payload += headerSize; payloadSize -= headerSize;
+  }
+  out.pesBytesRemaining = PESPacketSize;
+  out.isAwaitingPESStart = False;
+
+  addToFrame(outputIndex, payload, payloadSize);
+}
+
+void MPEG2TransportStreamDemux
+::addToFrame(u_int8_t outputIndex, unsigned char const* data, unsigned size) {
+  OutputDescriptor_t& out = fOutput[outputIndex];
+
+  Boolean frameIsComplete = False;
+  if (out.pesBytesRemaining > 0) {
+    // We know how long the PES packet is, so we can tell when we've reached its end (and ignore any stuffing after it):
+    if (size >= out.pesBytesRemaining) {
+      size = out.pesBytesRemaining;
+      frameIsComplete = True;
+    }
+    out.pesBytesRemaining -= size;
+  }
+
+  // Copy the data directly into our reader's buffer (this is the only time that it gets copied):
+  unsigned numBytesToCopy = size;
+  if (out.frameSize + numBytesToCopy > out.maxSize) {
+    numBytesToCopy = out.maxSize - out.frameSize;
+    out.numTruncatedBytes += size - numBytesToCopy;
+  }
+  memmove(&out.to[out.frameSize], data, numBytesToCopy);
+  out.frameSize += numBytesToCopy;
+
+  if (frameIsComplete) deliverFrame(outputIndex);
+}
+
+void MPEG2TransportStreamDemux::deliverFrame(u_int8_t outputIndex) {
+  OutputDescriptor_t& out = fOutput[outputIndex];
+  out.isAwaitingPESStart = True;
+
+  unsigned frameSize = out.frameSize, numTruncatedBytes = out.numTruncatedBytes;
+  out.frameSize = out.numTruncatedBytes = 0;
+  if (frameSize == 0 && numTruncatedBytes == 0) return; // there's nothing to deliver
+
+  out.isCurrentlyAwaitingData = False;
+  if (fNumPendingReads > 0) --fNumPendingReads;
+
+  // Complete delivery to the client:
+  (*out.fAfterGettingFunc)(out.afterGettingClientData, frameSize, numTruncatedBytes, out.presentationTime, 0);
+}
@@ -0,0 +1,83 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A MPEG Elementary Stream (or its PES packets), demultiplexed from a Transport Stream
+// Implementation
+
+#include "MPEG2TransportStreamDemuxedElementaryStream.hh"
+
+////////// MPEG2TransportStreamDemuxedElementaryStream //////////
+
+MPEG2TransportStreamDemuxedElementaryStream
+::MPEG2TransportStreamDemuxedElementaryStream(UsageEnvironment& env, u_int8_t outputIndex,
+					      MPEG2TransportStreamDemux& sourceDemux)
+  : FramedSource(env),
+    fOurOutputIndex(outputIndex), fOurSourceDemux(sourceDemux) {
+}
+
+MPEG2TransportStreamDemuxedElementaryStream::~MPEG2TransportStreamDemuxedElementaryStream() {
+  fOurSourceDemux.noteElementaryStreamDeletion(fOurOutputIndex);
+}
+
+void MPEG2TransportStreamDemuxedElementaryStream::doGetNextFrame() {
+  fOurSourceDemux.getNextFrame(fOurOutputIndex, fTo, fMaxSize,
+			       afterGettingFrame, this,
+			       handleClosure, this);
+}
+
+void MPEG2TransportStreamDemuxedElementaryStream::doStopGettingFrames() {
+  fOurSourceDemux.stopGettingFrames(fOurOutputIndex);
+}
+
+char const* MPEG2TransportStreamDemuxedElementaryStream::MIMEtype() const {
+  // We know our MIME type (for known media types) only once we've seen our stream type in the PMT:
+  if (!fOurSourceDemux.fOutput[fOurOutputIndex].deliverPESPackets) {
+    switch (streamType()) {
+      case 0x01: case 0x02: return "video/MPEG";
+      case 0x10: return "video/MP4V-ES";
+      case 0x1B: return "video/H264";
+      case 0x24: return "video/H265";
+      case 0x03: case 0x04: return "audio/MPEG";
+      case 0x81: return "audio/AC3";
+    }
+  }
+
+  return MediaSource::MIMEtype();
+}
+
+void MPEG2TransportStreamDemuxedElementaryStream
+::afterGettingFrame(void* clientData,
+		    unsigned frameSize, unsigned numTruncatedBytes,
+		    struct timeval presentationTime,
+		    unsigned durationInMicroseconds) {
+  MPEG2TransportStreamDemuxedElementaryStream* stream
+    = (MPEG2TransportStreamDemuxedElementaryStream*)clientData;
+  stream->afterGettingFrame1(frameSize, numTruncatedBytes,
+			     presentationTime, durationInMicroseconds);
+}
+
+void MPEG2TransportStreamDemuxedElementaryStream
+::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+		     struct timeval presentationTime,
+		     unsigned durationInMicroseconds) {
+  fFrameSize = frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = durationInMicroseconds;
+
+  FramedSource::afterGetting(this);
+}
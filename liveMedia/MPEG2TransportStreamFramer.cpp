@@ -151,17 +151,17 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   }
 
   // Make sure the data begins with a sync byte:
-  unsigned syncBytePosition;
-  for (syncBytePosition = 0; syncBytePosition < fFrameSize; ++syncBytePosition) {
-    if (fTo[syncBytePosition] == TRANSPORT_SYNC_BYTE) break;
-  }
-  if (syncBytePosition == fFrameSize) {
-    envir() << "No Transport Stream sync byte in data.";
-    handleClosure();
-    return;
-  } else if (syncBytePosition > 0) {
+  if (fTo[0] != TRANSPORT_SYNC_BYTE) {
+    unsigned char* syncByte = (unsigned char*)memchr(fTo, TRANSPORT_SYNC_BYTE, fFrameSize);
+    if (syncByte == NULL) {
+      envir() << "No Transport Stream sync byte in data.";
+      handleClosure();
+      return;
+    }
+
     // There's a sync byte, but not at the start of the data.  Move the good data
     // to the start of the buffer, then read more to fill it up again:
+    unsigned const syncBytePosition = syncByte - fTo;
     memmove(fTo, &fTo[syncBytePosition], fFrameSize - syncBytePosition);
     fFrameSize -= syncBytePosition;
     fInputSource->getNextFrame(&fTo[fFrameSize], syncBytePosition,
@@ -174,15 +174,10 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
 
   // Scan through the TS packets that we read, and update our estimate of
   // the duration of each packet:
-  struct timeval tvNow;
-  gettimeofday(&tvNow, NULL);
-  double timeNow = tvNow.tv_sec + tvNow.tv_usec/1000000.0;
-  for (unsigned i = 0; i < numTSPackets; ++i) {
-    if (!updateTSPacketDurationEstimate(&fTo[i*TRANSPORT_PACKET_SIZE], timeNow)) {
-      // We hit a preset limit (based on PCR) within the stream.  Handle this as if the input source has closed:
-      handleClosure();
-      return;
-    }
+  if (!updateTSPacketDurationEstimates(numTSPackets)) {
+    // We hit a preset limit (based on PCR) within the stream.  Handle this as if the input source has closed:
+    handleClosure();
+    return;
   }
 
   fDurationInMicroseconds
@@ -192,6 +187,44 @@ void MPEG2TransportStreamFramer::afterGettingFrame1(unsigned frameSize,
   afterGetting(this);
 }
 
+static double currentTime() {
+  struct timeval tvNow;
+  gettimeofday(&tvNow, NULL);
+  return tvNow.tv_sec + tvNow.tv_usec/1000000.0;
+}
+
+Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimates(unsigned numTSPackets) {
+  // First, check all of the packets' sync bytes at once:
+  u_int8_t syncByteMismatch = 0;
+  for (unsigned i = 0; i < numTSPackets; ++i) {
+    syncByteMismatch |= fTo[i*TRANSPORT_PACKET_SIZE]^TRANSPORT_SYNC_BYTE;
+  }
+  if (syncByteMismatch != 0) {
+    // At least one packet is missing its sync byte, so look at each packet in turn:
+    double const timeNow = currentTime();
+    for (unsigned i = 0; i < numTSPackets; ++i) {
+      if (!updateTSPacketDurationEstimate(&fTo[i*TRANSPORT_PACKET_SIZE], timeNow)) return False;
+    }
+    return True;
+  }
+
+  // Normal case: Only packets that contain a PCR (usually a small fraction of them) change our estimate,
+  // so look just for those.  (We also get the current time only if we find one.)
+  u_int64_t const initialTSPacketCount = fTSPacketCount;
+  double timeNow = 0.0;
+  for (unsigned i = 0; i < numTSPackets; ++i) {
+    unsigned char* pkt = &fTo[i*TRANSPORT_PACKET_SIZE];
+    if ((pkt[3]&0x20) == 0 || pkt[4] == 0 || (pkt[5]&0x10) == 0) continue; // no PCR
+
+    fTSPacketCount = initialTSPacketCount + i + 1; // as if we'd counted each packet up to (and including) this one
+    if (timeNow == 0.0) timeNow = currentTime();
+    if (!updateTSPacketDurationEstimateFromPCR(pkt, timeNow)) return False;
+  }
+  fTSPacketCount = initialTSPacketCount + numTSPackets;
+
+  return True;
+}
+
 Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow) {
   // Sanity check: Make sure we start with the sync byte:
   if (pkt[0] != TRANSPORT_SYNC_BYTE) {
@@ -209,10 +242,15 @@ Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimate(unsigned char
   u_int8_t const adaptation_field_length = pkt[4];
   if (adaptation_field_length == 0) return True;
 
-  u_int8_t const discontinuity_indicator = pkt[5]&0x80;
   u_int8_t const pcrFlag = pkt[5]&0x10;
   if (pcrFlag == 0) return True; // no PCR
 
+  return updateTSPacketDurationEstimateFromPCR(pkt, timeNow);
+}
+
+Boolean MPEG2TransportStreamFramer::updateTSPacketDurationEstimateFromPCR(unsigned char* pkt, double timeNow) {
+  u_int8_t const discontinuity_indicator = pkt[5]&0x80;
+
   // There's a PCR.  Get it, and the PID:
   ++fTSPCRCount;
   u_int32_t pcrBaseHigh = (pkt[6]<<24)|(pkt[7]<<16)|(pkt[8]<<8)|pkt[9];
@@ -148,6 +148,22 @@ void MPEG2TransportStreamFromESSource
 ::addNewInputSource(FramedSource* inputSource,
 		    u_int8_t streamId, int mpegVersion, int16_t PID) {
   if (inputSource == NULL) return;
+  if (PID == -1) {
+    if (isAllocatingPIDs()) { // otherwise we'll use "streamId" as the PID
+      PID = allocatePID();
+      if (PID == -1) {
+	envir() << "MPEG2TransportStreamFromESSource: No PID is available for a new input source (every PID is in use); ignoring it\n";
+	Medium::close(inputSource);
+	return;
+      }
+    }
+  } else if (!reservePID((u_int16_t)PID)) {
+    // (We reserve the PID now, rather than when the source first delivers data, so that our allocator can't hand it out.)
+    envir() << "MPEG2TransportStreamFromESSource: PID " << (int)PID
+	    << " is reserved (or is already in use), so can't be given to a new input source; ignoring it\n";
+    Medium::close(inputSource);
+    return;
+  }
   fInputSources = new InputESSourceRecord(*this, inputSource, streamId,
 					  mpegVersion, fInputSources, PID);
 }
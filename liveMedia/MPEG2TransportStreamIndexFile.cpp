@@ -23,21 +23,114 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MPEG2TransportStreamIndexFile.hh"
 #include "InputFile.hh"
+#include "HashTable.hh"
+
+////////// IndexFileContents //////////
+
+// The contents of an index file, read (in one go) into memory.
+// These are shared by all "MPEG2TransportStreamIndexFile"s (and thus all clients) that use the same file,
+// via a per-environment table (keyed by file name).
+// Note: We copy the file, rather than mapping it, because a mapped file that gets truncated (e.g., by an indexer
+// that rewrites it in place) would crash us (with SIGBUS).  Once read, our copy is never touched by changes to the file;
+// a new "IndexFileContents" is created whenever the file's size has changed.
+
+class IndexFileContents {
+public:
+  static IndexFileContents* lookupOrCreate(UsageEnvironment& env, char const* fileName);
+  void release(); // deletes us when we're no longer being used
+
+  unsigned char const* records() const { return fRecords; }
+  unsigned long numRecords() const { return fNumRecords; }
+
+private:
+  IndexFileContents(UsageEnvironment& env, char const* fileName, u_int64_t fileSize);
+  ~IndexFileContents();
+
+private:
+  UsageEnvironment& fEnv;
+  char* fFileName;
+  u_int64_t fFileSize;
+  unsigned fReferenceCount;
+  unsigned char* fRecords;
+  unsigned long fNumRecords;
+};
+
+IndexFileContents* IndexFileContents::lookupOrCreate(UsageEnvironment& env, char const* fileName) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->indexFileTable == NULL) {
+    ourTables->indexFileTable = HashTable::create(STRING_HASH_KEYS);
+  }
+  HashTable* table = (HashTable*)(ourTables->indexFileTable);
+
+  u_int64_t fileSize = GetFileSize(fileName, NULL);
+  IndexFileContents* contents = (IndexFileContents*)(table->Lookup(fileName));
+  if (contents == NULL || contents->fFileSize != fileSize) {
+    // The file is new to us, or its size has changed since we last read it.  (In the latter case,
+    // the old contents stay - unlisted - for whoever is still using them.)
+    contents = new IndexFileContents(env, fileName, fileSize);
+    table->Add(fileName, contents);
+  }
 
-MPEG2TransportStreamIndexFile
-::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
-  : Medium(env),
-    fFileName(strDup(indexFileName)), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
-    fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0) {
-  // Get the file size, to determine how many index records it contains:
-  u_int64_t indexFileSize = GetFileSize(indexFileName, NULL);
-  if (indexFileSize % INDEX_RECORD_SIZE != 0) {
-    env << "Warning: Size of the index file \"" << indexFileName
- 	<< "\" (" << (unsigned)indexFileSize
+  ++contents->fReferenceCount;
+  return contents;
+}
+
+void IndexFileContents::release() {
+  if (--fReferenceCount > 0) return;
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  HashTable* table = ourTables == NULL ? NULL : (HashTable*)(ourTables->indexFileTable);
+  if (table != NULL && table->Lookup(fFileName) == this) {
+    // (If we're no longer in the table - because the file has since changed - then we're all that remains.)
+    table->Remove(fFileName);
+    if (table->IsEmpty()) {
+      delete table;
+      ourTables->indexFileTable = NULL;
+      ourTables->reclaimIfPossible();
+    }
+  }
+
+  delete this;
+}
+
+IndexFileContents::IndexFileContents(UsageEnvironment& env, char const* fileName, u_int64_t fileSize)
+  : fEnv(env), fFileName(strDup(fileName)), fFileSize(fileSize), fReferenceCount(0),
+    fRecords(NULL), fNumRecords(0) {
+  if (fileSize % INDEX_RECORD_SIZE != 0) {
+    env << "Warning: Size of the index file \"" << fileName
+ 	<< "\" (" << (unsigned)fileSize
 	<< ") is not a multiple of the index record size ("
 	<< INDEX_RECORD_SIZE << ")\n";
   }
-  fNumIndexRecords = (unsigned long)(indexFileSize/INDEX_RECORD_SIZE);
+  u_int64_t const numRecords = fileSize/INDEX_RECORD_SIZE;
+  size_t const recordsSize = (size_t)(numRecords*INDEX_RECORD_SIZE);
+  if (numRecords == 0 || recordsSize != numRecords*INDEX_RECORD_SIZE) return; // empty, or too large for us
+
+  FILE* fid = OpenInputFile(env, fileName);
+  if (fid == NULL) return;
+
+  fRecords = new unsigned char[recordsSize];
+  fNumRecords = (unsigned long)fread(fRecords, INDEX_RECORD_SIZE, (size_t)numRecords, fid);
+      // (This may be fewer records than we expected, if the file has since been truncated.)
+
+  CloseInputFile(fid);
+}
+
+IndexFileContents::~IndexFileContents() {
+  delete[] fRecords;
+  delete[] fFileName;
+}
+
+
+////////// MPEG2TransportStreamIndexFile //////////
+
+MPEG2TransportStreamIndexFile
+::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
+  : Medium(env),
+    fFileName(strDup(indexFileName)), fContents(IndexFileContents::lookupOrCreate(env, indexFileName)),
+    fMPEGVersion(0), fCachedPCR(0.0f), fCachedTSPacketNumber(0), fBuf(NULL) {
+  fRecords = fContents->records();
+  fNumIndexRecords = fContents->numRecords();
 }
 
 MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
@@ -56,7 +149,7 @@ MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
 }
 
 MPEG2TransportStreamIndexFile::~MPEG2TransportStreamIndexFile() {
-  closeFid();
+  fContents->release();
   delete[] fFileName;
 }
 
@@ -77,7 +170,9 @@ void MPEG2TransportStreamIndexFile
   }
 
   // Search for the pair of neighboring index records whose PCR values span "npt".
-  // Use the 'regula-falsi' method.
+  // Use interpolation, but bisect instead whenever the previous interpolation failed to at least halve
+  // the search range.  (This bounds the number of records that we examine to about 2*log2(fNumIndexRecords),
+  // even if the PCR values are very unevenly spaced.)
   Boolean success = False;
   unsigned long ixFound = 0;
   do {
@@ -88,12 +183,14 @@ void MPEG2TransportStreamIndexFile
     if (npt > pcrRight) npt = pcrRight;
         // handle "npt" too large by seeking to the last frame of the file
 
+    Boolean bisectNext = False;
     while (ixRight-ixLeft > 1 && pcrLeft < npt && npt <= pcrRight) {
-      unsigned long ixNew = ixLeft
-	+ (unsigned long)(((npt-pcrLeft)/(pcrRight-pcrLeft))*(ixRight-ixLeft));
+      unsigned long const range = ixRight-ixLeft;
+      unsigned long ixNew = bisectNext ? ixLeft
+	: ixLeft + (unsigned long)(((double)(npt-pcrLeft)/(pcrRight-pcrLeft))*range);
       if (ixNew == ixLeft || ixNew == ixRight) {
 	// use bisection instead:
-	ixNew = (ixLeft+ixRight)/2;
+	ixNew = ixLeft + range/2;
       }
       if (!readIndexRecord(ixNew)) break;
       float pcrNew = pcrFromBuf();
@@ -104,6 +201,7 @@ void MPEG2TransportStreamIndexFile
 	pcrRight = pcrNew;
 	ixRight = ixNew;
       }
+      bisectNext = !bisectNext && ixRight-ixLeft > range/2;
     }
     if (ixRight-ixLeft > 1 || npt <= pcrLeft || npt > pcrRight) break; // bad PCR values in index file?
 
@@ -122,7 +220,6 @@ void MPEG2TransportStreamIndexFile
     npt = 0.0f;
     tsPacketNumber = indexRecordNumber = 0;
   }
-  closeFid();
 }
 
 void MPEG2TransportStreamIndexFile
@@ -142,7 +239,7 @@ void MPEG2TransportStreamIndexFile
   }
 
   // Search for the pair of neighboring index records whose TS packet #s span "tsPacketNumber".
-  // Use the 'regula-falsi' method.
+  // (As above, use interpolation - falling back to bisection.)
   Boolean success = False;
   unsigned long ixFound = 0;
   do {
@@ -153,12 +250,14 @@ void MPEG2TransportStreamIndexFile
     if (tsPacketNumber > tsRight) tsPacketNumber = tsRight;
         // handle "tsPacketNumber" too large by seeking to the last frame of the file
 
+    Boolean bisectNext = False;
     while (ixRight-ixLeft > 1 && tsLeft < tsPacketNumber && tsPacketNumber <= tsRight) {
-      unsigned long ixNew = ixLeft
-	+ (unsigned long)(((tsPacketNumber-tsLeft)/(tsRight-tsLeft))*(ixRight-ixLeft));
+      unsigned long const range = ixRight-ixLeft;
+      unsigned long ixNew = bisectNext ? ixLeft
+	: ixLeft + (unsigned long)(((double)(tsPacketNumber-tsLeft)/(tsRight-tsLeft))*range);
       if (ixNew == ixLeft || ixNew == ixRight) {
 	// Use bisection instead:
-	ixNew = (ixLeft+ixRight)/2;
+	ixNew = ixLeft + range/2;
       }
       if (!readIndexRecord(ixNew)) break;
       unsigned long tsNew = tsPacketNumFromBuf();
@@ -169,6 +268,7 @@ void MPEG2TransportStreamIndexFile
 	tsRight = tsNew;
 	ixRight = ixNew;
       }
+      bisectNext = !bisectNext && ixRight-ixLeft > range/2;
     }
     if (ixRight-ixLeft > 1 || tsPacketNumber <= tsLeft || tsPacketNumber > tsRight) break; // bad PCR values in index file?
 
@@ -192,7 +292,6 @@ void MPEG2TransportStreamIndexFile
     pcr = 0.0f;
     indexRecordNumber = 0;
   }
-  closeFid();
 }
 
 Boolean MPEG2TransportStreamIndexFile
@@ -210,7 +309,7 @@ Boolean MPEG2TransportStreamIndexFile
 }
 
 float MPEG2TransportStreamIndexFile::getPlayingDuration() {
-  if (fNumIndexRecords == 0 || !readOneIndexRecord(fNumIndexRecords-1)) return 0.0f;
+  if (fNumIndexRecords == 0 || !readIndexRecord(fNumIndexRecords-1)) return 0.0f;
 
   return pcrFromBuf();
 }
@@ -219,56 +318,17 @@ int MPEG2TransportStreamIndexFile::mpegVersion() {
   if (fMPEGVersion != 0) return fMPEGVersion; // we already know it
 
   // Read the first index record, and figure out the MPEG version from its type:
-  if (!readOneIndexRecord(0)) return 0; // unknown; perhaps the indecx file is empty?	
+  if (!readIndexRecord(0)) return 0; // unknown; perhaps the indecx file is empty?	
 
   setMPEGVersionFromRecordType(recordTypeFromBuf());
   return fMPEGVersion;
 }
 
-Boolean MPEG2TransportStreamIndexFile::openFid() {
-  if (fFid == NULL && fFileName != NULL) {
-    if ((fFid = OpenInputFile(envir(), fFileName)) != NULL) {
-      fCurrentIndexRecordNum = 0;
-    }
-  }
-
-  return fFid != NULL;
-}
-
-Boolean MPEG2TransportStreamIndexFile::seekToIndexRecord(unsigned long indexRecordNumber) {
-  if (!openFid()) return False;
-
-  if (indexRecordNumber == fCurrentIndexRecordNum) return True; // we're already there
-
-  if (SeekFile64(fFid, (int64_t)(indexRecordNumber*INDEX_RECORD_SIZE), SEEK_SET) != 0) return False;
-  fCurrentIndexRecordNum = indexRecordNumber;
-  return True;
-}
-
 Boolean MPEG2TransportStreamIndexFile::readIndexRecord(unsigned long indexRecordNum) {
-  do {
-    if (!seekToIndexRecord(indexRecordNum)) break;
-    if (fread(fBuf, INDEX_RECORD_SIZE, 1, fFid) != 1) break;
-    ++fCurrentIndexRecordNum;
-
-    return True;
-  } while (0);
-
-  return False; // an error occurred
-}
+  if (indexRecordNum >= fNumIndexRecords) return False;
 
-Boolean MPEG2TransportStreamIndexFile::readOneIndexRecord(unsigned long indexRecordNum) {
-  Boolean result = readIndexRecord(indexRecordNum);
-  closeFid();
-
-  return result;
-}
-
-void MPEG2TransportStreamIndexFile::closeFid() {
-  if (fFid != NULL) {
-    CloseInputFile(fFid);
-    fFid = NULL;
-  }
+  fBuf = &fRecords[indexRecordNum*INDEX_RECORD_SIZE];
+  return True;
 }
 
 float MPEG2TransportStreamIndexFile::pcrFromBuf() {
@@ -0,0 +1,632 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A class that generates an index file (for 'trick play') from a Transport Stream file - without using
+// the event loop.  Large files are split into parts that are indexed at the same time (on separate threads).
+// The index can also be extended as the Transport Stream file grows (e.g., while a recording is being made).
+// Implementation
+
+#include "MPEG2TransportStreamIndexGenerator.hh"
+#include "MPEG2TransportStreamIndexFile.hh"
+#include "InputFile.hh"
+#include "OutputFile.hh"
+
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(_WIN32_WCE) && !defined(NO_INDEXING_THREADS)
+#define USE_INDEXING_THREADS 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Each part of a file that's indexed separately is at least this large:
+#ifndef MIN_INDEX_CHUNK_SIZE
+#define MIN_INDEX_CHUNK_SIZE (8*1024*1024)
+#endif
+
+// The number of parts per thread (more than one, to balance the load):
+#define CHUNKS_PER_THREAD 4
+
+// The (approximate) size of the final part of the file, which we index (sequentially) ourself:
+#define TAIL_SIZE (1024*1024)
+
+// How many Transport Stream packets we read at a time:
+#define PACKETS_PER_READ 1024
+
+#define TRANSPORT_SYNC_BYTE 0x47
+
+////////// IndexChunk //////////
+
+// A part of the file - from one 'sync point' (see "findSyncPoint()" below) to the next - that's indexed separately.
+
+class IndexChunk {
+public:
+  IndexChunk();
+  virtual ~IndexChunk();
+
+  void index(char const* fileName, Boolean (*shouldAbort)(void* clientData), void* clientData);
+      // Note: Called from a separate thread (if we're using threads).  "shouldAbort(clientData)" is checked
+      // (from this thread) once per read, and indexing stops early if it returns True.
+  void saveIndexRecords(MPEG2TransportStreamIndexParser& parser);
+
+public:
+  // Set up before we're indexed:
+  unsigned long fStartPacket, fEndPacket;
+  unsigned fStartSplit; // if >0, we skip this many bytes of packet "fStartPacket"s video data (and its PCR)
+  unsigned fEndSplit; // if >0, we also index this many bytes of packet "fEndPacket"s video data
+  u_int8_t fLastContinuityCounter; // of the video packet before "fStartPacket"
+  MPEG2TransportStreamIndexParser::StreamState fInitialStreamState;
+
+  // Our results:
+  unsigned char* fRecords; // index records (their PCR fields get filled in later, when we're stitched)
+  u_int32_t* fPCRCounts; // for each record: the number of "fPCRValues" that preceded it
+  unsigned long fNumRecords, fRecordsSize;
+  float* fPCRValues;
+  u_int32_t fNumPCRValues;
+  MPEG2TransportStreamIndexParser::StreamState fFinalStreamState;
+  Boolean fEndedEarly; // because of bad data (in which case the file gets indexed sequentially instead)
+  Boolean fIsComplete; // iff all of our data got indexed
+  Boolean fIsDone;
+};
+
+IndexChunk::IndexChunk()
+  : fStartPacket(0), fEndPacket(0), fStartSplit(0), fEndSplit(0), fLastContinuityCounter(~0),
+    fRecords(NULL), fPCRCounts(NULL), fNumRecords(0), fRecordsSize(0),
+    fPCRValues(NULL), fNumPCRValues(0),
+    fEndedEarly(False), fIsComplete(False), fIsDone(False) {
+}
+
+IndexChunk::~IndexChunk() {
+  delete[] fRecords; delete[] fPCRCounts; delete[] fPCRValues;
+}
+
+void IndexChunk::saveIndexRecords(MPEG2TransportStreamIndexParser& parser) {
+  while (1) {
+    if (fNumRecords == fRecordsSize) {
+      unsigned long newSize = fRecordsSize == 0 ? 65536 : 2*fRecordsSize;
+      unsigned char* newRecords = new unsigned char[newSize*INDEX_RECORD_SIZE];
+      u_int32_t* newPCRCounts = new u_int32_t[newSize];
+      if (fNumRecords > 0) {
+	memmove(newRecords, fRecords, fNumRecords*INDEX_RECORD_SIZE);
+	memmove(newPCRCounts, fPCRCounts, fNumRecords*sizeof (u_int32_t));
+      }
+      delete[] fRecords; fRecords = newRecords;
+      delete[] fPCRCounts; fPCRCounts = newPCRCounts;
+      fRecordsSize = newSize;
+    }
+
+    if (parser.getNextIndexRecord(&fRecords[fNumRecords*INDEX_RECORD_SIZE], &fPCRCounts[fNumRecords])) {
+      ++fNumRecords;
+    } else if (!parser.parseFrame()) {
+      break;
+    }
+  }
+}
+
+void IndexChunk::index(char const* fileName, Boolean (*shouldAbort)(void* clientData), void* clientData) {
+  MPEG2TransportStreamIndexParser parser(NULL, True);
+  if (fStartPacket > 0) {
+    parser.setStreamState(fInitialStreamState);
+    parser.setLastContinuityCounter(fLastContinuityCounter);
+    parser.setNextPacketNumber(fStartPacket);
+  }
+
+  unsigned long const lastPacket = fEndSplit > 0 ? fEndPacket+1 : fEndPacket;
+  unsigned char* buf = new unsigned char[PACKETS_PER_READ*TRANSPORT_PACKET_SIZE];
+  FILE* fid = fopen(fileName, "rb");
+  if (fid == NULL || SeekFile64(fid, (int64_t)fStartPacket*TRANSPORT_PACKET_SIZE, SEEK_SET) != 0) {
+    fEndedEarly = True;
+  }
+
+  unsigned long packetNum = fStartPacket;
+  while (packetNum < lastPacket && !fEndedEarly && !(*shouldAbort)(clientData)) {
+    unsigned long numToRead = lastPacket - packetNum;
+    if (numToRead > PACKETS_PER_READ) numToRead = PACKETS_PER_READ;
+    unsigned long numRead = fread(buf, TRANSPORT_PACKET_SIZE, numToRead, fid);
+    if (numRead < numToRead) fEndedEarly = True;
+
+    for (unsigned long i = 0; i < numRead; ++i, ++packetNum) {
+      // As in "MPEG2IFrameIndexFromTransportStream", parse as much as we can before adding each packet:
+      saveIndexRecords(parser);
+      if (!parser.makeRoomForPacket()) {
+	fEndedEarly = True;
+	break;
+      }
+
+      unsigned char const* pkt = &buf[i*TRANSPORT_PACKET_SIZE];
+      Boolean result;
+      if (packetNum == fStartPacket && fStartSplit > 0) {
+	result = parser.addTransportPacket(pkt, TRANSPORT_PACKET_SIZE, fStartSplit, TRANSPORT_PACKET_SIZE, True);
+      } else if (packetNum == fEndPacket) {
+	result = parser.addTransportPacket(pkt, TRANSPORT_PACKET_SIZE, 0, fEndSplit);
+      } else {
+	result = parser.addTransportPacket(pkt, TRANSPORT_PACKET_SIZE);
+      }
+      if (!result) {
+	fEndedEarly = True;
+	break;
+      }
+    }
+  }
+  if (fid != NULL) fclose(fid);
+  delete[] buf;
+
+  // Parse our final frame.  (Its end is where the next chunk's first frame starts.)
+  saveIndexRecords(parser);
+  if (parser.addEndOfInputCode()) saveIndexRecords(parser);
+  fIsComplete = !parser.haveUnparsedData() && !fEndedEarly;
+
+  fFinalStreamState = parser.streamState();
+  fNumPCRValues = parser.numPCRValues();
+  fPCRValues = new float[fNumPCRValues+1];
+  memmove(fPCRValues, parser.pcrValues(), fNumPCRValues*sizeof (float));
+}
+
+
+////////// Thread pool //////////
+
+#ifdef USE_INDEXING_THREADS
+class IndexingThreadPool {
+public:
+  IndexingThreadPool(char const* fileName, IndexChunk* chunks, unsigned numChunks, unsigned numThreads);
+  virtual ~IndexingThreadPool(); // aborts (and waits for) any remaining indexing
+
+  void waitUntilDone(IndexChunk& chunk);
+
+private:
+  static void* threadMain(void* arg);
+  static Boolean shouldAbort(void* clientData);
+
+private:
+  char const* fFileName;
+  IndexChunk* fChunks;
+  unsigned fNumChunks, fNextChunk;
+  pthread_t* fThreads;
+  unsigned fNumThreads;
+  pthread_mutex_t fMutex;
+  pthread_cond_t fChunkIsDone;
+  Boolean fAbort; // protected by "fMutex" (like "fNextChunk", and each chunk's "fIsDone")
+};
+
+IndexingThreadPool::IndexingThreadPool(char const* fileName, IndexChunk* chunks, unsigned numChunks,
+				       unsigned numThreads)
+  : fFileName(fileName), fChunks(chunks), fNumChunks(numChunks), fNextChunk(0),
+    fThreads(new pthread_t[numThreads]), fNumThreads(0), fAbort(False) {
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fChunkIsDone, NULL);
+  for (unsigned i = 0; i < numThreads; ++i) {
+    if (pthread_create(&fThreads[fNumThreads], NULL, threadMain, this) == 0) ++fNumThreads;
+  }
+}
+
+IndexingThreadPool::~IndexingThreadPool() {
+  pthread_mutex_lock(&fMutex);
+  fAbort = True;
+  pthread_mutex_unlock(&fMutex);
+  for (unsigned i = 0; i < fNumThreads; ++i) pthread_join(fThreads[i], NULL);
+  pthread_cond_destroy(&fChunkIsDone);
+  pthread_mutex_destroy(&fMutex);
+  delete[] fThreads;
+}
+
+void IndexingThreadPool::waitUntilDone(IndexChunk& chunk) {
+  pthread_mutex_lock(&fMutex);
+  while (!chunk.fIsDone) {
+    if (fNumThreads == 0 && fNextChunk < fNumChunks) {
+      // We couldn't create any threads, so do the indexing ourself:
+      IndexChunk& nextChunk = fChunks[fNextChunk++];
+      pthread_mutex_unlock(&fMutex);
+      nextChunk.index(fFileName, shouldAbort, this);
+      pthread_mutex_lock(&fMutex);
+      nextChunk.fIsDone = True;
+    } else {
+      pthread_cond_wait(&fChunkIsDone, &fMutex);
+    }
+  }
+  pthread_mutex_unlock(&fMutex);
+}
+
+void* IndexingThreadPool::threadMain(void* arg) {
+  IndexingThreadPool* pool = (IndexingThreadPool*)arg;
+
+  pthread_mutex_lock(&pool->fMutex);
+  while (pool->fNextChunk < pool->fNumChunks && !pool->fAbort) {
+    IndexChunk& chunk = pool->fChunks[pool->fNextChunk++];
+    pthread_mutex_unlock(&pool->fMutex);
+
+    chunk.index(pool->fFileName, shouldAbort, pool);
+
+    pthread_mutex_lock(&pool->fMutex);
+    chunk.fIsDone = True;
+    pthread_cond_broadcast(&pool->fChunkIsDone);
+  }
+  pthread_mutex_unlock(&pool->fMutex);
+
+  return NULL;
+}
+
+Boolean IndexingThreadPool::shouldAbort(void* clientData) {
+  IndexingThreadPool* pool = (IndexingThreadPool*)clientData;
+
+  pthread_mutex_lock(&pool->fMutex);
+  Boolean result = pool->fAbort;
+  pthread_mutex_unlock(&pool->fMutex);
+
+  return result;
+}
+#endif
+
+
+////////// MPEG2TransportStreamIndexGenerator implementation //////////
+
+MPEG2TransportStreamIndexGenerator*
+MPEG2TransportStreamIndexGenerator::createNew(UsageEnvironment& env, char const* tsFileName,
+					      char const* indexFileName, unsigned numThreads) {
+  FILE* tsFid = OpenInputFile(env, tsFileName);
+  if (tsFid == NULL) return NULL;
+
+  // Write the index file under a temporary name at first, so that anyone who's reading an existing index file
+  // (e.g., a server) doesn't see it get truncated.  We rename it once we've indexed the file's existing data:
+  char* tempIndexFileName = new char[strlen(indexFileName) + 4/*".tmp"*/ + 1];
+  sprintf(tempIndexFileName, "%s.tmp", indexFileName);
+  FILE* indexFid = OpenOutputFile(env, tempIndexFileName);
+  if (indexFid == NULL) {
+    delete[] tempIndexFileName;
+    CloseInputFile(tsFid);
+    return NULL;
+  }
+
+  if (numThreads == 0) {
+#ifdef USE_INDEXING_THREADS
+    long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    numThreads = numCPUs > 0 ? (unsigned)numCPUs : 1;
+#else
+    numThreads = 1;
+#endif
+  }
+
+  return new MPEG2TransportStreamIndexGenerator(env, tsFileName, indexFileName, tempIndexFileName,
+						tsFid, indexFid, numThreads);
+}
+
+MPEG2TransportStreamIndexGenerator
+::MPEG2TransportStreamIndexGenerator(UsageEnvironment& env, char const* tsFileName, char const* indexFileName,
+				     char* tempIndexFileName, FILE* tsFid, FILE* indexFid, unsigned numThreads)
+  : Medium(env),
+    fTSFileName(strDup(tsFileName)), fIndexFileName(strDup(indexFileName)), fTempIndexFileName(tempIndexFileName),
+    fTSFid(tsFid), fIndexFid(indexFid), fNumThreads(numThreads),
+    fParser(NULL), fNextPacketNumber(0), fNextPacketVESStart(0),
+    fFirstPCR(0.0f), fLastPCR(0.0f), fHaveSeenFirstPCR(False), fClosureNumber(0),
+    fHaveStarted(False), fHaveFinished(False), fNumIndexRecords(0) {
+}
+
+MPEG2TransportStreamIndexGenerator::~MPEG2TransportStreamIndexGenerator() {
+  delete fParser;
+  if (fIndexFid != NULL) CloseOutputFile(fIndexFid);
+  if (fTempIndexFileName != NULL) remove(fTempIndexFileName); // we never got as far as replacing the index file
+  CloseInputFile(fTSFid);
+  delete[] fTSFileName; delete[] fIndexFileName; delete[] fTempIndexFileName;
+}
+
+unsigned long MPEG2TransportStreamIndexGenerator::indexNewData() {
+  if (fHaveFinished) return 0;
+  unsigned long const numRecordsBefore = fNumIndexRecords;
+  unsigned long const numPackets
+    = (unsigned long)(GetFileSize(fTSFileName, NULL)/TRANSPORT_PACKET_SIZE);
+
+  Boolean const isFirstCall = !fHaveStarted;
+  if (isFirstCall) {
+    fHaveStarted = True;
+    if (!indexInParallel(numPackets)) restart();
+  }
+
+  // Index - sequentially - the packets that we haven't yet seen:
+  if (!fHaveFinished && fNextPacketNumber < numPackets
+      && SeekFile64(fTSFid, (int64_t)fNextPacketNumber*TRANSPORT_PACKET_SIZE, SEEK_SET) == 0) {
+    unsigned char* buf = new unsigned char[PACKETS_PER_READ*TRANSPORT_PACKET_SIZE];
+    while (fNextPacketNumber < numPackets) {
+      unsigned long numToRead = numPackets - fNextPacketNumber;
+      if (numToRead > PACKETS_PER_READ) numToRead = PACKETS_PER_READ;
+      unsigned long numRead = fread(buf, TRANSPORT_PACKET_SIZE, numToRead, fTSFid);
+
+      for (unsigned long i = 0; i < numRead && !fHaveFinished; ) {
+	deliverIndexRecords();
+	if (!fParser->makeRoomForPacket()) {
+	  envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
+	  // Treat this as if the input ended (then try again):
+	  handleInputClosure();
+	  continue;
+	}
+
+	Boolean result = fParser->addTransportPacket(&buf[i*TRANSPORT_PACKET_SIZE], TRANSPORT_PACKET_SIZE,
+						     fNextPacketVESStart, TRANSPORT_PACKET_SIZE,
+						     fNextPacketVESStart > 0);
+	fNextPacketVESStart = 0;
+	++i; ++fNextPacketNumber;
+	if (!result) {
+	  // Treat bad data as if the input ended (then continue with the next packet):
+	  handleInputClosure();
+	}
+      }
+      if (fHaveFinished || numRead < numToRead/*shouldn't happen*/) break;
+    }
+    delete[] buf;
+  }
+
+  if (fParser != NULL) deliverIndexRecords();
+  if (fIndexFid != NULL) fflush(fIndexFid);
+  if (isFirstCall) replaceIndexFile();
+  return fNumIndexRecords - numRecordsBefore;
+}
+
+void MPEG2TransportStreamIndexGenerator::finish() {
+  if (fHaveFinished) return;
+
+  if (!fHaveStarted) indexNewData();
+  if (fParser != NULL && !fHaveFinished) handleInputClosure();
+  if (fIndexFid != NULL) fflush(fIndexFid);
+  fHaveFinished = True;
+}
+
+void MPEG2TransportStreamIndexGenerator::restart() {
+  // Start again, indexing the whole file sequentially.
+  // (This happens only before "replaceIndexFile()", so it's our temporary file that we're truncating.)
+  if (fIndexFid != NULL) CloseOutputFile(fIndexFid);
+  fIndexFid = OpenOutputFile(envir(), fTempIndexFileName);
+  if (fIndexFid == NULL) fHaveFinished = True;
+
+  delete fParser; fParser = new MPEG2TransportStreamIndexParser(&envir());
+  fNextPacketNumber = 0; fNextPacketVESStart = 0;
+  fFirstPCR = fLastPCR = 0.0f; fHaveSeenFirstPCR = False;
+  fClosureNumber = 0;
+  fNumIndexRecords = 0;
+}
+
+void MPEG2TransportStreamIndexGenerator::replaceIndexFile() {
+  // Our temporary index file now covers all of the Transport Stream file's existing data, so rename it to
+  // replace the old index file.  Any further records are appended to it (which is safe for its readers).
+  if (fIndexFid == NULL || fTempIndexFileName == NULL) return;
+  CloseOutputFile(fIndexFid);
+#if defined(__WIN32__) || defined(_WIN32) || defined(_WIN32_WCE)
+  remove(fIndexFileName); // because "rename()" doesn't replace an existing file here
+#endif
+  if (rename(fTempIndexFileName, fIndexFileName) != 0) {
+    envir() << "Failed to rename \"" << fTempIndexFileName << "\" to \"" << fIndexFileName << "\"\n";
+    fIndexFid = NULL;
+    fHaveFinished = True;
+    return;
+  }
+  delete[] fTempIndexFileName; fTempIndexFileName = NULL;
+
+  fIndexFid = fopen(fIndexFileName, "ab");
+  if (fIndexFid == NULL) fHaveFinished = True;
+}
+
+static Boolean findStreamState(FILE* fid, unsigned long maxNumPackets,
+			       MPEG2TransportStreamIndexParser::StreamState& streamState) {
+  // Parse the start of the file, until we see its (first) PAT and PMT:
+  if (SeekFile64(fid, 0, SEEK_SET) != 0) return False;
+  MPEG2TransportStreamIndexParser parser(NULL);
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  unsigned char record[INDEX_RECORD_SIZE];
+
+  for (unsigned long i = 0; i < maxNumPackets && !parser.haveSeenPMT(); ++i) {
+    while (parser.getNextIndexRecord(record) || parser.parseFrame()) {}
+    if (!parser.makeRoomForPacket()) return False;
+    if (fread(pkt, TRANSPORT_PACKET_SIZE, 1, fid) != 1) return False;
+    if (!parser.addTransportPacket(pkt, TRANSPORT_PACKET_SIZE)) return False;
+  }
+  streamState = parser.streamState();
+  return parser.haveSeenPMT();
+}
+
+static Boolean findSyncPoint(FILE* fid, unsigned long fromPacket, unsigned long toPacket,
+			     MPEG2TransportStreamIndexParser::StreamState const& streamState,
+			     unsigned long& syncPacket, unsigned& split, u_int8_t& lastContinuityCounter) {
+  // Look for a place where a sequential index would have ended one frame, and begun the next - at the start of
+  // a video PES packet whose data begins with a start code (of a kind that always ends the preceding frame).
+  // The index records that precede this point then don't depend on those that follow it (and vice versa),
+  // apart from the PCR values - which we fill in later.  Any zero bytes before the "00 00 01" belong to the
+  // preceding frame; so we record how many there are (as "split").
+  if (SeekFile64(fid, (int64_t)fromPacket*TRANSPORT_PACKET_SIZE, SEEK_SET) != 0) return False;
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  Boolean haveSeenVideoPacket = False;
+  u_int8_t lastCC = 0;
+  unsigned char lastBytes[3] = {0xFF, 0xFF, 0xFF}; // the last 3 bytes of video data that we saw
+  unsigned numLastBytes = 0;
+
+  for (unsigned long packetNum = fromPacket; packetNum < toPacket; ++packetNum) {
+    if (fread(pkt, TRANSPORT_PACKET_SIZE, 1, fid) != 1 || pkt[0] != TRANSPORT_SYNC_BYTE) return False;
+
+    // Check the packet in the same way as "MPEG2TransportStreamIndexParser::addTransportPacket()":
+    u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+    if (PID != streamState.video_PID) continue;
+    u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
+    unsigned totalHeaderSize = adaptation_field_control <= 1 ? 4 : 5 + pkt[4];
+    if ((adaptation_field_control == 2 && totalHeaderSize != TRANSPORT_PACKET_SIZE) ||
+	(adaptation_field_control == 3 && totalHeaderSize >= TRANSPORT_PACKET_SIZE)) continue;
+    if (!(adaptation_field_control == 1 || adaptation_field_control == 3)) continue;
+    u_int8_t continuity_counter = pkt[3]&0x0F;
+    if (haveSeenVideoPacket && continuity_counter == lastCC) continue; // a duplicate packet
+
+    Boolean isStartOfPESPacket = False;
+    if ((pkt[1]&0x40) != 0 && totalHeaderSize < TRANSPORT_PACKET_SIZE - 8
+	&& pkt[totalHeaderSize] == 0x00 && pkt[totalHeaderSize+1] == 0x00 && pkt[totalHeaderSize+2] == 0x01) {
+      totalHeaderSize += 9 + pkt[totalHeaderSize+8];
+      if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) return False;
+      isStartOfPESPacket = True;
+    }
+
+    if (isStartOfPESPacket && haveSeenVideoPacket && numLastBytes == 3
+	&& !(lastBytes[0] == 0 && lastBytes[1] == 0 && lastBytes[2] == 1)) {
+      // (That last check excludes the (unlikely) case of a start code ending just before this packet.)
+      unsigned i = totalHeaderSize;
+      while (i < TRANSPORT_PACKET_SIZE && pkt[i] == 0) ++i;
+      if (i >= totalHeaderSize+2 && i+1 < TRANSPORT_PACKET_SIZE && pkt[i] == 1) {
+	u_int8_t code = pkt[i+1];
+	if (streamState.isH264 || streamState.isH265
+	    || code == 0x00/*picture*/ || code == 0xB6/*VOP*/) {
+	  syncPacket = packetNum;
+	  split = i-2 - totalHeaderSize;
+	  lastContinuityCounter = lastCC;
+	  return True;
+	}
+      }
+    }
+
+    haveSeenVideoPacket = True;
+    lastCC = continuity_counter;
+    for (unsigned j = totalHeaderSize; j < TRANSPORT_PACKET_SIZE; ++j) {
+      lastBytes[0] = lastBytes[1]; lastBytes[1] = lastBytes[2]; lastBytes[2] = pkt[j];
+      if (numLastBytes < 3) ++numLastBytes;
+    }
+  }
+
+  return False;
+}
+
+Boolean MPEG2TransportStreamIndexGenerator::indexInParallel(unsigned long numPackets) {
+#ifdef USE_INDEXING_THREADS
+  unsigned long const packetsPerChunk = MIN_INDEX_CHUNK_SIZE/TRANSPORT_PACKET_SIZE;
+  unsigned long const numTailPackets = TAIL_SIZE/TRANSPORT_PACKET_SIZE;
+  if (fNumThreads < 2 || numPackets < 2*packetsPerChunk + numTailPackets) return False;
+
+  MPEG2TransportStreamIndexParser::StreamState streamState;
+  if (!findStreamState(fTSFid, packetsPerChunk, streamState)) return False;
+
+  // Divide the file (apart from its tail) into chunks, each starting at a 'sync point':
+  unsigned long const numParallelPackets = numPackets - numTailPackets;
+  unsigned numChunks = fNumThreads*CHUNKS_PER_THREAD;
+  if (numChunks > numParallelPackets/packetsPerChunk) numChunks = numParallelPackets/packetsPerChunk;
+  IndexChunk* chunks = new IndexChunk[numChunks];
+  unsigned numChunksFound = 1; // chunk 0 starts at the start of the file
+  unsigned long tailStart = 0;
+  unsigned tailSplit = 0;
+  u_int8_t tailLastCC = 0;
+  for (unsigned i = 1; i <= numChunks; ++i) {
+    unsigned long syncPacket; unsigned split; u_int8_t lastCC;
+    if (i < numChunks) {
+      unsigned long from = (numParallelPackets/numChunks)*i;
+      if (!findSyncPoint(fTSFid, from, from + numParallelPackets/numChunks, streamState,
+			 syncPacket, split, lastCC)) continue; // this chunk gets merged with the previous one
+      IndexChunk& chunk = chunks[numChunksFound++];
+      chunk.fStartPacket = syncPacket; chunk.fStartSplit = split; chunk.fLastContinuityCounter = lastCC;
+      chunk.fInitialStreamState = streamState;
+    } else {
+      if (!findSyncPoint(fTSFid, numParallelPackets, numPackets, streamState,
+			 syncPacket, split, lastCC)) break;
+      tailStart = syncPacket; tailSplit = split; tailLastCC = lastCC;
+    }
+  }
+  if (tailStart == 0) {
+    delete[] chunks;
+    return False;
+  }
+  for (unsigned i = 0; i < numChunksFound; ++i) {
+    IndexChunk& chunk = chunks[i];
+    if (i+1 < numChunksFound) {
+      chunk.fEndPacket = chunks[i+1].fStartPacket; chunk.fEndSplit = chunks[i+1].fStartSplit;
+    } else {
+      chunk.fEndPacket = tailStart; chunk.fEndSplit = tailSplit;
+    }
+  }
+
+  // Index the chunks (in parallel), and write out their index records (in order):
+  Boolean success = True;
+  {
+    IndexingThreadPool threadPool(fTSFileName, chunks, numChunksFound,
+				  fNumThreads < numChunksFound ? fNumThreads : numChunksFound);
+    for (unsigned i = 0; i < numChunksFound; ++i) {
+      threadPool.waitUntilDone(chunks[i]);
+      if (!stitchChunk(chunks[i], streamState)) {
+	success = False;
+	break;
+      }
+    }
+  }
+  delete[] chunks;
+  if (!success) return False;
+
+  // Index the rest of the file sequentially (continuing on from where the last chunk ended):
+  fParser = new MPEG2TransportStreamIndexParser(&envir());
+  fParser->setStreamState(streamState);
+  fParser->setLastContinuityCounter(tailLastCC);
+  fParser->setNextPacketNumber(tailStart);
+  fParser->setPCRState(fFirstPCR, fLastPCR, fHaveSeenFirstPCR);
+  fNextPacketNumber = tailStart;
+  fNextPacketVESStart = tailSplit;
+  return True;
+#else
+  return False;
+#endif
+}
+
+Boolean MPEG2TransportStreamIndexGenerator
+::stitchChunk(IndexChunk& chunk, MPEG2TransportStreamIndexParser::StreamState const& streamState) {
+  // Compute the PCR values (relative to the file's first PCR) for the chunk's index records.  We go through
+  // the chunk's PCRs in the same way as "MPEG2TransportStreamIndexParser::addTransportPacket()" does,
+  // so that we get the same values (and warnings) that a sequential index would have:
+  float* relativePCRs = new float[chunk.fNumPCRValues+1];
+  relativePCRs[0] = fLastPCR - fFirstPCR;
+  for (u_int32_t i = 0; i < chunk.fNumPCRValues; ++i) {
+    float pcr = chunk.fPCRValues[i];
+    if (!fHaveSeenFirstPCR) {
+      fFirstPCR = pcr;
+      fHaveSeenFirstPCR = True;
+    } else if (pcr < fLastPCR) {
+      envir() << "\nWarning: At about " << fLastPCR-fFirstPCR
+	      << " seconds into the file, the PCR timestamp decreased - from "
+	      << fLastPCR << " to " << pcr << "\n";
+      fFirstPCR -= (fLastPCR - pcr);
+    }
+    fLastPCR = pcr;
+    relativePCRs[i+1] = fLastPCR - fFirstPCR;
+  }
+
+  for (unsigned long i = 0; i < chunk.fNumRecords; ++i) {
+    MPEG2TransportStreamIndexParser::packPCR(&chunk.fRecords[i*INDEX_RECORD_SIZE], relativePCRs[chunk.fPCRCounts[i]]);
+  }
+  delete[] relativePCRs;
+  if (fIndexFid != NULL) fwrite(chunk.fRecords, INDEX_RECORD_SIZE, chunk.fNumRecords, fIndexFid);
+  fNumIndexRecords += chunk.fNumRecords;
+
+  // The next chunk (or our tail) assumed that this chunk would end - cleanly - in the same state that it began:
+  return chunk.fIsComplete && chunk.fFinalStreamState == streamState;
+}
+
+Boolean MPEG2TransportStreamIndexGenerator::handleInputClosure() {
+  // Do the same as "MPEG2IFrameIndexFromTransportStream::handleInputClosure1()": The first time, we arrange for
+  // any remaining data to get parsed, and continue.  Otherwise, we're done.
+  if (++fClosureNumber == 1 && fParser->addEndOfInputCode()) {
+    deliverIndexRecords();
+    return True;
+  }
+
+  fHaveFinished = True;
+  return False;
+}
+
+void MPEG2TransportStreamIndexGenerator::deliverIndexRecords() {
+  unsigned char record[INDEX_RECORD_SIZE];
+
+  while (1) {
+    if (fParser->getNextIndexRecord(record)) {
+      if (fIndexFid != NULL) fwrite(record, 1, INDEX_RECORD_SIZE, fIndexFid);
+      ++fNumIndexRecords;
+    } else if (!fParser->parseFrame()) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,86 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Parsing of the Program Association Table (PAT) and Program Map Table (PMT) in a Transport Stream
+// (used by "MPEG2TransportStreamDemux" and "MPEG2TransportStreamIndexParser")
+// Implementation
+
+#include "MPEG2TransportStreamPSIParser.hh"
+
+#define PAT_TABLE_ID 0x00
+#define PMT_TABLE_ID 0x02
+
+static unsigned char const* skipPointerField(unsigned char const* payload, unsigned& payloadSize) {
+  // Returns the start of the section (or NULL if there's no room for one):
+  if (payloadSize == 0) return NULL;
+  unsigned pointer_field = payload[0];
+  if (1 + pointer_field >= payloadSize) return NULL;
+
+  payloadSize -= 1 + pointer_field;
+  return &payload[1 + pointer_field];
+}
+
+static unsigned endOfSectionData(unsigned char const* section, unsigned size) {
+  // Returns the offset (within the section, but no further than "size") of the section's 'CRC_32':
+  unsigned section_length = ((section[1]&0x0F)<<8) | section[2];
+  if (section_length < 4) return 0;
+  unsigned end = 3 + section_length - 4/*CRC_32*/;
+  return end < size ? end : size;
+}
+
+Boolean parsePAT(unsigned char const* payload, unsigned payloadSize, u_int16_t& PMT_PID) {
+  unsigned size = payloadSize;
+  unsigned char const* section = skipPointerField(payload, size);
+  if (section == NULL || size < 8 || section[0] != PAT_TABLE_ID) return False;
+
+  // The programs are listed (4 bytes each) after the 8-byte section header:
+  unsigned const end = endOfSectionData(section, size);
+  for (unsigned i = 8; i + 4 <= end; i += 4) {
+    u_int16_t program_number = (section[i]<<8) | section[i+1];
+    if (program_number != 0) {
+      PMT_PID = ((section[i+2]&0x1F)<<8) | section[i+3];
+      return True;
+    }
+  }
+
+  return False;
+}
+
+PMTStreamIterator::PMTStreamIterator(unsigned char const* payload, unsigned payloadSize)
+  : fSection(NULL), fNextEntry(0), fEndOfEntries(0) {
+  unsigned size = payloadSize;
+  unsigned char const* section = skipPointerField(payload, size);
+  if (section == NULL || size < 12 || section[0] != PMT_TABLE_ID) return;
+
+  // The streams are listed after the 12-byte section header, and any program descriptors:
+  fSection = section;
+  unsigned program_info_length = ((section[10]&0x0F)<<8) | section[11];
+  fNextEntry = 12 + program_info_length;
+  fEndOfEntries = endOfSectionData(section, size);
+}
+
+Boolean PMTStreamIterator::next(u_int8_t& stream_type, u_int16_t& elementary_PID) {
+  if (fSection == NULL || fNextEntry + 5 > fEndOfEntries) return False;
+
+  unsigned char const* entry = &fSection[fNextEntry];
+  stream_type = entry[0];
+  elementary_PID = ((entry[1]&0x1F)<<8) | entry[2];
+  unsigned ES_info_length = ((entry[3]&0x0F)<<8) | entry[4];
+  fNextEntry += 5 + ES_info_length;
+
+  return True;
+}
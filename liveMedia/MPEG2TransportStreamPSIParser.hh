@@ -0,0 +1,53 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Parsing of the Program Association Table (PAT) and Program Map Table (PMT) in a Transport Stream
+// (used by "MPEG2TransportStreamDemux" and "MPEG2TransportStreamIndexParser")
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_PSI_PARSER_HH
+#define _MPEG2_TRANSPORT_STREAM_PSI_PARSER_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+// In each of the following, "payload" and "payloadSize" describe the payload of a Transport Stream packet that
+// begins a PSI section (i.e., with "payload_unit_start_indicator" set).  The payload begins with the 'pointer_field'.
+// We look only at the part of the section that's in this packet.
+
+Boolean parsePAT(unsigned char const* payload, unsigned payloadSize, u_int16_t& PMT_PID);
+    // Sets "PMT_PID" to that of the first program (other than the 'network' program) that's listed in a PAT.
+    // Returns False if this isn't a PAT, or if it lists no such program.
+
+class PMTStreamIterator {
+public:
+  PMTStreamIterator(unsigned char const* payload, unsigned payloadSize);
+      // (If this isn't a PMT, then "next()" immediately returns False.)
+
+  Boolean next(u_int8_t& stream_type, u_int16_t& elementary_PID);
+      // Returns the next ("stream_type","elementary_PID") pair that's listed in the PMT (or False if there are no more)
+
+private:
+  unsigned char const* fSection;
+  unsigned fNextEntry, fEndOfEntries;
+};
+
+#endif
@@ -0,0 +1,305 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A precomputed 'trick play' track for a (indexed) MPEG Transport Stream file: A separate Transport Stream file
+// - with its own index file - that contains the I-frames that "MPEG2TransportStreamTrickModeFilter" would deliver
+// for a particular scale, with their PCRs and PTSs rebased to start from 0.  Streaming at this scale can then be done
+// by reading this file sequentially (rather than seeking to each I-frame in the original file).
+// Implementation
+
+#include "MPEG2TransportStreamTrickPlayTrack.hh"
+#include "MPEG2TransportStreamTrickModeFilter.hh"
+#include "MPEG2TransportStreamFromESSource.hh"
+#include "ByteStreamFileSource.hh"
+#include "InputFile.hh"
+#include "GroupsockHelper.hh"
+
+// How far into a track we look for its PAT, PMT and first PCR:
+#define MAX_TRACK_HEADER_SCAN_PACKETS 50000
+
+#define TRANSPORT_SYNC_BYTE 0x47
+#define PAT_PID 0
+
+////////// MPEG2TransportStreamTrickPlayTrackSource //////////
+
+// A source that reads a track (sequentially), after first delivering the track's PAT and PMT - so that clients
+// can decode the track from wherever we start reading it:
+
+class MPEG2TransportStreamTrickPlayTrackSource: public FramedFilter {
+public:
+  MPEG2TransportStreamTrickPlayTrackSource(UsageEnvironment& env, ByteStreamFileSource* inputSource,
+					   unsigned char const* header);
+  virtual ~MPEG2TransportStreamTrickPlayTrackSource();
+
+  void seekToTSPacket(unsigned long tsPacketNum);
+  unsigned long nextTSPacketNum() const { return (unsigned long)(fNextByteNum/TRANSPORT_PACKET_SIZE); }
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+			  struct timeval presentationTime, unsigned durationInMicroseconds);
+
+private:
+  unsigned char fHeader[2*TRANSPORT_PACKET_SIZE];
+  unsigned fHeaderPosition; // how much of "fHeader" we've delivered
+  u_int64_t fNextByteNum; // the position (within the track) of the next data that we'll read
+};
+
+MPEG2TransportStreamTrickPlayTrackSource
+::MPEG2TransportStreamTrickPlayTrackSource(UsageEnvironment& env, ByteStreamFileSource* inputSource,
+					   unsigned char const* header)
+  : FramedFilter(env, inputSource),
+    fHeaderPosition(0), fNextByteNum(0) {
+  memmove(fHeader, header, sizeof fHeader);
+}
+
+MPEG2TransportStreamTrickPlayTrackSource::~MPEG2TransportStreamTrickPlayTrackSource() {
+}
+
+void MPEG2TransportStreamTrickPlayTrackSource::seekToTSPacket(unsigned long tsPacketNum) {
+  fNextByteNum = (u_int64_t)tsPacketNum*TRANSPORT_PACKET_SIZE;
+  ((ByteStreamFileSource*)fInputSource)->seekToByteAbsolute(fNextByteNum);
+  fHeaderPosition = 0; // so that we begin again with the PAT and PMT
+}
+
+void MPEG2TransportStreamTrickPlayTrackSource::doGetNextFrame() {
+  if (fHeaderPosition < sizeof fHeader) {
+    // Deliver (as much as will fit of) the PAT and PMT, as whole Transport Stream packets:
+    unsigned numBytes = sizeof fHeader - fHeaderPosition;
+    if (numBytes > fMaxSize) numBytes = (fMaxSize/TRANSPORT_PACKET_SIZE)*TRANSPORT_PACKET_SIZE;
+    memmove(fTo, &fHeader[fHeaderPosition], numBytes);
+    fHeaderPosition += numBytes;
+    fFrameSize = numBytes;
+    fNumTruncatedBytes = 0;
+    gettimeofday(&fPresentationTime, NULL);
+    fDurationInMicroseconds = 0;
+
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+    return;
+  }
+
+  fInputSource->getNextFrame(fTo, fMaxSize,
+			     afterGettingFrame, this,
+			     FramedSource::handleClosure, this);
+}
+
+void MPEG2TransportStreamTrickPlayTrackSource
+::afterGettingFrame(void* clientData, unsigned frameSize,
+		    unsigned numTruncatedBytes,
+		    struct timeval presentationTime,
+		    unsigned durationInMicroseconds) {
+  MPEG2TransportStreamTrickPlayTrackSource* source = (MPEG2TransportStreamTrickPlayTrackSource*)clientData;
+  source->afterGettingFrame1(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void MPEG2TransportStreamTrickPlayTrackSource
+::afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+		     struct timeval presentationTime, unsigned durationInMicroseconds) {
+  fNextByteNum += frameSize;
+
+  fFrameSize = frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = durationInMicroseconds;
+  afterGetting(this);
+}
+
+
+////////// MPEG2TransportStreamTrickPlayTrack //////////
+
+MPEG2TransportStreamTrickPlayTrack*
+MPEG2TransportStreamTrickPlayTrack::createNew(UsageEnvironment& env, char const* dataFileName,
+					      MPEG2TransportStreamIndexFile* indexFile, int scale) {
+  if (dataFileName == NULL || indexFile == NULL || scale == 0 || scale == 1) return NULL;
+
+  // The track begins at the original file's first index record (if it's a forward track), or its last:
+  unsigned long const numIndexRecords = indexFile->numIndexRecords();
+  unsigned long tsPacketNum;
+  u_int8_t offset, size, recordType; // all dummy
+  float originNPT;
+  if (numIndexRecords == 0
+      || !indexFile->readIndexRecordValues(scale > 0 ? 0 : numIndexRecords-1,
+					   tsPacketNum, offset, size, originNPT, recordType)) {
+    return NULL;
+  }
+
+  char* trackFileName = MPEG2TransportStreamTrickPlayTrack::trackFileName(dataFileName, scale);
+  char* trackIndexFileName = new char[strlen(trackFileName) + 2]; // allow for trailing x\0
+  sprintf(trackIndexFileName, "%sx", trackFileName);
+  MPEG2TransportStreamIndexFile* trackIndexFile = MPEG2TransportStreamIndexFile::createNew(env, trackIndexFileName);
+  delete[] trackIndexFileName;
+
+  MPEG2TransportStreamTrickPlayTrack* track = NULL;
+  if (trackIndexFile != NULL) {
+    track = new MPEG2TransportStreamTrickPlayTrack(env, trackFileName, trackIndexFile, scale, originNPT);
+    if (!track->readTrackHeader()) {
+      Medium::close(track);
+      track = NULL;
+    }
+  }
+  delete[] trackFileName;
+
+  return track;
+}
+
+char* MPEG2TransportStreamTrickPlayTrack::trackFileName(char const* dataFileName, int scale) {
+  // Replace any ".ts" suffix with "_ff<scale>.ts" (or, for reverse play, "_rw<-scale>.ts"):
+  int len = strlen(dataFileName);
+  if (len >= 3 && strcmp(&dataFileName[len-3], ".ts") == 0) len -= 3;
+
+  char* result = new char[len + 20]; // allow for the new suffix
+  sprintf(result, "%.*s_%s%d.ts", len, dataFileName, scale < 0 ? "rw" : "ff", scale < 0 ? -scale : scale);
+  return result;
+}
+
+FramedSource* MPEG2TransportStreamTrickPlayTrack
+::createTrackGenerator(UsageEnvironment& env, char const* dataFileName,
+		       MPEG2TransportStreamIndexFile* indexFile, int scale) {
+  if (indexFile == NULL || scale == 0 || indexFile->numIndexRecords() == 0) return NULL;
+
+  ByteStreamFileSource* input = ByteStreamFileSource::createNew(env, dataFileName, TRANSPORT_PACKET_SIZE);
+  if (input == NULL) return NULL;
+
+  // Use the same 'trick mode' filter that's used to stream at this scale on the fly:
+  MPEG2TransportStreamTrickModeFilter* trickModeFilter
+    = MPEG2TransportStreamTrickModeFilter::createNew(env, input, indexFile, scale);
+  if (scale < 0) {
+    // A reverse track begins at the end of the file:
+    unsigned long const lastIndexRecordNum = indexFile->numIndexRecords() - 1;
+    unsigned long tsPacketNum;
+    u_int8_t offset, size, recordType; // all dummy
+    float pcr; // dummy
+    if (indexFile->readIndexRecordValues(lastIndexRecordNum, tsPacketNum, offset, size, pcr, recordType)) {
+      trickModeFilter->seekTo(tsPacketNum, lastIndexRecordNum);
+    }
+  }
+
+  // Generate a Transport Stream from this.  (Its PCRs and PTSs begin at 0.)
+  MPEG2TransportStreamFromESSource* trackSource = MPEG2TransportStreamFromESSource::createNew(env);
+  trackSource->addNewVideoSource(trickModeFilter, indexFile->mpegVersion());
+
+  return trackSource;
+}
+
+MPEG2TransportStreamTrickPlayTrack
+::MPEG2TransportStreamTrickPlayTrack(UsageEnvironment& env, char const* trackFileName,
+				     MPEG2TransportStreamIndexFile* trackIndexFile, int scale, float originNPT)
+  : Medium(env),
+    fTrackFileName(strDup(trackFileName)), fTrackIndexFile(trackIndexFile),
+    fScale(scale), fOriginNPT(originNPT), fFirstTrackPCR(0.0f) {
+}
+
+MPEG2TransportStreamTrickPlayTrack::~MPEG2TransportStreamTrickPlayTrack() {
+  Medium::close(fTrackIndexFile);
+  delete[] fTrackFileName;
+}
+
+FramedSource* MPEG2TransportStreamTrickPlayTrack::createSource(float& npt, unsigned preferredFrameSize) {
+  ByteStreamFileSource* fileSource = ByteStreamFileSource::createNew(envir(), fTrackFileName, preferredFrameSize);
+  if (fileSource == NULL) return NULL;
+
+  FramedSource* source = new MPEG2TransportStreamTrickPlayTrackSource(envir(), fileSource, fHeader);
+  seekSource(source, npt);
+  return source;
+}
+
+void MPEG2TransportStreamTrickPlayTrack::seekSource(FramedSource* source, float& npt) {
+  // Look up the track's frame for "npt".  (Note that the track's index records have PCRs that are relative to
+  // the track's first PCR.)
+  float pcr = trackTimeFromNPT(npt) - fFirstTrackPCR;
+  unsigned long tsPacketNum, indexRecordNum;
+  fTrackIndexFile->lookupTSPacketNumFromNPT(pcr, tsPacketNum, indexRecordNum);
+
+  npt = tsPacketNum == 0 ? fOriginNPT : fOriginNPT + (pcr + fFirstTrackPCR)*fScale;
+  if (npt < 0.0f) npt = 0.0f;
+  ((MPEG2TransportStreamTrickPlayTrackSource*)source)->seekToTSPacket(tsPacketNum);
+}
+
+float MPEG2TransportStreamTrickPlayTrack::currentNPT(FramedSource* source, Boolean reverseToPreviousCleanPoint) {
+  unsigned long tsPacketNum = ((MPEG2TransportStreamTrickPlayTrackSource*)source)->nextTSPacketNum();
+  if (tsPacketNum == 0) return fOriginNPT;
+
+  float pcr;
+  unsigned long indexRecordNum;
+  fTrackIndexFile->lookupPCRFromTSPacketNum(tsPacketNum, reverseToPreviousCleanPoint, pcr, indexRecordNum);
+
+  float npt = fOriginNPT + (pcr + fFirstTrackPCR)*fScale;
+  return npt < 0.0f ? 0.0f : npt;
+}
+
+float MPEG2TransportStreamTrickPlayTrack::pcrLimit(float npt, double streamDuration) {
+  return trackTimeFromNPT(npt) + (float)(streamDuration/(fScale < 0 ? -fScale : fScale));
+}
+
+Boolean MPEG2TransportStreamTrickPlayTrack::readTrackHeader() {
+  // Look for the track's (first) PAT and PMT (which we'll deliver whenever we start reading the track),
+  // and its first PCR:
+  FILE* fid = OpenInputFile(envir(), fTrackFileName);
+  if (fid == NULL) return False;
+
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  Boolean haveSeenPAT = False, haveSeenPMT = False, haveSeenPCR = False;
+  u_int16_t PMT_PID = 0;
+  for (unsigned i = 0; i < MAX_TRACK_HEADER_SCAN_PACKETS && !(haveSeenPMT && haveSeenPCR); ++i) {
+    if (fread(pkt, TRANSPORT_PACKET_SIZE, 1, fid) != 1 || pkt[0] != TRANSPORT_SYNC_BYTE) break;
+
+    u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
+    Boolean payload_unit_start_indicator = (pkt[1]&0x40) != 0;
+    u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
+    unsigned totalHeaderSize = adaptation_field_control <= 1 ? 4 : 5 + pkt[4];
+    if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) continue;
+
+    if (totalHeaderSize > 5 && (pkt[5]&0x10) != 0 && !haveSeenPCR) {
+      // There's a PCR:
+      u_int32_t pcrBaseHigh = (pkt[6]<<24)|(pkt[7]<<16)|(pkt[8]<<8)|pkt[9];
+      fFirstTrackPCR = pcrBaseHigh/45000.0f;
+      if ((pkt[10]&0x80) != 0) fFirstTrackPCR += 1/90000.0f; // add in low-bit (if set)
+      unsigned short pcrExt = ((pkt[10]&0x01)<<8) | pkt[11];
+      fFirstTrackPCR += pcrExt/27000000.0f;
+      haveSeenPCR = True;
+    }
+
+    if (!haveSeenPAT && PID == PAT_PID && payload_unit_start_indicator) {
+      // Get the PMT_PID (of the first program) from the PAT:
+      unsigned char const* section = &pkt[totalHeaderSize + 1 + pkt[totalHeaderSize]]; // skip the "pointer_field"
+      if (section + 12 > &pkt[TRANSPORT_PACKET_SIZE]) continue;
+      PMT_PID = ((section[10]&0x1F)<<8) | section[11];
+      memmove(&fHeader[0], pkt, TRANSPORT_PACKET_SIZE);
+      haveSeenPAT = True;
+    } else if (haveSeenPAT && !haveSeenPMT && PID == PMT_PID && payload_unit_start_indicator) {
+      memmove(&fHeader[TRANSPORT_PACKET_SIZE], pkt, TRANSPORT_PACKET_SIZE);
+      haveSeenPMT = True;
+    }
+  }
+  CloseInputFile(fid);
+
+  // (If the track has no PCR, then it has just one frame, so "fFirstTrackPCR" doesn't matter.)
+  return haveSeenPMT;
+}
+
+float MPEG2TransportStreamTrickPlayTrack::trackTimeFromNPT(float npt) {
+  // The track was made by 'trick play' from "fOriginNPT", so its PCRs are the original file's PCRs - relative to this -
+  // divided by the scale:
+  float trackTime = (npt - fOriginNPT)/fScale;
+  return trackTime < 0.0f ? 0.0f : trackTime;
+}
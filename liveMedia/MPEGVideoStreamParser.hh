@@ -70,14 +70,36 @@ protected:
     *fTo++ = word>>24; *fTo++ = word>>16; *fTo++ = word>>8; *fTo++ = word;
   }
 
+  void saveBytes(u_int8_t const* from, unsigned numBytes) {
+    unsigned numBytesToSave = numBytes;
+    if (fTo+numBytesToSave > fLimit) numBytesToSave = fLimit - fTo; // there's space for only some (or none) of them
+    memmove(fTo, from, numBytesToSave);
+    fTo += numBytesToSave;
+    fNumTruncatedBytes += numBytes - numBytesToSave;
+  }
+
+  // Returns the number of bytes - from the current parse position - that precede the next sync word (0x000001) in the
+  // data that we've already read (or, if there's none, the number of bytes that can't be the start of one):
+  unsigned numBytesBeforeNextCode() {
+    unsigned char* ptr = nextToParse();
+    unsigned numBytes = numBufferedBytes();
+    unsigned char* code = findStartCode(ptr, ptr + numBytes);
+    if (code != NULL) return code - ptr;
+    return numBytes > 2 ? numBytes - 2 : 0;
+  }
+
   // Save data until we see a sync word (0x000001xx):
   void saveToNextCode(u_int32_t& curWord) {
     saveByte(curWord>>24);
     curWord = (curWord<<8)|get1Byte();
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
+	// a sync word definitely doesn't begin anywhere in "curWord", so save it - and everything after it,
+	// up until the next sync word - in bulk:
 	save4Bytes(curWord);
+	unsigned numBytesToSave = numBytesBeforeNextCode();
+	saveBytes(nextToParse(), numBytesToSave);
+	skipBytes(numBytesToSave);
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -93,7 +115,9 @@ protected:
     curWord = (curWord<<8)|get1Byte();
     while ((curWord&0xFFFFFF00) != 0x00000100) {
       if ((unsigned)(curWord&0xFF) > 1) {
-	// a sync word definitely doesn't begin anywhere in "curWord"
+	// a sync word definitely doesn't begin anywhere in "curWord", so skip it - and everything after it,
+	// up until the next sync word:
+	skipBytes(numBytesBeforeNextCode());
 	curWord = get4Bytes();
       } else {
 	// a sync word might begin in "curWord", although not at its start
@@ -43,6 +43,9 @@ Boolean MediaSource::isFramedSource() const {
 Boolean MediaSource::isRTPSource() const {
   return False; // default implementation
 }
+Boolean MediaSource::isMultiFramedRTPSource() const {
+  return False; // default implementation
+}
 Boolean MediaSource::isMPEG1or2VideoStreamFramer() const {
   return False; // default implementation
 }
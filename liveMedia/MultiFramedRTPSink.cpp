@@ -44,7 +44,11 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
 : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
           rtpPayloadFormatName, numChannels),
 fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-fOnSendErrorFunc(NULL), fOnSendErrorData(NULL)
+fExternalPayload(NULL), fExternalPayloadSize(0),
+fMaxPacketsPerBurst(1), fMaxBytesPerBurst(0), fNumPacketsInBurst(0), fNumBytesInBurst(0), fBurstStatus(NULL),
+fPacingRate(0), fPacingBucketSize(0), fPacingTokens(0),
+fOnSendErrorFunc(NULL), fOnSendErrorData(NULL),
+fPacketCaptureFunc(NULL), fPacketCaptureClientData(NULL)
 {
     setPacketSizes(1000, 1456);
     // Default max packet size (1500, minus allowance for IP, UDP, UMTP headers)
@@ -55,6 +59,23 @@ MultiFramedRTPSink::~MultiFramedRTPSink() {
     delete fOutBuf;
 }
 
+void MultiFramedRTPSink::setBurstLimits(unsigned maxPacketsPerBurst, unsigned maxBytesPerBurst) {
+    fMaxPacketsPerBurst = maxPacketsPerBurst == 0 ? 1 : maxPacketsPerBurst;
+    fMaxBytesPerBurst = maxBytesPerBurst;
+}
+
+void MultiFramedRTPSink::setPacingRate(unsigned bytesPerSecond, unsigned bucketSize) {
+    fPacingRate = bytesPerSecond;
+    if (bucketSize == 0) bucketSize = fOurMaxPacketSize;
+    fPacingBucketSize = fPacingTokens = (int64_t)bucketSize*1000000;
+    gettimeofday(&fPacingLastRefillTime, NULL);
+}
+
+void MultiFramedRTPSink::setPacketCaptureFunc(packetCaptureFunc* func, void* clientData) {
+    fPacketCaptureFunc = func;
+    fPacketCaptureClientData = clientData;
+}
+
 void MultiFramedRTPSink
 ::doSpecialFrameHandling(unsigned /*fragmentationOffset*/,
                          unsigned char* /*frameStart*/,
@@ -150,6 +171,11 @@ void MultiFramedRTPSink::setFramePadding(unsigned numPaddingBytes) {
     }
 }
 
+void MultiFramedRTPSink::setExternalPayload(unsigned char* payload, unsigned payloadSize) {
+    fExternalPayload = payload;
+    fExternalPayloadSize = payloadSize;
+}
+
 Boolean MultiFramedRTPSink::continuePlaying() {
     // Send the first packet.
     // (This will also schedule any future sends.)
@@ -161,6 +187,7 @@ void MultiFramedRTPSink::stopPlaying() {
     fOutBuf->resetPacketStart();
     fOutBuf->resetOffset();
     fOutBuf->resetOverflowData();
+    fExternalPayload = NULL; fExternalPayloadSize = 0;
     
     // Then call the default "stopPlaying()" function:
     MediaSink::stopPlaying();
@@ -245,6 +272,7 @@ void MultiFramedRTPSink
     if (fIsFirstPacket) {
         // Record the fact that we're starting to play now:
         gettimeofday(&fNextSendTime, NULL);
+        fCaptureTime = fNextSendTime;
     }
     
     fMostRecentPresentationTime = presentationTime;
@@ -339,8 +367,10 @@ void MultiFramedRTPSink
         //      read would overflow the packet, or
         // (iii) it contains the last fragment of a fragmented frame, and we
         //      don't allow anything else to follow this or
-        // (iv) one frame per packet is allowed:
-        if (fOutBuf->isPreferredSize()
+        // (iv) one frame per packet is allowed or
+        // (v) the packet ends with 'external' payload data (that must be sent before the next frame is read):
+        if (fExternalPayload != NULL
+            || fOutBuf->isPreferredSize()
             || fOutBuf->wouldOverflow(numFrameBytesToUse)
             || (fPreviousFrameEndedFragmentation &&
                 !allowOtherFramesAfterLastFragment())
@@ -366,22 +396,56 @@ Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const {
 }
 
 void MultiFramedRTPSink::sendPacketIfNecessary() {
+    // Tell "sendBurst()" (if it called us) that this packet has been completed:
+    int* burstStatus = fBurstStatus;
+    fBurstStatus = NULL;
+    if (burstStatus != NULL) {
+        *burstStatus = 1; // by default, stop sending after this packet
+    } else {
+        // This packet starts a new burst:
+        fNumPacketsInBurst = fNumBytesInBurst = 0;
+    }
+    
     if (fNumFramesUsedSoFar > 0) {
         // Send the packet:
+        if (fPacketCaptureFunc != NULL) {
+            // Capture the packet, rather than sending it.  "fNextSendTime" is now when the next packet is due:
+            int64_t uSecondsToNextPacket = (int64_t)(fNextSendTime.tv_sec - fCaptureTime.tv_sec)*1000000
+            + (fNextSendTime.tv_usec - fCaptureTime.tv_usec);
+            if (uSecondsToNextPacket < 0) {
+                uSecondsToNextPacket = 0;
+            } else {
+                fCaptureTime = fNextSendTime;
+            }
+            (*fPacketCaptureFunc)(fPacketCaptureClientData, fOutBuf->packet(), fOutBuf->curPacketSize(),
+                                  fExternalPayload, fExternalPayloadSize, (unsigned)uSecondsToNextPacket);
+        } else
 #ifdef TEST_LOSS
         if ((our_random()%10) != 0) // simulate 10% packet loss #####
 #endif
-            if (!fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())) {
+        {
+            Boolean sendSucceeded = fExternalPayload == NULL
+                ? fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize())
+                : fRTPInterface.sendPacket(fOutBuf->packet(), fOutBuf->curPacketSize(),
+                                           fExternalPayload, fExternalPayloadSize);
+            if (!sendSucceeded) {
                 // if failure handler has been specified, call it
                 if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
             }
+        }
+        unsigned packetSize = fOutBuf->curPacketSize() + fExternalPayloadSize;
         ++fPacketCount;
-        fTotalOctetCount += fOutBuf->curPacketSize();
-        fOctetCount += fOutBuf->curPacketSize()
+        fTotalOctetCount += packetSize;
+        fOctetCount += packetSize
         - rtpHeaderSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
         
+        ++fNumPacketsInBurst;
+        fNumBytesInBurst += packetSize;
+        if (fPacingRate > 0) fPacingTokens -= (int64_t)packetSize*1000000;
+        
         ++fSeqNo; // for next time
     }
+    fExternalPayload = NULL; fExternalPayloadSize = 0;
     
     if (fOutBuf->haveOverflowData()
         && fOutBuf->totalBytesAvailable() > fOutBuf->totalBufferSize()/2) {
@@ -410,19 +474,69 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
         gettimeofday(&timeNow, NULL);
         int secsDiff = fNextSendTime.tv_sec - timeNow.tv_sec;
         int64_t uSecondsToGo = secsDiff*1000000 + (fNextSendTime.tv_usec - timeNow.tv_usec);
-        if (uSecondsToGo < 0 || secsDiff < 0) { // sanity check: Make sure that the time-to-delay is non-negative:
+        if (uSecondsToGo < 0 || secsDiff < 0 // sanity check: Make sure that the time-to-delay is non-negative
+            || fPacketCaptureFunc != NULL) { // we're capturing packets, not sending them in real time
             uSecondsToGo = 0;
         }
+        if (fPacingRate > 0 && fPacketCaptureFunc == NULL) {
+            int64_t uSecondsToRefill = pacingDelay(timeNow);
+            if (uSecondsToRefill > uSecondsToGo) uSecondsToGo = uSecondsToRefill;
+        }
+        
+        if (uSecondsToGo == 0 && fNumPacketsInBurst < fMaxPacketsPerBurst
+            && (fMaxBytesPerBurst == 0 || fNumBytesInBurst < fMaxBytesPerBurst)) {
+            // The next packet is due now, and our current burst has room for it, so send it without a delay:
+            if (burstStatus != NULL) {
+                *burstStatus = 2; // "sendBurst()" will build the next packet, once we return
+            } else {
+                sendBurst();
+            }
+            return;
+        }
         
         // Delay this amount of time:
         nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc*)sendNext, this);
     }
 }
 
+int64_t MultiFramedRTPSink::pacingDelay(struct timeval const& timeNow) {
+    // Refill our token bucket, based on the time that has elapsed since we last did so:
+    int64_t uSecondsElapsed = (int64_t)(timeNow.tv_sec - fPacingLastRefillTime.tv_sec)*1000000
+    + (timeNow.tv_usec - fPacingLastRefillTime.tv_usec);
+    if (uSecondsElapsed > 0) {
+        fPacingTokens += uSecondsElapsed*fPacingRate;
+        if (fPacingTokens > fPacingBucketSize) fPacingTokens = fPacingBucketSize;
+    }
+    fPacingLastRefillTime = timeNow;
+    
+    // If the bucket is empty, return the time until it becomes non-empty again:
+    if (fPacingTokens >= 0) return 0;
+    return (-fPacingTokens + fPacingRate - 1)/fPacingRate;
+}
+
 // The following is called after each delay between packet sends:
 void MultiFramedRTPSink::sendNext(void* firstArg) {
     MultiFramedRTPSink* sink = (MultiFramedRTPSink*)firstArg;
-    sink->buildAndSendPacket(False);
+    sink->fNumPacketsInBurst = sink->fNumBytesInBurst = 0;
+    sink->sendBurst();
+}
+
+void MultiFramedRTPSink::sendBurst() {
+    // Build and send packets for as long as "sendPacketIfNecessary()" tells us that the next one is due now.
+    // (We do this in a loop - rather than having "sendPacketIfNecessary()" call "buildAndSendPacket()" directly -
+    // to avoid recursion when our source delivers its frames synchronously.)
+    int status;
+    do {
+        status = 0; // will be set by "sendPacketIfNecessary()", if it gets called before "buildAndSendPacket()" returns
+        fBurstStatus = &status;
+        buildAndSendPacket(False);
+        if (status == 0) {
+            // The packet is still waiting for data from our source; it will be completed (and sent) later:
+            fBurstStatus = NULL;
+            return;
+        }
+        // Note: If "status" is 1, then we might have been deleted (by "onSourceClosure()"), so don't touch any members.
+    } while (status == 2);
 }
 
 void MultiFramedRTPSink::ourHandleClosure(void* clientData) {
@@ -20,12 +20,27 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MultiFramedRTPSource.hh"
+#include "PacketBufferPool.hh"
 #include "RTCP.hh"
 #include "GroupsockHelper.hh"
 #include <string.h>
 
 ////////// ReorderingPacketBuffer definition //////////
 
+// The buffer is a ring of packet slots, indexed by (RTP sequence number) & (number of slots - 1), so that storing,
+// duplicate detection, and in-order release each take constant time.  It grows (by doubling) if packets arrive
+// that span more sequence numbers than it currently has slots.
+#ifndef REORDERING_BUFFER_INITIAL_NUM_SLOTS
+#define REORDERING_BUFFER_INITIAL_NUM_SLOTS 256 // must be a power of 2
+#endif
+#ifndef REORDERING_BUFFER_MAX_FREE_PACKETS
+#define REORDERING_BUFFER_MAX_FREE_PACKETS 32 // the most packets that we keep for reuse; any more are deleted
+#endif
+#ifndef MAX_DIRECT_DELIVERIES_PER_PACKET
+#define MAX_DIRECT_DELIVERIES_PER_PACKET 64 // bounds our recursion when delivering a packet's enclosed frames
+#endif
+#define DEFAULT_REORDERING_THRESHOLD_TIME 100000 // uSeconds (i.e., 100 ms)
+
 class ReorderingPacketBuffer {
 public:
   ReorderingPacketBuffer(BufferedPacketFactory* packetFactory);
@@ -37,27 +52,44 @@ public:
   BufferedPacket* getNextCompletedPacket(Boolean& packetLossPreceded);
   void releaseUsedPacket(BufferedPacket* packet);
   void freePacket(BufferedPacket* packet) {
-    if (packet != fSavedPacket) {
-      delete packet;
+    if (packet->isReferenced()) {
+      // The packet's data is still being used (by "FrameSlices"), so it will delete itself once it's no longer used:
+      packet->orphan();
+    } else if (fNumFreePackets < REORDERING_BUFFER_MAX_FREE_PACKETS) {
+      // Keep the packet for reuse (to avoid calling new/delete in the common case):
+      packet->nextPacket() = fFreePackets;
+      fFreePackets = packet;
+      ++fNumFreePackets;
     } else {
-      fSavedPacketFree = True;
+      delete packet;
     }
   }
-  Boolean isEmpty() const { return fHeadPacket == NULL; }
+  Boolean isEmpty() const { return fNumStoredPackets == 0; }
+  unsigned numStoredPackets() const { return fNumStoredPackets; }
 
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
   void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
 
+  // For looking at each of the stored packets (valid iff !isEmpty()):
+  unsigned short headSeqNo() const { return fHeadSeqNo; }
+  unsigned short tailSeqNo() const { return fTailSeqNo; }
+  BufferedPacket* storedPacket(unsigned short rtpSeqNo) { return slot(rtpSeqNo); } // NULL if missing
+
+private:
+  BufferedPacket*& slot(unsigned short rtpSeqNo) { return fSlots[rtpSeqNo&(fNumSlots-1)]; }
+  Boolean growToAtLeast(unsigned numSlots);
+
 private:
   BufferedPacketFactory* fPacketFactory;
   unsigned fThresholdTime; // uSeconds
   Boolean fHaveSeenFirstPacket; // used to set initial "fNextExpectedSeqNo"
   unsigned short fNextExpectedSeqNo;
-  BufferedPacket* fHeadPacket;
-  BufferedPacket* fTailPacket;
-  BufferedPacket* fSavedPacket;
-      // to avoid calling new/free in the common case
-  Boolean fSavedPacketFree;
+  BufferedPacket** fSlots;
+  unsigned fNumSlots; // a power of 2
+  unsigned fNumStoredPackets;
+  unsigned short fHeadSeqNo, fTailSeqNo; // of the first and last stored packets (valid iff "fNumStoredPackets" > 0)
+  BufferedPacket* fFreePackets; // a list (linked using "nextPacket()") of packets available for reuse
+  unsigned fNumFreePackets;
 };
 
 
@@ -68,9 +100,16 @@ MultiFramedRTPSource
 		       unsigned char rtpPayloadFormat,
 		       unsigned rtpTimestampFrequency,
 		       BufferedPacketFactory* packetFactory)
-  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
+  : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency),
+    fDeliverFrameSlices(False), fFrameSlices(new FrameSlices),
+    fReorderingThresholdTime(DEFAULT_REORDERING_THRESHOLD_TIME), fMinPlayoutDelay(0), fMaxPlayoutDelay(0),
+    fNumAheadTimestamps(0), fNumUsedTimestamps(0), fPlayoutTask(NULL) {
+  fPlayoutStats.playoutDelay = fPlayoutStats.jitter = 0;
+  fPlayoutStats.numFramesReleased = fPlayoutStats.numFramesHeld = fPlayoutStats.numLateFrames = 0;
+  fPlayoutStats.totalHoldTime = fPlayoutStats.totalLateness = 0;
   reset();
   fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  PacketBufferPool::ourPool(env)->incrementReferenceCount();
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 50*1024);
@@ -83,10 +122,17 @@ void MultiFramedRTPSource::reset() {
   fPacketReadInProgress = NULL;
   fNeedDelivery = False;
   fPacketLossInFragmentedFrame = False;
+  fHavePlayoutReference = False;
+  fCurFrameWasHeld = False;
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
+  delete fFrameSlices;
   delete fReorderingBuffer;
+
+  PacketBufferPool* pool = PacketBufferPool::ourPool(envir(), False);
+  if (pool != NULL) pool->decrementReferenceCount();
 }
 
 Boolean MultiFramedRTPSource
@@ -110,11 +156,17 @@ void MultiFramedRTPSource::doStopGettingFrames() {
     fPacketReadInProgress = NULL;
   }
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
   fRTPInterface.stopNetworkReading();
+  fFrameSlices->reset();
   fReorderingBuffer->reset();
   reset();
 }
 
+Boolean MultiFramedRTPSource::isMultiFramedRTPSource() const {
+  return True;
+}
+
 void MultiFramedRTPSource::doGetNextFrame() {
   if (!fAreDoingNetworkReads) {
     // Turn on background read handling of incoming packets:
@@ -127,6 +179,7 @@ void MultiFramedRTPSource::doGetNextFrame() {
   fSavedTo = fTo;
   fSavedMaxSize = fMaxSize;
   fFrameSize = 0; // for now
+  fFrameSlices->reset(); // we're done with the previous frame's slices (if any)
   fNeedDelivery = True;
   doGetNextFrame1();
 }
@@ -139,6 +192,11 @@ void MultiFramedRTPSource::doGetNextFrame1() {
       = fReorderingBuffer->getNextCompletedPacket(packetLossPrecededThis);
     if (nextPacket == NULL) break;
 
+    if (fMaxPlayoutDelay > 0 && fFrameSize == 0 && !frameIsDueForDelivery(nextPacket)) {
+      // We're holding this frame until its playout time:
+      break;
+    }
+
     fNeedDelivery = False;
 
     if (nextPacket->useCount() == 0) {
@@ -162,6 +220,7 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 	// Forget any data that we used from it:
 	fTo = fSavedTo; fMaxSize = fSavedMaxSize;
 	fFrameSize = 0;
+	fFrameSlices->reset();
       }
       fPacketLossInFragmentedFrame = False;
     } else if (packetLossPrecededThis) {
@@ -180,10 +239,12 @@ void MultiFramedRTPSource::doGetNextFrame1() {
     nextPacket->use(fTo, fMaxSize, frameSize, fNumTruncatedBytes,
 		    fCurPacketRTPSeqNum, fCurPacketRTPTimestamp,
 		    fPresentationTime, fCurPacketHasBeenSynchronizedUsingRTCP,
-		    fCurPacketMarkerBit);
+		    fCurPacketMarkerBit, fDeliverFrameSlices ? fFrameSlices : NULL);
     fFrameSize += frameSize;
 
-    if (!nextPacket->hasUsableData()) {
+    Boolean packetHasMoreFrames = nextPacket->hasUsableData();
+    unsigned packetUseCount = nextPacket->useCount();
+    if (!packetHasMoreFrames) {
       // We're completely done with this packet now
       fReorderingBuffer->releaseUsedPacket(nextPacket);
     }
@@ -196,10 +257,13 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 		<< fNumTruncatedBytes << " bytes of trailing data will be dropped!\n";
       }
       // Call our own 'after getting' function, so that the downstream object can consume the data:
-      if (fReorderingBuffer->isEmpty()) {
-	// Common case optimization: There are no more queued incoming packets, so this code will not get
-	// executed again without having first returned to the event loop.  Call our 'after getting' function
-	// directly, because there's no risk of a long chain of recursion (and thus stack overflow):
+      if (fReorderingBuffer->isEmpty()
+	  || (packetHasMoreFrames && fReorderingBuffer->numStoredPackets() == 1
+	      && packetUseCount < MAX_DIRECT_DELIVERIES_PER_PACKET)) {
+	// Common case optimization: There are no more queued incoming packets (except perhaps this one, if it
+	// contains more frames - e.g., an aggregation packet), so the chain of recursion that can occur - before
+	// we return to the event loop - is short.  Call our 'after getting' function directly, without risk of
+	// stack overflow:
 	afterGetting(this);
       } else {
 	// Special case: Call our 'after getting' function via the event loop.
@@ -217,7 +281,251 @@ void MultiFramedRTPSource::doGetNextFrame1() {
 
 void MultiFramedRTPSource
 ::setPacketReorderingThresholdTime(unsigned uSeconds) {
-  fReorderingBuffer->setThresholdTime(uSeconds);
+  fReorderingThresholdTime = uSeconds;
+  // If we're delaying playout, then there's no point in giving up on a missing packet sooner than this:
+  fReorderingBuffer->setThresholdTime(uSeconds > fPlayoutStats.playoutDelay ? uSeconds : fPlayoutStats.playoutDelay);
+}
+
+void MultiFramedRTPSource
+::setAdaptivePlayoutDelay(unsigned minDelayUSecs, unsigned maxDelayUSecs) {
+  if (timestampFrequency() == 0) maxDelayUSecs = 0; // we can't compute playout times
+  if (minDelayUSecs > maxDelayUSecs) minDelayUSecs = maxDelayUSecs;
+
+  fMinPlayoutDelay = minDelayUSecs;
+  fMaxPlayoutDelay = maxDelayUSecs;
+  fPlayoutStats.playoutDelay = minDelayUSecs; // initially
+  fHavePlayoutReference = False;
+  setPacketReorderingThresholdTime(fReorderingThresholdTime);
+}
+
+// The target playout delay is this multiple of the measured interarrival jitter:
+#ifndef PLAYOUT_DELAY_JITTER_MULTIPLE
+#define PLAYOUT_DELAY_JITTER_MULTIPLE 4
+#endif
+
+void MultiFramedRTPSource::noteFrameArrival(unsigned playoutTimestamp, int64_t arrivalTime) {
+  if (fHavePlayoutReference) {
+    // Keep "mediaTimeOffset()" within range, by moving our reference point forward from time to time:
+    if ((int)(playoutTimestamp - fPlayoutRefTimestamp) > 0x10000000) {
+      fPlayoutRefTime += mediaTimeOffset(playoutTimestamp);
+      fPlayoutRefTimestamp = playoutTimestamp;
+    }
+
+    // Compare this frame's transit time with the shortest that we've seen:
+    int64_t excessTransitTime = arrivalTime - (fPlayoutRefTime + mediaTimeOffset(playoutTimestamp));
+    if (excessTransitTime < 0) {
+      // This frame arrived sooner (relative to its timestamp) than any before it, so use it as our new reference:
+      fPlayoutRefTime += excessTransitTime;
+      return;
+    } else if (excessTransitTime <= 10*(int64_t)fMaxPlayoutDelay) {
+      // Creep slowly towards later transit times, to follow any drift between the sender's clock and ours:
+      fPlayoutRefTime += excessTransitTime>>10;
+      return;
+    }
+    // Otherwise, the stream's timing has changed completely (e.g., its timestamps jumped backwards),
+    // so start again, using this frame as our reference:
+  }
+
+  fPlayoutRefTimestamp = playoutTimestamp;
+  fPlayoutRefTime = arrivalTime;
+  fHavePlayoutReference = True;
+  fNumAheadTimestamps = fNumUsedTimestamps = 0;
+}
+
+int64_t MultiFramedRTPSource::mediaTimeOffset(unsigned rtpTimestamp) const {
+  return ((int64_t)(int)(rtpTimestamp - fPlayoutRefTimestamp)*1000000)/(int64_t)timestampFrequency();
+}
+
+Boolean MultiFramedRTPSource::frameIsDueForDelivery(BufferedPacket* firstPacket) {
+  if (fPlayoutTask != NULL) return False; // we're already waiting for this frame's playout time
+
+  unsigned const frameTimestamp = firstPacket->rtpTimestamp();
+  struct timeval const& timeReceived = firstPacket->timeReceived();
+  int64_t const arrivalTime = (int64_t)timeReceived.tv_sec*1000000 + timeReceived.tv_usec;
+  if (!fHavePlayoutReference) {
+    // This is the first frame.  Deliver it now, and use it as our reference:
+    noteFrameArrival(frameTimestamp, arrivalTime);
+    fLastPlayoutTimestamp = fLastFrameTimestamp = frameTimestamp;
+    fLastFrameArrivalTime = arrivalTime;
+    return True;
+  }
+  if (frameTimestamp == fLastFrameTimestamp) {
+    // This is more of the frame (e.g., the next NAL unit of the access unit) that we've just released:
+    return True;
+  }
+
+  int64_t turnKnownTime;
+  unsigned playoutTimestamp = nextPlayoutTimestamp(turnKnownTime);
+  // We can't release the frame before we know its turn - i.e., before its playout timestamp's own frame has arrived -
+  // so we treat it as having arrived no sooner than this.  (This lets our delay grow to cover any frame reordering.)
+  int64_t const availableTime = turnKnownTime > arrivalTime ? turnKnownTime : arrivalTime;
+  int64_t playoutOffset = mediaTimeOffset(playoutTimestamp);
+  int64_t const excessTransitTime = availableTime - (fPlayoutRefTime + playoutOffset);
+  if (excessTransitTime < -10*(int64_t)fMaxPlayoutDelay || excessTransitTime > 10*(int64_t)fMaxPlayoutDelay) {
+    // The stream's timing has changed completely (e.g., its timestamps jumped), so start again, with this frame:
+    fHavePlayoutReference = False;
+    return frameIsDueForDelivery(firstPacket);
+  }
+  int64_t const lastPlayoutOffset = mediaTimeOffset(fLastPlayoutTimestamp);
+  Boolean const isBehindLastFrame
+    = playoutOffset < lastPlayoutOffset && lastPlayoutOffset - playoutOffset <= 10*(int64_t)fMaxPlayoutDelay;
+  if (isBehindLastFrame) {
+    // This frame arrived too late for its turn.  It's due now (but we don't schedule it before the frame ahead of it):
+    playoutOffset = lastPlayoutOffset;
+  }
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  int64_t now = (int64_t)timeNow.tv_sec*1000000 + timeNow.tv_usec;
+  int64_t timeUntilPlayout = fPlayoutRefTime + playoutOffset + fPlayoutStats.playoutDelay - now;
+  if (timeUntilPlayout > 0) {
+    // Hold the frame until its playout time (but never for longer than our maximum delay):
+    if (timeUntilPlayout > (int64_t)fMaxPlayoutDelay) timeUntilPlayout = fMaxPlayoutDelay;
+    fPlayoutTask = envir().taskScheduler().scheduleDelayedTask(timeUntilPlayout, playoutTimerHandler, this);
+    fHeldPlayoutTimestamp = playoutTimestamp;
+    fCurFrameWasHeld = True;
+    return False;
+  }
+
+  // The frame is due now.  Update our statistics, and our target delay:
+  ++fPlayoutStats.numFramesReleased;
+  if (fCurFrameWasHeld) {
+    ++fPlayoutStats.numFramesHeld;
+  } else if (timeUntilPlayout < 0) {
+    ++fPlayoutStats.numLateFrames;
+    fPlayoutStats.totalLateness += -timeUntilPlayout;
+  }
+  int64_t holdTime = now - arrivalTime;
+  if (holdTime > 0) fPlayoutStats.totalHoldTime += holdTime;
+  fCurFrameWasHeld = False;
+
+  // Update our jitter estimate (as in RFC 3550, section 6.4.1, but in decoding order, rather than timestamp order):
+  int64_t transitTimeDifference = (availableTime - fLastFrameArrivalTime) - (playoutOffset - lastPlayoutOffset);
+  if (transitTimeDifference < 0) transitTimeDifference = -transitTimeDifference;
+  int64_t jitter = fPlayoutStats.jitter;
+  fPlayoutStats.jitter = (unsigned)(jitter + (transitTimeDifference - jitter)/16);
+
+  notePlayoutTimestampUse(playoutTimestamp, frameTimestamp);
+  if (isBehindLastFrame) playoutTimestamp = fLastPlayoutTimestamp;
+  noteFrameArrival(playoutTimestamp, availableTime);
+  fLastPlayoutTimestamp = playoutTimestamp;
+  fLastFrameTimestamp = frameTimestamp;
+  fLastFrameArrivalTime = availableTime;
+
+  updatePlayoutDelay();
+  return True;
+}
+
+unsigned MultiFramedRTPSource::nextPlayoutTimestamp(int64_t& arrivalTime) {
+  // The next playout timestamp is the smallest timestamp that hasn't yet had its turn: either one that belongs to
+  // a frame that we released ahead of it, or else one of the (not-yet-released) frames that we've received.
+  // (The latter include the frame that we're about to release, so there is always one.)
+  // We also return the arrival time of the frame that the timestamp belongs to (or 0, if it was released already).
+  Boolean haveResult = False;
+  unsigned result = 0;
+  arrivalTime = 0;
+  for (unsigned i = 0; i < fNumAheadTimestamps; ++i) {
+    if (!haveResult || (int)(fAheadTimestamps[i] - result) < 0) {
+      result = fAheadTimestamps[i];
+      haveResult = True;
+    }
+  }
+
+  Boolean usedTimestampIsStillStored[MAX_REORDERED_PLAYOUT_FRAMES];
+  for (unsigned i = 0; i < fNumUsedTimestamps; ++i) usedTimestampIsStillStored[i] = False;
+  unsigned short seqNo = fReorderingBuffer->headSeqNo();
+  unsigned short const tailSeqNo = fReorderingBuffer->tailSeqNo();
+  Boolean havePrevTimestamp = False;
+  unsigned prevTimestamp = 0;
+  while (1) {
+    BufferedPacket* packet = fReorderingBuffer->storedPacket(seqNo);
+    if (packet != NULL && !(havePrevTimestamp && packet->rtpTimestamp() == prevTimestamp)) {
+      unsigned timestamp = prevTimestamp = packet->rtpTimestamp();
+      havePrevTimestamp = True;
+
+      Boolean isUsed = False;
+      for (unsigned i = 0; i < fNumUsedTimestamps; ++i) {
+	if (fUsedTimestamps[i] == timestamp) usedTimestampIsStillStored[i] = isUsed = True;
+      }
+      if (!isUsed && timestamp != fLastFrameTimestamp
+	  && (!haveResult || (int)(timestamp - result) < 0)) {
+	result = timestamp;
+	haveResult = True;
+	struct timeval const& timeReceived = packet->timeReceived();
+	arrivalTime = (int64_t)timeReceived.tv_sec*1000000 + timeReceived.tv_usec;
+      }
+    }
+    if (seqNo == tailSeqNo) break;
+    ++seqNo;
+  }
+
+  // Forget the used timestamps of any frames that we no longer have (because they were discarded):
+  unsigned numUsedTimestamps = 0;
+  for (unsigned i = 0; i < fNumUsedTimestamps; ++i) {
+    if (usedTimestampIsStillStored[i]) fUsedTimestamps[numUsedTimestamps++] = fUsedTimestamps[i];
+  }
+  fNumUsedTimestamps = numUsedTimestamps;
+
+  if (!haveResult) result = fReorderingBuffer->storedPacket(fReorderingBuffer->headSeqNo())->rtpTimestamp(); // shouldn't happen
+  return result;
+}
+
+static Boolean removeTimestamp(unsigned timestamp, unsigned* timestamps, unsigned& numTimestamps) {
+  for (unsigned i = 0; i < numTimestamps; ++i) {
+    if (timestamps[i] == timestamp) {
+      timestamps[i] = timestamps[--numTimestamps];
+      return True;
+    }
+  }
+  return False;
+}
+
+static void addTimestamp(unsigned timestamp, unsigned* timestamps, unsigned& numTimestamps) {
+  if (numTimestamps == MAX_REORDERED_PLAYOUT_FRAMES) {
+    // The table is full (which shouldn't happen).  Forget the oldest entry:
+    for (unsigned i = 1; i < numTimestamps; ++i) timestamps[i-1] = timestamps[i];
+    --numTimestamps;
+  }
+  timestamps[numTimestamps++] = timestamp;
+}
+
+void MultiFramedRTPSource::notePlayoutTimestampUse(unsigned playoutTimestamp, unsigned frameTimestamp) {
+  if (playoutTimestamp == frameTimestamp) return; // the common case: The frame used its own timestamp
+
+  // The frame took the turn of another timestamp - either of a frame that we released earlier, or of a frame that
+  // we'll release later:
+  if (!removeTimestamp(playoutTimestamp, fAheadTimestamps, fNumAheadTimestamps)) {
+    addTimestamp(playoutTimestamp, fUsedTimestamps, fNumUsedTimestamps);
+  }
+
+  // And the frame's own timestamp is still to have its turn - unless an earlier frame already took it:
+  if (!removeTimestamp(frameTimestamp, fUsedTimestamps, fNumUsedTimestamps)) {
+    addTimestamp(frameTimestamp, fAheadTimestamps, fNumAheadTimestamps);
+  }
+}
+
+void MultiFramedRTPSource::updatePlayoutDelay() {
+  // Note that we use our own jitter estimate, rather than the one in "RTPReceptionStats", because that one compares
+  // packets in timestamp order, so is inflated by any frame reordering:
+  u_int64_t targetDelay = PLAYOUT_DELAY_JITTER_MULTIPLE*(u_int64_t)fPlayoutStats.jitter;
+  if (targetDelay < fMinPlayoutDelay) targetDelay = fMinPlayoutDelay;
+  else if (targetDelay > fMaxPlayoutDelay) targetDelay = fMaxPlayoutDelay;
+
+  // Increase the delay quickly (so that few frames arrive too late), but decrease it slowly (so that the rate at
+  // which we deliver frames stays steady):
+  unsigned& playoutDelay = fPlayoutStats.playoutDelay;
+  if (targetDelay > playoutDelay) {
+    playoutDelay += (unsigned)((targetDelay - playoutDelay + 3)/4);
+  } else {
+    playoutDelay -= (unsigned)((playoutDelay - targetDelay)/64);
+  }
+  setPacketReorderingThresholdTime(fReorderingThresholdTime);
+}
+
+void MultiFramedRTPSource::playoutTimerHandler(void* clientData) {
+  MultiFramedRTPSource* source = (MultiFramedRTPSource*)clientData;
+  source->fPlayoutTask = NULL;
+  source->doGetNextFrame1();
 }
 
 #define ADVANCE(n) do { bPacket->skip(n); } while (0)
@@ -310,6 +618,7 @@ void MultiFramedRTPSource::networkReadHandler1() {
       // but we can handle a single-SSRC stream where the SSRC changes occasionally:
       fLastReceivedSSRC = rtpSSRC;
       fReorderingBuffer->resetHaveSeenFirstPacket();
+      fHavePlayoutReference = False;
     }
     unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
     Boolean usableInJitterCalculation
@@ -330,6 +639,12 @@ void MultiFramedRTPSource::networkReadHandler1() {
 			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
 			      timeNow);
     if (!fReorderingBuffer->storePacket(bPacket)) break;
+    if (fPlayoutTask != NULL && (int)(rtpTimestamp - fHeldPlayoutTimestamp) < 0
+	&& (int)(rtpTimestamp - fLastPlayoutTimestamp) > 0) {
+      // This packet's frame (e.g., a 'B' frame) has an earlier turn than the one that we used to schedule the frame
+      // that we're holding.  Reschedule that frame (below):
+      envir().taskScheduler().unscheduleDelayedTask(fPlayoutTask);
+    }
 
     readSuccess = True;
   } while (0);
@@ -342,17 +657,39 @@ void MultiFramedRTPSource::networkReadHandler1() {
 
 ////////// BufferedPacket and BufferedPacketFactory implementation /////
 
-#define MAX_PACKET_SIZE 65536
+#define MAX_PACKET_SIZE PACKET_BUFFER_POOL_MAX_PACKET_SIZE
+
+// When we allocate a buffer for an incoming packet, we leave a little room after its data, because some
+// "nextEnclosedFrameSize()" implementations append a few bytes (e.g., a JPEG 'EOI' marker) to the data:
+#define PACKET_TRAILER_ROOM 8
 
 BufferedPacket::BufferedPacket()
   : fPacketSize(MAX_PACKET_SIZE),
-    fBuf(new unsigned char[MAX_PACKET_SIZE]),
-    fNextPacket(NULL) {
+    fBuf(NULL), fHead(0), fTail(0),
+    fPool(NULL), fBufferSize(0), fRefCount(0), fIsOrphaned(False), fNextPacket(NULL) {
 }
 
 BufferedPacket::~BufferedPacket() {
   delete fNextPacket;
-  delete[] fBuf;
+  if (fPool != NULL) {
+    fPool->release(fBuf, fBufferSize);
+    fPool->decrementReferenceCount();
+  }
+}
+
+void BufferedPacket::removeReference() {
+  if (--fRefCount == 0 && fIsOrphaned) delete this;
+}
+
+void BufferedPacket::reallocateBuffer(unsigned newSize, unsigned numBytesToKeep) {
+  unsigned newBufferSize;
+  unsigned char* newBuf = fPool->allocate(newSize, newBufferSize);
+  if (fBuf != NULL) {
+    if (numBytesToKeep > 0) memmove(newBuf, fBuf, numBytesToKeep);
+    fPool->release(fBuf, fBufferSize);
+  }
+  fBuf = newBuf;
+  fBufferSize = newBufferSize;
 }
 
 void BufferedPacket::reset() {
@@ -389,19 +726,58 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_i
 				   Boolean& packetReadWasIncomplete) {
   if (!packetReadWasIncomplete) reset();
 
-  unsigned const maxBytesToRead = bytesAvailable();
-  if (maxBytesToRead == 0) return False; // exceeded buffer size when reading over TCP
+  if (fPool == NULL) {
+    // This is our first packet.  We get our buffers from the environment's pool (and keep it alive while we use it):
+    fPool = PacketBufferPool::ourPool(rtpInterface.envir());
+    fPool->incrementReferenceCount();
+  }
 
   unsigned numBytesRead;
-  int tcpSocketNum; // not used
-  unsigned char tcpStreamChannelId; // not used
-  if (!rtpInterface.handleRead(&fBuf[fTail], maxBytesToRead,
-			       numBytesRead, fromAddress,
-			       tcpSocketNum, tcpStreamChannelId,
-			       packetReadWasIncomplete)) {
+  if (rtpInterface.nextReadIsFromTCP()) {
+    // We know how much (more) data there is in this packet, so make sure that our buffer is the right size for it,
+    // and then read the data directly into it:
+    unsigned bufferSizeNeeded = fTail + rtpInterface.nextTCPReadSize() + PACKET_TRAILER_ROOM;
+    if (bufferSizeNeeded > fPacketSize) bufferSizeNeeded = fPacketSize;
+    if (fBuf == NULL || fBufferSize < bufferSizeNeeded
+	|| (fTail == 0 && PacketBufferPool::sizeClassFor(fBufferSize) != PacketBufferPool::sizeClassFor(bufferSizeNeeded))) {
+      reallocateBuffer(bufferSizeNeeded, fTail);
+    }
+
+    unsigned const maxBytesToRead = fBufferSize - fTail;
+    if (maxBytesToRead == 0) return False; // exceeded buffer size when reading over TCP
+
+    int tcpSocketNum; // not used
+    unsigned char tcpStreamChannelId; // not used
+    if (!rtpInterface.handleRead(&fBuf[fTail], maxBytesToRead,
+				 numBytesRead, fromAddress,
+				 tcpSocketNum, tcpStreamChannelId,
+				 packetReadWasIncomplete)) {
+      return False;
+    }
+    fTail += numBytesRead;
+    return True;
+  }
+
+  // We don't know how big an incoming datagram is until we've read it.  Read it directly into our buffer (which is
+  // at least 'MTU'-sized), with any data that doesn't fit going into our pool's scratch buffer:
+  if (fBuf == NULL) reallocateBuffer(PACKET_BUFFER_POOL_MTU_BUFFER_SIZE, 0);
+  unsigned const buffer1Size = fBufferSize - PACKET_TRAILER_ROOM;
+  if (!rtpInterface.handleRead(fBuf, buffer1Size,
+			       fPool->scratchBuffer(), fPacketSize - buffer1Size,
+			       numBytesRead, fromAddress)) {
     return False;
   }
-  fTail += numBytesRead;
+
+  unsigned const bufferSizeNeeded = numBytesRead + PACKET_TRAILER_ROOM;
+  if (numBytesRead > buffer1Size) {
+    // Rare case: The datagram didn't fit in our buffer, so move it to a bigger one:
+    reallocateBuffer(bufferSizeNeeded, buffer1Size);
+    memmove(&fBuf[buffer1Size], fPool->scratchBuffer(), numBytesRead - buffer1Size);
+  } else if (PacketBufferPool::sizeClassFor(bufferSizeNeeded) < PacketBufferPool::sizeClassFor(fBufferSize)) {
+    // Our buffer (from an earlier, larger packet) is bigger than we now need, so move to a smaller one:
+    reallocateBuffer(bufferSizeNeeded, numBytesRead);
+  }
+  fTail = numBytesRead;
   return True;
 }
 
@@ -430,6 +806,10 @@ void BufferedPacket::removePadding(unsigned numBytes) {
 
 void BufferedPacket::appendData(unsigned char* newData, unsigned numBytes) {
   if (numBytes > fPacketSize-fTail) numBytes = fPacketSize - fTail;
+  if (fTail + numBytes > fBufferSize) {
+    if (fPool == NULL) return; // we don't have any data yet
+    reallocateBuffer(fTail + numBytes + PACKET_TRAILER_ROOM, fTail);
+  }
   memmove(&fBuf[fTail], newData, numBytes);
   fTail += numBytes;
 }
@@ -439,7 +819,8 @@ void BufferedPacket::use(unsigned char* to, unsigned toSize,
 			 unsigned short& rtpSeqNo, unsigned& rtpTimestamp,
 			 struct timeval& presentationTime,
 			 Boolean& hasBeenSyncedUsingRTCP,
-			 Boolean& rtpMarkerBit) {
+			 Boolean& rtpMarkerBit,
+			 FrameSlices* toSlices) {
   unsigned char* origFramePtr = &fBuf[fHead];
   unsigned char* newFramePtr = origFramePtr; // may change in the call below
   unsigned frameSize, frameDurationInMicroseconds;
@@ -453,7 +834,11 @@ void BufferedPacket::use(unsigned char* to, unsigned toSize,
     bytesUsed = frameSize;
   }
 
-  memmove(to, newFramePtr, bytesUsed);
+  if (toSlices != NULL) {
+    if (bytesUsed > 0) toSlices->addSlice(this, newFramePtr, bytesUsed);
+  } else {
+    memmove(to, newFramePtr, bytesUsed);
+  }
   fHead += (newFramePtr - origFramePtr) + frameSize;
   ++fUseCount;
 
@@ -471,6 +856,52 @@ void BufferedPacket::use(unsigned char* to, unsigned toSize,
   }
 }
 
+////////// FrameSlices implementation //////////
+
+FrameSlices::FrameSlices()
+  : fSlices(NULL), fNumSlices(0), fMaxNumSlices(0), fTotalSize(0) {
+}
+
+FrameSlices::~FrameSlices() {
+  reset();
+  delete[] fSlices;
+}
+
+void FrameSlices::addSlice(BufferedPacket* packet, unsigned char* data, unsigned size) {
+  if (fNumSlices == fMaxNumSlices) {
+    // Grow our array of slices:
+    unsigned newMaxNumSlices = fMaxNumSlices == 0 ? 16 : 2*fMaxNumSlices;
+    Slice* newSlices = new Slice[newMaxNumSlices];
+    for (unsigned i = 0; i < fNumSlices; ++i) newSlices[i] = fSlices[i];
+    delete[] fSlices;
+    fSlices = newSlices;
+    fMaxNumSlices = newMaxNumSlices;
+  }
+
+  packet->addReference();
+  fSlices[fNumSlices].packet = packet;
+  fSlices[fNumSlices].data = data;
+  fSlices[fNumSlices].size = size;
+  ++fNumSlices;
+  fTotalSize += size;
+}
+
+void FrameSlices::assign(FrameSlices const& from) {
+  if (&from == this) return;
+
+  reset();
+  for (unsigned i = 0; i < from.fNumSlices; ++i) {
+    addSlice(from.fSlices[i].packet, from.fSlices[i].data, from.fSlices[i].size);
+  }
+}
+
+void FrameSlices::reset() {
+  for (unsigned i = 0; i < fNumSlices; ++i) fSlices[i].packet->removeReference();
+  fNumSlices = 0;
+  fTotalSize = 0;
+}
+
+
 BufferedPacketFactory::BufferedPacketFactory() {
 }
 
@@ -487,37 +918,55 @@ BufferedPacket* BufferedPacketFactory
 
 ReorderingPacketBuffer
 ::ReorderingPacketBuffer(BufferedPacketFactory* packetFactory)
-  : fThresholdTime(100000) /* default reordering threshold: 100 ms */,
-    fHaveSeenFirstPacket(False), fHeadPacket(NULL), fTailPacket(NULL), fSavedPacket(NULL), fSavedPacketFree(True) {
+  : fThresholdTime(DEFAULT_REORDERING_THRESHOLD_TIME),
+    fHaveSeenFirstPacket(False), fNumSlots(REORDERING_BUFFER_INITIAL_NUM_SLOTS), fNumStoredPackets(0),
+    fFreePackets(NULL), fNumFreePackets(0) {
   fPacketFactory = (packetFactory == NULL)
     ? (new BufferedPacketFactory)
     : packetFactory;
+  fSlots = new BufferedPacket*[fNumSlots];
+  for (unsigned i = 0; i < fNumSlots; ++i) fSlots[i] = NULL;
 }
 
 ReorderingPacketBuffer::~ReorderingPacketBuffer() {
   reset();
+  delete[] fSlots;
   delete fPacketFactory;
 }
 
 void ReorderingPacketBuffer::reset() {
-  if (fSavedPacketFree) delete fSavedPacket; // because fSavedPacket is not in the list
-  delete fHeadPacket; // will also delete fSavedPacket if it's in the list
+  if (fNumStoredPackets > 0) {
+    for (unsigned i = 0; i < fNumSlots; ++i) {
+      if (fSlots[i] != NULL) {
+	if (fSlots[i]->isReferenced()) {
+	  fSlots[i]->orphan();
+	} else {
+	  delete fSlots[i]; // stored packets are not linked to any others
+	}
+	fSlots[i] = NULL;
+      }
+    }
+    fNumStoredPackets = 0;
+  }
+  while (fFreePackets != NULL) {
+    // Delete the free packets one at a time (rather than having each packet's destructor delete the rest of the list):
+    BufferedPacket* packet = fFreePackets;
+    fFreePackets = packet->nextPacket();
+    packet->nextPacket() = NULL;
+    delete packet;
+  }
+  fNumFreePackets = 0;
   resetHaveSeenFirstPacket();
-  fHeadPacket = fTailPacket = fSavedPacket = NULL;
 }
 
 BufferedPacket* ReorderingPacketBuffer::getFreePacket(MultiFramedRTPSource* ourSource) {
-  if (fSavedPacket == NULL) { // we're being called for the first time
-    fSavedPacket = fPacketFactory->createNewPacket(ourSource);
-    fSavedPacketFree = True;
-  }
+  if (fFreePackets == NULL) return fPacketFactory->createNewPacket(ourSource);
 
-  if (fSavedPacketFree == True) {
-    fSavedPacketFree = False;
-    return fSavedPacket;
-  } else {
-    return fPacketFactory->createNewPacket(ourSource);
-  }
+  BufferedPacket* packet = fFreePackets;
+  fFreePackets = packet->nextPacket();
+  --fNumFreePackets;
+  packet->nextPacket() = NULL;
+  return packet;
 }
 
 Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
@@ -533,76 +982,76 @@ Boolean ReorderingPacketBuffer::storePacket(BufferedPacket* bPacket) {
   // that we're looking for (in this case, it's been excessively delayed).
   if (seqNumLT(rtpSeqNo, fNextExpectedSeqNo)) return False;
 
-  if (fTailPacket == NULL) {
-    // Common case: There are no packets in the queue; this will be the first one:
-    bPacket->nextPacket() = NULL;
-    fHeadPacket = fTailPacket = bPacket;
-    return True;
-  }
-
-  if (seqNumLT(fTailPacket->rtpSeqNo(), rtpSeqNo)) {
-    // The next-most common case: There are packets already in the queue; this packet arrived in order => put it at the tail:
-    bPacket->nextPacket() = NULL;
-    fTailPacket->nextPacket() = bPacket;
-    fTailPacket = bPacket;
-    return True;
-  } 
-
-  if (rtpSeqNo == fTailPacket->rtpSeqNo()) {
-    // This is a duplicate packet - ignore it
-    return False;
-  }
-
-  // Rare case: This packet is out-of-order.  Run through the list (from the head), to figure out where it belongs:
-  BufferedPacket* beforePtr = NULL;
-  BufferedPacket* afterPtr = fHeadPacket;
-  while (afterPtr != NULL) {
-    if (seqNumLT(rtpSeqNo, afterPtr->rtpSeqNo())) break; // it comes here
-    if (rtpSeqNo == afterPtr->rtpSeqNo()) {
+  if (fNumStoredPackets == 0) {
+    // Common case: There are no packets in the buffer; this will be the first one:
+    fHeadSeqNo = fTailSeqNo = rtpSeqNo;
+  } else {
+    // Make sure that we have a slot for each sequence number from the (new) head to the (new) tail:
+    unsigned short newHeadSeqNo = seqNumLT(rtpSeqNo, fHeadSeqNo) ? rtpSeqNo : fHeadSeqNo;
+    unsigned short newTailSeqNo = seqNumLT(fTailSeqNo, rtpSeqNo) ? rtpSeqNo : fTailSeqNo;
+    unsigned numSeqNosSpanned = (unsigned short)(newTailSeqNo - newHeadSeqNo) + 1;
+    if (numSeqNosSpanned > fNumSlots && !growToAtLeast(numSeqNosSpanned)) return False;
+
+    // Because all stored packets now fall within "fNumSlots" consecutive sequence numbers, a slot can already be in use
+    // only by a packet with the same sequence number:
+    if (slot(rtpSeqNo) != NULL) {
       // This is a duplicate packet - ignore it
       return False;
     }
-
-    beforePtr = afterPtr;
-    afterPtr = afterPtr->nextPacket();
+    fHeadSeqNo = newHeadSeqNo;
+    fTailSeqNo = newTailSeqNo;
   }
 
-  // Link our new packet between "beforePtr" and "afterPtr":
-  bPacket->nextPacket() = afterPtr;
-  if (beforePtr == NULL) {
-    fHeadPacket = bPacket;
-  } else {
-    beforePtr->nextPacket() = bPacket;
+  slot(rtpSeqNo) = bPacket;
+  ++fNumStoredPackets;
+  return True;
+}
+
+Boolean ReorderingPacketBuffer::growToAtLeast(unsigned numSlots) {
+  // Sequence numbers are compared modulo 2^16, so we can't usefully span more than half of them:
+  if (numSlots > 0x8000) return False;
+
+  unsigned newNumSlots = fNumSlots;
+  while (newNumSlots < numSlots) newNumSlots *= 2;
+
+  BufferedPacket** newSlots = new BufferedPacket*[newNumSlots];
+  for (unsigned i = 0; i < newNumSlots; ++i) newSlots[i] = NULL;
+  for (unsigned j = 0; j < fNumSlots; ++j) {
+    if (fSlots[j] != NULL) newSlots[fSlots[j]->rtpSeqNo()&(newNumSlots-1)] = fSlots[j];
   }
 
+  delete[] fSlots;
+  fSlots = newSlots;
+  fNumSlots = newNumSlots;
   return True;
 }
 
 void ReorderingPacketBuffer::releaseUsedPacket(BufferedPacket* packet) {
-  // ASSERT: packet == fHeadPacket
+  // ASSERT: packet == slot(fHeadSeqNo)
   // ASSERT: fNextExpectedSeqNo == packet->rtpSeqNo()
   ++fNextExpectedSeqNo; // because we're finished with this packet now
 
-  fHeadPacket = fHeadPacket->nextPacket();
-  if (!fHeadPacket) { 
-    fTailPacket = NULL;
+  slot(packet->rtpSeqNo()) = NULL;
+  if (--fNumStoredPackets > 0) {
+    // Move the head forward to the next stored packet:
+    do ++fHeadSeqNo; while (slot(fHeadSeqNo) == NULL);
   }
-  packet->nextPacket() = NULL;
 
   freePacket(packet);
 }
 
 BufferedPacket* ReorderingPacketBuffer
 ::getNextCompletedPacket(Boolean& packetLossPreceded) {
-  if (fHeadPacket == NULL) return NULL;
+  if (fNumStoredPackets == 0) return NULL;
+  BufferedPacket* headPacket = slot(fHeadSeqNo);
 
   // Check whether the next packet we want is already at the head
   // of the queue:
-  // ASSERT: fHeadPacket->rtpSeqNo() >= fNextExpectedSeqNo
-  if (fHeadPacket->rtpSeqNo() == fNextExpectedSeqNo) {
-    packetLossPreceded = fHeadPacket->isFirstPacket();
+  // ASSERT: headPacket->rtpSeqNo() >= fNextExpectedSeqNo
+  if (headPacket->rtpSeqNo() == fNextExpectedSeqNo) {
+    packetLossPreceded = headPacket->isFirstPacket();
         // (The very first packet is treated as if there was packet loss beforehand.)
-    return fHeadPacket;
+    return headPacket;
   }
 
   // We're still waiting for our desired packet to arrive.  However, if
@@ -615,15 +1064,15 @@ BufferedPacket* ReorderingPacketBuffer
     struct timeval timeNow;
     gettimeofday(&timeNow, NULL);
     unsigned uSecondsSinceReceived
-      = (timeNow.tv_sec - fHeadPacket->timeReceived().tv_sec)*1000000
-      + (timeNow.tv_usec - fHeadPacket->timeReceived().tv_usec);
+      = (timeNow.tv_sec - headPacket->timeReceived().tv_sec)*1000000
+      + (timeNow.tv_usec - headPacket->timeReceived().tv_usec);
     timeThresholdHasBeenExceeded = uSecondsSinceReceived > fThresholdTime;
   }
   if (timeThresholdHasBeenExceeded) {
-    fNextExpectedSeqNo = fHeadPacket->rtpSeqNo();
+    fNextExpectedSeqNo = headPacket->rtpSeqNo();
         // we've given up on earlier packets now
     packetLossPreceded = True;
-    return fHeadPacket;
+    return headPacket;
   }
 
   // Otherwise, keep waiting for our desired packet to arrive:
@@ -21,7 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "OggFileSink.hh"
 #include "OutputFile.hh"
 #include "VorbisAudioRTPSource.hh" // for "parseVorbisOrTheoraConfigStr()"
-#include "MPEG2TransportStreamMultiplexor.hh" // for calculateCRC()
+#include "CRC32.hh"
 #include "FramedSource.hh"
 
 OggFileSink* OggFileSink
@@ -0,0 +1,131 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A pool of incoming packet buffers, shared by all RTP sources in an environment.
+// Implementation
+
+#include "PacketBufferPool.hh"
+
+// Each slab begins with a header that points to the next slab (padded, to keep the buffers that follow it aligned):
+#define SLAB_HEADER_SIZE 16
+
+PacketBufferPool* PacketBufferPool::ourPool(UsageEnvironment& env, Boolean createIfNotPresent) {
+  _Tables* ourTables = _Tables::getOurTables(env, createIfNotPresent);
+  if (ourTables == NULL) return NULL;
+
+  if (ourTables->packetBufferPool == NULL && createIfNotPresent) {
+    ourTables->packetBufferPool = new PacketBufferPool(env);
+  }
+  return (PacketBufferPool*)(ourTables->packetBufferPool);
+}
+
+PacketBufferPool::PacketBufferPool(UsageEnvironment& env)
+  : fEnv(env), fScratchBuffer(new unsigned char[PACKET_BUFFER_POOL_MAX_PACKET_SIZE]),
+    fReferenceCount(0), fNumBuffersInUse(0) {
+  for (unsigned i = 0; i < numSizeClasses; ++i) {
+    SizeClassRecord& c = fClasses[i];
+    c.stats.bufferSize = i == mtuSizeClass ? PACKET_BUFFER_POOL_MTU_BUFFER_SIZE
+      : i == jumboSizeClass ? PACKET_BUFFER_POOL_JUMBO_BUFFER_SIZE : 0;
+    c.stats.numBuffersInUse = c.stats.maxNumBuffersInUse = c.stats.numBuffersAllocated = 0;
+    c.stats.numAllocations = 0;
+    c.freeBuffers = c.slabs = NULL;
+  }
+}
+
+PacketBufferPool::~PacketBufferPool() {
+  for (unsigned i = 0; i < numSizeClasses; ++i) {
+    unsigned char* slab = fClasses[i].slabs;
+    while (slab != NULL) {
+      unsigned char* nextSlab = *(unsigned char**)slab;
+      delete[] slab;
+      slab = nextSlab;
+    }
+  }
+  delete[] fScratchBuffer;
+}
+
+PacketBufferPool::SizeClass PacketBufferPool::sizeClassFor(unsigned size) {
+  if (size <= PACKET_BUFFER_POOL_MTU_BUFFER_SIZE) return mtuSizeClass;
+  if (size <= PACKET_BUFFER_POOL_JUMBO_BUFFER_SIZE) return jumboSizeClass;
+  return oversizeSizeClass;
+}
+
+unsigned char* PacketBufferPool::allocate(unsigned size, unsigned& resultBufferSize) {
+  SizeClass sizeClass = sizeClassFor(size);
+  SizeClassRecord& c = fClasses[sizeClass];
+
+  unsigned char* buffer;
+  if (sizeClass == oversizeSizeClass) {
+    resultBufferSize = size;
+    buffer = new unsigned char[size];
+  } else {
+    if (c.freeBuffers == NULL) addSlab(sizeClass);
+    resultBufferSize = c.stats.bufferSize;
+    buffer = c.freeBuffers;
+    c.freeBuffers = *(unsigned char**)buffer;
+  }
+
+  ++fNumBuffersInUse;
+  if (++c.stats.numBuffersInUse > c.stats.maxNumBuffersInUse) c.stats.maxNumBuffersInUse = c.stats.numBuffersInUse;
+  ++c.stats.numAllocations;
+  return buffer;
+}
+
+void PacketBufferPool::release(unsigned char* buffer, unsigned bufferSize) {
+  if (buffer == NULL) return;
+
+  SizeClass sizeClass = sizeClassFor(bufferSize);
+  SizeClassRecord& c = fClasses[sizeClass];
+  if (sizeClass == oversizeSizeClass) {
+    delete[] buffer;
+  } else {
+    *(unsigned char**)buffer = c.freeBuffers;
+    c.freeBuffers = buffer;
+  }
+
+  --c.stats.numBuffersInUse;
+  --fNumBuffersInUse;
+}
+
+void PacketBufferPool::decrementReferenceCount() {
+  if (fReferenceCount > 0) --fReferenceCount;
+  if (fReferenceCount > 0 || fNumBuffersInUse > 0) return;
+
+  // We're no longer used, so delete ourself:
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv);
+  ourTables->packetBufferPool = NULL;
+  ourTables->reclaimIfPossible();
+  delete this;
+}
+
+void PacketBufferPool::addSlab(SizeClass sizeClass) {
+  SizeClassRecord& c = fClasses[sizeClass];
+  unsigned const bufferSize = c.stats.bufferSize;
+
+  unsigned char* slab = new unsigned char[SLAB_HEADER_SIZE + PACKET_BUFFER_POOL_NUM_BUFFERS_PER_SLAB*bufferSize];
+  *(unsigned char**)slab = c.slabs;
+  c.slabs = slab;
+
+  // Add each of the slab's buffers to the free list:
+  for (unsigned i = 0; i < PACKET_BUFFER_POOL_NUM_BUFFERS_PER_SLAB; ++i) {
+    unsigned char* buffer = &slab[SLAB_HEADER_SIZE + i*bufferSize];
+    *(unsigned char**)buffer = c.freeBuffers;
+    c.freeBuffers = buffer;
+  }
+  c.stats.numBuffersAllocated += PACKET_BUFFER_POOL_NUM_BUFFERS_PER_SLAB;
+}
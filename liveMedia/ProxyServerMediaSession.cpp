@@ -106,7 +106,8 @@ ProxyServerMediaSession
     fPresentationTimeSessionNormalizer(new PresentationTimeSessionNormalizer(envir())),
     fCreateNewProxyRTSPClientFunc(ourCreateNewProxyRTSPClientFunc),
     fTranscodingTable(transcodingTable),
-    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP) {
+    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP),
+    fMinPlayoutDelay(0), fMaxPlayoutDelay(0) {
   // Open a RTSP connection to the input stream, and send a "DESCRIBE" command.
   // We'll use the SDP description in the response to set ourselves up.
   fProxyRTSPClient
@@ -487,6 +488,10 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
       envir() << "\tInitiated: " << *this << "\n";
     }
 
+    if (fClientMediaSubsession.rtpSource() != NULL && sms->fMaxPlayoutDelay > 0) {
+      fClientMediaSubsession.rtpSource()->setAdaptivePlayoutDelay(sms->fMinPlayoutDelay, sms->fMaxPlayoutDelay);
+    }
+
     if (fClientMediaSubsession.readSource() != NULL) {
       // First, check whether we have defined a 'transcoder' filter to be used with this codec:
       if (sms->fTranscodingTable != NULL) {
@@ -619,13 +624,20 @@ RTPSink* ProxyServerMediaSubsession
     newSink = H263plusVideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
 					      fClientMediaSubsession.rtpTimestampFrequency()); 
   } else if (strcmp(fCodecName, "H264") == 0) {
-    newSink = H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
-					  fClientMediaSubsession.fmtp_spropparametersets());
+    H264VideoRTPSink* h264Sink
+      = H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+				    fClientMediaSubsession.fmtp_spropparametersets());
+    // Send each proxied NAL unit directly from the buffer into which it was reassembled, rather than copying it again:
+    if (h264Sink != NULL) h264Sink->setScatterGatherPacketization();
+    newSink = h264Sink;
   } else if (strcmp(fCodecName, "H265") == 0) {
-    newSink = H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
-					  fClientMediaSubsession.fmtp_spropvps(),
-					  fClientMediaSubsession.fmtp_spropsps(),
-					  fClientMediaSubsession.fmtp_sproppps());
+    H265VideoRTPSink* h265Sink
+      = H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+				    fClientMediaSubsession.fmtp_spropvps(),
+				    fClientMediaSubsession.fmtp_spropsps(),
+				    fClientMediaSubsession.fmtp_sproppps());
+    if (h265Sink != NULL) h265Sink->setScatterGatherPacketization();
+    newSink = h265Sink;
   } else if (strcmp(fCodecName, "JPEG") == 0) {
     newSink = SimpleRTPSink::createNew(envir(), rtpGroupsock, 26, 90000, "video", "JPEG",
 				       1/*numChannels*/, False/*allowMultipleFramesPerPacket*/, False/*doNormalMBitRule*/);
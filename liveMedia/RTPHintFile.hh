@@ -0,0 +1,55 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// The format of 'RTP hint' files: files of pre-built RTP packet payloads, that can be streamed
+// without re-parsing (or re-packetizing) the original media file.
+// C++ header
+
+#ifndef _RTP_HINT_FILE_HH
+#define _RTP_HINT_FILE_HH
+
+// An 'RTP hint' file (written by "RTPHintFileWriter"; read by "RTPHintFileSource") consists of:
+// - A header (RTP_HINT_FILE_HEADER_SIZE bytes):
+//     4 bytes: 'L', 'R', 'T', 'H'
+//     1 byte: the format version (RTP_HINT_FILE_VERSION)
+//     1 byte: the RTP payload type
+//     1 byte: the number of (audio) channels
+//     1 byte: (reserved: 0)
+//     4 bytes: the RTP timestamp frequency
+//     8 bytes: the total playing duration, in microseconds
+//     8 bytes: the file offset of the trailer (0 if the file was not completed)
+// - A sequence of packet records, each consisting of:
+//     2 bytes: the size of the packet's RTP payload
+//     1 byte: flags (RTP_HINT_FLAG_MARKER: the RTP 'M' bit is set)
+//     1 byte: (reserved: 0)
+//     4 bytes: the packet's RTP timestamp, relative to that of the first packet
+//     4 bytes: the time (in microseconds) from sending this packet until the next packet should be sent
+//     the RTP payload (i.e., the packet, without its 12-byte RTP header)
+// - A trailer, consisting of three strings - each preceded by its 2-byte length:
+//     the SDP media type (e.g., "video")
+//     the RTP payload format name (e.g., "H264")
+//     the SDP line(s) (e.g., "a=fmtp:") returned by "RTPSink::auxSDPLine()" (if any)
+// All numbers are big-endian.
+
+#define RTP_HINT_FILE_VERSION 1
+#define RTP_HINT_FILE_HEADER_SIZE 28
+#define RTP_HINT_FILE_DURATION_POSITION 12
+#define RTP_HINT_FILE_TRAILER_OFFSET_POSITION 20
+#define RTP_HINT_RECORD_HEADER_SIZE 12
+#define RTP_HINT_FLAG_MARKER 0x80
+
+#endif
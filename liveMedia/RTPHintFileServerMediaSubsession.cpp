@@ -0,0 +1,67 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A 'ServerMediaSubsession' object that creates new, unicast, "RTPSink"s
+// on demand, from an 'RTP hint' file (of pre-built RTP packet payloads).
+// Implementation
+
+#include "RTPHintFileServerMediaSubsession.hh"
+#include "RTPHintFileSource.hh"
+#include "HintedRTPSink.hh"
+
+RTPHintFileServerMediaSubsession*
+RTPHintFileServerMediaSubsession::createNew(UsageEnvironment& env, char const* fileName,
+					    Boolean reuseFirstSource) {
+  // Open the file once now, to check it, and to get its duration and bitrate:
+  RTPHintFileSource* hintFileSource = RTPHintFileSource::createNew(env, fileName);
+  if (hintFileSource == NULL) return NULL;
+
+  float duration = hintFileSource->duration();
+  unsigned estBitrate = duration > 0.0 ? (unsigned)((hintFileSource->numRecordBytes()*8)/(duration*1000)) : 500;
+  Medium::close(hintFileSource);
+
+  return new RTPHintFileServerMediaSubsession(env, fileName, reuseFirstSource, duration, estBitrate);
+}
+
+RTPHintFileServerMediaSubsession
+::RTPHintFileServerMediaSubsession(UsageEnvironment& env, char const* fileName, Boolean reuseFirstSource,
+				   float duration, unsigned estBitrate)
+  : FileServerMediaSubsession(env, fileName, reuseFirstSource),
+    fDuration(duration), fEstBitrate(estBitrate) {
+}
+
+RTPHintFileServerMediaSubsession::~RTPHintFileServerMediaSubsession() {
+}
+
+float RTPHintFileServerMediaSubsession::duration() const {
+  return fDuration;
+}
+
+FramedSource* RTPHintFileServerMediaSubsession
+::createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+  estBitrate = fEstBitrate;
+
+  return RTPHintFileSource::createNew(envir(), fFileName);
+}
+
+RTPSink* RTPHintFileServerMediaSubsession
+::createNewRTPSink(Groupsock* rtpGroupsock,
+		   unsigned char rtpPayloadTypeIfDynamic,
+		   FramedSource* inputSource) {
+  return HintedRTPSink::createNew(envir(), rtpGroupsock, *(RTPHintFileSource*)inputSource,
+				  rtpPayloadTypeIfDynamic);
+}
@@ -0,0 +1,183 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A source that reads the pre-built RTP packet payloads from an 'RTP hint' file
+// (delivering each as a separate frame, for streaming by a "HintedRTPSink").
+// Implementation
+
+#include "RTPHintFileSource.hh"
+#include "RTPHintFile.hh"
+#include "InputFile.hh"
+#include <GroupsockHelper.hh>
+
+static u_int32_t get32(unsigned char const* p) { return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3]; }
+static u_int64_t get64(unsigned char const* p) { return ((u_int64_t)get32(p)<<32)|get32(&p[4]); }
+
+static char* readString(FILE* fid) {
+  unsigned char lenBytes[2];
+  if (fread(lenBytes, 1, 2, fid) < 2) return NULL;
+  unsigned len = (lenBytes[0]<<8)|lenBytes[1];
+
+  char* str = new char[len+1];
+  if (fread(str, 1, len, fid) < len) {
+    delete[] str;
+    return NULL;
+  }
+  str[len] = '\0';
+  return str;
+}
+
+RTPHintFileSource*
+RTPHintFileSource::createNew(UsageEnvironment& env, char const* fileName) {
+  FILE* fid = NULL;
+  char* sdpMediaType = NULL;
+  char* rtpPayloadFormatName = NULL;
+  char* auxSDPLine = NULL;
+  do {
+    fid = OpenInputFile(env, fileName);
+    if (fid == NULL) break;
+
+    unsigned char header[RTP_HINT_FILE_HEADER_SIZE];
+    if (fread(header, 1, sizeof header, fid) < sizeof header
+	|| header[0] != 'L' || header[1] != 'R' || header[2] != 'T' || header[3] != 'H') {
+      env.setResultMsg("\"", fileName, "\" is not an RTP hint file");
+      break;
+    }
+    if (header[4] != RTP_HINT_FILE_VERSION) {
+      env.setResultMsg("RTP hint file \"", fileName, "\" has an unknown format version");
+      break;
+    }
+    unsigned rtpTimestampFrequency = get32(&header[8]);
+    u_int64_t durationInMicroseconds = get64(&header[RTP_HINT_FILE_DURATION_POSITION]);
+    u_int64_t trailerOffset = get64(&header[RTP_HINT_FILE_TRAILER_OFFSET_POSITION]);
+    if (rtpTimestampFrequency == 0 || trailerOffset < RTP_HINT_FILE_HEADER_SIZE) {
+      env.setResultMsg("RTP hint file \"", fileName, "\" is incomplete");
+      break;
+    }
+
+    // Read the strings in the trailer, then return to the first packet record:
+    if (SeekFile64(fid, trailerOffset, SEEK_SET) < 0) break;
+    sdpMediaType = readString(fid);
+    rtpPayloadFormatName = readString(fid);
+    auxSDPLine = readString(fid);
+    if (sdpMediaType == NULL || rtpPayloadFormatName == NULL || auxSDPLine == NULL) {
+      env.setResultMsg("RTP hint file \"", fileName, "\" has a bad trailer");
+      break;
+    }
+    if (auxSDPLine[0] == '\0') {
+      delete[] auxSDPLine; auxSDPLine = NULL;
+    }
+    if (SeekFile64(fid, RTP_HINT_FILE_HEADER_SIZE, SEEK_SET) < 0) break;
+
+    return new RTPHintFileSource(env, fid, header[5], rtpTimestampFrequency, header[6],
+				 durationInMicroseconds, trailerOffset,
+				 sdpMediaType, rtpPayloadFormatName, auxSDPLine);
+  } while (0);
+
+  // An error occurred:
+  delete[] sdpMediaType; delete[] rtpPayloadFormatName; delete[] auxSDPLine;
+  CloseInputFile(fid);
+  return NULL;
+}
+
+RTPHintFileSource
+::RTPHintFileSource(UsageEnvironment& env, FILE* fid,
+		    unsigned char rtpPayloadType, unsigned rtpTimestampFrequency, unsigned numChannels,
+		    u_int64_t fileDurationInMicroseconds, u_int64_t recordsEnd,
+		    char* sdpMediaType, char* rtpPayloadFormatName, char* auxSDPLine)
+  : FramedFileSource(env, fid),
+    fRTPPayloadType(rtpPayloadType), fRTPTimestampFrequency(rtpTimestampFrequency), fNumChannels(numChannels),
+    fFileDurationInMicroseconds(fileDurationInMicroseconds),
+    fRecordsStart(RTP_HINT_FILE_HEADER_SIZE), fRecordsEnd(recordsEnd),
+    fNumUnreadRecordBytes(recordsEnd - RTP_HINT_FILE_HEADER_SIZE),
+    fSDPMediaType(sdpMediaType), fRTPPayloadFormatName(rtpPayloadFormatName), fAuxSDPLine(auxSDPLine),
+    fBuffer(new unsigned char[RTP_HINT_FILE_SOURCE_BUFFER_SIZE]), fBufferHead(0), fBufferTail(0),
+    fHaveStarted(False),
+    fDeliverByReference(False), fCurPayload(NULL), fCurPayloadSize(0), fCurPacketHasMarkerBit(False) {
+}
+
+RTPHintFileSource::~RTPHintFileSource() {
+  delete[] fBuffer;
+  delete[] fSDPMediaType; delete[] fRTPPayloadFormatName; delete[] fAuxSDPLine;
+  CloseInputFile(fFid);
+}
+
+Boolean RTPHintFileSource::ensureBufferedBytes(unsigned numBytes) {
+  if (fBufferTail - fBufferHead >= numBytes) return True;
+
+  // Move our remaining data to the start of the buffer, then read (as much as we can) after it:
+  unsigned numRemainingBytes = fBufferTail - fBufferHead;
+  memmove(fBuffer, &fBuffer[fBufferHead], numRemainingBytes);
+  fBufferHead = 0; fBufferTail = numRemainingBytes;
+
+  unsigned numBytesToRead = RTP_HINT_FILE_SOURCE_BUFFER_SIZE - fBufferTail;
+  if (numBytesToRead > fNumUnreadRecordBytes) numBytesToRead = (unsigned)fNumUnreadRecordBytes;
+  if (numBytesToRead > 0) {
+    size_t numBytesRead = fread(&fBuffer[fBufferTail], 1, numBytesToRead, fFid);
+    fBufferTail += numBytesRead;
+    fNumUnreadRecordBytes -= numBytesRead;
+    if (numBytesRead < numBytesToRead) fNumUnreadRecordBytes = 0; // the file was truncated
+  }
+
+  return fBufferTail - fBufferHead >= numBytes;
+}
+
+void RTPHintFileSource::doGetNextFrame() {
+  // Read the next packet record:
+  if (!ensureBufferedBytes(RTP_HINT_RECORD_HEADER_SIZE)) {
+    handleClosure();
+    return;
+  }
+  unsigned char const* recordHeader = &fBuffer[fBufferHead];
+  unsigned payloadSize = (recordHeader[0]<<8)|recordHeader[1];
+  fCurPacketHasMarkerBit = (recordHeader[2]&RTP_HINT_FLAG_MARKER) != 0;
+  int32_t rtpTimestampOffset = (int32_t)get32(&recordHeader[4]);
+  fDurationInMicroseconds = get32(&recordHeader[8]);
+  if (!ensureBufferedBytes(RTP_HINT_RECORD_HEADER_SIZE + payloadSize)) {
+    handleClosure();
+    return;
+  }
+  fCurPayload = &fBuffer[fBufferHead + RTP_HINT_RECORD_HEADER_SIZE];
+  fCurPayloadSize = payloadSize;
+  fBufferHead += RTP_HINT_RECORD_HEADER_SIZE + payloadSize;
+
+  // Each packet's presentation time is that of the first, plus its relative RTP timestamp:
+  if (!fHaveStarted) {
+    gettimeofday(&fPresentationTimeBase, NULL);
+    fHaveStarted = True;
+  }
+  int64_t uSecondsFromBase = ((int64_t)rtpTimestampOffset*1000000)/fRTPTimestampFrequency;
+  int64_t uSeconds = fPresentationTimeBase.tv_usec + uSecondsFromBase;
+  int64_t seconds = uSeconds >= 0 ? uSeconds/1000000 : -((999999 - uSeconds)/1000000);
+  fPresentationTime.tv_sec = fPresentationTimeBase.tv_sec + (long)seconds;
+  fPresentationTime.tv_usec = (long)(uSeconds - seconds*1000000);
+
+  if (fDeliverByReference) {
+    fFrameSize = 0;
+  } else {
+    fFrameSize = payloadSize;
+    if (fFrameSize > fMaxSize) {
+      fNumTruncatedBytes = fFrameSize - fMaxSize;
+      fFrameSize = fMaxSize;
+    }
+    memmove(fTo, fCurPayload, fFrameSize);
+  }
+
+  // Because we read the file from within the event loop, we can call our 'after getting' function directly,
+  // without risk of infinite recursion:
+  FramedSource::afterGetting(this);
+}
@@ -0,0 +1,125 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// An object that writes the packets built by a "MultiFramedRTPSink" to an 'RTP hint' file,
+// so that they can later be streamed (using "RTPHintFileSource" and "HintedRTPSink")
+// without re-parsing (or re-packetizing) the original media.
+// Implementation
+
+#include "RTPHintFileWriter.hh"
+#include "RTPHintFile.hh"
+#include "OutputFile.hh"
+#include "InputFile.hh"
+
+static void put16(unsigned char* p, unsigned x) { p[0] = x>>8; p[1] = x; }
+static void put32(unsigned char* p, u_int32_t x) { p[0] = x>>24; p[1] = x>>16; p[2] = x>>8; p[3] = x; }
+static void put64(unsigned char* p, u_int64_t x) { put32(p, (u_int32_t)(x>>32)); put32(&p[4], (u_int32_t)x); }
+
+RTPHintFileWriter* RTPHintFileWriter
+::createNew(UsageEnvironment& env, char const* fileName, MultiFramedRTPSink& sink) {
+  FILE* fid = OpenOutputFile(env, fileName);
+  if (fid == NULL) return NULL;
+
+  // Write the file header.  (The duration and trailer offset get filled in later, when we're closed.)
+  unsigned char header[RTP_HINT_FILE_HEADER_SIZE];
+  memset(header, 0, sizeof header);
+  header[0] = 'L'; header[1] = 'R'; header[2] = 'T'; header[3] = 'H';
+  header[4] = RTP_HINT_FILE_VERSION;
+  header[5] = sink.rtpPayloadType();
+  header[6] = sink.numChannels();
+  put32(&header[8], sink.rtpTimestampFrequency());
+  if (fwrite(header, 1, sizeof header, fid) < sizeof header) {
+    env.setResultMsg("Failed to write the header of RTP hint file \"", fileName, "\"");
+    CloseOutputFile(fid);
+    return NULL;
+  }
+
+  return new RTPHintFileWriter(env, fid, sink);
+}
+
+RTPHintFileWriter::RTPHintFileWriter(UsageEnvironment& env, FILE* fid, MultiFramedRTPSink& sink)
+  : Medium(env), fFid(fid), fSink(sink),
+    fNumPacketsWritten(0), fFirstRTPTimestamp(0), fTotalDurationInMicroseconds(0) {
+  fSink.setPacketCaptureFunc(capturePacket, this);
+}
+
+RTPHintFileWriter::~RTPHintFileWriter() {
+  fSink.setPacketCaptureFunc(NULL, NULL);
+
+  // Write the trailer, then go back and fill in the header's duration and trailer offset:
+  u_int64_t trailerOffset = (u_int64_t)TellFile64(fFid);
+  writeString(fSink.sdpMediaType());
+  writeString(fSink.rtpPayloadFormatName());
+  writeString(fSink.auxSDPLine());
+
+  unsigned char buf[16];
+  put64(buf, fTotalDurationInMicroseconds);
+  put64(&buf[8], trailerOffset);
+  SeekFile64(fFid, RTP_HINT_FILE_DURATION_POSITION, SEEK_SET);
+  fwrite(buf, 1, sizeof buf, fFid);
+
+  CloseOutputFile(fFid);
+}
+
+void RTPHintFileWriter
+::capturePacket(void* clientData,
+		unsigned char const* packet, unsigned packetSize,
+		unsigned char const* externalPayload, unsigned externalPayloadSize,
+		unsigned uSecondsToNextPacket) {
+  ((RTPHintFileWriter*)clientData)
+    ->capturePacket1(packet, packetSize, externalPayload, externalPayloadSize, uSecondsToNextPacket);
+}
+
+void RTPHintFileWriter
+::capturePacket1(unsigned char const* packet, unsigned packetSize,
+		 unsigned char const* externalPayload, unsigned externalPayloadSize,
+		 unsigned uSecondsToNextPacket) {
+  unsigned const rtpHeaderSize = 12; // "MultiFramedRTPSink" doesn't add CSRCs or header extensions
+  if (packetSize < rtpHeaderSize) return; // shouldn't happen
+  unsigned payloadSize = packetSize - rtpHeaderSize + externalPayloadSize;
+  if (payloadSize > 0xFFFF) {
+    envir() << "RTPHintFileWriter: Ignoring an (impossibly) large " << payloadSize << "-byte packet\n";
+    return;
+  }
+
+  u_int32_t rtpTimestamp = (packet[4]<<24)|(packet[5]<<16)|(packet[6]<<8)|packet[7];
+  if (fNumPacketsWritten == 0) fFirstRTPTimestamp = rtpTimestamp;
+
+  unsigned char recordHeader[RTP_HINT_RECORD_HEADER_SIZE];
+  put16(recordHeader, payloadSize);
+  recordHeader[2] = (packet[1]&0x80) != 0 ? RTP_HINT_FLAG_MARKER : 0;
+  recordHeader[3] = 0;
+  put32(&recordHeader[4], rtpTimestamp - fFirstRTPTimestamp);
+  put32(&recordHeader[8], uSecondsToNextPacket);
+
+  fwrite(recordHeader, 1, sizeof recordHeader, fFid);
+  fwrite(&packet[rtpHeaderSize], 1, packetSize - rtpHeaderSize, fFid);
+  if (externalPayloadSize > 0) fwrite(externalPayload, 1, externalPayloadSize, fFid);
+
+  ++fNumPacketsWritten;
+  fTotalDurationInMicroseconds += uSecondsToNextPacket;
+}
+
+void RTPHintFileWriter::writeString(char const* str) {
+  unsigned len = str == NULL ? 0 : strlen(str);
+  if (len > 0xFFFF) len = 0xFFFF;
+
+  unsigned char lenBytes[2];
+  put16(lenBytes, len);
+  fwrite(lenBytes, 1, 2, fFid);
+  if (len > 0) fwrite(str, 1, len, fFid);
+}
@@ -24,6 +24,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <GroupsockHelper.hh>
 #include <stdio.h>
 
+// On platforms that support it, we send the RFC 2326 framing header and the RTP/RTCP packet
+// data that follows it using a single, scatter-gather "sendmsg()" call (rather than separate "send()"s):
+#ifdef HAVE_SCATTER_GATHER_SEND
+#include <sys/uio.h>
+#endif
+
 ////////// Helper Functions - Definition //////////
 
 // Helper routines and data structures, used to implement
@@ -45,6 +51,12 @@ static HashTable* socketHashTable(UsageEnvironment& env, Boolean createIfNotPres
   return (HashTable*)(ourTables->socketTable);
 }
 
+// Data arriving on a TCP socket is read in large chunks into a per-socket buffer, from which
+// the RFC 2326 framing (and any RTSP command or response bytes) is then parsed:
+#ifndef RTP_OVER_TCP_READ_BUFFER_SIZE
+#define RTP_OVER_TCP_READ_BUFFER_SIZE 65536
+#endif
+
 class SocketDescriptor {
 public:
   SocketDescriptor(UsageEnvironment& env, int socketNum);
@@ -60,9 +72,17 @@ public:
     fServerRequestAlternativeByteHandlerClientData = clientData;
   }
 
+  int readData(u_int8_t* to, unsigned numBytes, struct sockaddr_in& fromAddress);
+      // Reads up to "numBytes" bytes of packet data - first from our buffer, then (if that's empty)
+      // directly from the socket.  Returns the number of bytes read, or -1 on error.
+
 private:
   static void tcpReadHandler(SocketDescriptor*, int mask);
   Boolean tcpReadHandler1(int mask);
+  int readNextByte(u_int8_t& c);
+      // Returns 1 if a byte was read (from our buffer, refilling it if necessary), 0 if no data
+      // is currently available, or -1 on error.
+  Boolean haveBufferedData() const { return fReadBufferHead < fReadBufferTail; }
 
 private:
   UsageEnvironment& fEnv;
@@ -71,6 +91,9 @@ private:
   ServerRequestAlternativeByteHandler* fServerRequestAlternativeByteHandler;
   void* fServerRequestAlternativeByteHandlerClientData;
   u_int8_t fStreamChannelId, fSizeByte1;
+  u_int8_t* fReadBuffer; // allocated when first needed
+  unsigned fReadBufferHead, fReadBufferTail; // the unconsumed data is fReadBuffer[fReadBufferHead..fReadBufferTail)
+  struct sockaddr_in fLastFromAddress;
   Boolean fReadErrorOccurred, fDeleteMyselfNext, fAreInReadHandlerLoop;
   enum { AWAITING_DOLLAR, AWAITING_STREAM_CHANNEL_ID, AWAITING_SIZE1, AWAITING_SIZE2, AWAITING_PACKET_DATA } fTCPReadingState;
 };
@@ -227,6 +250,27 @@ Boolean RTPInterface::sendPacket(unsigned char* packet, unsigned packetSize) {
   return success;
 }
 
+Boolean RTPInterface::sendPacket(unsigned char* header, unsigned headerSize,
+				 unsigned char* payload, unsigned payloadSize) {
+  Boolean success = True; // we'll return False instead if any of the sends fail
+
+  // Normal case: Send as a UDP packet:
+  if (!fGS->output(envir(), header, headerSize, payload, payloadSize)) success = False;
+
+  // Also, send over each of our TCP sockets:
+  tcpStreamRecord* nextStream;
+  for (tcpStreamRecord* stream = fTCPStreams; stream != NULL; stream = nextStream) {
+    nextStream = stream->fNext; // Set this now, in case the following deletes "stream":
+    if (!sendRTPorRTCPPacketOverTCP(header, headerSize,
+				    stream->fStreamSocketNum, stream->fStreamChannelId,
+				    payload, payloadSize)) {
+      success = False;
+    }
+  }
+
+  return success;
+}
+
 void RTPInterface
 ::startNetworkReading(TaskScheduler::BackgroundHandlerProc* handlerProc) {
   // Normal case: Arrange to read UDP packets:
@@ -265,9 +309,10 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
     if (totBytesToRead > bufferMaxSize) totBytesToRead = bufferMaxSize;
     unsigned curBytesToRead = totBytesToRead;
     int curBytesRead;
-    while ((curBytesRead = readSocket(envir(), fNextTCPReadStreamSocketNum,
-				      &buffer[bytesRead], curBytesToRead,
-				      fromAddress)) > 0) {
+    SocketDescriptor* socketDescriptor = lookupSocketDescriptor(envir(), fNextTCPReadStreamSocketNum, False);
+    while ((curBytesRead = socketDescriptor != NULL
+	    ? socketDescriptor->readData(&buffer[bytesRead], curBytesToRead, fromAddress)
+	    : readSocket(envir(), fNextTCPReadStreamSocketNum, &buffer[bytesRead], curBytesToRead, fromAddress)) > 0) {
       bytesRead += curBytesRead;
       if (bytesRead >= totBytesToRead) break;
       curBytesToRead -= curBytesRead;
@@ -295,6 +340,26 @@ Boolean RTPInterface::handleRead(unsigned char* buffer, unsigned bufferMaxSize,
   return readSuccess;
 }
 
+Boolean RTPInterface::handleRead(unsigned char* buffer1, unsigned buffer1MaxSize,
+				 unsigned char* buffer2, unsigned buffer2MaxSize,
+				 unsigned& bytesRead, struct sockaddr_in& fromAddress) {
+  if (!fGS->handleRead(buffer1, buffer1MaxSize, buffer2, buffer2MaxSize, bytesRead, fromAddress)) return False;
+
+  if (fAuxReadHandlerFunc != NULL) {
+    // Also pass the newly-read packet data to our auxilliary handler (which needs it in one piece):
+    if (bytesRead <= buffer1MaxSize) {
+      (*fAuxReadHandlerFunc)(fAuxReadHandlerClientData, buffer1, bytesRead);
+    } else {
+      unsigned char* packet = new unsigned char[bytesRead];
+      memcpy(packet, buffer1, buffer1MaxSize);
+      memcpy(&packet[buffer1MaxSize], buffer2, bytesRead - buffer1MaxSize);
+      (*fAuxReadHandlerFunc)(fAuxReadHandlerClientData, packet, bytesRead);
+      delete[] packet;
+    }
+  }
+  return True;
+}
+
 void RTPInterface::stopNetworkReading() {
   // Normal case
   if (fGS != NULL) envir().taskScheduler().turnOffBackgroundReadHandling(fGS->socketNum());
@@ -309,25 +374,26 @@ void RTPInterface::stopNetworkReading() {
 ////////// Helper Functions - Implementation /////////
 
 Boolean RTPInterface::sendRTPorRTCPPacketOverTCP(u_int8_t* packet, unsigned packetSize,
-						 int socketNum, unsigned char streamChannelId) {
+						 int socketNum, unsigned char streamChannelId,
+						 u_int8_t* packetRemainder, unsigned packetRemainderSize) {
+  packetSize += packetRemainderSize;
 #ifdef DEBUG_SEND
   fprintf(stderr, "sendRTPorRTCPPacketOverTCP: %d bytes over channel %d (socket %d)\n",
 	  packetSize, streamChannelId, socketNum); fflush(stderr);
 #endif
   // Send a RTP/RTCP packet over TCP, using the encoding defined in RFC 2326, section 10.12:
   //     $<streamChannelId><packetSize><packet>
-  // (If the initial "send()" of '$<streamChannelId><packetSize>' succeeds, then we force
-  // the subsequent "send()" for the <packet> data to succeed, even if we have to do so with
-  // a blocking "send()".)
+  // (Where possible, the framing header and the <packet> data are sent using a single system call.
+  // If any of '$<streamChannelId><packetSize>' gets sent, then we force the rest of the <packet>
+  // data to be sent also, even if we have to do so with a blocking "send()".)
   do {
     u_int8_t framingHeader[4];
     framingHeader[0] = '$';
     framingHeader[1] = streamChannelId;
     framingHeader[2] = (u_int8_t) ((packetSize&0xFF00)>>8);
     framingHeader[3] = (u_int8_t) (packetSize&0xFF);
-    if (!sendDataOverTCP(socketNum, framingHeader, 4, False)) break;
-
-    if (!sendDataOverTCP(socketNum, packet, packetSize, True)) break;
+    if (!sendFramedDataOverTCP(socketNum, framingHeader, 4, packet, packetSize - packetRemainderSize,
+			       packetRemainder, packetRemainderSize)) break;
 #ifdef DEBUG_SEND
     fprintf(stderr, "sendRTPorRTCPPacketOverTCP: completed\n"); fflush(stderr);
 #endif
@@ -388,11 +454,68 @@ Boolean RTPInterface::sendDataOverTCP(int socketNum, u_int8_t const* data, unsig
   return True;
 }
 
+Boolean RTPInterface::sendFramedDataOverTCP(int socketNum,
+					     u_int8_t const* header, unsigned headerSize,
+					     u_int8_t const* data, unsigned dataSize,
+					     u_int8_t const* data2, unsigned data2Size) {
+  u_int8_t const* pieces[3] = { header, data, data2 };
+  unsigned pieceSizes[3] = { headerSize, dataSize, data2Size };
+  unsigned const numPieces = data2Size > 0 ? 3 : 2;
+#ifdef HAVE_SCATTER_GATHER_SEND
+  // Send the header and the data together, using a single "sendmsg()":
+  struct iovec iov[3];
+  unsigned totSize = 0;
+  for (unsigned i = 0; i < numPieces; ++i) {
+    iov[i].iov_base = (void*)pieces[i]; iov[i].iov_len = pieceSizes[i];
+    totSize += pieceSizes[i];
+  }
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof msg);
+  msg.msg_iov = iov;
+  msg.msg_iovlen = numPieces;
+
+  int sendResult = sendmsg(socketNum, &msg, 0/*flags*/);
+  if (sendResult == (int)totSize) return True;
+
+  if (sendResult < 0) {
+    // Nothing was sent.  As with a failed "send()" of the framing header alone, we drop this packet.
+    // Unless the OS's TCP send buffer was merely full, assume that the socket is now unusable, so stop
+    // using it (for both RTP and RTCP):
+    if (envir().getErrno() != EAGAIN) removeStreamSocket(socketNum, 0xFF);
+    return False;
+  }
+
+  // Part of the header and/or data was sent, so force the remainder to be sent also:
+  unsigned numBytesToSkip = (unsigned)sendResult;
+  for (unsigned i = 0; i < numPieces; ++i) {
+    if (numBytesToSkip >= pieceSizes[i]) {
+      numBytesToSkip -= pieceSizes[i]; // this piece was sent completely
+      continue;
+    }
+    if (!sendDataOverTCP(socketNum, &pieces[i][numBytesToSkip], pieceSizes[i] - numBytesToSkip, True)) {
+      return False;
+    }
+    numBytesToSkip = 0;
+  }
+  return True;
+#else
+  // Send the header, then the data, forcing the latter to succeed if the former did:
+  if (!sendDataOverTCP(socketNum, header, headerSize, False)) return False;
+  for (unsigned i = 1; i < numPieces; ++i) {
+    if (!sendDataOverTCP(socketNum, pieces[i], pieceSizes[i], True)) return False;
+  }
+  return True;
+#endif
+}
+
 SocketDescriptor::SocketDescriptor(UsageEnvironment& env, int socketNum)
   :fEnv(env), fOurSocketNum(socketNum),
     fSubChannelHashTable(HashTable::create(ONE_WORD_HASH_KEYS)),
    fServerRequestAlternativeByteHandler(NULL), fServerRequestAlternativeByteHandlerClientData(NULL),
+   fReadBuffer(NULL), fReadBufferHead(0), fReadBufferTail(0),
    fReadErrorOccurred(False), fDeleteMyselfNext(False), fAreInReadHandlerLoop(False), fTCPReadingState(AWAITING_DOLLAR) {
+  memset(&fLastFromAddress, 0, sizeof fLastFromAddress);
 }
 
 SocketDescriptor::~SocketDescriptor() {
@@ -425,7 +548,18 @@ SocketDescriptor::~SocketDescriptor() {
     // - no error occurred, but it needs to take over control of the TCP socket once again.
     u_int8_t specialChar = fReadErrorOccurred ? 0xFF : 0xFE;
     (*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, specialChar);
+
+    if (!fReadErrorOccurred) {
+      // Also pass back any data that we had already read from the socket (into our buffer), but not yet handled
+      // - e.g., a RTSP request that the client sent straight after the one that ended our last stream.  (The handler
+      // treats each of these bytes as data - even 0xFF and 0xFE - and doesn't handle them until later.)
+      while (haveBufferedData()) {
+	(*fServerRequestAlternativeByteHandler)(fServerRequestAlternativeByteHandlerClientData, fReadBuffer[fReadBufferHead++]);
+      }
+    }
   }
+
+  delete[] fReadBuffer;
 }
 
 void SocketDescriptor::registerRTPInterface(unsigned char streamChannelId,
@@ -471,9 +605,12 @@ void SocketDescriptor
 
 void SocketDescriptor::tcpReadHandler(SocketDescriptor* socketDescriptor, int mask) {
   // Call the read handler until it returns false, with a limit to avoid starving other sockets
-  unsigned count = 2000;
+  int count = 2000; // (signed, because we may continue past 0 - see below)
   socketDescriptor->fAreInReadHandlerLoop = True;
-  while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask) && --count > 0) {}
+  // (However, we always continue until we've handled all of the data that we've already read into our
+  // buffer, because we won't get called again for that data.)
+  while (!socketDescriptor->fDeleteMyselfNext && socketDescriptor->tcpReadHandler1(mask)
+	 && (--count > 0 || socketDescriptor->haveBufferedData())) {}
   socketDescriptor->fAreInReadHandlerLoop = False;
   if (socketDescriptor->fDeleteMyselfNext) delete socketDescriptor;
 }
@@ -488,14 +625,13 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
   // However, because the socket is being read asynchronously, this data might arrive in pieces.
   
   u_int8_t c;
-  struct sockaddr_in fromAddress;
   if (fTCPReadingState != AWAITING_PACKET_DATA) {
-    int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+    int result = readNextByte(c);
     if (result == 0) { // There was no more data to read
       return False;
     } else if (result != 1) { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+      fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readNextByte() returned %d (error)\n", fOurSocketNum, result);
 #endif
       fReadErrorOccurred = True;
       fDeleteMyselfNext = True;
@@ -555,7 +691,7 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
       break;
     }
     case AWAITING_PACKET_DATA: {
-      callAgain = False;
+      callAgain = haveBufferedData(); // we may already have the data that follows, in our buffer
       fTCPReadingState = AWAITING_DOLLAR; // the next state, unless we end up having to read more data in the current state
       // Call the appropriate read handler to get the packet data from the TCP stream:
       RTPInterface* rtpInterface = lookupRTPInterface(fStreamChannelId);
@@ -570,14 +706,16 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
 #endif
 	  fTCPReadingState = AWAITING_PACKET_DATA;
 	  rtpInterface->fReadHandlerProc(rtpInterface->fOwner, mask);
+	  // If we already have (buffered) data that follows this packet, then handle it now:
+	  callAgain = haveBufferedData();
 	} else {
 #ifdef DEBUG_RECEIVE
 	  fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): No handler proc for \"rtpInterface\" for channel %d; need to skip %d remaining bytes\n", fOurSocketNum, fStreamChannelId, rtpInterface->fNextTCPReadSize);
 #endif
-	  int result = readSocket(fEnv, fOurSocketNum, &c, 1, fromAddress);
+	  int result = readNextByte(c);
 	  if (result < 0) { // error reading TCP socket, so we will no longer handle it
 #ifdef DEBUG_RECEIVE
-	    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readSocket(1 byte) returned %d (error)\n", fOurSocketNum, result);
+	    fprintf(stderr, "SocketDescriptor(socket %d)::tcpReadHandler(): readNextByte() returned %d (error)\n", fOurSocketNum, result);
 #endif
 	    fReadErrorOccurred = True;
 	    fDeleteMyselfNext = True;
@@ -600,6 +738,37 @@ Boolean SocketDescriptor::tcpReadHandler1(int mask) {
   return callAgain;
 }
 
+int SocketDescriptor::readNextByte(u_int8_t& c) {
+  if (!haveBufferedData()) {
+    // Refill our buffer, with as much data as is currently available:
+    if (fReadBuffer == NULL) fReadBuffer = new u_int8_t[RTP_OVER_TCP_READ_BUFFER_SIZE];
+    fReadBufferHead = fReadBufferTail = 0;
+
+    int result = readSocket(fEnv, fOurSocketNum, fReadBuffer, RTP_OVER_TCP_READ_BUFFER_SIZE, fLastFromAddress);
+    if (result <= 0) return result;
+    fReadBufferTail = (unsigned)result;
+  }
+
+  c = fReadBuffer[fReadBufferHead++];
+  return 1;
+}
+
+int SocketDescriptor::readData(u_int8_t* to, unsigned numBytes, struct sockaddr_in& fromAddress) {
+  if (!haveBufferedData()) {
+    // Read directly from the socket.  (This happens only for the remainder of a packet that didn't fit
+    // in our buffer, so we don't bother buffering it.)
+    return readSocket(fEnv, fOurSocketNum, to, numBytes, fromAddress);
+  }
+
+  unsigned numBufferedBytes = fReadBufferTail - fReadBufferHead;
+  if (numBytes > numBufferedBytes) numBytes = numBufferedBytes;
+  memcpy(to, &fReadBuffer[fReadBufferHead], numBytes);
+  fReadBufferHead += numBytes;
+  fromAddress = fLastFromAddress;
+
+  return (int)numBytes;
+}
+
 
 ////////// tcpStreamRecord implementation //////////
 
@@ -64,6 +64,10 @@ RTPSource::~RTPSource() {
   delete fReceptionStatsDB;
 }
 
+void RTPSource::setAdaptivePlayoutDelay(unsigned /*minDelayUSecs*/, unsigned /*maxDelayUSecs*/) {
+  // Default implementation: Do nothing
+}
+
 void RTPSource::getAttributes() const {
   envir().setResultMsg(""); // Fix later to get attributes from  header #####
 }
@@ -364,7 +364,8 @@ RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
     fTunnelOverHTTPPortNum(tunnelOverHTTPPortNum),
     fUserAgentHeaderStr(NULL), fUserAgentHeaderStrLen(0),
     fInputSocketNum(-1), fOutputSocketNum(-1), fBaseURL(NULL), fTCPStreamIdCount(0),
-    fLastSessionId(NULL), fSessionTimeoutParameter(0), fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
+    fLastSessionId(NULL), fSessionTimeoutParameter(0), fTakeBackInputSocketTask(NULL), fNumHandedBackBytes(0),
+    fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
   setBaseURL(rtspURL);
 
   fResponseBuffer = new char[responseBufferSize+1];
@@ -829,6 +830,7 @@ Boolean RTSPClient::isRTSPClient() const {
 }
 
 void RTSPClient::resetTCPSockets() {
+  envir().taskScheduler().unscheduleDelayedTask(fTakeBackInputSocketTask);
   if (fInputSocketNum >= 0) {
     envir().taskScheduler().disableBackgroundHandling(fInputSocketNum);
     ::closeSocket(fInputSocketNum);
@@ -1380,13 +1382,22 @@ void RTSPClient::handleAlternativeRequestByte(void* rtspClient, u_int8_t request
 }
 
 void RTSPClient::handleAlternativeRequestByte1(u_int8_t requestByte) {
-  if (requestByte == 0xFF) {
+  if (fTakeBackInputSocketTask != NULL) {
+    // The previous handler of the input TCP socket had already read this byte from the socket, but not handled it.
+    // Add it to our buffer, to be handled by "takeBackInputSocket1()".  (0xFF and 0xFE have no special meaning here.)
+    if (fNumHandedBackBytes < fResponseBufferBytesLeft) {
+      fResponseBuffer[fResponseBytesAlreadySeen + fNumHandedBackBytes++] = requestByte;
+    }
+  } else if (requestByte == 0xFF) {
     // Hack: The new handler of the input TCP socket encountered an error reading it.  Indicate this:
     handleResponseBytes(-1);
   } else if (requestByte == 0xFE) {
-    // Another hack: The new handler of the input TCP socket no longer needs it, so take back control:
-    envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
-						  (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+    // Another hack: The new handler of the input TCP socket no longer needs it, so take back control.  We do this - and
+    // handle any data that it passes back to us - from a (zero-delay) task, because that handler may be being deleted
+    // as part of handling a response:
+    fNumHandedBackBytes = 0;
+    fTakeBackInputSocketTask
+      = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)takeBackInputSocket, this);
   } else {
     // Normal case:
     fResponseBuffer[fResponseBytesAlreadySeen] = requestByte;
@@ -1394,6 +1405,20 @@ void RTSPClient::handleAlternativeRequestByte1(u_int8_t requestByte) {
   }
 }
 
+void RTSPClient::takeBackInputSocket(void* rtspClient) {
+  ((RTSPClient*)rtspClient)->takeBackInputSocket1();
+}
+
+void RTSPClient::takeBackInputSocket1() {
+  fTakeBackInputSocketTask = NULL;
+  if (fInputSocketNum < 0) return; // we've since been reset
+  envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
+						(TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+
+  // Handle any data that was passed back to us, as if we'd just read it from the socket ourself:
+  if (fNumHandedBackBytes > 0) handleResponseBytes(fNumHandedBackBytes);
+}
+
 static Boolean isAbsoluteURL(char const* url) {
   // Assumption: "url" is absolute if it contains a ':', before any
   // occurrence of '/'
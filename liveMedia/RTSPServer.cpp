@@ -368,7 +368,8 @@ RTSPServer::RTSPClientConnection
 ::RTSPClientConnection(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : GenericMediaServer::ClientConnection(ourServer, clientSocket, clientAddr),
     fOurRTSPServer(ourServer), fClientInputSocket(fOurSocket), fClientOutputSocket(fOurSocket),
-    fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL) {
+    fIsActive(True), fRecursionCount(0), fOurSessionCookie(NULL),
+    fTakeBackInputSocketTask(NULL), fNumHandedBackBytes(0) {
   resetRequestBuffer();
 }
 
@@ -380,6 +381,7 @@ RTSPServer::RTSPClientConnection::~RTSPClientConnection() {
   }
   
   closeSocketsRTSP();
+  envir().taskScheduler().unscheduleDelayedTask(fTakeBackInputSocketTask); // in case closing our sockets scheduled it
 }
 
 // Special mechanism for handling our custom "REGISTER" command:
@@ -721,13 +723,23 @@ void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte(void* instan
 }
 
 void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte1(u_int8_t requestByte) {
-  if (requestByte == 0xFF) {
+  if (fTakeBackInputSocketTask != NULL) {
+    // The previous handler of the input TCP socket had already read this byte (and any that follow it) from the socket,
+    // but not handled it.  Add it to our buffer, to be handled by "takeBackInputSocket1()".  (Because these bytes come
+    // straight from the socket, 0xFF and 0xFE have no special meaning here.)
+    if (fNumHandedBackBytes < fRequestBufferBytesLeft) {
+      fRequestBuffer[fRequestBytesAlreadySeen + fNumHandedBackBytes++] = requestByte;
+    }
+  } else if (requestByte == 0xFF) {
     // Hack: The new handler of the input TCP socket encountered an error reading it.  Indicate this:
     handleRequestBytes(-1);
   } else if (requestByte == 0xFE) {
-    // Another hack: The new handler of the input TCP socket no longer needs it, so take back control of it:
-    envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
-						  incomingRequestHandler, this);
+    // Another hack: The new handler of the input TCP socket no longer needs it, so take back control of it.
+    // We do this - and handle any data that it passes back to us - from a (zero-delay) task, because that handler
+    // may be being deleted as part of handling an earlier request (e.g., a "TEARDOWN") of ours:
+    fNumHandedBackBytes = 0;
+    fTakeBackInputSocketTask
+      = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)takeBackInputSocket, this);
   } else {
     // Normal case: Add this character to our buffer; then try to handle the data that we have buffered so far:
     if (fRequestBufferBytesLeft == 0 || fRequestBytesAlreadySeen >= REQUEST_BUFFER_SIZE) return;
@@ -736,6 +748,20 @@ void RTSPServer::RTSPClientConnection::handleAlternativeRequestByte1(u_int8_t re
   }
 }
 
+void RTSPServer::RTSPClientConnection::takeBackInputSocket(void* instance) {
+  RTSPClientConnection* connection = (RTSPClientConnection*)instance;
+  connection->takeBackInputSocket1();
+}
+
+void RTSPServer::RTSPClientConnection::takeBackInputSocket1() {
+  fTakeBackInputSocketTask = NULL;
+  envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
+						incomingRequestHandler, this);
+
+  // Handle any data that was passed back to us, as if we'd just read it from the socket ourself:
+  if (fNumHandedBackBytes > 0) handleRequestBytes(fNumHandedBackBytes);
+}
+
 // A special version of "parseTransportHeader()", used just for parsing the "Transport:" header in an incoming "REGISTER" command:
 static void parseTransportHeaderForREGISTER(char const* buf,
 					    Boolean &reuseConnection,
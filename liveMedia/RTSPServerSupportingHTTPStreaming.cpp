@@ -38,7 +38,8 @@ RTSPServerSupportingHTTPStreaming::createNew(UsageEnvironment& env, Port rtspPor
 RTSPServerSupportingHTTPStreaming
 ::RTSPServerSupportingHTTPStreaming(UsageEnvironment& env, int ourSocket, Port rtspPort,
 				    UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds)
-  : RTSPServer(env, ourSocket, rtspPort, authDatabase, reclamationTestSeconds) {
+  : RTSPServer(env, ourSocket, rtspPort, authDatabase, reclamationTestSeconds),
+    fZeroCopyStreaming(False) {
 }
 
 RTSPServerSupportingHTTPStreaming::~RTSPServerSupportingHTTPStreaming() {
@@ -153,6 +154,9 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
       fStreamSource = subsession->getStreamSource(streamToken);
       if (fStreamSource != NULL) {
 	if (fTCPSink == NULL) fTCPSink = TCPStreamSink::createNew(envir(), fClientOutputSocket);
+	if (((RTSPServerSupportingHTTPStreaming&)fOurRTSPServer).fZeroCopyStreaming) {
+	  (void)fTCPSink->enableZeroCopySends(); // if this fails, we just send normally
+	}
 	fTCPSink->startPlaying(*fStreamSource, afterStreaming, this);
       }
     } while(0);
@@ -19,11 +19,63 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "StreamParser.hh"
+#include "BitVector.hh"
 
 #include <string.h>
 #include <stdlib.h>
+#if defined(__linux__) && !defined(NO_MIRRORED_RING_BUFFER)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef SYS_memfd_create
+#define USE_MIRRORED_RING_BUFFER 1
+#endif
+#endif
+
+// Our buffer starts out small, and grows (by doubling) when the data that we need to keep - e.g., the stream's largest
+// frame or NAL unit - doesn't fit in it:
+#ifndef STREAM_PARSER_INITIAL_BUFFER_SIZE
+#define STREAM_PARSER_INITIAL_BUFFER_SIZE (128*1024) // must be a power of 2
+#endif
+#ifndef STREAM_PARSER_MAX_BUFFER_SIZE
+#define STREAM_PARSER_MAX_BUFFER_SIZE (16*1024*1024)
+#endif
+
+static unsigned char* allocateBuffer(unsigned size, Boolean& isMirrored) {
+#ifdef USE_MIRRORED_RING_BUFFER
+  // Map the same (shared memory) pages twice, back-to-back:
+  long pageSize = sysconf(_SC_PAGESIZE);
+  int fd = pageSize > 0 && size%pageSize == 0 ? (int)syscall(SYS_memfd_create, "StreamParser", 0) : -1;
+  if (fd >= 0) {
+    void* region = ftruncate(fd, size) == 0
+      ? mmap(NULL, 2*size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0) : MAP_FAILED;
+    if (region != MAP_FAILED) {
+      unsigned char* buffer = (unsigned char*)region;
+      if (mmap(buffer, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0) != MAP_FAILED
+	  && mmap(buffer+size, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0) != MAP_FAILED) {
+	close(fd); // the mappings remain
+	isMirrored = True;
+	return buffer;
+      }
+      munmap(region, 2*size);
+    }
+    close(fd);
+  }
+#endif
+  // Use an ordinary buffer instead:
+  isMirrored = False;
+  return new unsigned char[size];
+}
 
-#define BANK_SIZE 1500000
+static void freeBuffer(unsigned char* buffer, unsigned size, Boolean isMirrored) {
+#ifdef USE_MIRRORED_RING_BUFFER
+  if (isMirrored) {
+    munmap(buffer, 2*size);
+    return;
+  }
+#endif
+  delete[] buffer;
+}
 
 void StreamParser::flushInput() {
   fCurParserIndex = fSavedParserIndex = 0;
@@ -43,16 +95,14 @@ StreamParser::StreamParser(FramedSource* inputSource,
     fSavedParserIndex(0), fSavedRemainingUnparsedBits(0),
     fCurParserIndex(0), fRemainingUnparsedBits(0),
     fTotNumValidBytes(0), fHaveSeenEOF(False) {
-  fBank[0] = new unsigned char[BANK_SIZE];
-  fBank[1] = new unsigned char[BANK_SIZE];
-  fCurBankNum = 0;
-  fCurBank = fBank[fCurBankNum];
+  fBufferSize = STREAM_PARSER_INITIAL_BUFFER_SIZE;
+  fCurBank = fBuffer = allocateBuffer(fBufferSize, fBufferIsMirrored);
 
   fLastSeenPresentationTime.tv_sec = 0; fLastSeenPresentationTime.tv_usec = 0;
 }
 
 StreamParser::~StreamParser() {
-  delete[] fBank[0]; delete[] fBank[1];
+  freeBuffer(fBuffer, fBufferSize, fBufferIsMirrored);
 }
 
 void StreamParser::saveParserState() {
@@ -112,8 +162,12 @@ unsigned StreamParser::getBits(unsigned numBits) {
   }
 }
 
+unsigned char* StreamParser::findStartCode(unsigned char* from, unsigned char* limit) {
+  return findTwoZerosAndByte(from, limit, 0x01, 0x01);
+}
+
 unsigned StreamParser::bankSize() const {
-  return BANK_SIZE;
+  return fBufferSize;
 }
 
 #define NO_MORE_BUFFERED_INPUT 1
@@ -124,35 +178,35 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
   unsigned maxInputFrameSize = fInputSource->maxFrameSize();
   if (maxInputFrameSize > numBytesNeeded) numBytesNeeded = maxInputFrameSize;
 
-  // First, check whether these new bytes would overflow the current
-  // bank.  If so, start using a new bank now.
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
-    // Swap banks, but save any still-needed bytes from the old bank:
-    unsigned numBytesToSave = fTotNumValidBytes - fSavedParserIndex;
-    unsigned char const* from = &curBank()[fSavedParserIndex];
-
-    fCurBankNum = (fCurBankNum + 1)%2;
-    fCurBank = fBank[fCurBankNum];
-    memmove(curBank(), from, numBytesToSave);
-    fCurParserIndex = fCurParserIndex - fSavedParserIndex;
-    fSavedParserIndex = 0;
-    fTotNumValidBytes = numBytesToSave;
+  // Make room for these new bytes, by discarding the bytes that we no longer need.  (If our buffer is mirrored, this is
+  // cheap, so we always do it; otherwise, we do it only when the new bytes wouldn't fit, or the buffer is half full.)
+  if (fBufferIsMirrored || fCurParserIndex + numBytesNeeded > fBufferSize || fTotNumValidBytes > fBufferSize/2) {
+    discardBytesBeforeSavedState();
+  }
+
+  // If the bytes that we still need (plus the new bytes) don't fit - or fill more than half of our buffer - then
+  // enlarge it:
+  if ((fCurParserIndex + numBytesNeeded > fBufferSize || fTotNumValidBytes > fBufferSize/2)
+      && fBufferSize < STREAM_PARSER_MAX_BUFFER_SIZE) {
+    unsigned newSize = fBufferSize;
+    do newSize *= 2; while (newSize < fCurParserIndex + numBytesNeeded && newSize < STREAM_PARSER_MAX_BUFFER_SIZE);
+    enlargeBuffer(newSize);
   }
 
   // ASSERT: fCurParserIndex + numBytesNeeded > fTotNumValidBytes
-  //      && fCurParserIndex + numBytesNeeded <= BANK_SIZE
-  if (fCurParserIndex + numBytesNeeded > BANK_SIZE) {
+  //      && fCurParserIndex + numBytesNeeded <= fBufferSize
+  if (fCurParserIndex + numBytesNeeded > fBufferSize) {
     // If this happens, it means that we have too much saved parser state.
-    // To fix this, increase BANK_SIZE as appropriate.
+    // To fix this, increase STREAM_PARSER_MAX_BUFFER_SIZE as appropriate.
     fInputSource->envir() << "StreamParser internal error ("
 			  << fCurParserIndex << " + "
 			  << numBytesNeeded << " > "
-			  << BANK_SIZE << ")\n";
+			  << fBufferSize << ")\n";
     fInputSource->envir().internalError();
   }
 
-  // Try to read as many new bytes as will fit in the current bank:
-  unsigned maxNumBytesToRead = BANK_SIZE - fTotNumValidBytes;
+  // Try to read as many new bytes as will fit in our buffer:
+  unsigned maxNumBytesToRead = fBufferSize - fTotNumValidBytes;
   fInputSource->getNextFrame(&curBank()[fTotNumValidBytes],
 			     maxNumBytesToRead,
 			     afterGettingBytes, this,
@@ -161,6 +215,33 @@ void StreamParser::ensureValidBytes1(unsigned numBytesNeeded) {
   throw NO_MORE_BUFFERED_INPUT;
 }
 
+void StreamParser::discardBytesBeforeSavedState() {
+  if (fSavedParserIndex == 0) return; // there's nothing to discard
+
+  unsigned numBytesToKeep = fTotNumValidBytes - fSavedParserIndex;
+  if (fBufferIsMirrored) {
+    // Just move our start point forward (around the ring):
+    fCurBank = &fBuffer[(unsigned)(fCurBank - fBuffer + fSavedParserIndex)%fBufferSize];
+  } else {
+    memmove(fBuffer, &curBank()[fSavedParserIndex], numBytesToKeep);
+    fCurBank = fBuffer;
+  }
+  fCurParserIndex -= fSavedParserIndex;
+  fSavedParserIndex = 0;
+  fTotNumValidBytes = numBytesToKeep;
+}
+
+void StreamParser::enlargeBuffer(unsigned newSize) {
+  Boolean newBufferIsMirrored;
+  unsigned char* newBuffer = allocateBuffer(newSize, newBufferIsMirrored);
+  memmove(newBuffer, curBank(), fTotNumValidBytes); // our data is contiguous from "fCurBank", even if it wraps around the ring
+
+  freeBuffer(fBuffer, fBufferSize, fBufferIsMirrored);
+  fCurBank = fBuffer = newBuffer;
+  fBufferSize = newSize;
+  fBufferIsMirrored = newBufferIsMirrored;
+}
+
 void StreamParser::afterGettingBytes(void* clientData,
 				     unsigned numBytesRead,
 				     unsigned /*numTruncatedBytes*/,
@@ -173,11 +254,11 @@ void StreamParser::afterGettingBytes(void* clientData,
 
 void StreamParser::afterGettingBytes1(unsigned numBytesRead, struct timeval presentationTime) {
   // Sanity check: Make sure we didn't get too many bytes for our bank:
-  if (fTotNumValidBytes + numBytesRead > BANK_SIZE) {
+  if (fTotNumValidBytes + numBytesRead > fBufferSize) {
     fInputSource->envir()
       << "StreamParser::afterGettingBytes() warning: read "
       << numBytesRead << " bytes; expected no more than "
-      << BANK_SIZE - fTotNumValidBytes << "\n";
+      << fBufferSize - fTotNumValidBytes << "\n";
   }
 
   fLastSeenPresentationTime = presentationTime;
@@ -103,11 +103,19 @@ protected: // we're a virtual base class
 
   Boolean haveSeenEOF() const { return fHaveSeenEOF; }
 
-  unsigned bankSize() const;
+  unsigned bankSize() const; // the current size of our buffer (which can grow, if necessary)
+
+  // Direct access to the data that we've already read (from the current parse position onwards), for subclasses that
+  // scan it a block at a time:
+  unsigned char* nextToParse() { return &curBank()[fCurParserIndex]; }
+  unsigned numBufferedBytes() const { return fTotNumValidBytes - fCurParserIndex; }
+
+  static unsigned char* findStartCode(unsigned char* from, unsigned char* limit);
+      // Returns a pointer to the first 0x000001 'start code' that lies completely within [from,limit), or NULL if there's none.
+      // (This uses "findTwoZerosAndByte()" - see "BitVector.hh".)
 
 private:
   unsigned char* curBank() { return fCurBank; }
-  unsigned char* nextToParse() { return &curBank()[fCurParserIndex]; }
   unsigned char* lastParsed() { return &curBank()[fCurParserIndex-1]; }
 
   // makes sure that at least "numBytes" valid bytes remain:
@@ -118,6 +126,8 @@ private:
     ensureValidBytes1(numBytesNeeded);
   }
   void ensureValidBytes1(unsigned numBytesNeeded);
+  void discardBytesBeforeSavedState();
+  void enlargeBuffer(unsigned newSize);
 
   static void afterGettingBytes(void* clientData, unsigned numBytesRead,
 				unsigned numTruncatedBytes,
@@ -135,10 +145,13 @@ private:
   clientContinueFunc* fClientContinueFunc;
   void* fClientContinueClientData;
 
-  // Use a pair of 'banks', and swap between them as they fill up:
-  unsigned char* fBank[2];
-  unsigned char fCurBankNum;
-  unsigned char* fCurBank;
+  // Our data is kept in a ring buffer.  If possible, its memory is mapped twice, back-to-back ('mirrored'), so that the
+  // "fBufferSize" bytes that follow any point in the ring are contiguous, and we never need to move data within it.
+  // Otherwise, we move the data that we still need back to the start of the buffer, whenever it gets too full:
+  unsigned char* fBuffer;
+  unsigned fBufferSize;
+  Boolean fBufferIsMirrored;
+  unsigned char* fCurBank; // where the data that we're currently parsing begins (within "fBuffer")
 
   // The most recent 'saved' parse position:
   unsigned fSavedParserIndex; // <= fCurParserIndex
@@ -149,7 +162,7 @@ private:
   unsigned char fRemainingUnparsedBits; // in previous byte: [0,7]
 
   // The total number of valid bytes stored in the current bank:
-  unsigned fTotNumValidBytes; // <= BANK_SIZE
+  unsigned fTotNumValidBytes; // <= fBufferSize
 
   // Whether we have seen EOF on the input source:
   Boolean fHaveSeenEOF;
@@ -20,6 +20,120 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "TCPStreamSink.hh"
 #include <GroupsockHelper.hh> // for "ignoreSigPipeOnSocket()"
+#ifdef __linux__
+#include <linux/errqueue.h>
+#endif
+
+// Zero-copy sending uses the Linux "SO_ZEROCOPY"/"MSG_ZEROCOPY" socket API (kernel 4.14 or later):
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_ZERO_COPY_SENDS 1
+#endif
+
+// If we get woken up while waiting for a zero-copy send completion, but no completion has arrived (because the socket
+// also has incoming data, which is left for its reader), then we wait this long before waiting for a completion again:
+#define ZERO_COPY_COMPLETION_RECHECK_DELAY 10000 /*microseconds*/
+
+// How long we keep the zero-copy buffers of a deleted "TCPStreamSink", while waiting for the kernel to release them:
+#ifndef ZERO_COPY_BUFFER_RECLAIM_TIMEOUT
+#define ZERO_COPY_BUFFER_RECLAIM_TIMEOUT 30 /*seconds*/
+#endif
+
+static void readZeroCopyCompletions(int socketNum, u_int32_t& numSendsCompleted) {
+#ifdef HAVE_ZERO_COPY_SENDS
+  // Read (without blocking) any zero-copy completion notifications from the socket's error queue.
+  // Each notification reports a range [ee_info, ee_data] of completed sends (numbered from 0):
+  while (1) {
+    char control[CMSG_SPACE(sizeof (struct sock_extended_err)) + 64];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+
+    if (recvmsg(socketNum, &msg, MSG_ERRQUEUE|MSG_DONTWAIT) < 0) break; // no more notifications
+
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+      struct sock_extended_err* serr = (struct sock_extended_err*)CMSG_DATA(cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+      u_int32_t numCompleted = serr->ee_data + 1;
+      if ((int32_t)(numCompleted - numSendsCompleted) > 0) numSendsCompleted = numCompleted;
+    }
+  }
+#endif
+}
+
+////////// ZeroCopyBufferReclaimer //////////
+
+// When a "TCPStreamSink" is deleted, the kernel might still be sending from its zero-copy buffers, so they can't be
+// freed (and possibly reused) yet.  Instead, they're handed to one of these, which frees them once the kernel has
+// released them.  It uses its own duplicate of the socket, so that it can keep reading completion notifications
+// after the sink's owner has closed the socket.  (If the kernel doesn't release the buffers within
+// ZERO_COPY_BUFFER_RECLAIM_TIMEOUT seconds - e.g., because the receiver stopped reading - then we give up, and leak
+// the buffers, rather than risk their memory being reused while the kernel might still be sending from it.)
+
+class ZeroCopyBufferReclaimer {
+public:
+  ZeroCopyBufferReclaimer(UsageEnvironment& env, int socketNum, unsigned char* buffers[2],
+			  u_int32_t numSends, u_int32_t numSendsCompleted);
+
+private:
+  ~ZeroCopyBufferReclaimer();
+
+  static void completionHandler(void* clientData, int mask);
+  static void timeoutHandler(void* clientData);
+
+private:
+  UsageEnvironment& fEnv;
+  int fSocketNum;
+  unsigned char* fBuffers[2];
+  u_int32_t fNumSends, fNumSendsCompleted;
+  TaskToken fTimeoutTask;
+};
+
+ZeroCopyBufferReclaimer::ZeroCopyBufferReclaimer(UsageEnvironment& env, int socketNum, unsigned char* buffers[2],
+						 u_int32_t numSends, u_int32_t numSendsCompleted)
+  : fEnv(env), fSocketNum(socketNum), fNumSends(numSends), fNumSendsCompleted(numSendsCompleted) {
+  fBuffers[0] = buffers[0]; fBuffers[1] = buffers[1];
+
+  // The kernel makes the socket 'readable' (with POLLERR) when it has queued completion notifications:
+  fEnv.taskScheduler().setBackgroundHandling(fSocketNum, SOCKET_READABLE, completionHandler, this);
+  fTimeoutTask = fEnv.taskScheduler().scheduleDelayedTask(ZERO_COPY_BUFFER_RECLAIM_TIMEOUT*1000000,
+							  timeoutHandler, this);
+}
+
+ZeroCopyBufferReclaimer::~ZeroCopyBufferReclaimer() {
+  fEnv.taskScheduler().unscheduleDelayedTask(fTimeoutTask);
+  fEnv.taskScheduler().disableBackgroundHandling(fSocketNum);
+  closeSocket(fSocketNum);
+  delete[] fBuffers[0]; delete[] fBuffers[1];
+}
+
+void ZeroCopyBufferReclaimer::completionHandler(void* clientData, int /*mask*/) {
+  ZeroCopyBufferReclaimer* reclaimer = (ZeroCopyBufferReclaimer*)clientData;
+
+  u_int32_t numSendsCompletedBefore = reclaimer->fNumSendsCompleted;
+  readZeroCopyCompletions(reclaimer->fSocketNum, reclaimer->fNumSendsCompleted);
+  if (reclaimer->fNumSendsCompleted == reclaimer->fNumSends) {
+    delete reclaimer; // the kernel has released our buffers, so we can now free them
+  } else if (reclaimer->fNumSendsCompleted == numSendsCompletedBefore) {
+    // We were woken up by incoming data (that no-one will now read), rather than by a completion.
+    // Stop waiting on the socket (to avoid spinning), and just check once more, when we time out:
+    reclaimer->fEnv.taskScheduler().disableBackgroundHandling(reclaimer->fSocketNum);
+  }
+}
+
+void ZeroCopyBufferReclaimer::timeoutHandler(void* clientData) {
+  ZeroCopyBufferReclaimer* reclaimer = (ZeroCopyBufferReclaimer*)clientData;
+  reclaimer->fTimeoutTask = NULL;
+
+  readZeroCopyCompletions(reclaimer->fSocketNum, reclaimer->fNumSendsCompleted);
+  if (reclaimer->fNumSendsCompleted != reclaimer->fNumSends) {
+    reclaimer->fBuffers[0] = reclaimer->fBuffers[1] = NULL; // leak them (see above)
+  }
+  delete reclaimer;
+}
+
+////////// TCPStreamSink //////////
 
 TCPStreamSink* TCPStreamSink::createNew(UsageEnvironment& env, int socketNum) {
   return new TCPStreamSink(env, socketNum);
@@ -27,15 +141,76 @@ TCPStreamSink* TCPStreamSink::createNew(UsageEnvironment& env, int socketNum) {
 
 TCPStreamSink::TCPStreamSink(UsageEnvironment& env, int socketNum)
   : MediaSink(env),
+    fBuffer(fStaticBuffer), fBufferSize(TCP_STREAM_SINK_BUFFER_SIZE),
     fUnwrittenBytesStart(0), fUnwrittenBytesEnd(0),
     fInputSourceIsOpen(False), fOutputSocketIsWritable(True),
-    fOutputSocketNum(socketNum) {
+    fOutputSocketNum(socketNum),
+    fZeroCopyIsEnabled(False), fZeroCopyCompletionSocketNum(-1), fCurZeroCopyBufferIndex(0),
+    fNumZeroCopySends(0), fNumZeroCopySendsCompleted(0) {
   ignoreSigPipeOnSocket(socketNum);
+  fZeroCopyBuffer[0] = fZeroCopyBuffer[1] = NULL;
+  fZeroCopyBufferSendCount[0] = fZeroCopyBufferSendCount[1] = 0;
 }
 
 TCPStreamSink::~TCPStreamSink() {
   // Turn off any pending background handling of our output socket:
   envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
+
+  if (fZeroCopyIsEnabled) {
+    envir().taskScheduler().disableBackgroundHandling(fZeroCopyCompletionSocketNum);
+
+    // If the kernel might still be sending from our buffers, we can't free them yet.  Instead, hand them
+    // (along with our duplicate of the socket) to an object that will free them once the kernel releases them:
+    readZeroCopyCompletions(fZeroCopyCompletionSocketNum, fNumZeroCopySendsCompleted);
+    if (fNumZeroCopySendsCompleted != fNumZeroCopySends) {
+      new ZeroCopyBufferReclaimer(envir(), fZeroCopyCompletionSocketNum, fZeroCopyBuffer,
+				  fNumZeroCopySends, fNumZeroCopySendsCompleted);
+      return;
+    }
+    ::closeSocket(fZeroCopyCompletionSocketNum);
+  }
+
+  delete[] fZeroCopyBuffer[0]; delete[] fZeroCopyBuffer[1];
+}
+
+void TCPStreamSink::stopPlaying() {
+  if (fZeroCopyIsEnabled) {
+    // Stop waiting for zero-copy send completions (if we were), because we no longer have a source to read from:
+    envir().taskScheduler().disableBackgroundHandling(fZeroCopyCompletionSocketNum);
+  }
+
+  MediaSink::stopPlaying();
+}
+
+Boolean TCPStreamSink::enableZeroCopySends() {
+#ifdef HAVE_ZERO_COPY_SENDS
+  if (fZeroCopyIsEnabled) return True;
+  if (fSource != NULL) return False; // too late; we're already playing
+
+  // We wait for send completions using our own duplicate of the socket, so that this doesn't interfere with
+  // any other handling of the socket, and so that we can keep our buffers until they've been released (even
+  // if the socket gets closed after we're deleted):
+  int completionSocketNum = dup(fOutputSocketNum);
+  if (completionSocketNum < 0) return False;
+
+  int one = 1;
+  if (setsockopt(fOutputSocketNum, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof one) < 0) {
+    ::closeSocket(completionSocketNum);
+    return False;
+  }
+  fZeroCopyCompletionSocketNum = completionSocketNum;
+
+  fZeroCopyBuffer[0] = new unsigned char[TCP_STREAM_SINK_ZERO_COPY_BUFFER_SIZE];
+  fZeroCopyBuffer[1] = new unsigned char[TCP_STREAM_SINK_ZERO_COPY_BUFFER_SIZE];
+  fCurZeroCopyBufferIndex = 0;
+  fBuffer = fZeroCopyBuffer[0];
+  fBufferSize = TCP_STREAM_SINK_ZERO_COPY_BUFFER_SIZE;
+  fZeroCopyIsEnabled = True;
+
+  return True;
+#else
+  return False;
+#endif
 }
 
 Boolean TCPStreamSink::continuePlaying() {
@@ -50,8 +225,16 @@ Boolean TCPStreamSink::continuePlaying() {
 void TCPStreamSink::processBuffer() {
   // First, try writing data to our output socket, if we can:
   if (fOutputSocketIsWritable && numUnwrittenBytes() > 0) {
+    int sendFlags = 0;
+#ifdef HAVE_ZERO_COPY_SENDS
+    if (fZeroCopyIsEnabled) sendFlags = MSG_ZEROCOPY;
+#endif
     int numBytesWritten
-      = send(fOutputSocketNum, (const char*)&fBuffer[fUnwrittenBytesStart], numUnwrittenBytes(), 0);
+      = send(fOutputSocketNum, (const char*)&fBuffer[fUnwrittenBytesStart], numUnwrittenBytes(), sendFlags);
+    if (fZeroCopyIsEnabled && numBytesWritten >= 0) {
+      // The kernel will (later) notify us of the completion of this send, identified by a sequential count:
+      fZeroCopyBufferSendCount[fCurZeroCopyBufferIndex] = ++fNumZeroCopySends;
+    }
     if (numBytesWritten < (int)numUnwrittenBytes()) {
       // The output socket is no longer writable.  Set a handler to be called when it becomes writable again.
       fOutputSocketIsWritable = False;
@@ -64,11 +247,20 @@ void TCPStreamSink::processBuffer() {
       fUnwrittenBytesStart += numBytesWritten;
       if (fUnwrittenBytesStart > fUnwrittenBytesEnd) fUnwrittenBytesStart = fUnwrittenBytesEnd; // sanity check
       if (fUnwrittenBytesStart == fUnwrittenBytesEnd && (!fInputSourceIsOpen || !fSource->isCurrentlyAwaitingData())) {
-	fUnwrittenBytesStart = fUnwrittenBytesEnd = 0; // reset the buffer to empty
+	resetBufferIfReleased();
       }
     }
   }
 
+  if (fZeroCopyIsEnabled && fInputSourceIsOpen && freeBufferSpace() < TCP_STREAM_SINK_MIN_READ_SIZE
+      && numUnwrittenBytes() == 0 && !fSource->isCurrentlyAwaitingData() && !resetBufferIfReleased()) {
+    // We can't read any more data until the kernel releases one of our buffers.  The kernel tells us of this
+    // by queueing a completion notification, which makes the socket 'readable' (with POLLERR), so wait for that:
+    envir().taskScheduler().setBackgroundHandling(fZeroCopyCompletionSocketNum, SOCKET_READABLE,
+						  zeroCopyCompletionHandler, this);
+    return;
+  }
+
   // Then, read from our input source, if we can (& we're not already reading from it):
   if (fInputSourceIsOpen && freeBufferSpace() >= TCP_STREAM_SINK_MIN_READ_SIZE && !fSource->isCurrentlyAwaitingData()) {
     fSource->getNextFrame(&fBuffer[fUnwrittenBytesEnd], freeBufferSpace(), afterGettingFrame, this, ourOnSourceClosure, this);
@@ -78,6 +270,55 @@ void TCPStreamSink::processBuffer() {
   }
 }
 
+Boolean TCPStreamSink::resetBufferIfReleased() {
+  if (fZeroCopyIsEnabled) {
+    // We can't overwrite data that the kernel might still be sending from.  Instead, reset to whichever of
+    // our two buffers the kernel has completely released (preferring the current one), if any:
+    readZeroCopyCompletions(fZeroCopyCompletionSocketNum, fNumZeroCopySendsCompleted);
+
+    unsigned i;
+    for (i = 0; i < 2; ++i) {
+      unsigned bufferIndex = (fCurZeroCopyBufferIndex + i)%2;
+      if ((int32_t)(fNumZeroCopySendsCompleted - fZeroCopyBufferSendCount[bufferIndex]) >= 0) break;
+    }
+    if (i == 2) return False; // neither buffer has yet been released
+
+    fCurZeroCopyBufferIndex = (fCurZeroCopyBufferIndex + i)%2;
+    fBuffer = fZeroCopyBuffer[fCurZeroCopyBufferIndex];
+  }
+
+  fUnwrittenBytesStart = fUnwrittenBytesEnd = 0; // reset the buffer to empty
+  return True;
+}
+
+void TCPStreamSink::zeroCopyCompletionHandler(void* clientData, int /*mask*/) {
+  TCPStreamSink* sink = (TCPStreamSink*)clientData;
+  sink->zeroCopyCompletionHandler1();
+}
+
+void TCPStreamSink::zeroCopyCompletionHandler1() {
+  envir().taskScheduler().disableBackgroundHandling(fZeroCopyCompletionSocketNum);
+
+  u_int32_t numSendsCompletedBefore = fNumZeroCopySendsCompleted;
+  readZeroCopyCompletions(fZeroCopyCompletionSocketNum, fNumZeroCopySendsCompleted);
+  if (fNumZeroCopySendsCompleted == numSendsCompletedBefore) {
+    // We were woken up by incoming data on the socket (which we leave for its reader), rather than by a completion.
+    // To avoid spinning, wait a little before waiting for a completion again:
+    envir().taskScheduler().unscheduleDelayedTask(nextTask());
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(ZERO_COPY_COMPLETION_RECHECK_DELAY,
+							     zeroCopyCompletionRecheckHandler, this);
+    return;
+  }
+
+  processBuffer();
+}
+
+void TCPStreamSink::zeroCopyCompletionRecheckHandler(void* clientData) {
+  TCPStreamSink* sink = (TCPStreamSink*)clientData;
+  sink->nextTask() = NULL;
+  sink->processBuffer();
+}
+
 void TCPStreamSink::socketWritableHandler(void* clientData, int /*mask*/) {
   TCPStreamSink* sink = (TCPStreamSink*)clientData;
   sink->socketWritableHandler1();
@@ -24,6 +24,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _BOOLEAN_HH
 #include "Boolean.hh"
 #endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
 
 class BitVector {
 public:
@@ -58,9 +61,56 @@ private:
   unsigned fCurBitIndex;
 };
 
+// A read-only alternative to "BitVector", for parsing code (e.g., H.264/H.265 parameter sets) that reads many small,
+// variable-length fields.  Rather than extracting each field a bit at a time, it keeps up to 64 upcoming bits in a
+// cache (refilled a word at a time), and decodes exponential-Golomb codes using a 'count leading zeros' operation.
+// Its results - including when reading past the end of the data - are the same as "BitVector"'s.
+class BitReader {
+public:
+  BitReader(unsigned char const* baseBytePtr,
+	    unsigned baseBitOffset,
+	    unsigned totNumBits);
+
+  void setup(unsigned char const* baseBytePtr,
+	     unsigned baseBitOffset,
+	     unsigned totNumBits);
+
+  unsigned getBits(unsigned numBits); // "numBits" <= 32
+  unsigned get1Bit();
+  Boolean get1BitBoolean() { return get1Bit() != 0; }
+
+  void skipBits(unsigned numBits);
+
+  unsigned curBitIndex() const { return fCurBitIndex; }
+  unsigned totNumBits() const { return fTotNumBits; }
+  unsigned numBitsRemaining() const { return fTotNumBits - fCurBitIndex; }
+
+  unsigned get_expGolomb(); // ue(v)
+  int get_signedExpGolomb(); // se(v)
+
+private:
+  void refill();
+  unsigned takeBits(unsigned numBits); // assumes that 0 < "numBits" <= 32, and <= "numBitsRemaining()"
+
+private:
+  unsigned char const* fNextBytePtr; // the next byte to be loaded into the cache
+  unsigned char const* fLimitBytePtr;
+  u_int64_t fCache; // the next "fNumCachedBits" bits, left-justified
+  unsigned fNumCachedBits;
+  unsigned fTotNumBits;
+  unsigned fCurBitIndex;
+};
+
 // A general bit copy operation:
 void shiftBits(unsigned char* toBasePtr, unsigned toBitOffset,
 	       unsigned char const* fromBasePtr, unsigned fromBitOffset,
 	       unsigned numBits);
 
+// A general search operation, for 3-byte sequences such as 'start codes' (0x000001) and 'emulation prevention' (0x000003):
+unsigned char* findTwoZerosAndByte(unsigned char* from, unsigned char* limit,
+				   unsigned char minByte, unsigned char maxByte);
+    // Returns a pointer to the first 0x00 0x00 x sequence (with "minByte" <= x <= "maxByte") that lies completely within
+    // [from,limit), or NULL if there's none.  (This tests a block of positions at a time, using SSE2 or AVX2 instructions,
+    // if they are available at compile time.)
+
 #endif
@@ -0,0 +1,47 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// The CRC-32 used by MPEG-2 Transport Streams (in PSI sections) and Ogg files (in page headers)
+// C++ header
+
+#ifndef _CRC32_HH
+#define _CRC32_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+u_int32_t calculateCRC(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+    // The generator polynomial is 0x04C11DB7; bits are processed most-significant first, and the result is not inverted.
+    // (To continue a CRC over non-contiguous data, pass the previous result as "initialValue".)
+    // This uses the fastest of the implementations below that the CPU supports (checked at run time).
+
+// The individual implementations (all of which give the same result):
+u_int32_t calculateCRCBytewise(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+    // one table lookup per byte
+u_int32_t calculateCRCSlicingBy8(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+    // eight table lookups per 8 bytes, all independent of each other
+u_int32_t calculateCRCCarrylessMultiply(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
+    // folds 64 bytes at a time, using the x86 PCLMULQDQ instruction; may be called only if
+    // "haveCarrylessMultiplyCRC()" returns True
+
+Boolean haveCarrylessMultiplyCRC();
+
+#endif
@@ -41,12 +41,22 @@ public:
 		       struct timeval presentationTime);
   // (Available in case a client wants to add extra data to the output file)
 
+  void setWriteFrameSlices(Boolean writeFrameSlices = True) { fWriteFrameSlices = writeFrameSlices; }
+  // If set - and our source is a "MultiFramedRTPSource" - then each incoming frame is written to the file directly
+  //   from the source's packet buffers (see "MultiFramedRTPSource::setDeliverFrameSlices()"), rather than first
+  //   being reassembled into our buffer.  Must be called before "startPlaying()".
+  // This is set by default for sinks that are created by "FileSink::createNew()".  It is not set by default for
+  //   subclasses, because they may examine (or add to) "fBuffer".
+
 protected:
   FileSink(UsageEnvironment& env, FILE* fid, unsigned bufferSize,
 	   char const* perFrameFileNamePrefix);
       // called only by createNew()
   virtual ~FileSink();
 
+public: // redefined virtual functions:
+  virtual void stopPlaying();
+
 protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
 
@@ -58,6 +68,7 @@ protected:
   virtual void afterGettingFrame(unsigned frameSize,
 				 unsigned numTruncatedBytes,
 				 struct timeval presentationTime);
+  void addFrameSlices(class FrameSlices const& frameSlices, struct timeval presentationTime);
 
   FILE* fOutFid;
   unsigned char* fBuffer;
@@ -66,6 +77,7 @@ protected:
   char* fPerFrameFileNameBuffer; // used if "oneFilePerFrame" is True
   struct timeval fPrevPresentationTime;
   unsigned fSamePresentationTimeCounter;
+  Boolean fWriteFrameSlices;
 };
 
 #endif
@@ -28,11 +28,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 class H264VideoStreamFramer: public H264or5VideoStreamFramer {
 public:
   static H264VideoStreamFramer* createNew(UsageEnvironment& env, FramedSource* inputSource,
-					  Boolean includeStartCodeInOutput = False);
+					  Boolean includeStartCodeInOutput = False,
+					  Boolean inputIsAccessUnitDelimited = False);
+      // (See "H264or5VideoStreamFramer.hh" for the meaning of "inputIsAccessUnitDelimited".)
 
 protected:
   H264VideoStreamFramer(UsageEnvironment& env, FramedSource* inputSource,
-			Boolean createParser, Boolean includeStartCodeInOutput);
+			Boolean createParser, Boolean includeStartCodeInOutput,
+			Boolean inputIsAccessUnitDelimited = False);
       // called only by "createNew()"
   virtual ~H264VideoStreamFramer();
 
@@ -29,6 +29,17 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class H264or5VideoRTPSink: public VideoRTPSink {
+public:
+  void setScatterGatherPacketization(Boolean useScatterGather = True) { fUseScatterGather = useScatterGather; }
+      // If set, each outgoing packet is sent directly from the RTP (and FU) headers and the NAL unit data
+      // in our fragmenter's buffer, rather than first copying this data into our output packet buffer.
+      // (Takes effect from the next "startPlaying()".)
+  void setAggregationPacketization(Boolean useAggregation = True) { fUseAggregation = useAggregation; }
+      // If set, consecutive small NAL units from the same 'access unit' (e.g., parameter sets and SEI
+      // that precede a key frame) are packed together into a single outgoing packet - a STAP-A packet
+      // (RFC 6184) for H.264, or an AP packet (RFC 7798) for H.265 - rather than sent in separate packets.
+      // (Takes effect from the next "startPlaying()".)
+
 protected:
   H264or5VideoRTPSink(int hNumber, // 264 or 265
 		      UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
@@ -52,9 +63,12 @@ protected:
   int fHNumber;
   FramedFilter* fOurFragmenter;
   char* fFmtpSDPLine;
+  unsigned fFmtpSDPLineParameterSetsVersion; // of the framer whose parameter sets "fFmtpSDPLine" was made from (else 0)
   u_int8_t* fVPS; unsigned fVPSSize;
   u_int8_t* fSPS; unsigned fSPSSize;
   u_int8_t* fPPS; unsigned fPPSSize;
+  Boolean fUseScatterGather;
+  Boolean fUseAggregation;
 };
 
 #endif
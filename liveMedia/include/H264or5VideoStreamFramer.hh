@@ -48,16 +48,27 @@ public:
     saveCopyOfPPS(pps, ppsSize);
   }
 
+  unsigned parameterSetsVersion() const { return fParameterSetsVersion; }
+      // Changes (to a new value, unique across all framers) whenever the contents of our saved VPS, SPS or PPS change.
+      // (Downstream objects - e.g., RTP sinks - can use this to avoid recomputing anything that they derive from
+      // these NAL units, when an encoder repeats them unchanged.)
+
 protected:
   H264or5VideoStreamFramer(int hNumber, // 264 or 265
 			   UsageEnvironment& env, FramedSource* inputSource,
-			   Boolean createParser, Boolean includeStartCodeInOutput);
+			   Boolean createParser, Boolean includeStartCodeInOutput,
+			   Boolean inputIsAccessUnitDelimited = False);
       // We're an abstract base class.
+      // If "inputIsAccessUnitDelimited" is True, then each frame that we read from "inputSource" is assumed to be
+      // a complete 'access unit' (i.e., picture) in byte-stream (start code) format - e.g., the output of an encoder,
+      // or of a demultiplexor.  In this case, rather than parsing the input stream, we just split each input frame
+      // into NAL units, using its presentation time, and marking its last NAL unit as ending the 'access unit'.
   virtual ~H264or5VideoStreamFramer();
 
-  void saveCopyOfVPS(u_int8_t* from, unsigned size);
-  void saveCopyOfSPS(u_int8_t* from, unsigned size);
-  void saveCopyOfPPS(u_int8_t* from, unsigned size);
+  Boolean saveCopyOfVPS(u_int8_t* from, unsigned size);
+  Boolean saveCopyOfSPS(u_int8_t* from, unsigned size);
+  Boolean saveCopyOfPPS(u_int8_t* from, unsigned size);
+      // Each returns True iff the saved copy changed (i.e., it wasn't already identical to "from")
 
   void setPresentationTime() { fPresentationTime = fNextPresentationTime; }
 
@@ -66,6 +77,22 @@ protected:
   Boolean isPPS(u_int8_t nal_unit_type);
   Boolean isVCL(u_int8_t nal_unit_type);
 
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+
+private:
+  // Used only when the input is 'access unit delimited':
+  static void afterGettingAccessUnit(void* clientData, unsigned frameSize,
+				     unsigned numTruncatedBytes,
+				     struct timeval presentationTime,
+				     unsigned durationInMicroseconds);
+  void afterGettingAccessUnit1(unsigned frameSize, unsigned numTruncatedBytes,
+			       struct timeval presentationTime,
+			       unsigned durationInMicroseconds);
+  unsigned char* skipStartCodes(unsigned char* ptr);
+  void deliverNALUnitFromAccessUnit();
+
 protected:
   int fHNumber;
   u_int8_t* fLastSeenVPS;
@@ -74,8 +101,19 @@ protected:
   unsigned fLastSeenSPSSize;
   u_int8_t* fLastSeenPPS;
   unsigned fLastSeenPPSSize;
+  unsigned fParameterSetsVersion;
   struct timeval fNextPresentationTime; // the presentation time to be used for the next NAL unit to be parsed/delivered after this
   friend class H264or5VideoStreamParser; // hack
+
+private:
+  Boolean fInputIsAccessUnitDelimited;
+  unsigned fOutputStartCodeSize;
+  unsigned char* fAccessUnitBuffer;
+  unsigned fAccessUnitBufferSize;
+  unsigned char* fNextNALUnit; // the start of the next (undelivered) NAL unit in "fAccessUnitBuffer"
+  unsigned char* fAccessUnitEnd;
+  struct timeval fAccessUnitPresentationTime;
+  unsigned fAccessUnitDurationInMicroseconds;
 };
 
 // A general routine for making a copy of a (H.264 or H.265) NAL unit,
@@ -84,4 +122,10 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 				     u_int8_t* from, unsigned fromSize);
     // returns the size of the copy; it will be <= min(toMaxSize,fromSize)
 
+// The inverse: A general routine for making a copy of (H.264 or H.265) NAL unit data,
+// inserting 'emulation' bytes (0x03) wherever they are needed:
+unsigned addH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
+				  u_int8_t* from, unsigned fromSize);
+    // returns the size of the copy; it will be <= toMaxSize (if "toMaxSize" is too small, the copy is truncated)
+
 #endif
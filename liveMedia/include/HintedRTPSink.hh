@@ -0,0 +1,63 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// An RTP sink that sends the pre-built packet payloads read (by a "RTPHintFileSource") from an
+// 'RTP hint' file - with its own SSRC, sequence numbers and timestamps.
+// C++ header
+
+#ifndef _HINTED_RTP_SINK_HH
+#define _HINTED_RTP_SINK_HH
+
+#ifndef _MULTI_FRAMED_RTP_SINK_HH
+#include "MultiFramedRTPSink.hh"
+#endif
+#ifndef _RTP_HINT_FILE_SOURCE_HH
+#include "RTPHintFileSource.hh"
+#endif
+
+class HintedRTPSink: public MultiFramedRTPSink {
+public:
+  static HintedRTPSink* createNew(UsageEnvironment& env, Groupsock* RTPgs,
+				  RTPHintFileSource const& hintFileSource,
+				  unsigned char rtpPayloadTypeIfDynamic);
+      // Our parameters (RTP payload type - if static -, payload format name, SDP lines, etc.) are taken from
+      // "hintFileSource".  Note that we must be fed only by a "RTPHintFileSource".
+
+protected:
+  HintedRTPSink(UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadType,
+		RTPHintFileSource const& hintFileSource);
+      // called only by createNew()
+  virtual ~HintedRTPSink();
+
+protected: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+  virtual void doSpecialFrameHandling(unsigned fragmentationOffset,
+                                      unsigned char* frameStart,
+                                      unsigned numBytesInFrame,
+                                      struct timeval framePresentationTime,
+                                      unsigned numRemainingBytes);
+  virtual Boolean frameCanAppearAfterPacketStart(unsigned char const* frameStart,
+						 unsigned numBytesInFrame) const;
+  virtual char const* sdpMediaType() const;
+  virtual char const* auxSDPLine();
+
+private:
+  char* fSDPMediaType;
+  char* fAuxSDPLine;
+};
+
+#endif
@@ -35,6 +35,84 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class IndexRecord; // forward
 
+// The parser that turns Transport Stream packets into index records.  It's used by
+// "MPEG2IFrameIndexFromTransportStream" (below), and by "MPEG2TransportStreamIndexGenerator" - which runs
+// several of them at once (on separate threads), each on its own part of a file.  Because of this, a parser
+// doesn't use the event loop, and reports errors and warnings only if it's given a "UsageEnvironment".
+
+class MPEG2TransportStreamIndexParser {
+public:
+  MPEG2TransportStreamIndexParser(UsageEnvironment* env, Boolean keepPCRValues = False);
+      // If "keepPCRValues" is True, we also record every PCR value that we see (see "pcrValues()" below)
+  virtual ~MPEG2TransportStreamIndexParser();
+
+  Boolean getNextIndexRecord(unsigned char* to, u_int32_t* pcrCount = NULL);
+      // If a (parsed, non-junk) index record is ready, writes it (11 bytes) to "to", and returns True.
+      // If "pcrCount" is not NULL, it's set to the number of PCRs that had been seen when the record was made.
+  Boolean parseFrame(); // returns True iff a new 'frame' was parsed (so more index records may now be ready)
+  Boolean makeRoomForPacket(); // returns False if the parse buffer is full (i.e., a frame is too large)
+
+  Boolean addTransportPacket(unsigned char const* pkt, unsigned size,
+			     unsigned vesStart = 0, unsigned vesEnd = TRANSPORT_PACKET_SIZE,
+			     Boolean ignorePCR = False);
+      // Returns False if the data is bad, and should be treated as the end of the input.
+      // "vesStart" and "vesEnd" select just part of the packet's video data (used when a packet is split between
+      // two parsers; the first part also gets the packet's PCR - so the second part should set "ignorePCR").
+  Boolean addEndOfInputCode();
+      // Called at the end of the input, to let the final frame be parsed.  Returns False if this wasn't possible.
+  Boolean haveUnparsedData() const { return fHeadIndexRecord != NULL; }
+
+  // The state that's carried from one Transport Stream packet to the next (apart from the parse buffer):
+  struct StreamState {
+    u_int16_t PMT_PID, video_PID;
+    Boolean isH264, isH265;
+    Boolean operator==(StreamState const& other) const {
+      return PMT_PID == other.PMT_PID && video_PID == other.video_PID
+	&& isH264 == other.isH264 && isH265 == other.isH265;
+    }
+  };
+  StreamState const& streamState() const { return fStreamState; }
+  void setStreamState(StreamState const& streamState) { fStreamState = streamState; }
+  Boolean haveSeenPMT() const { return fHaveSeenPMT; }
+  void setLastContinuityCounter(u_int8_t lastContinuityCounter) { fLastContinuityCounter = lastContinuityCounter; }
+  void setNextPacketNumber(unsigned long packetNumber) { fInputTransportPacketCounter = packetNumber - 1; }
+  unsigned long nextPacketNumber() const { return fInputTransportPacketCounter + 1; }
+
+  void getPCRState(float& firstPCR, float& lastPCR, Boolean& haveSeenFirstPCR) const;
+  void setPCRState(float firstPCR, float lastPCR, Boolean haveSeenFirstPCR);
+  float const* pcrValues() const { return fPCRValues; } // if "keepPCRValues"
+  u_int32_t numPCRValues() const { return fNumPCRs; }
+
+  static void packPCR(unsigned char* record, float pcr); // sets the PCR field (bytes 3-6) of an index record
+
+private:
+  void analyzePAT(unsigned char const* payload, unsigned payloadSize);
+  void analyzePMT(unsigned char const* payload, unsigned payloadSize);
+  Boolean parseToNextCode(unsigned char& nextCode);
+  void compactParseBuffer();
+  void addToTail(IndexRecord* newIndexRecord);
+
+private:
+  UsageEnvironment* fEnv; // may be NULL
+  StreamState fStreamState;
+      // Note: We assume: 1 program per Transport Stream; 1 video stream per program
+  Boolean fHaveSeenPMT;
+  unsigned long fInputTransportPacketCounter;
+  u_int8_t fLastContinuityCounter;
+  float fFirstPCR, fLastPCR;
+  Boolean fHaveSeenFirstPCR;
+  u_int32_t fNumPCRs;
+  float* fPCRValues; // if "keepPCRValues"
+  u_int32_t fPCRValuesSize;
+  unsigned char* fParseBuffer;
+  unsigned fParseBufferSize;
+  unsigned fParseBufferFrameStart;
+  unsigned fParseBufferParseEnd;
+  unsigned fParseBufferDataEnd;
+  IndexRecord* fHeadIndexRecord;
+  IndexRecord* fTailIndexRecord;
+};
+
 class MPEG2IFrameIndexFromTransportStream: public FramedFilter {
 public:
   static MPEG2IFrameIndexFromTransportStream*
@@ -63,33 +141,10 @@ private:
   static void handleInputClosure(void* clientData);
   void handleInputClosure1();
 
-  void analyzePAT(unsigned char* pkt, unsigned size);
-  void analyzePMT(unsigned char* pkt, unsigned size);
-
-  Boolean deliverIndexRecord();
-  Boolean parseFrame();
-  Boolean parseToNextCode(unsigned char& nextCode);
-  void compactParseBuffer();
-  void addToTail(IndexRecord* newIndexRecord);
-
 private:
-  Boolean fIsH264; // True iff the video is H.264 (encapsulated in a Transport Stream)
-  Boolean fIsH265; // True iff the video is H.265 (encapsulated in a Transport Stream)
-  unsigned long fInputTransportPacketCounter;
+  MPEG2TransportStreamIndexParser fParser;
   unsigned fClosureNumber;
-  u_int8_t fLastContinuityCounter;
-  float fFirstPCR, fLastPCR;
-  Boolean fHaveSeenFirstPCR;
-  u_int16_t fPMT_PID, fVideo_PID;
-      // Note: We assume: 1 program per Transport Stream; 1 video stream per program
   unsigned char fInputBuffer[TRANSPORT_PACKET_SIZE];
-  unsigned char* fParseBuffer;
-  unsigned fParseBufferSize;
-  unsigned fParseBufferFrameStart;
-  unsigned fParseBufferParseEnd;
-  unsigned fParseBufferDataEnd;
-  IndexRecord* fHeadIndexRecord;
-  IndexRecord* fTailIndexRecord;
 };
 
 #endif
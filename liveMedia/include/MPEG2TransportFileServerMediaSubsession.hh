@@ -37,6 +37,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MPEG2_TRANSPORT_STREAM_FROM_ES_SOURCE_HH
 #include "MPEG2TransportStreamFromESSource.hh"
 #endif
+#ifndef _MPEG2_TRANSPORT_STREAM_TRICK_PLAY_TRACK_HH
+#include "MPEG2TransportStreamTrickPlayTrack.hh"
+#endif
 
 class ClientTrickPlayState; // forward
 
@@ -47,6 +50,10 @@ public:
 	    char const* dataFileName, char const* indexFileName,
 	    Boolean reuseFirstSource);
 
+  MPEG2TransportStreamTrickPlayTrack* lookupTrickPlayTrack(int scale);
+      // Returns the precomputed 'trick play' track for "scale", if one has been generated (see
+      // "MPEG2TransportStreamTrickPlayTrack.hh"); otherwise NULL (and we do 'trick play' on the fly instead).
+
 protected:
   MPEG2TransportFileServerMediaSubsession(UsageEnvironment& env,
 					  char const* fileName,
@@ -91,6 +98,7 @@ private:
   MPEG2TransportStreamIndexFile* fIndexFile;
   float fDuration;
   HashTable* fClientSessionHashTable; // indexed by client session id
+  HashTable* fTrickPlayTracks; // indexed by scale
 };
 
 
@@ -101,7 +109,9 @@ private:
 
 class ClientTrickPlayState {
 public:
-  ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile);
+  ClientTrickPlayState(MPEG2TransportStreamIndexFile* indexFile,
+		       MPEG2TransportFileServerMediaSubsession* subsession = NULL);
+      // "subsession" (if not NULL) is used to look up precomputed 'trick play' tracks
 
   // Functions to bring "fNPT", "fTSRecordNum" and "fIxRecordNum" in sync:
   unsigned long updateStateFromNPT(double npt, double seekDuration);
@@ -117,6 +127,7 @@ public:
 protected:
   void updateTSRecordNum();
   void reseekOriginalTransportStreamSource();
+  void closeTrickPlaySource();
 
 protected:
   MPEG2TransportStreamIndexFile* fIndexFile;
@@ -124,6 +135,9 @@ protected:
   MPEG2TransportStreamTrickModeFilter* fTrickModeFilter;
   MPEG2TransportStreamFromESSource* fTrickPlaySource;
   MPEG2TransportStreamFramer* fFramer;
+  MPEG2TransportFileServerMediaSubsession* fSubsession;
+  MPEG2TransportStreamTrickPlayTrack* fTrickPlayTrack; // if we're streaming from a precomputed track:
+  FramedSource* fTrickPlayTrackSource; // ... this reads it (instead of "fTrickModeFilter" and "fTrickPlaySource")
   float fScale, fNextScale, fNPT;
   unsigned long fTSRecordNum, fIxRecordNum;
 };
@@ -0,0 +1,162 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// Demultiplexer for a MPEG Transport Stream
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_DEMUX_HH
+#define _MPEG2_TRANSPORT_STREAM_DEMUX_HH
+
+#ifndef _FRAMED_SOURCE_HH
+#include "FramedSource.hh"
+#endif
+
+#ifndef MAX_DEMUXED_ELEMENTARY_STREAMS
+#define MAX_DEMUXED_ELEMENTARY_STREAMS 32 // must be < 256
+#endif
+
+#ifndef MPEG2_TRANSPORT_STREAM_DEMUX_INPUT_BUFFER_SIZE
+#define MPEG2_TRANSPORT_STREAM_DEMUX_INPUT_BUFFER_SIZE (100*188)
+#endif
+
+class MPEG2TransportStreamDemuxedElementaryStream; // forward
+
+class MPEG2TransportStreamDemux: public Medium {
+public:
+  static MPEG2TransportStreamDemux* createNew(UsageEnvironment& env,
+					      FramedSource* inputSource,
+					      Boolean reclaimWhenLastESDies = False);
+  // "inputSource" delivers Transport Stream data (e.g., from a file, or a "BasicUDPSource").
+  // If "reclaimWhenLastESDies" is True, the the demux is deleted when
+  // all "MPEG2TransportStreamDemuxedElementaryStream"s that we created get deleted.
+
+  MPEG2TransportStreamDemuxedElementaryStream* newElementaryStream(u_int16_t PID, Boolean deliverPESPackets = False);
+      // Each delivered frame is one PES packet of the stream with this PID: either the whole PES packet
+      // (if "deliverPESPackets" is True), or else just its elementary stream data, with a presentation time
+      // taken from its PTS.  Returns NULL if we've already created MAX_DEMUXED_ELEMENTARY_STREAMS streams, if "PID"
+      // is not a valid elementary stream PID, or if "PID" is already claimed - i.e., is already being delivered by a stream
+      // that we created earlier (including a 'video' or 'audio' stream (see below) that has since been bound to this PID).
+      // Note that a stream gets data only once its reader has begun reading it (and we then read no further input
+      // until each such reader has asked for its next frame).
+
+  // Versions of the above for the first video (or audio) stream that's listed in the PMT of the
+  // (first) program in the PAT.  (The stream's PID is not known until we next see the PMT.)
+  MPEG2TransportStreamDemuxedElementaryStream* newVideoStream(Boolean deliverPESPackets = False);
+  MPEG2TransportStreamDemuxedElementaryStream* newAudioStream(Boolean deliverPESPackets = False);
+
+  void getNextFrame(u_int8_t outputIndex,
+		    unsigned char* to, unsigned maxSize,
+		    FramedSource::afterGettingFunc* afterGettingFunc,
+		    void* afterGettingClientData,
+		    FramedSource::onCloseFunc* onCloseFunc,
+		    void* onCloseClientData);
+      // similar to FramedSource::getNextFrame(), except that it also
+      // takes (as parameter) the index of the elementary stream's output
+
+  void stopGettingFrames(u_int8_t outputIndex);
+      // similar to FramedSource::stopGettingFrames(), except that it also
+      // takes (as parameter) the index of the elementary stream's output
+
+  static void handleClosure(void* clientData);
+      // This should be called (on ourself) if the source is discovered
+      // to be closed (i.e., no longer readable)
+
+  FramedSource* inputSource() const { return fInputSource; }
+
+  u_int16_t PID(u_int8_t outputIndex) const { return fOutput[outputIndex].PID; }
+  u_int8_t streamType(u_int8_t outputIndex) const { return fOutput[outputIndex].streamType; }
+      // These are not known for 'video' or 'audio' streams until we've seen the PMT
+
+  void flushInput(); // should be called before any 'seek' on the underlying source
+
+private:
+  MPEG2TransportStreamDemux(UsageEnvironment& env,
+			    FramedSource* inputSource, Boolean reclaimWhenLastESDies);
+      // called only by createNew()
+  virtual ~MPEG2TransportStreamDemux();
+
+  MPEG2TransportStreamDemuxedElementaryStream* newOutput(u_int16_t PID, u_int8_t streamKind,
+							 Boolean deliverPESPackets);
+
+  static void afterGettingInput(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingInput1(unsigned frameSize);
+  void continueReadProcessing();
+  Boolean handlePacket(unsigned char const* pkt);
+      // Returns False iff we need to wait for the packet's reader before we can handle it
+  void analyzePAT(unsigned char const* payload, unsigned payloadSize);
+  void analyzePMT(unsigned char const* payload, unsigned payloadSize);
+      // (called only for packets that begin a section; "payload" begins with the "pointer_field")
+  void startFrame(u_int8_t outputIndex, unsigned char const* payload, unsigned payloadSize);
+  void addToFrame(u_int8_t outputIndex, unsigned char const* data, unsigned size);
+  void deliverFrame(u_int8_t outputIndex);
+  void handleEndOfInput();
+
+private:
+  friend class MPEG2TransportStreamDemuxedElementaryStream;
+  void noteElementaryStreamDeletion(u_int8_t outputIndex);
+
+private:
+  FramedSource* fInputSource;
+  Boolean fReclaimWhenLastESDies;
+  unsigned fNumOutstandingESs;
+
+  // A descriptor for each elementary stream that we deliver:
+  typedef struct OutputDescriptor {
+    MPEG2TransportStreamDemuxedElementaryStream* es; // NULL iff this descriptor is unused
+    u_int16_t PID; // (0x1FFF if not yet known)
+    u_int8_t streamKind; // a PID that was asked for explicitly, or else the first video or audio stream
+    u_int8_t streamType; // from the PMT (or 0 if not yet known)
+    Boolean deliverPESPackets;
+
+    // input parameters
+    unsigned char* to; unsigned maxSize;
+    FramedSource::afterGettingFunc* fAfterGettingFunc;
+    void* afterGettingClientData;
+    FramedSource::onCloseFunc* fOnCloseFunc;
+    void* onCloseClientData;
+
+    // output parameters (for the frame that's being read)
+    unsigned frameSize, numTruncatedBytes; struct timeval presentationTime;
+    unsigned pesBytesRemaining; // if the PES packet's length is known; otherwise 0
+
+    // status parameters
+    Boolean isAwaitingPESStart; // we have no frame in progress (or we lost data from it)
+    Boolean haveSeenPacket; u_int8_t lastContinuityCounter;
+    Boolean isCurrentlyActive; // our reader has begun reading (and hasn't stopped)
+    Boolean isCurrentlyAwaitingData;
+  } OutputDescriptor_t;
+  OutputDescriptor_t fOutput[MAX_DEMUXED_ELEMENTARY_STREAMS];
+  u_int8_t fPIDTable[0x2000]; // for each PID: 1 + the index of the output that delivers it, or 0 (if none)
+  u_int16_t fPMT_PID; // (0x1FFF if not yet known)
+
+  // Conversion of PTSs into presentation times (shared by all of our outputs, so that they stay in sync):
+  Boolean fHaveSeenPTS;
+  u_int64_t fLastPTS;
+  double fLastPTSTime;
+
+  // Input buffering:
+  unsigned char* fInputBuffer;
+  unsigned fInputDataStart, fInputDataEnd;
+  unsigned fNumPendingReads;
+  Boolean fIsReadingInput, fIsProcessingInput;
+  Boolean fInputHasClosed;
+};
+
+#endif
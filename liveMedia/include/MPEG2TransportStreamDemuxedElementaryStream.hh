@@ -0,0 +1,65 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A MPEG Elementary Stream (or its PES packets), demultiplexed from a Transport Stream
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_DEMUXED_ELEMENTARY_STREAM_HH
+#define _MPEG2_TRANSPORT_STREAM_DEMUXED_ELEMENTARY_STREAM_HH
+
+#ifndef _MPEG2_TRANSPORT_STREAM_DEMUX_HH
+#include "MPEG2TransportStreamDemux.hh"
+#endif
+
+class MPEG2TransportStreamDemuxedElementaryStream: public FramedSource {
+public:
+  u_int16_t PID() const { return fOurSourceDemux.PID(fOurOutputIndex); }
+  u_int8_t streamType() const { return fOurSourceDemux.streamType(fOurOutputIndex); }
+      // (from the PMT; 0 if not yet known)
+
+  MPEG2TransportStreamDemux& sourceDemux() const { return fOurSourceDemux; }
+
+private: // We are created only by a MPEG2TransportStreamDemux (a friend)
+  MPEG2TransportStreamDemuxedElementaryStream(UsageEnvironment& env,
+					      u_int8_t outputIndex,
+					      MPEG2TransportStreamDemux& sourceDemux);
+  virtual ~MPEG2TransportStreamDemuxedElementaryStream();
+
+private:
+  // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+  virtual char const* MIMEtype() const;
+
+private:
+  static void afterGettingFrame(void* clientData,
+				unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+
+  void afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes,
+			  struct timeval presentationTime,
+			  unsigned durationInMicroseconds);
+
+private:
+  u_int8_t fOurOutputIndex;
+  MPEG2TransportStreamDemux& fOurSourceDemux;
+
+  friend class MPEG2TransportStreamDemux;
+};
+
+#endif
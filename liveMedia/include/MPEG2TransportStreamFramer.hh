@@ -62,7 +62,11 @@ private:
   void afterGettingFrame1(unsigned frameSize,
 			  struct timeval presentationTime);
 
+  Boolean updateTSPacketDurationEstimates(unsigned numTSPackets);
+      // Updates our estimate from the "numTSPackets" packets at "fTo".  Returns False iff we hit our PCR limit.
   Boolean updateTSPacketDurationEstimate(unsigned char* pkt, double timeNow);
+  Boolean updateTSPacketDurationEstimateFromPCR(unsigned char* pkt, double timeNow);
+      // "pkt" (which has already been counted in "fTSPacketCount") contains a PCR
 
 private:
   u_int64_t fTSPacketCount;
@@ -33,9 +33,10 @@ public:
   void addNewVideoSource(FramedSource* inputSource, int mpegVersion, int16_t PID = -1);
       // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5.
   void addNewAudioSource(FramedSource* inputSource, int mpegVersion, int16_t PID = -1);
-      // Note: In these functions, if "PID" is not -1, then it (currently, just the low 8 bits)
-      // is used as the stream's PID.  Otherwise (if "PID" is -1) the 'stream_id' is used as
-      // the PID.
+      // Note: In these functions, if "PID" is not -1, then it is used as the stream's PID.  Otherwise (if "PID" is -1)
+      // the stream is given the next PID from our allocator - if "setPIDAllocation()" was called - or else its
+      // 'stream_id' is used as the PID.  A source is ignored if its (explicit) "PID" is reserved (0x0000-0x000F or
+      // 0x1FFF), is our PMT's PID (0x0030), or was already given to another source.
 
 protected:
   MPEG2TransportStreamFromESSource(UsageEnvironment& env);
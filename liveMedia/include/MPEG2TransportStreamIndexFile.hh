@@ -57,7 +57,10 @@ public:
 				unsigned long& transportPacketNum, u_int8_t& offset,
 				u_int8_t& size, float& pcr, u_int8_t& recordType);
   float getPlayingDuration();
-  void stopReading() { closeFid(); }
+  unsigned long numIndexRecords() const { return fNumIndexRecords; }
+  void stopReading() {}
+      // (now a no-op: the index file's contents stay in memory - and shared with other users of the same file -
+      //  until we're deleted)
 
   int mpegVersion();
       // returns the best guess for the version of MPEG being used for data within the underlying Transport Stream file.
@@ -66,11 +69,7 @@ public:
 private:
   MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName);
 
-  Boolean openFid();
-  Boolean seekToIndexRecord(unsigned long indexRecordNumber);
-  Boolean readIndexRecord(unsigned long indexRecordNum); // into "fBuf"
-  Boolean readOneIndexRecord(unsigned long indexRecordNum); // closes "fFid" at end
-  void closeFid();
+  Boolean readIndexRecord(unsigned long indexRecordNum); // sets "fBuf" to point to it
 
   u_int8_t recordTypeFromBuf() { return fBuf[0]; }
   u_int8_t offsetFromBuf() { return fBuf[1]; }
@@ -84,13 +83,13 @@ private:
 
 private:
   char* fFileName;
-  FILE* fFid; // used internally when reading from the file
+  class IndexFileContents* fContents; // shared by all users of the same index file
+  unsigned char const* fRecords; // the index records (all "fNumIndexRecords" of them)
   int fMPEGVersion;
-  unsigned long fCurrentIndexRecordNum; // within "fFid"
   float fCachedPCR;
   unsigned long fCachedTSPacketNumber, fCachedIndexRecordNumber;
   unsigned long fNumIndexRecords;
-  unsigned char fBuf[INDEX_RECORD_SIZE]; // used for reading index records from file
+  unsigned char const* fBuf; // the index record most recently 'read' (within "fRecords")
 };
 
 #endif
@@ -0,0 +1,85 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A class that generates an index file (for 'trick play') from a Transport Stream file - without using
+// the event loop.  Large files are split into parts that are indexed at the same time (on separate threads).
+// The index can also be extended as the Transport Stream file grows (e.g., while a recording is being made).
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_INDEX_GENERATOR_HH
+#define _MPEG2_TRANSPORT_STREAM_INDEX_GENERATOR_HH
+
+#ifndef _MPEG2_IFRAME_INDEX_FROM_TRANSPORT_STREAM_HH
+#include "MPEG2IndexFromTransportStream.hh"
+#endif
+
+class IndexChunk; // forward
+
+class MPEG2TransportStreamIndexGenerator: public Medium {
+public:
+  static MPEG2TransportStreamIndexGenerator*
+  createNew(UsageEnvironment& env, char const* tsFileName, char const* indexFileName,
+	    unsigned numThreads = 0);
+      // "numThreads" == 0 means: one per CPU.  The index file is always created anew: it's written as
+      // "<indexFileName>.tmp" at first, then renamed (replacing any existing index file) by the first
+      // "indexNewData()" call, once the file's existing data has been indexed.
+
+  unsigned long indexNewData();
+      // Indexes the (whole) Transport Stream packets that have been added to the file since we were last called,
+      // and appends the resulting records to the index file.  (The first call indexes the existing file.)
+      // Returns the number of index records that were added.
+      // Note: The records for the frame that's currently being received are not added until a later call
+      // (or "finish()").
+  void finish();
+      // Call this (after a final "indexNewData()") when the Transport Stream file is complete,
+      // to index its last frame.
+
+  unsigned long numIndexRecords() const { return fNumIndexRecords; }
+
+protected:
+  MPEG2TransportStreamIndexGenerator(UsageEnvironment& env, char const* tsFileName, char const* indexFileName,
+				     char* tempIndexFileName, FILE* tsFid, FILE* indexFid, unsigned numThreads);
+      // called only by createNew()
+  virtual ~MPEG2TransportStreamIndexGenerator();
+
+private:
+  Boolean indexInParallel(unsigned long numPackets);
+  Boolean stitchChunk(IndexChunk& chunk, MPEG2TransportStreamIndexParser::StreamState const& streamState);
+  void restart();
+  void replaceIndexFile();
+  void deliverIndexRecords();
+  Boolean handleInputClosure();
+
+private:
+  char* fTSFileName;
+  char* fIndexFileName;
+  char* fTempIndexFileName; // NULL once we've renamed our (temporary) index file to "fIndexFileName"
+  FILE* fTSFid;
+  FILE* fIndexFid;
+  unsigned fNumThreads;
+  MPEG2TransportStreamIndexParser* fParser;
+      // indexes (sequentially) the end of the file - and any data that's added to it later
+  unsigned long fNextPacketNumber;
+  unsigned fNextPacketVESStart; // >0 if the next packet's first few bytes of video data were already indexed
+  float fFirstPCR, fLastPCR; // used when stitching together the parts of the file that were indexed separately
+  Boolean fHaveSeenFirstPCR;
+  unsigned fClosureNumber;
+  Boolean fHaveStarted, fHaveFinished;
+  unsigned long fNumIndexRecords;
+};
+
+#endif
@@ -28,10 +28,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _MPEG_1OR2_DEMUX_HH
 #include "MPEG1or2Demux.hh" // for SCR
 #endif
-
-#define PID_TABLE_SIZE 256
+#ifndef _CRC32_HH
+#include "CRC32.hh" // for "calculateCRC()", which Transport Streams use (and which was once declared here)
+#endif
 
 class MPEG2TransportStreamMultiplexor: public FramedSource {
+public:
+  void setPIDAllocation(u_int16_t firstPID = 0x100);
+      // Causes each stream that isn't given an explicit PID to be given the next unused PID (starting at "firstPID"),
+      // instead of reusing its 8-bit 'stream_id' as its PID.  Call this before adding any input streams.
+
 protected:
   MPEG2TransportStreamMultiplexor(UsageEnvironment& env);
   virtual ~MPEG2TransportStreamMultiplexor();
@@ -44,19 +50,38 @@ protected:
       // called by "awaitNewBuffer()"
       // Note: For MPEG-4 video, set "mpegVersion" to 4; for H.264 video, set "mpegVersion" to 5. 
       // The buffer is assumed to be a PES packet, with a proper PES header.
-      // If "PID" is not -1, then it (currently, only the low 8 bits) is used as the stream's PID,
-      // otherwise the "stream_id" in the PES header is reused to be the stream's PID.
+      // If "PID" is not -1, then it is used as the stream's PID.  Otherwise, the stream is given a PID from our
+      // allocator (if "setPIDAllocation()" was called), or else the "stream_id" in the PES header is reused as its PID.
+      // (A buffer whose "PID" is one of the reserved PIDs (0x0000-0x000F and 0x1FFF), or our PMT's PID, is ignored.)
+
+  int16_t allocatePID();
+      // Returns the next unused PID, or -1 if "setPIDAllocation()" wasn't called (or if every PID is in use).
+  Boolean reservePID(u_int16_t pid);
+      // Marks "pid" - given explicitly for a new stream - as being in use, so that our allocator won't also hand it out.
+      // Returns False if "pid" can't be used: if it's reserved (see above), or is already in use.
+  Boolean isAllocatingPIDs() const { return fFirstPIDToAllocate != 0; }
 
 private:
   // Redefined virtual functions:
   virtual void doGetNextFrame();
 
 private:
-  void deliverDataToClient(u_int8_t pid, unsigned char* buffer, unsigned bufferSize,
+  struct PIDState {
+    u_int16_t pid;
+    u_int8_t continuityCounter; // for the next packet
+    u_int8_t streamType; // for use in Program Maps (0 if the PID isn't in the Program Map)
+  };
+  PIDState& pidState(u_int16_t pid); // creates the state if the PID doesn't yet have one
+  Boolean pidForStreamId(u_int8_t stream_id, u_int16_t& pid);
+      // Returns False (having reported an error, the first time) if the stream needed a PID from our allocator,
+      // but none was available.  (We then ignore the stream.)
+
+  void deliverDataToClient(u_int16_t pid, unsigned char* buffer, unsigned bufferSize,
 			   unsigned& startPositionInBuffer);
 
   void deliverPATPacket();
-  void deliverPMTPacket(Boolean hasChanged);
+  void deliverPMTPacket();
+  void buildPMT();
 
   void setProgramStreamMap(unsigned frameSize);
 
@@ -65,24 +90,25 @@ protected:
 
 private:
   unsigned fOutgoingPacketCounter;
+  unsigned fOutgoingFrameCounter; // each frame that we deliver contains one or more packets
   unsigned fProgramMapVersion;
-  u_int8_t fPreviousInputProgramMapVersion, fCurrentInputProgramMapVersion;
-      // These two fields are used if we see "program_stream_map"s in the input.
-  struct {
-    unsigned counter;
-    u_int8_t streamType; // for use in Program Maps
-  } fPIDState[PID_TABLE_SIZE];
-  u_int8_t fPCR_PID, fCurrentPID;
-      // Note: We map 8-bit stream_ids directly to PIDs
+  Boolean fProgramMapHasChanged;
+  u_int8_t fInputProgramMapVersion; // used if we see "program_stream_map"s in the input
+  PIDState* fPIDStates; // a compact array, with one entry for each PID that we've used
+  unsigned fNumPIDStates, fPIDStatesSize;
+  u_int16_t* fPIDStateIndex; // for each of the 8192 PIDs: 1 + its index in "fPIDStates", or 0 if none
+  u_int16_t fFirstPIDToAllocate, fNextPIDToAllocate; // fFirstPIDToAllocate == 0 means we don't allocate PIDs
+  u_int16_t* fStreamIdToPID;
+      // used only if we allocate PIDs: for each 'stream_id', its PID (or 0 if none yet, or NULL_PID if none was available)
+  u_int16_t fPCR_PID, fCurrentPID;
   MPEG1or2Demux::SCR fPCR;
   unsigned char* fInputBuffer;
   unsigned fInputBufferSize, fInputBufferBytesUsed;
   Boolean fIsFirstAdaptationField;
+  unsigned char* fPATBuffer; // created once, then reused
+  unsigned char* fPMTBuffer; // recreated (by "buildPMT()") only when the Program Map changes
+  unsigned fPMTBufferSize; // a multiple of the Transport Stream packet payload size
+  unsigned fPMTDeliveryPosition; // > 0 iff we're part way through delivering a multi-packet Program Map Table
 };
 
-
-// The CRC calculation function that Transport Streams use.  We make this function public
-// here in case it's useful elsewhere:
-u_int32_t calculateCRC(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue = 0xFFFFFFFF);
-
 #endif
@@ -0,0 +1,89 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A precomputed 'trick play' track for a (indexed) MPEG Transport Stream file: A separate Transport Stream file
+// - with its own index file - that contains the I-frames that "MPEG2TransportStreamTrickModeFilter" would deliver
+// for a particular scale, with their PCRs and PTSs rebased to start from 0.  Streaming at this scale can then be done
+// by reading this file sequentially (rather than seeking to each I-frame in the original file).
+// C++ header
+
+#ifndef _MPEG2_TRANSPORT_STREAM_TRICK_PLAY_TRACK_HH
+#define _MPEG2_TRANSPORT_STREAM_TRICK_PLAY_TRACK_HH
+
+#ifndef _MPEG2_TRANSPORT_STREAM_INDEX_FILE_HH
+#include "MPEG2TransportStreamIndexFile.hh"
+#endif
+#ifndef _FRAMED_SOURCE_HH
+#include "FramedSource.hh"
+#endif
+
+#ifndef TRANSPORT_PACKET_SIZE
+#define TRANSPORT_PACKET_SIZE 188
+#endif
+
+class MPEG2TransportStreamTrickPlayTrack: public Medium {
+public:
+  static MPEG2TransportStreamTrickPlayTrack*
+  createNew(UsageEnvironment& env, char const* dataFileName, MPEG2TransportStreamIndexFile* indexFile, int scale);
+      // "dataFileName" and "indexFile" are the original Transport Stream file, and its index file.
+      // Returns NULL if the track for "scale" (and its index file) have not been generated.
+
+  static char* trackFileName(char const* dataFileName, int scale);
+      // Returns the name of the track for "scale": e.g., "name_ff8.ts" (for scale 8) or "name_rw8.ts" (for scale -8),
+      // if "dataFileName" is "name.ts".  (The track's index file has this name, followed by "x".)
+      // The result is dynamically allocated; the caller should delete[] it.
+
+  static FramedSource* createTrackGenerator(UsageEnvironment& env, char const* dataFileName,
+					    MPEG2TransportStreamIndexFile* indexFile, int scale);
+      // Returns a source of the Transport Stream that makes up the track for "scale".  To generate the track,
+      // write this to the file named by "trackFileName()", and then index that file.
+      // (Forward tracks begin at the start of the original file; reverse tracks at its end.)
+
+  int scale() const { return fScale; }
+
+  FramedSource* createSource(float& npt, unsigned preferredFrameSize = 0);
+      // Returns a new source that reads the track sequentially, starting from the frame for "npt"
+      // (a time within the original file, which we adjust to the time of that frame).
+      // The source begins - and, after "seekSource()", begins again - with the track's PAT and PMT.
+  void seekSource(FramedSource* source, float& npt);
+  float currentNPT(FramedSource* source, Boolean reverseToPreviousCleanPoint);
+      // Returns the time (within the original file) of the data that "source" will read next
+  float pcrLimit(float npt, double streamDuration);
+      // Returns the PCR (within the track) at which to stop streaming "streamDuration" seconds of the original file,
+      // starting from "npt"
+
+protected:
+  MPEG2TransportStreamTrickPlayTrack(UsageEnvironment& env, char const* trackFileName,
+				     MPEG2TransportStreamIndexFile* trackIndexFile, int scale, float originNPT);
+      // called only by createNew()
+  virtual ~MPEG2TransportStreamTrickPlayTrack();
+
+private:
+  Boolean readTrackHeader();
+  float trackTimeFromNPT(float npt);
+
+private:
+  friend class MPEG2TransportStreamTrickPlayTrackSource;
+  char* fTrackFileName;
+  MPEG2TransportStreamIndexFile* fTrackIndexFile;
+  int fScale;
+  float fOriginNPT; // the time (within the original file) at which the track begins
+  float fFirstTrackPCR; // the PCR to which the track's (relative) index record PCRs are relative
+  unsigned char fHeader[2*TRANSPORT_PACKET_SIZE]; // the track's PAT and PMT
+};
+
+#endif
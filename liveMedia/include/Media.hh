@@ -125,6 +125,8 @@ public:
 
   MediaLookupTable* mediaTable;
   void* socketTable;
+  void* packetBufferPool;
+  void* indexFileTable;
 
 protected:
   _Tables(UsageEnvironment& env);
@@ -38,6 +38,7 @@ public:
   // Test for specific types of source:
   virtual Boolean isFramedSource() const;
   virtual Boolean isRTPSource() const;
+  virtual Boolean isMultiFramedRTPSource() const;
   virtual Boolean isMPEG1or2VideoStreamFramer() const;
   virtual Boolean isMPEG4VideoStreamFramer() const;
   virtual Boolean isH264VideoStreamFramer() const;
@@ -37,6 +37,27 @@ public:
     fOnSendErrorData = onSendErrorFuncData;
   }
 
+  void setBurstLimits(unsigned maxPacketsPerBurst, unsigned maxBytesPerBurst = 0);
+      // By default, each outgoing packet is built and sent from a separate (delayed) task - even when it is due
+      // to be sent immediately (e.g., the successive fragments of a large frame).  If "maxPacketsPerBurst" > 1,
+      // then packets that are due immediately are instead built and sent together, from one task, up to
+      // "maxPacketsPerBurst" packets (and, if "maxBytesPerBurst" > 0, up to "maxBytesPerBurst" bytes) at a time.
+      // (To send all of a frame's packets at once, use a large value - e.g., ~0 - for "maxPacketsPerBurst".)
+  void setPacingRate(unsigned bytesPerSecond, unsigned bucketSize = 0);
+      // If "bytesPerSecond" > 0, then outgoing packets are also paced by a 'token bucket' that fills at this rate,
+      // up to "bucketSize" bytes (by default, our max packet size).  A packet is sent only when the bucket is not
+      // empty; otherwise we wait (using a single delayed task) until it has refilled.
+
+  typedef void (packetCaptureFunc)(void* clientData,
+				   unsigned char const* packet, unsigned packetSize,
+				   unsigned char const* externalPayload, unsigned externalPayloadSize,
+				   unsigned uSecondsToNextPacket);
+  void setPacketCaptureFunc(packetCaptureFunc* func, void* clientData);
+      // If "func" is non-NULL, then each outgoing packet - its RTP header and payload in "packet", followed by
+      // any payload data in "externalPayload" - is passed to "func", rather than being sent.  Packets are then
+      // built as fast as our source can deliver frames, instead of in real time; "uSecondsToNextPacket" is the
+      // time that we would have waited before sending the next packet.  (This is used to make 'RTP hint' files.)
+
 protected:
   MultiFramedRTPSink(UsageEnvironment& env,
 		     Groupsock* rtpgs, unsigned char rtpPayloadType,
@@ -88,6 +109,11 @@ protected:
   void setFrameSpecificHeaderBytes(unsigned char const* bytes, unsigned numBytes,
 				   unsigned bytePosition = 0);
   void setFramePadding(unsigned numPaddingBytes);
+  void setExternalPayload(unsigned char* payload, unsigned payloadSize);
+      // Can be called by "doSpecialFrameHandling()" to have "payloadSize" bytes - stored outside our packet
+      // buffer (e.g., within the source's own buffer) - sent, without being copied, at the end of the current
+      // packet.  (The packet will be sent immediately after this frame, so "payload" need remain valid only
+      // until the next frame is requested from the source.)
   unsigned numFramesUsedSoFar() const { return fNumFramesUsedSoFar; }
   unsigned ourMaxPacketSize() const { return fOurMaxPacketSize; }
 
@@ -103,6 +129,8 @@ private:
   void sendPacketIfNecessary();
   static void sendNext(void* firstArg);
   friend void sendNext(void*);
+  void sendBurst();
+  int64_t pacingDelay(struct timeval const& timeNow);
 
   static void afterGettingFrame(void* clientData,
 				unsigned numBytesRead, unsigned numTruncatedBytes,
@@ -132,9 +160,22 @@ private:
   unsigned fCurFrameSpecificHeaderSize; // size in bytes of cur frame-specific header
   unsigned fTotalFrameSpecificHeaderSizes; // size of all frame-specific hdrs in pkt
   unsigned fOurMaxPacketSize;
+  unsigned char* fExternalPayload; // if non-NULL, sent after the contents of "fOutBuf"
+  unsigned fExternalPayloadSize;
+
+  unsigned fMaxPacketsPerBurst, fMaxBytesPerBurst;
+  unsigned fNumPacketsInBurst, fNumBytesInBurst;
+  int* fBurstStatus; // non-NULL iff we're being called (synchronously) from within "sendBurst()"
+  unsigned fPacingRate; // bytes per second; 0 means no pacing
+  int64_t fPacingBucketSize, fPacingTokens; // both in units of (bytes * 1000000)
+  struct timeval fPacingLastRefillTime;
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
+
+  packetCaptureFunc* fPacketCaptureFunc;
+  void* fPacketCaptureClientData;
+  struct timeval fCaptureTime; // the time at which we would have sent the current packet (if capturing)
 };
 
 #endif
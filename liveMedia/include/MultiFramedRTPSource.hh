@@ -28,8 +28,35 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
+class PacketBufferPool; // forward
+class FrameSlices; // forward
+
+#ifndef MAX_REORDERED_PLAYOUT_FRAMES
+#define MAX_REORDERED_PLAYOUT_FRAMES 16
+#endif
 
 class MultiFramedRTPSource: public RTPSource {
+public:
+  void setDeliverFrameSlices(Boolean deliverFrameSlices = True) { fDeliverFrameSlices = deliverFrameSlices; }
+      // If set, then the data of each delivered frame is not copied into the caller's buffer ("fTo").  Instead, the
+      // caller's 'after getting' function should call "frameSlices()" to get a list of slices - of our incoming packets'
+      // buffers - that together make up the frame.  (The 'frame size' that's delivered is still the frame's total size.)
+  FrameSlices const& frameSlices() const { return *fFrameSlices; }
+      // The slices of the most recently delivered frame.  These remain valid until the next call to "getNextFrame()"
+      // or "stopGettingFrames()"; to keep them for longer, copy them (using "FrameSlices::assign()").
+
+  // Statistics for our adaptive playout delay (see "RTPSource::setAdaptivePlayoutDelay()"):
+  struct PlayoutStats {
+    unsigned playoutDelay; // the current target delay (in microseconds); this adapts to "jitter" (below)
+    unsigned jitter; // the current interarrival jitter estimate (in microseconds), measured in decoding order
+    unsigned numFramesReleased;
+    unsigned numFramesHeld; // the number of frames that we held until their playout time
+    unsigned numLateFrames; // the number of frames that became available only after their playout time
+    u_int64_t totalHoldTime; // the total time (in microseconds) between released frames' arrival and their delivery
+    u_int64_t totalLateness; // the total time (in microseconds) by which late frames missed their playout time
+  };
+  PlayoutStats const& playoutStats() const { return fPlayoutStats; }
+
 protected:
   MultiFramedRTPSource(UsageEnvironment& env, Groupsock* RTPgs,
 		       unsigned char rtpPayloadFormat,
@@ -59,6 +86,8 @@ private:
   // redefined virtual functions:
   virtual void doGetNextFrame();
   virtual void setPacketReorderingThresholdTime(unsigned uSeconds);
+  virtual void setAdaptivePlayoutDelay(unsigned minDelayUSecs, unsigned maxDelayUSecs);
+  virtual Boolean isMultiFramedRTPSource() const;
 
 private:
   void reset();
@@ -67,12 +96,43 @@ private:
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
 
+  void noteFrameArrival(unsigned playoutTimestamp, int64_t arrivalTime);
+  int64_t mediaTimeOffset(unsigned rtpTimestamp) const; // in microseconds, relative to "fPlayoutRefTimestamp"
+  Boolean frameIsDueForDelivery(BufferedPacket* firstPacket);
+  unsigned nextPlayoutTimestamp(int64_t& arrivalTime);
+  void notePlayoutTimestampUse(unsigned playoutTimestamp, unsigned frameTimestamp);
+  void updatePlayoutDelay();
+  static void playoutTimerHandler(void* clientData);
+
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
   Boolean fNeedDelivery;
   Boolean fPacketLossInFragmentedFrame;
   unsigned char* fSavedTo;
   unsigned fSavedMaxSize;
+  Boolean fDeliverFrameSlices;
+  FrameSlices* fFrameSlices;
+
+  // Used to implement an adaptive playout delay:
+  unsigned fReorderingThresholdTime; // as set by "setPacketReorderingThresholdTime()"
+  unsigned fMinPlayoutDelay, fMaxPlayoutDelay; // uSeconds; "fMaxPlayoutDelay" == 0 means: deliver frames immediately
+  Boolean fHavePlayoutReference;
+  unsigned fPlayoutRefTimestamp;
+  int64_t fPlayoutRefTime; // the earliest arrival time (in uSeconds) that we've seen for "fPlayoutRefTimestamp"
+  // Frames are scheduled in the order in which they're decoded (and sent), which - with reordered (e.g., 'B') frames -
+  // is not the order of their RTP timestamps.  The "n"th frame that we release is scheduled using the "n"th smallest
+  // timestamp (a 'playout timestamp'), which is not necessarily its own:
+  unsigned fLastPlayoutTimestamp; // the playout timestamp that we used for the most recently released frame
+  unsigned fLastFrameTimestamp; // that frame's own RTP timestamp
+  int64_t fLastFrameArrivalTime; // (or, if later, the time when we learned its turn)
+  unsigned fAheadTimestamps[MAX_REORDERED_PLAYOUT_FRAMES], fNumAheadTimestamps;
+      // the timestamps of frames that we released before their own timestamp's turn came
+  unsigned fUsedTimestamps[MAX_REORDERED_PLAYOUT_FRAMES], fNumUsedTimestamps;
+      // the timestamps of not-yet-released frames whose turn has already been taken (by an earlier frame)
+  TaskToken fPlayoutTask;
+  unsigned fHeldPlayoutTimestamp; // the playout timestamp of the frame that we're holding (if "fPlayoutTask" != NULL)
+  Boolean fCurFrameWasHeld;
+  PlayoutStats fPlayoutStats;
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
@@ -103,11 +163,14 @@ public:
 	   unsigned& bytesUsed, unsigned& bytesTruncated,
 	   unsigned short& rtpSeqNo, unsigned& rtpTimestamp,
 	   struct timeval& presentationTime,
-	   Boolean& hasBeenSyncedUsingRTCP, Boolean& rtpMarkerBit);
+	   Boolean& hasBeenSyncedUsingRTCP, Boolean& rtpMarkerBit,
+	   FrameSlices* toSlices = NULL);
+      // If "toSlices" is non-NULL, then the data is added to it as a slice (of our buffer), rather than copied to "to".
 
   BufferedPacket*& nextPacket() { return fNextPacket; }
 
   unsigned short rtpSeqNo() const { return fRTPSeqNo; }
+  unsigned rtpTimestamp() const { return fRTPTimestamp; }
   struct timeval const& timeReceived() const { return fTimeReceived; }
 
   unsigned char* data() const { return &fBuf[fHead]; }
@@ -126,12 +189,27 @@ protected:
 					      unsigned& frameSize,
 					      unsigned& frameDurationInMicroseconds);
 
-  unsigned fPacketSize;
-  unsigned char* fBuf;
+  unsigned fPacketSize; // the maximum size of the packet (including any space reserved in front of "fHead")
+  unsigned char* fBuf; // NULL until the first call to "fillInData()"
   unsigned fHead;
   unsigned fTail;
 
 private:
+  friend class FrameSlices;
+  friend class ReorderingPacketBuffer;
+  void reallocateBuffer(unsigned newSize, unsigned numBytesToKeep);
+  void addReference() { ++fRefCount; }
+  void removeReference();
+  Boolean isReferenced() const { return fRefCount > 0; }
+  void orphan() { fIsOrphaned = True; }
+      // called instead of deleting (or reusing) a packet that's still referenced by "FrameSlices";
+      // we then delete ourself when our last reference is removed
+
+private:
+  PacketBufferPool* fPool; // the source of "fBuf"
+  unsigned fBufferSize; // the allocated size of "fBuf" (<= "fPacketSize")
+  unsigned fRefCount; // the number of "FrameSlices" slices that refer to our data
+  Boolean fIsOrphaned;
   BufferedPacket* fNextPacket; // used to link together packets
 
   unsigned fUseCount;
@@ -144,6 +222,37 @@ private:
   struct timeval fTimeReceived;
 };
 
+// A list of slices - each part of the data of a "BufferedPacket" - that together make up a frame.
+// Each slice holds a reference to its packet, so the data remains valid for as long as the slice does.
+
+class FrameSlices {
+public:
+  FrameSlices();
+  virtual ~FrameSlices();
+
+  unsigned numSlices() const { return fNumSlices; }
+  unsigned char* sliceData(unsigned i) const { return fSlices[i].data; }
+  unsigned sliceSize(unsigned i) const { return fSlices[i].size; }
+  unsigned totalSize() const { return fTotalSize; }
+
+  void addSlice(BufferedPacket* packet, unsigned char* data, unsigned size);
+  void assign(FrameSlices const& from); // makes us a copy of "from" (with our own references to its packets)
+  void reset(); // removes all slices, releasing our references to their packets
+
+private:
+  FrameSlices(FrameSlices const&); // not implemented; use "assign()" instead
+
+private:
+  struct Slice {
+    BufferedPacket* packet;
+    unsigned char* data;
+    unsigned size;
+  };
+  Slice* fSlices;
+  unsigned fNumSlices, fMaxNumSlices;
+  unsigned fTotalSize;
+};
+
 // A 'factory' class for creating "BufferedPacket" objects.
 // If you want to subclass "BufferedPacket", then you'll also
 // want to subclass this, to redefine createNewPacket()
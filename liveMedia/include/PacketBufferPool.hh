@@ -0,0 +1,96 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A pool of incoming packet buffers, shared by all RTP sources in an environment.
+// Buffers come in a few fixed size classes, each allocated from 'slabs' of several buffers at a time.
+// C++ header
+
+#ifndef _PACKET_BUFFER_POOL_HH
+#define _PACKET_BUFFER_POOL_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+#ifndef PACKET_BUFFER_POOL_MTU_BUFFER_SIZE
+#define PACKET_BUFFER_POOL_MTU_BUFFER_SIZE 2048 // enough for any packet that fits in an Ethernet frame
+#endif
+#ifndef PACKET_BUFFER_POOL_JUMBO_BUFFER_SIZE
+#define PACKET_BUFFER_POOL_JUMBO_BUFFER_SIZE 10240 // enough for any packet that fits in a 9000-byte 'jumbo' frame
+#endif
+#ifndef PACKET_BUFFER_POOL_NUM_BUFFERS_PER_SLAB
+#define PACKET_BUFFER_POOL_NUM_BUFFERS_PER_SLAB 16
+#endif
+#define PACKET_BUFFER_POOL_MAX_PACKET_SIZE 65536
+
+class PacketBufferPool {
+public:
+  static PacketBufferPool* ourPool(UsageEnvironment& env, Boolean createIfNotPresent = True);
+      // returns the pool for this environment (creating it, if necessary and requested)
+
+  enum SizeClass { mtuSizeClass, jumboSizeClass, oversizeSizeClass, numSizeClasses };
+      // Buffers in the 'oversize' class are allocated (and deleted) individually, rather than from slabs.
+
+  static SizeClass sizeClassFor(unsigned size);
+
+  unsigned char* allocate(unsigned size, unsigned& resultBufferSize);
+      // Returns a buffer of at least "size" (<= PACKET_BUFFER_POOL_MAX_PACKET_SIZE) bytes
+  void release(unsigned char* buffer, unsigned bufferSize);
+      // "bufferSize" must be the value that was returned by "allocate()".
+
+  void incrementReferenceCount() { ++fReferenceCount; }
+  void decrementReferenceCount();
+      // Each RTP source - and each packet that has a buffer from the pool - holds a reference to the pool.
+      // The pool stays in existence (even when all of its buffers are free) until its last reference goes away.
+      // (It's not deleted merely because its last buffer is released.)
+
+  unsigned char* scratchBuffer() const { return fScratchBuffer; }
+      // A PACKET_BUFFER_POOL_MAX_PACKET_SIZE-byte buffer that receives whatever part of an incoming datagram doesn't fit
+      // in the (smaller) buffer that it's being read into - to then be copied into a bigger buffer.  Its contents are valid
+      // only until control returns to the event loop.
+
+  // Usage statistics, for each size class:
+  struct SizeClassStats {
+    unsigned bufferSize; // 0 for the 'oversize' class (whose buffers vary in size)
+    unsigned numBuffersInUse;
+    unsigned maxNumBuffersInUse;
+    unsigned numBuffersAllocated; // the total number of buffers in our slabs (in use or free); 0 for the 'oversize' class
+    u_int64_t numAllocations;
+  };
+  SizeClassStats const& stats(SizeClass sizeClass) const { return fClasses[sizeClass].stats; }
+
+protected:
+  PacketBufferPool(UsageEnvironment& env);
+  virtual ~PacketBufferPool();
+
+private:
+  void addSlab(SizeClass sizeClass);
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned char* fScratchBuffer;
+  unsigned fReferenceCount;
+  unsigned fNumBuffersInUse; // in all size classes
+
+  struct SizeClassRecord {
+    SizeClassStats stats;
+    unsigned char* freeBuffers; // a list; each free buffer begins with a pointer to the next one
+    unsigned char* slabs; // a list; each slab begins with a pointer to the next one
+  } fClasses[numSizeClasses];
+};
+
+#endif
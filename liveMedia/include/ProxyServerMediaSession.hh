@@ -120,6 +120,12 @@ public:
   Boolean describeCompletedSuccessfully() const { return fClientMediaSession != NULL; }
     // This can be used - along with "describeCompletdFlag" - to check whether the back-end "DESCRIBE" completed *successfully*.
 
+  void setAdaptivePlayoutDelay(unsigned minDelayUSecs, unsigned maxDelayUSecs) {
+    fMinPlayoutDelay = minDelayUSecs; fMaxPlayoutDelay = maxDelayUSecs;
+  }
+    // Asks the back-end streams' "RTPSource"s to smooth out the network's jitter before we re-send their frames.
+    // (See "RTPSource::setAdaptivePlayoutDelay()".)  This affects only streams that are set up after it is called.
+
 protected:
   ProxyServerMediaSession(UsageEnvironment& env, GenericMediaServer* ourMediaServer,
 			  char const* inputStreamURL, char const* streamName,
@@ -163,6 +169,7 @@ private:
   MediaTranscodingTable* fTranscodingTable;
   portNumBits fInitialPortNum;
   Boolean fMultiplexRTCPWithRTP;
+  unsigned fMinPlayoutDelay, fMaxPlayoutDelay; // uSeconds
 };
 
 
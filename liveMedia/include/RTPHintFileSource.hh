@@ -0,0 +1,89 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// A source that reads the pre-built RTP packet payloads from an 'RTP hint' file
+// (delivering each as a separate frame, for streaming by a "HintedRTPSink").
+// C++ header
+
+#ifndef _RTP_HINT_FILE_SOURCE_HH
+#define _RTP_HINT_FILE_SOURCE_HH
+
+#ifndef _FRAMED_FILE_SOURCE_HH
+#include "FramedFileSource.hh"
+#endif
+
+#ifndef RTP_HINT_FILE_SOURCE_BUFFER_SIZE
+#define RTP_HINT_FILE_SOURCE_BUFFER_SIZE 262144 // must be at least 65535 + 12 (the largest possible record)
+#endif
+
+class RTPHintFileSource: public FramedFileSource {
+public:
+  static RTPHintFileSource* createNew(UsageEnvironment& env, char const* fileName);
+
+  // The parameters of the 'RTPSink' that made the file:
+  unsigned char rtpPayloadType() const { return fRTPPayloadType; }
+  unsigned rtpTimestampFrequency() const { return fRTPTimestampFrequency; }
+  unsigned numChannels() const { return fNumChannels; }
+  char const* sdpMediaType() const { return fSDPMediaType; }
+  char const* rtpPayloadFormatName() const { return fRTPPayloadFormatName; }
+  char const* auxSDPLine() const { return fAuxSDPLine; } // may be NULL
+  float duration() const { return fFileDurationInMicroseconds/1000000.0f; } // in seconds
+  u_int64_t numRecordBytes() const { return fRecordsEnd - fRecordsStart; } // the packet records' total size
+
+  void setDeliverByReference(Boolean deliverByReference) { fDeliverByReference = deliverByReference; }
+      // If set, then we deliver no data to "fTo"; instead, each packet's payload is left in our buffer,
+      // as described by "curPayload()" and "curPayloadSize()" (until the next frame is requested from us).
+  unsigned char* curPayload() const { return fCurPayload; }
+  unsigned curPayloadSize() const { return fCurPayloadSize; }
+  Boolean curPacketHasMarkerBit() const { return fCurPacketHasMarkerBit; }
+
+private:
+  RTPHintFileSource(UsageEnvironment& env, FILE* fid,
+		    unsigned char rtpPayloadType, unsigned rtpTimestampFrequency, unsigned numChannels,
+		    u_int64_t fileDurationInMicroseconds, u_int64_t recordsEnd,
+		    char* sdpMediaType, char* rtpPayloadFormatName, char* auxSDPLine);
+      // called only by createNew()
+  virtual ~RTPHintFileSource();
+
+  Boolean ensureBufferedBytes(unsigned numBytes);
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  unsigned char fRTPPayloadType;
+  unsigned fRTPTimestampFrequency;
+  unsigned fNumChannels;
+  u_int64_t fFileDurationInMicroseconds;
+  u_int64_t fRecordsStart, fRecordsEnd; // file offsets
+  u_int64_t fNumUnreadRecordBytes; // not yet read from the file into our buffer
+  char* fSDPMediaType;
+  char* fRTPPayloadFormatName;
+  char* fAuxSDPLine;
+
+  unsigned char* fBuffer;
+  unsigned fBufferHead, fBufferTail; // the unused data in our buffer
+  struct timeval fPresentationTimeBase;
+  Boolean fHaveStarted;
+
+  Boolean fDeliverByReference;
+  unsigned char* fCurPayload;
+  unsigned fCurPayloadSize;
+  Boolean fCurPacketHasMarkerBit;
+};
+
+#endif
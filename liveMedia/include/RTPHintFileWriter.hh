@@ -0,0 +1,63 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2015 Live Networks, Inc.  All rights reserved.
+// An object that writes the packets built by a "MultiFramedRTPSink" to an 'RTP hint' file,
+// so that they can later be streamed (using "RTPHintFileSource" and "HintedRTPSink")
+// without re-parsing (or re-packetizing) the original media.
+// C++ header
+
+#ifndef _RTP_HINT_FILE_WRITER_HH
+#define _RTP_HINT_FILE_WRITER_HH
+
+#ifndef _MULTI_FRAMED_RTP_SINK_HH
+#include "MultiFramedRTPSink.hh"
+#endif
+
+class RTPHintFileWriter: public Medium {
+public:
+  static RTPHintFileWriter* createNew(UsageEnvironment& env, char const* fileName,
+				      MultiFramedRTPSink& sink);
+      // Each packet that "sink" subsequently builds will be written to "fileName", rather than sent.
+      // (The sink then plays as fast as its source can deliver data.)  The file is completed - using "sink"'s
+      // SDP parameters - when we're closed, so close us after "sink" has finished playing, but before closing "sink".
+
+  unsigned numPacketsWritten() const { return fNumPacketsWritten; }
+
+protected:
+  RTPHintFileWriter(UsageEnvironment& env, FILE* fid, MultiFramedRTPSink& sink);
+      // called only by createNew()
+  virtual ~RTPHintFileWriter();
+
+private:
+  static void capturePacket(void* clientData,
+			    unsigned char const* packet, unsigned packetSize,
+			    unsigned char const* externalPayload, unsigned externalPayloadSize,
+			    unsigned uSecondsToNextPacket);
+  void capturePacket1(unsigned char const* packet, unsigned packetSize,
+		      unsigned char const* externalPayload, unsigned externalPayloadSize,
+		      unsigned uSecondsToNextPacket);
+  void writeString(char const* str);
+
+private:
+  FILE* fFid;
+  MultiFramedRTPSink& fSink;
+  unsigned fNumPacketsWritten;
+  u_int32_t fFirstRTPTimestamp;
+  u_int64_t fTotalDurationInMicroseconds;
+};
+
+#endif
@@ -67,6 +67,10 @@ public:
   static void clearServerRequestAlternativeByteHandler(UsageEnvironment& env, int socketNum);
 
   Boolean sendPacket(unsigned char* packet, unsigned packetSize);
+  Boolean sendPacket(unsigned char* header, unsigned headerSize,
+		     unsigned char* payload, unsigned payloadSize);
+      // Sends a packet that consists of "header" followed by "payload" (e.g., a RTP header, followed by
+      // payload data that is stored elsewhere), without (if possible) first copying them together.
   void startNetworkReading(TaskScheduler::BackgroundHandlerProc*
                            handlerProc);
   Boolean handleRead(unsigned char* buffer, unsigned bufferMaxSize,
@@ -81,6 +85,16 @@ public:
   // Otherwise (if "tcpSocketNum" >= 0), the packet was received (interleaved) over TCP, and
   //   "tcpStreamChannelId" will return the channel id.
 
+  Boolean nextReadIsFromTCP() const { return fNextTCPReadStreamSocketNum >= 0; }
+  unsigned nextTCPReadSize() const { return fNextTCPReadSize; }
+      // If "nextReadIsFromTCP()", then the size of the (rest of the) packet that "handleRead()" will read
+  Boolean handleRead(unsigned char* buffer1, unsigned buffer1MaxSize,
+		     unsigned char* buffer2, unsigned buffer2MaxSize,
+		     // out parameters:
+		     unsigned& bytesRead, struct sockaddr_in& fromAddress);
+      // A version of "handleRead()" - used only if not "nextReadIsFromTCP()" - that reads a packet (from our
+      // 'groupsock') into "buffer1", and then (any data that doesn't fit) into "buffer2".
+
   void stopNetworkReading();
 
   UsageEnvironment& envir() const { return fOwner->envir(); }
@@ -99,8 +113,13 @@ public:
 private:
   // Helper functions for sending a RTP or RTCP packet over a TCP connection:
   Boolean sendRTPorRTCPPacketOverTCP(unsigned char* packet, unsigned packetSize,
-				     int socketNum, unsigned char streamChannelId);
+				     int socketNum, unsigned char streamChannelId,
+				     unsigned char* packetRemainder = NULL, unsigned packetRemainderSize = 0);
   Boolean sendDataOverTCP(int socketNum, u_int8_t const* data, unsigned dataSize, Boolean forceSendToSucceed);
+  Boolean sendFramedDataOverTCP(int socketNum, u_int8_t const* header, unsigned headerSize,
+				u_int8_t const* data, unsigned dataSize,
+				u_int8_t const* data2 = NULL, unsigned data2Size = 0);
+    // sends "header" followed by "data" (and "data2", if any), using a single system call where possible
 
 private:
   friend class SocketDescriptor;
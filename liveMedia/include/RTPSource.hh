@@ -44,6 +44,11 @@ public:
   Groupsock* RTPgs() const { return fRTPInterface.gs(); }
 
   virtual void setPacketReorderingThresholdTime(unsigned uSeconds) = 0;
+  virtual void setAdaptivePlayoutDelay(unsigned minDelayUSecs, unsigned maxDelayUSecs);
+      // Asks the source to hold each incoming frame until a 'playout time' that's computed from its RTP timestamp plus a
+      // delay that adapts (between "minDelayUSecs" and "maxDelayUSecs") to the stream's measured jitter - so that frames
+      // are delivered at an even rate, rather than in bursts.  "maxDelayUSecs" == 0 (the default) means: don't do this.
+      // (The default implementation of this function does nothing.)
 
   // used by RTCP:
   u_int32_t SSRC() const { return fSSRC; }
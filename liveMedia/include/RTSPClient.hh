@@ -293,6 +293,8 @@ private:
   char const* sessionURL(MediaSession const& session) const;
   static void handleAlternativeRequestByte(void*, u_int8_t requestByte);
   void handleAlternativeRequestByte1(u_int8_t requestByte);
+  static void takeBackInputSocket(void* rtspClient);
+  void takeBackInputSocket1();
   void constructSubsessionURL(MediaSubsession const& subsession,
 			      char const*& prefix,
 			      char const*& separator,
@@ -336,6 +338,8 @@ private:
   unsigned fSessionTimeoutParameter; // optionally set in response "Session:" headers
   char* fResponseBuffer;
   unsigned fResponseBytesAlreadySeen, fResponseBufferBytesLeft;
+  TaskToken fTakeBackInputSocketTask; // non-NULL while the input socket is being handed back to us
+  unsigned fNumHandedBackBytes; // data already read from the input socket (by its previous handler), but not handled
   RequestQueue fRequestsAwaitingConnection, fRequestsAwaitingHTTPTunneling, fRequestsAwaitingResponse;
 
   // Support for tunneling RTSP-over-HTTP:
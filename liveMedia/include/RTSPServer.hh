@@ -177,6 +177,8 @@ public: // should be protected, but some old compilers complain otherwise
     void closeSocketsRTSP();
     static void handleAlternativeRequestByte(void*, u_int8_t requestByte);
     void handleAlternativeRequestByte1(u_int8_t requestByte);
+    static void takeBackInputSocket(void* instance);
+    void takeBackInputSocket1();
     Boolean authenticationOK(char const* cmdName, char const* urlSuffix, char const* fullRequestStr);
     void changeClientInputSocket(int newSocketNum, unsigned char const* extraData, unsigned extraDataSize);
       // used to implement RTSP-over-HTTP tunneling
@@ -199,6 +201,8 @@ public: // should be protected, but some old compilers complain otherwise
     Authenticator fCurrentAuthenticator; // used if access control is needed
     char* fOurSessionCookie; // used for optional RTSP-over-HTTP tunneling
     unsigned fBase64RemainderCount; // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3)
+    TaskToken fTakeBackInputSocketTask; // non-NULL while the input socket is being handed back to us
+    unsigned fNumHandedBackBytes; // data already read from the input socket (by its previous handler), but not handled
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
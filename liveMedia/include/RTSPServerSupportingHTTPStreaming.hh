@@ -39,6 +39,10 @@ public:
 
   Boolean setHTTPPort(Port httpPort) { return setUpTunnelingOverHTTP(httpPort); }
 
+  void setZeroCopyStreaming(Boolean zeroCopyStreaming = True) { fZeroCopyStreaming = zeroCopyStreaming; }
+      // If set, we try to stream (Transport Stream) data over HTTP without the kernel copying it.
+      // (See "TCPStreamSink::enableZeroCopySends()".)
+
 protected:
   RTSPServerSupportingHTTPStreaming(UsageEnvironment& env,
 				    int ourSocket, Port ourPort,
@@ -68,6 +72,9 @@ public: // should be protected, but some old compilers complain otherwise
     ByteStreamMemoryBufferSource* fPlaylistSource;
     TCPStreamSink* fTCPSink;
   };
+
+private:
+  Boolean fZeroCopyStreaming;
 };
 
 #endif
@@ -26,6 +26,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 #define TCP_STREAM_SINK_BUFFER_SIZE 10000
+#ifndef TCP_STREAM_SINK_ZERO_COPY_BUFFER_SIZE
+#define TCP_STREAM_SINK_ZERO_COPY_BUFFER_SIZE 1000000
+#endif
 
 class TCPStreamSink: public MediaSink {
 public:
@@ -33,6 +36,15 @@ public:
   // "socketNum" is the socket number of an existing, writable TCP socket (which should be non-blocking).
   // The caller is responsible for closing this socket later (when this object no longer exists).
 
+  Boolean enableZeroCopySends();
+  // Optionally, called (before "startPlaying()") to have data written to the socket without it being copied
+  // into the kernel, using "MSG_ZEROCOPY".  (This is worthwhile only for high-bitrate streams.)
+  // Our (larger) buffers are then reused only once the kernel has told us that it has released them.
+  // (If we're deleted before then, they're freed later, once the kernel has released them.)
+  // Returns False - and leaves us unchanged - if zero-copy sending is not supported on this OS or socket.
+
+  virtual void stopPlaying(); // redefined virtual function
+
 protected:
   TCPStreamSink(UsageEnvironment& env, int socketNum); // called only by "createNew()"
   virtual ~TCPStreamSink();
@@ -54,14 +66,31 @@ private:
   static void ourOnSourceClosure(void* clientData);
   void ourOnSourceClosure1();
 
+  // Used to implement zero-copy sending:
+  Boolean resetBufferIfReleased(); // returns True iff our buffer could be reset to empty
+  static void zeroCopyCompletionHandler(void* clientData, int mask);
+  void zeroCopyCompletionHandler1();
+  static void zeroCopyCompletionRecheckHandler(void* clientData);
+
   unsigned numUnwrittenBytes() const { return fUnwrittenBytesEnd - fUnwrittenBytesStart; }
-  unsigned freeBufferSpace() const { return TCP_STREAM_SINK_BUFFER_SIZE - fUnwrittenBytesEnd; }
+  unsigned freeBufferSpace() const { return fBufferSize - fUnwrittenBytesEnd; }
 
 private:
-  unsigned char fBuffer[TCP_STREAM_SINK_BUFFER_SIZE];
+  unsigned char fStaticBuffer[TCP_STREAM_SINK_BUFFER_SIZE];
+  unsigned char* fBuffer; // either "fStaticBuffer", or one of "fZeroCopyBuffer[]"
+  unsigned fBufferSize;
   unsigned fUnwrittenBytesStart, fUnwrittenBytesEnd;
   Boolean fInputSourceIsOpen, fOutputSocketIsWritable;
   int fOutputSocketNum;
+
+  // Zero-copy sending state (used only if "enableZeroCopySends()" succeeded).  We alternate between two
+  // buffers, so that we can fill one while the kernel may still be using the other:
+  Boolean fZeroCopyIsEnabled;
+  int fZeroCopyCompletionSocketNum; // our duplicate of "fOutputSocketNum", used to wait for send completions
+  unsigned char* fZeroCopyBuffer[2];
+  u_int32_t fZeroCopyBufferSendCount[2]; // the value of "fNumZeroCopySends" after the last send from each buffer
+  unsigned fCurZeroCopyBufferIndex;
+  u_int32_t fNumZeroCopySends, fNumZeroCopySendsCompleted;
 };
 
 #endif
@@ -48,11 +48,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "SimpleRTPSink.hh"
 #include "uLawAudioFilter.hh"
 #include "MPEG2IndexFromTransportStream.hh"
+#include "MPEG2TransportStreamIndexGenerator.hh"
 #include "MPEG2TransportStreamTrickModeFilter.hh"
+#include "MPEG2TransportStreamTrickPlayTrack.hh"
 #include "ByteStreamMultiFileSource.hh"
 #include "ByteStreamMemoryBufferSource.hh"
 #include "BasicUDPSource.hh"
 #include "SimpleRTPSource.hh"
+#include "PacketBufferPool.hh"
 #include "MPEG1or2AudioRTPSource.hh"
 #include "MPEG4LATMAudioRTPSource.hh"
 #include "MPEG4LATMAudioRTPSink.hh"
@@ -71,6 +74,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG2TransportStreamFromPESSource.hh"
 #include "MPEG2TransportStreamFromESSource.hh"
 #include "MPEG2TransportStreamFramer.hh"
+#include "MPEG2TransportStreamDemuxedElementaryStream.hh"
 #include "ADTSAudioFileSource.hh"
 #include "H261VideoRTPSource.hh"
 #include "H263plusVideoRTPSource.hh"
@@ -126,5 +130,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MatroskaFileServerDemux.hh"
 #include "OggFileServerDemux.hh"
 #include "ProxyServerMediaSession.hh"
+#include "RTPHintFileWriter.hh"
+#include "HintedRTPSink.hh"
+#include "RTPHintFileServerMediaSubsession.hh"
 
 #endif
@@ -203,6 +203,13 @@ static ServerMediaSession* createNewSMS(UsageEnvironment& env,
 
     NEW_SMS("DV Video");
     sms->addSubsession(DVVideoFileServerMediaSubsession::createNew(env, fileName, reuseSource));
+  } else if (strcmp(extension, ".rtph") == 0) {
+    // Assumed to be an 'RTP hint' file (made by "RTPHintFileGenerator"), whose packets we stream as is
+    ServerMediaSubsession* smss = RTPHintFileServerMediaSubsession::createNew(env, fileName, reuseSource);
+    if (smss != NULL) {
+      NEW_SMS("RTP hint file");
+      sms->addSubsession(smss);
+    }
   } else if (strcmp(extension, ".mkv") == 0 || strcmp(extension, ".webm") == 0) {
     // Assumed to be a Matroska file (note that WebM ('.webm') files are also Matroska files)
     OutPacketBuffer::maxSize = 100000; // allow for some possibly large VP8 or VP9 frames
@@ -22,18 +22,29 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include <liveMedia.hh>
 #include <BasicUsageEnvironment.hh>
-
-void afterPlaying(void* clientData); // forward
+#include <GroupsockHelper.hh> // for "gettimeofday()"
+#include <InputFile.hh> // for "GetFileSize()"
 
 UsageEnvironment* env;
 char const* programName;
+char const* inputFileName;
+MPEG2TransportStreamIndexGenerator* indexGenerator;
+
+// When 'following' a file that's still being written, we stop once it hasn't grown for this long:
+#define FOLLOW_TIMEOUT_SECONDS 10
 
 void usage() {
-  *env << "usage: " << programName << " <transport-stream-file-name>\n";
+  *env << "usage: " << programName << " [-t <num-threads>] [-f] <transport-stream-file-name>\n";
   *env << "\twhere <transport-stream-file-name> ends with \".ts\"\n";
+  *env << "\t-t <num-threads>: the number of threads to use (default: one per CPU)\n";
+  *env << "\t-f: 'follow' a file that's still being written (e.g., a recording), adding to the index as the file grows\n";
+  *env << "\t    (until the file has stopped growing for " << FOLLOW_TIMEOUT_SECONDS << " seconds)\n";
   exit(1);
 }
 
+void indexNewData(void* clientData); // forward
+void finish(); // forward
+
 int main(int argc, char const** argv) {
   // Begin by setting up our usage environment:
   TaskScheduler* scheduler = BasicTaskScheduler::createNew();
@@ -41,9 +52,23 @@ int main(int argc, char const** argv) {
 
   // Parse the command line:
   programName = argv[0];
+  unsigned numThreads = 0;
+  Boolean follow = False;
+  while (argc > 2) {
+    char const* const opt = argv[1];
+    if (strcmp(opt, "-t") == 0) {
+      if (sscanf(argv[2], "%u", &numThreads) != 1) usage();
+      ++argv; --argc;
+    } else if (strcmp(opt, "-f") == 0) {
+      follow = True;
+    } else {
+      usage();
+    }
+    ++argv; --argc;
+  }
   if (argc != 2) usage();
 
-  char const* inputFileName = argv[1];
+  inputFileName = argv[1];
   // Check whether the input file name ends with ".ts":
   int len = strlen(inputFileName);
   if (len < 4 || strcmp(&inputFileName[len-3], ".ts") != 0) {
@@ -52,39 +77,54 @@ int main(int argc, char const** argv) {
     usage();
   }
 
-  // Open the input file (as a 'byte stream file source'):
-  FramedSource* input
-    = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
-  if (input == NULL) {
-    *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
-    exit(1);
-  }
-
-  // Create a filter that indexes the input Transport Stream data:
-  FramedSource* indexer
-    = MPEG2IFrameIndexFromTransportStream::createNew(*env, input);
-
   // The output file name is the same as the input file name, except with suffix ".tsx":
   char* outputFileName = new char[len+2]; // allow for trailing x\0
   sprintf(outputFileName, "%sx", inputFileName);
 
-  // Open the output file (for writing), as a 'file sink':
-  MediaSink* output = FileSink::createNew(*env, outputFileName);
-  if (output == NULL) {
-    *env << "Failed to open output file \"" << outputFileName << "\"\n";
+  // Create an index generator for the input file (this also creates the output file):
+  indexGenerator
+    = MPEG2TransportStreamIndexGenerator::createNew(*env, inputFileName, outputFileName, numThreads);
+  if (indexGenerator == NULL) {
+    *env << "Failed to open input file \"" << inputFileName
+	 << "\" (does it exist?), or output file \"" << outputFileName << "\"\n";
     exit(1);
   }
 
-  // Start playing, to generate the output index file:
   *env << "Writing index file \"" << outputFileName << "\"...";
-  output->startPlaying(*indexer, afterPlaying, NULL);
+  if (!follow) {
+    indexGenerator->indexNewData();
+    finish();
+  }
 
+  // Index the file as it grows (checking once per second):
+  indexNewData(NULL);
   env->taskScheduler().doEventLoop(); // does not return
 
   return 0; // only to prevent compiler warning
 }
 
-void afterPlaying(void* /*clientData*/) {
-  *env << "...done\n";
+void indexNewData(void* /*clientData*/) {
+  static struct timeval timeOfLastNewData;
+  static u_int64_t lastFileSize = 0;
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  // Note: We check whether the file has grown, rather than whether we got new index records, because
+  // a recording can grow for a long time (e.g., during a long frame, or with no video) without adding any:
+  u_int64_t fileSize = GetFileSize(inputFileName, NULL);
+  indexGenerator->indexNewData();
+  if (fileSize != lastFileSize || timeOfLastNewData.tv_sec == 0) {
+    lastFileSize = fileSize;
+    timeOfLastNewData = timeNow;
+  } else if (timeNow.tv_sec - timeOfLastNewData.tv_sec >= FOLLOW_TIMEOUT_SECONDS) {
+    finish();
+  }
+
+  env->taskScheduler().scheduleDelayedTask(1000000, indexNewData, NULL);
+}
+
+void finish() {
+  indexGenerator->finish();
+  *env << "...done (" << (unsigned)indexGenerator->numIndexRecords() << " index records)\n";
   exit(0);
 }
@@ -0,0 +1,124 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that reads an existing (indexed) MPEG-2 Transport Stream file, and generates - for each of
+// several scales - a precomputed 'trick play' track (and its index file).  Our RTSP server implementation
+// will then stream from these tracks (sequentially) when a client asks to play at one of these scales,
+// rather than seeking around the original file.
+// For this to work, the Transport Stream file's index file (made by "MPEG2TransportStreamIndexer")
+// must already be present.
+// main program
+
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+
+UsageEnvironment* env;
+char const* programName;
+char watchVariable;
+
+int const defaultScales[] = { -16, -8, -4, -2, 2, 4, 8, 16 };
+
+void usage() {
+  *env << "usage: " << programName << " <transport-stream-file-name> [<scale> ...]\n";
+  *env << "\twhere\t<transport-stream-file-name> ends with \".ts\"\n";
+  *env << "\t\t<scale> is an integer other than 0 or 1 (use a negative number for reverse play)\n";
+  *env << "\t\t(default scales: -16 -8 -4 -2 2 4 8 16)\n";
+  exit(1);
+}
+
+void afterPlaying(void* /*clientData*/) {
+  watchVariable = 1;
+}
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  programName = argv[0];
+  if (argc < 2) usage();
+
+  char const* inputFileName = argv[1];
+  // Check whether the input file name ends with ".ts":
+  int len = strlen(inputFileName);
+  if (len < 4 || strcmp(&inputFileName[len-3], ".ts") != 0) {
+    *env << "ERROR: input file name \"" << inputFileName
+	 << "\" does not end with \".ts\"\n";
+    usage();
+  }
+
+  int numScales = argc - 2;
+  int* scales = new int[numScales > 0 ? numScales : sizeof defaultScales/sizeof defaultScales[0]];
+  if (numScales == 0) {
+    numScales = sizeof defaultScales/sizeof defaultScales[0];
+    for (int i = 0; i < numScales; ++i) scales[i] = defaultScales[i];
+  } else {
+    for (int i = 0; i < numScales; ++i) {
+      if (sscanf(argv[i+2], "%d", &scales[i]) != 1 || scales[i] == 0 || scales[i] == 1) usage();
+    }
+  }
+
+  // Open the input file's index file (which has the same name, except with suffix ".tsx"):
+  char* indexFileName = new char[len+2]; // allow for trailing x\0
+  sprintf(indexFileName, "%sx", inputFileName);
+  MPEG2TransportStreamIndexFile* indexFile = MPEG2TransportStreamIndexFile::createNew(*env, indexFileName);
+  if (indexFile == NULL) {
+    *env << "Failed to open index file \"" << indexFileName << "\" (does it exist?  If not, first run \"MPEG2TransportStreamIndexer\")\n";
+    exit(1);
+  }
+  delete[] indexFileName;
+
+  for (int i = 0; i < numScales; ++i) {
+    char* trackFileName = MPEG2TransportStreamTrickPlayTrack::trackFileName(inputFileName, scales[i]);
+    char* trackIndexFileName = new char[strlen(trackFileName)+2]; // allow for trailing x\0
+    sprintf(trackIndexFileName, "%sx", trackFileName);
+
+    FramedSource* trackSource
+      = MPEG2TransportStreamTrickPlayTrack::createTrackGenerator(*env, inputFileName, indexFile, scales[i]);
+    MediaSink* trackSink = FileSink::createNew(*env, trackFileName);
+    if (trackSource == NULL || trackSink == NULL) {
+      *env << "Failed to open input file \"" << inputFileName << "\", or output file \"" << trackFileName << "\"\n";
+      exit(1);
+    }
+
+    // Write the track:
+    *env << "Writing track \"" << trackFileName << "\" (scale " << scales[i] << ")...";
+    watchVariable = 0;
+    trackSink->startPlaying(*trackSource, afterPlaying, NULL);
+    env->taskScheduler().doEventLoop(&watchVariable);
+    Medium::close(trackSink);
+    Medium::close(trackSource);
+
+    // Then index it (as a regular Transport Stream file):
+    MPEG2TransportStreamIndexGenerator* trackIndexGenerator
+      = MPEG2TransportStreamIndexGenerator::createNew(*env, trackFileName, trackIndexFileName);
+    if (trackIndexGenerator == NULL) {
+      *env << "Failed to create index file \"" << trackIndexFileName << "\"\n";
+      exit(1);
+    }
+    trackIndexGenerator->indexNewData();
+    trackIndexGenerator->finish();
+    *env << "...done (" << (unsigned)trackIndexGenerator->numIndexRecords() << " index records)\n";
+    Medium::close(trackIndexGenerator);
+
+    delete[] trackIndexFileName; delete[] trackFileName;
+  }
+
+  delete[] scales;
+  Medium::close(indexFile);
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// A program that reads an existing H.264 or H.265 Elementary Stream file, or MPEG-2 Transport Stream file,
+// and generates a separate 'RTP hint' file - containing the RTP packets that we'd send when streaming it.
+// Our RTSP server implementation can then stream the hint file without re-parsing the original media.
+// main program
+
+#include <liveMedia.hh>
+#include <BasicUsageEnvironment.hh>
+
+void afterPlaying(void* clientData); // forward
+
+UsageEnvironment* env;
+char const* programName;
+RTPSink* sink;
+RTPHintFileWriter* writer;
+
+void usage() {
+  *env << "usage: " << programName << " <input-file-name>\n";
+  *env << "\twhere <input-file-name> ends with \".264\", \".265\", or \".ts\"\n";
+  exit(1);
+}
+
+#define TRANSPORT_PACKETS_PER_NETWORK_PACKET 7
+// The product of these two numbers must be enough to fit within a network packet
+
+int main(int argc, char const** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  // Parse the command line:
+  programName = argv[0];
+  if (argc != 2) usage();
+
+  char const* inputFileName = argv[1];
+  char const* extension = strrchr(inputFileName, '.');
+  if (extension == NULL) usage();
+
+  // Nothing will actually be sent from this 'groupsock'; it's needed only to create the "RTPSink":
+  struct in_addr dummyAddress;
+  dummyAddress.s_addr = 0;
+  Groupsock dummyGroupsock(*env, dummyAddress, Port(0), 255);
+
+  // Create the appropriate source, framer, and "RTPSink" for the input file:
+  FramedSource* framer;
+  if (strcmp(extension, ".264") == 0 || strcmp(extension, ".265") == 0) {
+    FramedSource* input = ByteStreamFileSource::createNew(*env, inputFileName);
+    if (input == NULL) {
+      *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+      exit(1);
+    }
+
+    OutPacketBuffer::maxSize = 100000; // allow for some possibly large NAL units
+    if (strcmp(extension, ".264") == 0) {
+      framer = H264VideoStreamFramer::createNew(*env, input);
+      sink = H264VideoRTPSink::createNew(*env, &dummyGroupsock, 96);
+    } else {
+      framer = H265VideoStreamFramer::createNew(*env, input);
+      sink = H265VideoRTPSink::createNew(*env, &dummyGroupsock, 96);
+    }
+  } else if (strcmp(extension, ".ts") == 0) {
+    unsigned const inputDataChunkSize = TRANSPORT_PACKETS_PER_NETWORK_PACKET*TRANSPORT_PACKET_SIZE;
+    FramedSource* input = ByteStreamFileSource::createNew(*env, inputFileName, inputDataChunkSize);
+    if (input == NULL) {
+      *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+      exit(1);
+    }
+
+    framer = MPEG2TransportStreamFramer::createNew(*env, input);
+    sink = SimpleRTPSink::createNew(*env, &dummyGroupsock, 33, 90000, "video", "MP2T",
+				    1, True, False /*no 'M' bit*/);
+  } else {
+    usage();
+  }
+
+  // The output file name is the input file name, with ".rtph" appended (e.g., "test.ts" -> "test.ts.rtph"):
+  char* outputFileName = new char[strlen(inputFileName) + 6]; // allow for ".rtph\0"
+  sprintf(outputFileName, "%s.rtph", inputFileName);
+
+  // Capture each packet that the sink builds into the output file:
+  writer = RTPHintFileWriter::createNew(*env, outputFileName, *(MultiFramedRTPSink*)sink);
+  if (writer == NULL) {
+    *env << "Failed to open output file \"" << outputFileName << "\"\n";
+    exit(1);
+  }
+
+  // Start playing, to generate the output hint file:
+  *env << "Writing hint file \"" << outputFileName << "\"...";
+  sink->startPlaying(*framer, afterPlaying, NULL);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void afterPlaying(void* /*clientData*/) {
+  *env << "...done (" << writer->numPacketsWritten() << " packets)\n";
+
+  // Close the writer (which completes the hint file) before the sink that it's attached to:
+  Medium::close(writer);
+  exit(0);
+}
@@ -0,0 +1,220 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Compares "BitReader" with "BitVector" over random sequences of "getBits()", "get1Bit()", "skipBits()" and
+// "get_expGolomb()" calls (including reads past the end of the data), and checks se(v) decoding.  Then times both
+// readers on synthetic H.264 slice headers.
+// main program
+
+#include <BitVector.hh>
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_RANDOM_CASES 500000
+#define NUM_READS_PER_CASE 60
+#define NUM_SLICE_HEADERS 4096
+#define MAX_SLICE_HEADER_SIZE 64 // bytes
+
+// A simple bit writer, used to generate test data:
+class BitWriter {
+public:
+  BitWriter(unsigned char* buffer): fBuffer(buffer), fNumBits(0) {}
+
+  unsigned numBits() const { return fNumBits; }
+
+  void put1Bit(unsigned value) {
+    if (fNumBits%8 == 0) fBuffer[fNumBits/8] = 0;
+    if (value != 0) fBuffer[fNumBits/8] |= 0x80>>(fNumBits%8);
+    ++fNumBits;
+  }
+  void putBits(unsigned value, unsigned numBits) {
+    while (numBits-- > 0) put1Bit((value>>numBits)&1);
+  }
+  void put_expGolomb(unsigned value) { // ue(v)
+    unsigned const codeNum = value + 1;
+    unsigned numLeadingZeros = 0;
+    while ((codeNum>>numLeadingZeros) > 1) ++numLeadingZeros;
+    putBits(0, numLeadingZeros);
+    putBits(codeNum, numLeadingZeros+1);
+  }
+  void put_signedExpGolomb(int value) { // se(v)
+    put_expGolomb(value > 0 ? 2*value - 1 : -2*value);
+  }
+
+private:
+  unsigned char* fBuffer;
+  unsigned fNumBits;
+};
+
+static unsigned writeSliceHeader(unsigned char* buffer, unsigned i) {
+  // Writes (most of) the header of a H.264 P or B slice, with typical field values, and returns its size (in bits):
+  BitWriter w(buffer);
+  w.putBits(0x41, 8); // NAL unit header
+  w.put_expGolomb(nextRandom()%8160 < 8000 ? 0 : nextRandom()%8160); // first_mb_in_slice
+  unsigned const slice_type = i%3 == 0 ? 5 : 6;
+  w.put_expGolomb(slice_type);
+  w.put_expGolomb(0); // pic_parameter_set_id
+  w.putBits(i&0xFF, 8); // frame_num
+  w.putBits((2*i)&0xFF, 8); // pic_order_cnt_lsb
+  if (slice_type == 6) w.put1Bit(1); // direct_spatial_mv_pred_flag
+  w.put1Bit(nextRandom()&1); // num_ref_idx_active_override_flag
+  w.put_expGolomb(nextRandom()%4); // num_ref_idx_l0_active_minus1
+  if (slice_type == 6) w.put_expGolomb(nextRandom()%2); // num_ref_idx_l1_active_minus1
+  w.put1Bit(0); // ref_pic_list_modification_flag_l0
+  if (slice_type == 6) w.put1Bit(0); // ref_pic_list_modification_flag_l1
+  w.put1Bit(1); // adaptive_ref_pic_marking_mode_flag
+  w.put_expGolomb(nextRandom()%3); // memory_management_control_operation
+  if (nextRandom()%2) { w.put_expGolomb(nextRandom()%16); w.put_expGolomb(0); }
+  w.put_expGolomb(nextRandom()%3); // cabac_init_idc
+  w.put_signedExpGolomb((int)(nextRandom()%21) - 10); // slice_qp_delta
+  w.put_expGolomb(0); w.put_signedExpGolomb(-1); w.put_signedExpGolomb(1); // deblocking filter parameters
+  for (unsigned k = 0; k < 8; ++k) w.put_expGolomb(nextRandom()%300); // e.g., a "pred_weight_table()"
+  while (w.numBits()%8 != 0) w.put1Bit(1);
+
+  return w.numBits();
+}
+
+template <class Reader>
+static unsigned parseSliceHeader(Reader& r) {
+  // Reads the fields written by "writeSliceHeader()", and returns a hash of them:
+  unsigned hash = r.getBits(8);
+  hash += r.get_expGolomb();
+  unsigned const slice_type = r.get_expGolomb();
+  hash += slice_type;
+  hash += r.get_expGolomb();
+  hash += r.getBits(8);
+  hash += r.getBits(8);
+  if (slice_type == 6) hash += r.get1Bit();
+  hash += r.get1Bit();
+  hash += r.get_expGolomb();
+  if (slice_type == 6) hash += r.get_expGolomb();
+  hash += r.get1Bit();
+  if (slice_type == 6) hash += r.get1Bit();
+  hash += r.get1Bit();
+  hash += r.get_expGolomb();
+  for (unsigned k = 0; k < 13; ++k) hash = hash*31 + r.get_expGolomb();
+      // (The remaining fields are not all ue(v), but reading them as such still exercises the reader.)
+  return hash;
+}
+
+int main(int argc, char** argv) {
+  // First, check that the "BitReader" and the "BitVector" read the same values, and stay at the same bit index:
+  unsigned char data[64+16];
+  unsigned numFailures = 0;
+  for (unsigned i = 0; i < NUM_RANDOM_CASES; ++i) {
+    // Random data, in which (depending on the case) most bits - or even most bytes - are zero:
+    unsigned const density = i%4;
+    for (unsigned j = 0; j < sizeof data; ++j) {
+      u_int8_t const b = (u_int8_t)nextRandom();
+      data[j] = density == 0 ? b : density == 1 ? b&(u_int8_t)nextRandom()
+	: density == 2 ? (nextRandom()%8 == 0 ? b : 0) : (nextRandom()%64 == 0 ? b : 0);
+    }
+    unsigned const baseBitOffset = nextRandom()%24, totNumBits = nextRandom()%(8*48);
+    BitVector bv(data, baseBitOffset, totNumBits);
+    BitReader br(data, baseBitOffset, totNumBits);
+
+    for (unsigned j = 0; j < NUM_READS_PER_CASE; ++j) {
+      unsigned const kind = nextRandom()%6;
+      unsigned expected, result;
+      if (kind == 0) {
+	unsigned const numBits = nextRandom()%33;
+	Boolean const isUndefined = numBits == 32 && bv.numBitsRemaining() == 0;
+	    // (a "BitVector" then returns whatever happens to be in its (uninitialized) buffer)
+	expected = bv.getBits(numBits); result = br.getBits(numBits);
+	if (isUndefined) expected = result;
+      } else if (kind == 1) {
+	expected = bv.get1Bit(); result = br.get1Bit();
+      } else if (kind == 2) {
+	unsigned const numBits = nextRandom()%4 != 0 ? nextRandom()%20 : nextRandom()%200;
+	bv.skipBits(numBits); br.skipBits(numBits);
+	expected = result = 0;
+      } else {
+	unsigned const numBitsRemaining = bv.numBitsRemaining();
+	expected = bv.get_expGolomb(); result = br.get_expGolomb();
+	if (expected != result && numBitsRemaining > 32 && bv.numBitsRemaining() == 0 && result == 0xFFFFFFFF) {
+	  // There were >= 32 zero bits up to the end of the data, so the "BitVector" did a (undefined) 32-bit read
+	  // past the end:
+	  expected = result;
+	}
+      }
+
+      if (result != expected || br.curBitIndex() != bv.curBitIndex()) {
+	if (++numFailures <= 10) {
+	  fprintf(stderr, "FAILED: case %u, read %u (kind %u): %u (bit index %u); expected %u (bit index %u)\n",
+		  i, j, kind, result, br.curBitIndex(), expected, bv.curBitIndex());
+	}
+	break;
+      }
+    }
+  }
+
+  // Also check signed Exp-Golomb codes, which a "BitVector" can't read:
+  unsigned char* buffer = new unsigned char[NUM_SLICE_HEADERS*MAX_SLICE_HEADER_SIZE];
+  BitWriter w(buffer);
+  for (int value = -1000; value <= 1000; ++value) w.put_signedExpGolomb(value);
+  BitReader br(buffer, 0, w.numBits());
+  for (int value = -1000; value <= 1000; ++value) {
+    int const result = br.get_signedExpGolomb();
+    if (result != value) {
+      fprintf(stderr, "FAILED: se(v) %d was read as %d\n", value, result);
+      ++numFailures;
+      break;
+    }
+  }
+
+  if (numFailures > 0) return 1;
+  fprintf(stderr, "All %d cases gave the same results with a \"BitReader\" as with a \"BitVector\"\n", NUM_RANDOM_CASES);
+
+  // Finally, measure the time taken to parse slice headers (if wanted):
+  if (!measurementsAreWanted(argc, argv)) return 0;
+  unsigned headerSize[NUM_SLICE_HEADERS];
+  unsigned totNumBits = 0;
+  for (unsigned i = 0; i < NUM_SLICE_HEADERS; ++i) {
+    headerSize[i] = writeSliceHeader(&buffer[i*MAX_SLICE_HEADER_SIZE], i);
+    totNumBits += headerSize[i];
+  }
+
+  unsigned const numRepetitions = 400;
+  unsigned bvHash = 0, brHash = 0;
+  double const startTime = timeNow();
+  for (unsigned rep = 0; rep < numRepetitions; ++rep) {
+    for (unsigned i = 0; i < NUM_SLICE_HEADERS; ++i) {
+      BitVector bv(&buffer[i*MAX_SLICE_HEADER_SIZE], 0, headerSize[i]);
+      bvHash += parseSliceHeader(bv);
+    }
+  }
+  double const midTime = timeNow();
+  for (unsigned rep = 0; rep < numRepetitions; ++rep) {
+    for (unsigned i = 0; i < NUM_SLICE_HEADERS; ++i) {
+      br.setup(&buffer[i*MAX_SLICE_HEADER_SIZE], 0, headerSize[i]);
+      brHash += parseSliceHeader(br);
+    }
+  }
+  double const endTime = timeNow();
+  if (brHash != bvHash) {
+    fprintf(stderr, "FAILED: the slice headers were parsed differently\n");
+    return 1;
+  }
+
+  double const numHeaders = (double)numRepetitions*NUM_SLICE_HEADERS;
+  fprintf(stderr, "%d slice headers (%u bits each, on average): BitVector %.0f ns/header, BitReader %.0f ns/header\n",
+	  NUM_SLICE_HEADERS, totNumBits/NUM_SLICE_HEADERS,
+	  (midTime-startTime)/numHeaders*1e9, (endTime-midTime)/numHeaders*1e9);
+
+  return 0;
+}
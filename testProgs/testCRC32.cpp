@@ -0,0 +1,108 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Checks each CRC-32 implementation (bytewise, slicing-by-8 and - if the CPU has it - PCLMULQDQ) against the
+// standard check value and against each other, over random lengths, alignments, initial values and split
+// continuations.  Then reports the throughput of each, for inputs from 24 bytes to 64 KB.
+// main program
+
+#include <CRC32.hh>
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_RANDOM_CASES 200000
+#define MAX_DATA_LENGTH 70000
+
+typedef u_int32_t (crcFunc)(u_int8_t const* data, unsigned dataLength, u_int32_t initialValue);
+
+static double measure(crcFunc* func, u_int8_t const* data, unsigned dataLength) {
+  // Returns the throughput, in GB/s, over (at least) 0.2 seconds:
+  unsigned numIterations = 0;
+  u_int32_t result = 0;
+  double const startTime = timeNow();
+  double elapsed;
+  do {
+    for (unsigned i = 0; i < 1000; ++i) result ^= (*func)(data, dataLength, result);
+    numIterations += 1000;
+    elapsed = timeNow() - startTime;
+  } while (elapsed < 0.2);
+  if (result == 0x12345678) fprintf(stderr, " "); // (so that the computation can't be optimized away)
+
+  return (double)numIterations*dataLength/elapsed/1e9;
+}
+
+int main(int argc, char** argv) {
+  Boolean const haveCLMul = haveCarrylessMultiplyCRC();
+  u_int8_t* data = new u_int8_t[MAX_DATA_LENGTH + 64];
+  for (unsigned i = 0; i < MAX_DATA_LENGTH + 64; ++i) data[i] = (u_int8_t)nextRandom();
+
+  // First, check a known value:
+  u_int8_t const* check = (u_int8_t const*)"123456789";
+  if (calculateCRC(check, 9) != 0x0376E6E7 || calculateCRCBytewise(check, 9) != 0x0376E6E7
+      || calculateCRCSlicingBy8(check, 9) != 0x0376E6E7
+      || (haveCLMul && calculateCRCCarrylessMultiply(check, 9) != 0x0376E6E7)) {
+    fprintf(stderr, "FAILED: wrong CRC for \"123456789\"\n");
+    return 1;
+  }
+
+  // Then compare each implementation with the (simplest) bytewise one:
+  unsigned numFailures = 0;
+  for (unsigned i = 0; i < NUM_RANDOM_CASES; ++i) {
+    unsigned const dataLength = (i%4 == 0) ? nextRandom()%MAX_DATA_LENGTH : nextRandom()%300;
+    u_int8_t const* start = &data[nextRandom()%64];
+    u_int32_t const initialValue = (i%3 == 0) ? 0xFFFFFFFF : (i%3 == 1) ? 0 : nextRandom()^(nextRandom()<<16);
+
+    u_int32_t const expected = calculateCRCBytewise(start, dataLength, initialValue);
+    Boolean ok = calculateCRC(start, dataLength, initialValue) == expected
+      && calculateCRCSlicingBy8(start, dataLength, initialValue) == expected
+      && (!haveCLMul || calculateCRCCarrylessMultiply(start, dataLength, initialValue) == expected);
+
+    // Also check continuing a CRC over the same data, split in two:
+    unsigned const split = dataLength == 0 ? 0 : nextRandom()%dataLength;
+    ok = ok && calculateCRC(&start[split], dataLength - split, calculateCRC(start, split, initialValue)) == expected;
+
+    if (!ok) {
+      if (++numFailures <= 10) {
+	fprintf(stderr, "FAILED: length %u, offset %u, initial value 0x%08x\n",
+		dataLength, (unsigned)(start - data), initialValue);
+      }
+    }
+  }
+  if (numFailures > 0) {
+    fprintf(stderr, "%u of %u cases FAILED\n", numFailures, NUM_RANDOM_CASES);
+    return 1;
+  }
+  fprintf(stderr, "All %d cases gave the same CRC with each implementation%s\n", NUM_RANDOM_CASES,
+	  haveCLMul ? "" : " (PCLMULQDQ is not available on this CPU)");
+
+  // Finally, measure throughput (if wanted):
+  if (!measurementsAreWanted(argc, argv)) return 0;
+  unsigned const lengths[] = { 24, 188, 4096, 65536 };
+  fprintf(stderr, "Throughput (GB/s):\tbytewise\tslicing-by-8\tPCLMULQDQ\n");
+  for (unsigned i = 0; i < sizeof lengths/sizeof lengths[0]; ++i) {
+    fprintf(stderr, "%u bytes:\t\t%.2f\t\t%.2f", lengths[i],
+	    measure(calculateCRCBytewise, data, lengths[i]), measure(calculateCRCSlicingBy8, data, lengths[i]));
+    if (haveCLMul) {
+      fprintf(stderr, "\t\t%.2f\n", measure(calculateCRCCarrylessMultiply, data, lengths[i]));
+    } else {
+      fprintf(stderr, "\t\t-\n");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,30 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Common routines, used by the programs that are built by "make tests"
+// Interfaces
+
+#include <NetCommon.h>
+#include <Boolean.hh>
+
+extern u_int32_t nextRandom();
+    // Returns a 24-bit pseudo-random number.  (The sequence is the same each time that the program is run,
+    // so that any failure can be reproduced.)
+
+extern double timeNow(); // the current (wall clock) time, in seconds
+
+extern Boolean measurementsAreWanted(int argc, char** argv);
+    // Returns False iff the program was given the "-n" option, meaning: run the checks only (not the timings)
@@ -0,0 +1,151 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Tests "removeH264or5EmulationBytes()" and "addH264or5EmulationBytes()" against plain byte-at-a-time versions,
+// on random data that's rich in 0x00-0x03 bytes, with output buffers that may be too small.  Also checks that
+// escaped data contains no start code prefixes, and round-trips.  Then times both on a 4 KB SEI-like payload.
+// main program
+
+#include <liveMedia.hh>
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_RANDOM_CASES 300000
+#define MAX_DATA_SIZE 600
+#define OUTPUT_BUFFER_SIZE (2*MAX_DATA_SIZE)
+
+typedef unsigned (emulationFunc)(u_int8_t* to, unsigned toMaxSize, u_int8_t* from, unsigned fromSize);
+
+// The byte-at-a-time versions (the first being the original implementation of "removeH264or5EmulationBytes()"):
+static unsigned removeEmulationBytesBytewise(u_int8_t* to, unsigned toMaxSize, u_int8_t* from, unsigned fromSize) {
+  unsigned toSize = 0;
+  unsigned i = 0;
+  while (i < fromSize && toSize+1 < toMaxSize) {
+    if (i+2 < fromSize && from[i] == 0 && from[i+1] == 0 && from[i+2] == 3) {
+      to[toSize] = to[toSize+1] = 0;
+      toSize += 2;
+      i += 3;
+    } else {
+      to[toSize] = from[i];
+      toSize += 1;
+      i += 1;
+    }
+  }
+
+  return toSize;
+}
+
+static unsigned addEmulationBytesBytewise(u_int8_t* to, unsigned toMaxSize, u_int8_t* from, unsigned fromSize) {
+  unsigned toSize = 0;
+  unsigned numZeros = 0;
+  for (unsigned i = 0; i < fromSize; ++i) {
+    if (numZeros == 2 && from[i] <= 3) {
+      if (toSize == toMaxSize) return toSize;
+      to[toSize++] = 3;
+      numZeros = 0;
+    }
+    if (toSize == toMaxSize) return toSize;
+    to[toSize++] = from[i];
+    numZeros = from[i] == 0 ? numZeros+1 : 0;
+  }
+  if (fromSize > 0 && from[fromSize-1] == 0 && toSize < toMaxSize) to[toSize++] = 3;
+
+  return toSize;
+}
+
+static double measure(emulationFunc* func, u_int8_t* data, unsigned dataSize) {
+  // Returns the throughput, in MB/s (of input data), over (at least) 0.2 seconds:
+  static u_int8_t output[2*4096];
+  unsigned numIterations = 0;
+  unsigned result = 0;
+  double const startTime = timeNow();
+  double elapsed;
+  do {
+    for (unsigned i = 0; i < 1000; ++i) result += (*func)(output, sizeof output, data, dataSize);
+    numIterations += 1000;
+    elapsed = timeNow() - startTime;
+  } while (elapsed < 0.2);
+  if (result == 0x12345678) fprintf(stderr, " "); // (so that the computation can't be optimized away)
+
+  return (double)numIterations*dataSize/elapsed/1e6;
+}
+
+int main(int argc, char** argv) {
+  u_int8_t data[MAX_DATA_SIZE];
+  u_int8_t output[OUTPUT_BUFFER_SIZE], expected[OUTPUT_BUFFER_SIZE];
+
+  unsigned numFailures = 0;
+  for (unsigned i = 0; i < NUM_RANDOM_CASES; ++i) {
+    // Random data - for 3 cases in 4, made mostly of 0x00, 0x01, 0x02 and 0x03 bytes:
+    unsigned const dataSize = nextRandom()%MAX_DATA_SIZE;
+    for (unsigned j = 0; j < dataSize; ++j) {
+      unsigned const r = nextRandom()%16;
+      data[j] = i%4 == 0 || r >= 11 ? (u_int8_t)nextRandom() : r < 6 ? 0 : r < 9 ? 3 : (u_int8_t)(r-8);
+    }
+    // The output buffer may be too small, exactly the input size, or plenty big enough:
+    unsigned const toMaxSize
+      = i%3 == 0 ? nextRandom()%(2*dataSize+2) : i%3 == 1 ? dataSize : OUTPUT_BUFFER_SIZE;
+
+    // Compare each routine's output (including any bytes that it wrote beyond its result) with the bytewise one's:
+    memset(output, 0xEE, sizeof output); memset(expected, 0xEE, sizeof expected);
+    Boolean ok = removeH264or5EmulationBytes(output, toMaxSize, data, dataSize)
+	== removeEmulationBytesBytewise(expected, toMaxSize, data, dataSize)
+      && memcmp(output, expected, sizeof output) == 0;
+
+    memset(output, 0xEE, sizeof output); memset(expected, 0xEE, sizeof expected);
+    ok = ok && addH264or5EmulationBytes(output, toMaxSize, data, dataSize)
+	== addEmulationBytesBytewise(expected, toMaxSize, data, dataSize)
+      && memcmp(output, expected, sizeof output) == 0;
+
+    // Also check that - given enough room - the escaped data contains no "00 00 00", "00 00 01" or "00 00 02",
+    // doesn't end with 0x00, and gives back the original data when its emulation bytes are removed again:
+    unsigned const escapedSize = addH264or5EmulationBytes(output, sizeof output, data, dataSize);
+    for (unsigned j = 0; j+2 < escapedSize; ++j) {
+      if (output[j] == 0 && output[j+1] == 0 && output[j+2] <= 2) ok = False;
+    }
+    if (escapedSize > 0 && output[escapedSize-1] == 0) ok = False;
+    unsigned const unescapedSize = removeH264or5EmulationBytes(expected, sizeof expected, output, escapedSize);
+    ok = ok && unescapedSize >= dataSize && memcmp(expected, data, dataSize) == 0;
+	// (the result may have a trailing 0x03, if the data ended with 0x00)
+
+    if (!ok) {
+      if (++numFailures <= 10) {
+	fprintf(stderr, "FAILED: case %u: data size %u, output buffer size %u\n", i, dataSize, toMaxSize);
+      }
+    }
+  }
+  if (numFailures > 0) {
+    fprintf(stderr, "%u of %u cases FAILED\n", numFailures, NUM_RANDOM_CASES);
+    return 1;
+  }
+  fprintf(stderr, "All %d cases gave the same results as the bytewise routines, and round-tripped\n", NUM_RANDOM_CASES);
+
+  // Finally, measure throughput (if wanted), on a 4 KB SEI-like payload (random, with occasional
+  // 0x00 bytes), and that payload escaped:
+  if (!measurementsAreWanted(argc, argv)) return 0;
+  u_int8_t raw[4096], escaped[2*4096];
+  for (unsigned i = 0; i < sizeof raw; ++i) raw[i] = nextRandom()%20 == 0 ? 0 : (u_int8_t)nextRandom();
+  unsigned const escapedSize = addH264or5EmulationBytes(escaped, sizeof escaped, raw, sizeof raw);
+  fprintf(stderr, "Throughput (MB/s):\tbytewise\tcurrent\n");
+  fprintf(stderr, "remove (%u bytes):\t%.0f\t\t%.0f\n", escapedSize,
+	  measure(removeEmulationBytesBytewise, escaped, escapedSize), measure(removeH264or5EmulationBytes, escaped, escapedSize));
+  fprintf(stderr, "add (%u bytes):\t%.0f\t\t%.0f\n", (unsigned)sizeof raw,
+	  measure(addEmulationBytesBytewise, raw, sizeof raw), measure(addH264or5EmulationBytes, raw, sizeof raw));
+
+  return 0;
+}
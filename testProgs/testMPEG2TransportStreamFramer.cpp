@@ -0,0 +1,255 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Runs synthetic Transport Streams (with sparse or dense PCRs, and with missing sync bytes) through a
+// "MPEG2TransportStreamFramer", and compares its packet count, the packets that it delivers, and where it stops
+// for a PCR limit, with a simple packet-by-packet scan.  Then times the framer on data that's delivered in place.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "gettimeofday()"
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TS_PACKET_SIZE 188
+#define CHECK_STREAM_NUM_PACKETS 20000
+#define BENCHMARK_STREAM_NUM_PACKETS 2000 // small enough to stay in the CPU's cache
+#define PCR_TICKS_PER_PACKET 4060 // (in units of 1/27 MHz) i.e., about 10 Mbps
+
+// An environment that doesn't print messages (because the framer reports each missing sync byte):
+class QuietEnvironment: public BasicUsageEnvironment {
+public:
+  QuietEnvironment(TaskScheduler& taskScheduler): BasicUsageEnvironment(taskScheduler) {}
+
+  virtual UsageEnvironment& operator<<(char const* /*str*/) { return *this; }
+  virtual UsageEnvironment& operator<<(int /*i*/) { return *this; }
+  virtual UsageEnvironment& operator<<(unsigned /*u*/) { return *this; }
+  virtual UsageEnvironment& operator<<(double /*d*/) { return *this; }
+  virtual UsageEnvironment& operator<<(void* /*p*/) { return *this; }
+};
+
+// The Transport Stream:
+u_int8_t* tsData;
+unsigned tsNumPackets;
+
+static void generateStream(unsigned numPackets, unsigned pcrPeriod, unsigned badSyncBytePeriod) {
+  // Generates a stream in which PID 0x100 has a PCR about every "pcrPeriod" packets, and PID 0x101 has one
+  // about every 5*"pcrPeriod" packets, and (if "badSyncBytePeriod" is non-zero) every "badSyncBytePeriod"th
+  // packet is missing its sync byte.  Some packets have an adaptation field, but no PCR:
+  tsNumPackets = numPackets;
+  for (unsigned i = 0; i < numPackets; ++i) {
+    u_int8_t* pkt = &tsData[i*TS_PACKET_SIZE];
+    unsigned const pid = nextRandom()%6 == 0 ? 0x101 : 0x100;
+    pkt[0] = badSyncBytePeriod > 0 && i%badSyncBytePeriod == badSyncBytePeriod-1 ? 0x46 : 0x47;
+    pkt[1] = pid>>8; pkt[2] = (u_int8_t)pid;
+    for (unsigned j = 4; j < TS_PACKET_SIZE; ++j) {
+      u_int8_t const b = (u_int8_t)nextRandom();
+      pkt[j] = b == 0x47 ? 0x48 : b; // so that a missing sync byte can't be 'found' within a packet
+    }
+
+    if (nextRandom()%(pid == 0x100 ? pcrPeriod : 5*pcrPeriod) == 0) {
+      // A PCR:
+      u_int64_t const pcr = (u_int64_t)i*PCR_TICKS_PER_PACKET;
+      u_int64_t const pcrBase = pcr/300;
+      unsigned const pcrExtension = (unsigned)(pcr%300);
+      pkt[3] = 0x30; pkt[4] = 7; pkt[5] = 0x10;
+      pkt[6] = (u_int8_t)(pcrBase>>25); pkt[7] = (u_int8_t)(pcrBase>>17);
+      pkt[8] = (u_int8_t)(pcrBase>>9); pkt[9] = (u_int8_t)(pcrBase>>1);
+      pkt[10] = (u_int8_t)((pcrBase&1)<<7)|0x7E|(pcrExtension>>8); pkt[11] = (u_int8_t)pcrExtension;
+    } else if (nextRandom()%8 == 0) {
+      // An adaptation field (possibly empty), but no PCR:
+      pkt[3] = 0x30; pkt[4] = nextRandom()%2; pkt[5] &=~ 0x10;
+    } else {
+      pkt[3] = 0x10;
+    }
+    pkt[3] |= i%16; // continuity_counter
+  }
+}
+
+static double pcrOf(unsigned packetNum) {
+  // Returns the PCR (in seconds) in this packet, or -1.0 if it (or its sync byte) is missing:
+  u_int8_t const* pkt = &tsData[packetNum*TS_PACKET_SIZE];
+  if (pkt[0] != 0x47 || (pkt[3]&0x20) == 0 || pkt[4] == 0 || (pkt[5]&0x10) == 0) return -1.0;
+  return packetNum*(double)PCR_TICKS_PER_PACKET/27000000.0;
+}
+
+// A source that delivers the stream from memory.  (If the client asks for data to be put where it already is,
+// then it's delivered 'in place', without copying.):
+class MemorySource: public FramedSource {
+public:
+  MemorySource(UsageEnvironment& env): FramedSource(env), fPosition(0) {}
+
+  void rewind() { fPosition = 0; }
+
+private:
+  virtual void doGetNextFrame() {
+    unsigned const dataSize = tsNumPackets*TS_PACKET_SIZE;
+    if (fPosition >= dataSize) {
+      handleClosure();
+      return;
+    }
+    fFrameSize = fMaxSize < dataSize - fPosition ? fMaxSize : dataSize - fPosition;
+    if (fTo != &tsData[fPosition]) memcpy(fTo, &tsData[fPosition], fFrameSize);
+    fPosition += fFrameSize;
+    gettimeofday(&fPresentationTime, NULL);
+    afterGetting(this);
+  }
+
+private:
+  unsigned fPosition;
+};
+
+// The delivered data is checked against the stream as it arrives:
+u_int8_t* deliveryBuffer;
+unsigned nextPacketNum; // the next packet of the stream that we expect to be delivered
+Boolean deliveryIsOK, sourceHasClosed;
+
+static void afterGettingTSData(void* /*clientData*/, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+			       struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  if (frameSize%TS_PACKET_SIZE != 0) deliveryIsOK = False;
+  for (unsigned i = 0; i < frameSize/TS_PACKET_SIZE; ++i) {
+    // Each delivered packet should be the next packet of the stream, except that a packet with a missing sync byte
+    // is not delivered if it would begin the data:
+    u_int8_t const* pkt = &deliveryBuffer[i*TS_PACKET_SIZE];
+    while (nextPacketNum < tsNumPackets && tsData[nextPacketNum*TS_PACKET_SIZE] != 0x47
+	   && memcmp(pkt, &tsData[nextPacketNum*TS_PACKET_SIZE], TS_PACKET_SIZE) != 0) {
+      ++nextPacketNum;
+    }
+    if (nextPacketNum >= tsNumPackets || memcmp(pkt, &tsData[nextPacketNum*TS_PACKET_SIZE], TS_PACKET_SIZE) != 0) {
+      deliveryIsOK = False;
+      return;
+    }
+    ++nextPacketNum;
+  }
+}
+
+static void onTSClosure(void* /*clientData*/) {
+  sourceHasClosed = True;
+}
+
+// Reads the stream (of "tsNumPackets" packets) through a framer - into a buffer of "bufferNumPackets" packets - and
+// checks that its result is the same as a packet-at-a-time scan (with the same "pcrLimit"):
+static Boolean checkStream(UsageEnvironment& env, char const* description, unsigned bufferNumPackets, float pcrLimit) {
+  // First, the scan: We expect the framer to count each packet that has a sync byte, up to and including the first
+  // PCR that's beyond the limit (if any).  That PCR's buffer - and all data after it - should not be delivered.
+  // (With 1-packet buffers, a packet that's missing its sync byte leaves the framer with no sync byte at all in
+  // its data, so it gives up there.):
+  u_int64_t expectedTSPacketCount = 0;
+  unsigned cutOffPacketNum = tsNumPackets;
+  for (unsigned i = 0; i < tsNumPackets; ++i) {
+    if (tsData[i*TS_PACKET_SIZE] != 0x47) {
+      if (bufferNumPackets == 1) {
+	cutOffPacketNum = i;
+	break;
+      }
+      continue;
+    }
+    ++expectedTSPacketCount;
+    if (pcrLimit != 0.0 && pcrOf(i) > pcrLimit) {
+      cutOffPacketNum = i;
+      break;
+    }
+  }
+
+  // Then, read the stream:
+  MemorySource* source = new MemorySource(env);
+  MPEG2TransportStreamFramer* framer = MPEG2TransportStreamFramer::createNew(env, source);
+  if (pcrLimit != 0.0) framer->setPCRLimit(pcrLimit);
+  unsigned const bufferSize = bufferNumPackets*TS_PACKET_SIZE;
+  nextPacketNum = 0;
+  deliveryIsOK = True; sourceHasClosed = False;
+  while (!sourceHasClosed && deliveryIsOK) {
+    framer->getNextFrame(deliveryBuffer, bufferSize, afterGettingTSData, NULL, onTSClosure, NULL);
+  }
+  u_int64_t const tsPacketCount = framer->tsPacketCount();
+  Medium::close(framer); // also closes "source"
+
+  // Every packet before the cut-off point's buffer should have been delivered (but no packet after it):
+  Boolean ok = deliveryIsOK && tsPacketCount == expectedTSPacketCount
+    && nextPacketNum <= cutOffPacketNum && cutOffPacketNum < nextPacketNum + 2*bufferNumPackets;
+  if (cutOffPacketNum == tsNumPackets) ok = ok && nextPacketNum == tsNumPackets;
+  if (!ok) {
+    fprintf(stderr, "FAILED: %s, %u-packet buffers, PCR limit %.2f s: counted %lu packets (expected %lu); delivered %u packets%s, with cut-off at packet %u\n",
+	    description, bufferNumPackets, pcrLimit, (unsigned long)tsPacketCount, (unsigned long)expectedTSPacketCount,
+	    nextPacketNum, deliveryIsOK ? "" : " (then wrong data)", cutOffPacketNum);
+  }
+  return ok;
+}
+
+// Measures the framer's throughput (in GB/s) on the stream, with data delivered in place in buffers of
+// "bufferNumPackets" packets:
+static double measure(UsageEnvironment& env, unsigned bufferNumPackets) {
+  MemorySource* source = new MemorySource(env);
+  MPEG2TransportStreamFramer* framer = MPEG2TransportStreamFramer::createNew(env, source);
+  unsigned const bufferSize = bufferNumPackets*TS_PACKET_SIZE;
+  unsigned const dataSize = (tsNumPackets/bufferNumPackets)*bufferSize;
+  double numBytes = 0.0;
+  double const startTime = timeNow();
+  double elapsed;
+  do {
+    for (unsigned i = 0; i < 100; ++i) {
+      source->rewind();
+      for (unsigned offset = 0; offset < dataSize; offset += bufferSize) {
+	deliveryBuffer = &tsData[offset]; // so that we don't check the delivered data
+	framer->getNextFrame(&tsData[offset], bufferSize, afterGettingTSData, NULL, onTSClosure, NULL);
+      }
+      numBytes += dataSize;
+    }
+    elapsed = timeNow() - startTime;
+  } while (elapsed < 0.2);
+  Medium::close(framer);
+
+  return numBytes/elapsed/1e9;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = new QuietEnvironment(*scheduler);
+  tsData = new u_int8_t[CHECK_STREAM_NUM_PACKETS*TS_PACKET_SIZE];
+  deliveryBuffer = new u_int8_t[100*TS_PACKET_SIZE];
+
+  // First, check the framer on streams with normal and very frequent PCRs, and with missing sync bytes,
+  // for various buffer sizes and PCR limits:
+  unsigned const bufferNumPackets[] = { 1, 7, 100 };
+  float const streamDuration = CHECK_STREAM_NUM_PACKETS*(float)PCR_TICKS_PER_PACKET/27000000;
+  float const pcrLimits[] = { 0.0, streamDuration/4, streamDuration/2, streamDuration*9/10 };
+  unsigned numFailures = 0;
+  for (unsigned s = 0; s < 3; ++s) {
+    char const* const description
+      = s == 0 ? "PCR every 200 packets" : s == 1 ? "PCR every 6 packets" : "missing sync byte every 997 packets";
+    generateStream(CHECK_STREAM_NUM_PACKETS, s == 1 ? 6 : 200, s == 2 ? 997 : 0);
+    for (unsigned b = 0; b < sizeof bufferNumPackets/sizeof bufferNumPackets[0]; ++b) {
+      for (unsigned l = 0; l < sizeof pcrLimits/sizeof pcrLimits[0]; ++l) {
+	if (!checkStream(*env, description, bufferNumPackets[b], pcrLimits[l])) ++numFailures;
+      }
+    }
+  }
+  if (numFailures > 0) return 1;
+  fprintf(stderr, "The framer delivered and counted the right packets, and stopped at the right PCR, in each case\n");
+
+  // Finally, measure throughput (if wanted):
+  if (!measurementsAreWanted(argc, argv)) return 0;
+  fprintf(stderr, "Throughput (GB/s):\t\t7-packet buffers\t100-packet buffers\n");
+  for (unsigned s = 0; s < 2; ++s) {
+    generateStream(BENCHMARK_STREAM_NUM_PACKETS, s == 0 ? 200 : 6, 0);
+    fprintf(stderr, "PCR every %u packets:\t%.1f\t\t\t%.1f\n", s == 0 ? 200 : 6, measure(*env, 7), measure(*env, 100));
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Sends RTP packets 'interleaved' (RFC 2326, section 10.12) over one end of a stream socket pair - both as single
+// buffers, and as a header plus separate payload - and checks that the other end receives exactly the expected
+// '$'-framed byte stream.  Then times sending (and receiving) them.  To compare scatter-gather ("sendmsg()")
+// sending with separate "send()"s, run this program from a normal build, and from a build (of both the libraries
+// and this program) with NO_SCATTER_GATHER_SEND defined.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define RTP_HEADER_SIZE 12
+#define NUM_PACKETS_PER_BATCH 16 // we empty the receiving socket after sending each batch
+
+// "RTPInterface"s are normally owned by a RTP sink or source; for us, any "Medium" will do:
+class InterfaceOwner: public Medium {
+public:
+  InterfaceOwner(UsageEnvironment& env): Medium(env) {}
+};
+
+UsageEnvironment* env;
+int receivingSocket;
+u_int8_t packet[RTP_HEADER_SIZE + 1500];
+u_int8_t* received;
+
+static void makePacket(unsigned index, unsigned payloadSize) {
+  packet[0] = 0x80; packet[1] = 96; packet[2] = (u_int8_t)(index>>8); packet[3] = (u_int8_t)index;
+  memset(&packet[4], 0, 8);
+  for (unsigned i = 0; i < payloadSize; ++i) packet[RTP_HEADER_SIZE + i] = (u_int8_t)nextRandom();
+}
+
+static unsigned receiveAll() {
+  // Reads everything that's waiting to be read from "receivingSocket" (into "received"), and returns its size:
+  unsigned numBytesReceived = 0;
+  while (1) {
+    int const result = recv(receivingSocket, (char*)&received[numBytesReceived], 100000, 0);
+    if (result <= 0) break;
+    numBytesReceived += result;
+  }
+  return numBytesReceived;
+}
+
+static Boolean sendBatch(RTPInterface& rtpInterface, unsigned firstIndex, unsigned payloadSize, Boolean asTwoPieces,
+			 Boolean doCheck) {
+  // Sends a batch of packets, then reads them at the other end, and (if "doCheck") checks their framing and contents:
+  unsigned const packetSize = RTP_HEADER_SIZE + payloadSize;
+  unsigned char expected[NUM_PACKETS_PER_BATCH*(4 + sizeof packet)];
+  unsigned expectedSize = 0;
+  for (unsigned i = 0; i < NUM_PACKETS_PER_BATCH; ++i) {
+    if (doCheck) {
+      makePacket(firstIndex + i, payloadSize);
+      u_int8_t* p = &expected[expectedSize];
+      p[0] = '$'; p[1] = 0; p[2] = (u_int8_t)(packetSize>>8); p[3] = (u_int8_t)packetSize;
+      memcpy(&p[4], packet, packetSize);
+      expectedSize += 4 + packetSize;
+    }
+    Boolean const sent = asTwoPieces
+      ? rtpInterface.sendPacket(packet, RTP_HEADER_SIZE, &packet[RTP_HEADER_SIZE], payloadSize)
+      : rtpInterface.sendPacket(packet, packetSize);
+    if (!sent) return False;
+  }
+
+  unsigned const numBytesReceived = receiveAll();
+  if (!doCheck) return numBytesReceived == NUM_PACKETS_PER_BATCH*(4 + packetSize);
+  return numBytesReceived == expectedSize && memcmp(received, expected, expectedSize) == 0;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+  received = new u_int8_t[1000000];
+
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0) {
+    fprintf(stderr, "FAILED: unable to create a socket pair\n");
+    return 1;
+  }
+  receivingSocket = sockets[1];
+  makeSocketNonBlocking(receivingSocket);
+
+  // Set up a "RTPInterface" that sends over the socket pair (rather than its 'groupsock'), as it would for a
+  // RTSP client that asked for RTP-over-TCP:
+  struct in_addr loopbackAddress;
+  loopbackAddress.s_addr = our_inet_addr("127.0.0.1");
+  Groupsock gs(*env, loopbackAddress, Port(0), 255);
+  InterfaceOwner* owner = new InterfaceOwner(*env);
+  RTPInterface* rtpInterface = new RTPInterface(owner, &gs);
+  rtpInterface->setStreamSocket(sockets[0], 0);
+  makeSocketNonBlocking(sockets[0]);
+
+  // First, check what gets sent, for various payload sizes:
+  for (unsigned i = 0; i < 1000; ++i) {
+    unsigned const payloadSize = i%10 == 0 ? 0 : 1 + nextRandom()%1400;
+    if (!sendBatch(*rtpInterface, i*NUM_PACKETS_PER_BATCH, payloadSize, i%2 == 1, True)) {
+      fprintf(stderr, "FAILED: %u-byte payloads, sent as %s: wrong data was received\n",
+	      payloadSize, i%2 == 1 ? "header + payload" : "a single buffer");
+      return 1;
+    }
+  }
+  fprintf(stderr, "Each interleaved packet was received intact, and correctly framed\n");
+
+  // Finally, time the sending (if wanted):
+  if (measurementsAreWanted(argc, argv)) {
+#ifdef HAVE_SCATTER_GATHER_SEND
+    fprintf(stderr, "Sending with one \"sendmsg()\" per packet:\n");
+#else
+    fprintf(stderr, "Sending with a separate \"send()\" for each piece of each packet:\n");
+#endif
+    unsigned const payloadSizes[] = { 188, 1400 };
+    for (unsigned i = 0; i < sizeof payloadSizes/sizeof payloadSizes[0]; ++i) {
+      for (unsigned asTwoPieces = 0; asTwoPieces <= 1; ++asTwoPieces) {
+	makePacket(0, payloadSizes[i]);
+	unsigned numPackets = 0;
+	double const startTime = timeNow();
+	double elapsed;
+	do {
+	  for (unsigned j = 0; j < 100; ++j) {
+	    if (!sendBatch(*rtpInterface, 0, payloadSizes[i], asTwoPieces, False)) {
+	      fprintf(stderr, "FAILED: a packet was lost while timing\n");
+	      return 1;
+	    }
+	  }
+	  numPackets += 100*NUM_PACKETS_PER_BATCH;
+	  elapsed = timeNow() - startTime;
+	} while (elapsed < 0.5);
+	fprintf(stderr, "\t%u-byte payloads, sent as %s:\t%.0f ns/packet (%.0f MB/s)\n", payloadSizes[i],
+		asTwoPieces ? "header + payload" : "a single buffer",
+		elapsed*1e9/numPackets, numPackets*(4.0 + RTP_HEADER_SIZE + payloadSizes[i])/elapsed/1e6);
+      }
+    }
+  }
+
+  delete rtpInterface;
+  Medium::close(owner);
+  return 0;
+}
@@ -0,0 +1,181 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Sends RTP packets over the loopback interface - in order; displaced by up to 64 places, with 5% sent twice; and
+// with the second packet sent last - to a "SimpleRTPSource", and checks that its reordering buffer delivers each
+// of them exactly once, in sequence number order (across a sequence number wraparound).  Reports the time taken.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAYLOAD_SIZE 100
+
+UsageEnvironment* env;
+int senderSocket;
+struct in_addr loopbackAddress;
+Port receiverPort(0);
+
+// The packets to be sent (each identified by its index in the stream), in the order in which they're sent:
+unsigned* sendOrder;
+unsigned numToSend, numSent;
+unsigned firstSeqNum;
+
+// The packets that were delivered, in order:
+unsigned* delivered;
+unsigned numDelivered, numExpected;
+char testIsDone;
+
+void sendNextPacket(void* /*clientData*/) {
+  // We send just one packet each time through the event loop, so that our receiver (which reads one packet each time)
+  // keeps up with us, and so no packet is dropped by the (loopback) network:
+  unsigned char packet[12 + PAYLOAD_SIZE];
+  unsigned const index = sendOrder[numSent++];
+  u_int16_t const seqNum = (u_int16_t)(firstSeqNum + index);
+  packet[0] = 0x80; packet[1] = 96; packet[2] = seqNum>>8; packet[3] = (u_int8_t)seqNum;
+  u_int32_t const timestamp = 1000*index;
+  packet[4] = timestamp>>24; packet[5] = timestamp>>16; packet[6] = timestamp>>8; packet[7] = timestamp;
+  packet[8] = 0x12; packet[9] = 0x34; packet[10] = 0x56; packet[11] = 0x78; // SSRC
+  packet[12] = index>>24; packet[13] = index>>16; packet[14] = index>>8; packet[15] = index;
+  memset(&packet[16], (u_int8_t)index, PAYLOAD_SIZE - 4);
+  writeSocket(*env, senderSocket, loopbackAddress, receiverPort.num(), packet, sizeof packet);
+
+  if (numSent < numToSend) env->taskScheduler().scheduleDelayedTask(0, sendNextPacket, NULL);
+}
+
+class DeliveryChecker: public MediaSink {
+public:
+  DeliveryChecker(UsageEnvironment& env): MediaSink(env) {}
+
+private:
+  virtual Boolean continuePlaying() {
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    DeliveryChecker* checker = (DeliveryChecker*)clientData;
+    u_int8_t const* p = checker->fBuffer;
+    unsigned const index = frameSize == PAYLOAD_SIZE ? (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3] : ~0U;
+    if (numDelivered < numExpected) delivered[numDelivered] = index;
+    if (++numDelivered == numExpected) testIsDone = 1;
+    checker->continuePlaying();
+  }
+
+private:
+  unsigned char fBuffer[2*PAYLOAD_SIZE];
+};
+
+static void stopTest(void* /*clientData*/) {
+  testIsDone = 1;
+}
+
+// Sends the packets in "sendOrder" (numbered 0 .. "numPackets"-1), checks that they're delivered in order, and
+// returns the time taken (or a negative number, if the check fails):
+static double runTest(char const* description, unsigned numPackets) {
+  Groupsock receiverGroupsock(*env, loopbackAddress, Port(0), 255);
+  getSourcePort(*env, receiverGroupsock.socketNum(), receiverPort);
+  RTPSource* source = SimpleRTPSource::createNew(*env, &receiverGroupsock, 96, 90000, "video/X-TEST", 0, False);
+      // (each packet is a complete frame)
+  source->setPacketReorderingThresholdTime(10000000); // wait for each missing packet, for as long as we need to
+  DeliveryChecker* checker = new DeliveryChecker(*env);
+  checker->startPlaying(*source, NULL, NULL);
+
+  numSent = numDelivered = 0;
+  numExpected = numPackets;
+  firstSeqNum = 65536 - numPackets/2; // so that the sequence numbers wrap around
+  testIsDone = 0;
+  double const startTime = timeNow();
+  sendNextPacket(NULL);
+  TaskToken timeoutTask = env->taskScheduler().scheduleDelayedTask(30000000, stopTest, NULL);
+  env->taskScheduler().doEventLoop(&testIsDone);
+  double const elapsed = timeNow() - startTime;
+  env->taskScheduler().unscheduleDelayedTask(timeoutTask);
+
+  // Let any remaining (duplicate) packets arrive, to check that none of them gets delivered again:
+  numExpected = numPackets + 1;
+  testIsDone = 0;
+  timeoutTask = env->taskScheduler().scheduleDelayedTask(100000, stopTest, NULL);
+  env->taskScheduler().doEventLoop(&testIsDone);
+  env->taskScheduler().unscheduleDelayedTask(timeoutTask);
+
+  checker->stopPlaying();
+  Medium::close(checker);
+  Medium::close(source);
+
+  unsigned i;
+  for (i = 0; i < numPackets && i < numDelivered; ++i) {
+    if (delivered[i] != i) break;
+  }
+  if (i < numPackets || numDelivered != numPackets) {
+    fprintf(stderr, "FAILED: %s: %u packets delivered (of %u); the first wrong one was #%u\n",
+	    description, numDelivered, numPackets, i);
+    return -1.0;
+  }
+  fprintf(stderr, "%s: %u packets, each delivered once, in order, in %.3f s (%.2f us/packet)\n",
+	  description, numPackets, elapsed, elapsed*1e6/numToSend);
+  return elapsed;
+}
+
+int main(int /*argc*/, char** /*argv*/) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+  loopbackAddress.s_addr = our_inet_addr("127.0.0.1");
+  senderSocket = setupDatagramSocket(*env, Port(0));
+  if (senderSocket < 0) {
+    fprintf(stderr, "FAILED: unable to create a socket: %s\n", env->getResultMsg());
+    return 1;
+  }
+
+  unsigned const maxNumPackets = 30000;
+  sendOrder = new unsigned[2*maxNumPackets];
+  delivered = new unsigned[maxNumPackets + 1];
+  Boolean ok = True;
+
+  // 1. In order:
+  for (numToSend = 0; numToSend < maxNumPackets; ++numToSend) sendOrder[numToSend] = numToSend;
+  ok &= runTest("In order", maxNumPackets) >= 0.0;
+
+  // (Note that the first packet to arrive always has to be the first packet of the stream, because the source takes
+  // its sequence number to be the start of the stream.)
+
+  // 2. Each packet displaced by up to 64 places, then 5% of them sent again (after they've all been delivered):
+  for (unsigned i = 0; i < maxNumPackets; ++i) sendOrder[i] = i;
+  for (unsigned i = 1; i < maxNumPackets; ++i) {
+    unsigned j = i + nextRandom()%64;
+    if (j >= maxNumPackets) j = maxNumPackets-1;
+    unsigned const tmp = sendOrder[i]; sendOrder[i] = sendOrder[j]; sendOrder[j] = tmp;
+  }
+  numToSend = maxNumPackets;
+  for (unsigned i = 0; i < maxNumPackets/20; ++i) {
+    unsigned const j = nextRandom()%numToSend;
+    sendOrder[numToSend++] = sendOrder[j];
+  }
+  ok &= runTest("Reordered and duplicated", maxNumPackets) >= 0.0;
+
+  // 3. The second packet arrives last, so all of the others are queued behind it:
+  sendOrder[0] = 0;
+  for (numToSend = 1; numToSend < maxNumPackets-1; ++numToSend) sendOrder[numToSend] = numToSend + 1;
+  sendOrder[numToSend++] = 1;
+  ok &= runTest("Second packet last", maxNumPackets) >= 0.0;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Sets up a stream from a "RTSPServer" using RTP-over-TCP, then - in a single write - sends it an interleaved RTCP
+// packet, a "TEARDOWN" for the stream, and a pipelined "OPTIONS".  Checks that the server answers both requests
+// (the "OPTIONS" having been read by the server's RTP-over-TCP reader before it handed the socket back), and
+// that it still answers requests on the same connection afterwards.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A source that never delivers any data (so the only data that the server sends over the TCP connection - apart
+// from its RTSP responses - are RTCP reports):
+class SilentSource: public FramedSource {
+public:
+  SilentSource(UsageEnvironment& env): FramedSource(env) {}
+
+private:
+  virtual void doGetNextFrame() {}
+};
+
+class SilentServerMediaSubsession: public OnDemandServerMediaSubsession {
+public:
+  SilentServerMediaSubsession(UsageEnvironment& env): OnDemandServerMediaSubsession(env, False) {}
+
+private:
+  virtual FramedSource* createNewStreamSource(unsigned /*clientSessionId*/, unsigned& estBitrate) {
+    estBitrate = 100; // kbps
+    return new SilentSource(envir());
+  }
+  virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic,
+				    FramedSource* /*inputSource*/) {
+    return SimpleRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, 90000, "video", "X-SILENT");
+  }
+};
+
+UsageEnvironment* env;
+int clientSocket;
+char responses[100000];
+unsigned responsesSize;
+char const* awaitedString;
+char watchVariable;
+
+static Boolean haveReceived(char const* str) {
+  // (We can't use "strstr()", because the server's RTCP reports - which are interleaved with its responses - may
+  // contain '\0' bytes.)
+  unsigned const len = strlen(str);
+  for (unsigned i = 0; i + len <= responsesSize; ++i) {
+    if (memcmp(&responses[i], str, len) == 0) return True;
+  }
+  return False;
+}
+
+static void clientReadHandler(void* /*clientData*/, int /*mask*/) {
+  struct sockaddr_in fromAddress;
+  int const result = readSocket(*env, clientSocket, (unsigned char*)&responses[responsesSize],
+				sizeof responses - 1 - responsesSize, fromAddress);
+  if (result > 0) responsesSize += result;
+  if (result <= 0 || haveReceived(awaitedString)) watchVariable = 1;
+}
+
+static void timeoutHandler(void* /*clientData*/) {
+  watchVariable = 1;
+}
+
+static Boolean sendAndAwait(char const* data, unsigned dataSize, char const* str) {
+  // Sends data to the server, then waits (for up to 5 seconds) until "str" has been received from it:
+  if (send(clientSocket, data, dataSize, 0) != (int)dataSize) return False;
+
+  awaitedString = str;
+  watchVariable = 0;
+  TaskToken timeoutTask = env->taskScheduler().scheduleDelayedTask(5000000, timeoutHandler, NULL);
+  env->taskScheduler().doEventLoop(&watchVariable);
+  env->taskScheduler().unscheduleDelayedTask(timeoutTask);
+
+  return haveReceived(str);
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  RTSPServer* rtspServer = RTSPServer::createNew(*env, 0);
+  if (rtspServer == NULL) {
+    fprintf(stderr, "FAILED: unable to create a RTSP server: %s\n", env->getResultMsg());
+    return 1;
+  }
+  ServerMediaSession* sms = ServerMediaSession::createNew(*env, "test");
+  sms->addSubsession(new SilentServerMediaSubsession(*env));
+  rtspServer->addServerMediaSession(sms);
+
+  // Connect to the server (over the loopback interface):
+  char* urlPrefix = rtspServer->rtspURLPrefix();
+  unsigned serverPortNum;
+  if (sscanf(urlPrefix, "rtsp://%*[^:]:%u/", &serverPortNum) != 1) {
+    fprintf(stderr, "FAILED: unexpected URL prefix: %s\n", urlPrefix);
+    return 1;
+  }
+  delete[] urlPrefix;
+  struct sockaddr_in serverAddress;
+  memset(&serverAddress, 0, sizeof serverAddress);
+  serverAddress.sin_family = AF_INET;
+  serverAddress.sin_addr.s_addr = our_inet_addr("127.0.0.1");
+  serverAddress.sin_port = htons((u_int16_t)serverPortNum);
+  clientSocket = setupStreamSocket(*env, 0, False);
+  if (clientSocket < 0 || connect(clientSocket, (struct sockaddr*)&serverAddress, sizeof serverAddress) != 0) {
+    fprintf(stderr, "FAILED: unable to connect to the RTSP server\n");
+    return 1;
+  }
+  makeSocketNonBlocking(clientSocket);
+  env->taskScheduler().setBackgroundHandling(clientSocket, SOCKET_READABLE|SOCKET_EXCEPTION, clientReadHandler, NULL);
+
+  // Set up (and start) the stream, using RTP-over-TCP:
+  char request[1000];
+  sprintf(request, "SETUP rtsp://127.0.0.1:%u/test/track1 RTSP/1.0\r\nCSeq: 1\r\n"
+	  "Transport: RTP/AVP/TCP;unicast;interleaved=0-1\r\n\r\n", serverPortNum);
+  if (!sendAndAwait(request, strlen(request), "CSeq: 1\r\n") || !haveReceived("\r\n\r\n")) {
+    fprintf(stderr, "FAILED: no response to \"SETUP\"\n");
+    return 1;
+  }
+  char sessionId[100];
+  char const* sessionHeader = strstr(responses, "Session: ");
+  if (sessionHeader == NULL || sscanf(sessionHeader, "Session: %[^;\r\n]", sessionId) != 1) {
+    fprintf(stderr, "FAILED: \"SETUP\" failed:\n%s\n", responses);
+    return 1;
+  }
+  sprintf(request, "PLAY rtsp://127.0.0.1:%u/test/ RTSP/1.0\r\nCSeq: 2\r\nSession: %s\r\n\r\n", serverPortNum, sessionId);
+  if (!sendAndAwait(request, strlen(request), "CSeq: 2\r\n")) {
+    fprintf(stderr, "FAILED: no response to \"PLAY\"\n");
+    return 1;
+  }
+
+  // Then, in a single write, send an interleaved RTCP "RR" (on channel 1), a "TEARDOWN", and a pipelined "OPTIONS":
+  unsigned char const interleavedRTCP[] = { '$', 1, 0, 8, 0x80, 201, 0, 1, 0x12, 0x34, 0x56, 0x78 };
+  memcpy(request, interleavedRTCP, sizeof interleavedRTCP);
+  sprintf(&request[sizeof interleavedRTCP],
+	  "TEARDOWN rtsp://127.0.0.1:%u/test/ RTSP/1.0\r\nCSeq: 3\r\nSession: %s\r\n\r\n"
+	  "OPTIONS rtsp://127.0.0.1:%u/test/ RTSP/1.0\r\nCSeq: 4\r\n\r\n", serverPortNum, sessionId, serverPortNum);
+  Boolean const gotOPTIONSResponse
+    = sendAndAwait(request, sizeof interleavedRTCP + strlen(&request[sizeof interleavedRTCP]), "CSeq: 4\r\n");
+  if (!haveReceived("CSeq: 3\r\n")) {
+    fprintf(stderr, "FAILED: no response to \"TEARDOWN\"\n");
+    return 1;
+  }
+  if (!gotOPTIONSResponse) {
+    fprintf(stderr, "FAILED: no response to the \"OPTIONS\" that was sent straight after the \"TEARDOWN\"\n");
+    return 1;
+  }
+
+  // Finally, check that the server still reads requests from the connection:
+  sprintf(request, "OPTIONS rtsp://127.0.0.1:%u/test/ RTSP/1.0\r\nCSeq: 5\r\n\r\n", serverPortNum);
+  if (!sendAndAwait(request, strlen(request), "CSeq: 5\r\n")) {
+    fprintf(stderr, "FAILED: no response to a later \"OPTIONS\"\n");
+    return 1;
+  }
+  fprintf(stderr, "The server answered the request that followed the \"TEARDOWN\", and later requests\n");
+
+  env->taskScheduler().disableBackgroundHandling(clientSocket);
+  closeSocket(clientSocket);
+  Medium::close(rtspServer);
+  return 0;
+}
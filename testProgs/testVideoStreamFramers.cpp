@@ -0,0 +1,245 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 2.1 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2015, Live Networks, Inc.  All rights reserved
+// Feeds synthetic H.264, H.265 and MPEG-1/2 video elementary streams - read from 1 to 150000 bytes at a time - to
+// the corresponding video stream framers, and compares the frames that they deliver with the NAL units (or, for
+// MPEG-1/2, the data) that were generated.  Then times how fast each framer parses a 64 MB stream.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh" // for "gettimeofday()"
+#include "testCommon.hh"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK_STREAM_SIZE 300000
+#define BENCHMARK_STREAM_SIZE 64000000
+#define MAX_NUM_UNITS 200000
+
+enum StreamKind { H264, H265, MPEG2 };
+char const* const kindName[] = { "H.264", "H.265", "MPEG-2" };
+
+// The elementary stream, and - for H.264 and H.265 - the position and size of each of its NAL units:
+u_int8_t* esData;
+unsigned esSize;
+unsigned unitStart[MAX_NUM_UNITS], unitSize[MAX_NUM_UNITS];
+unsigned numUnits;
+
+static void addBytes(u_int8_t const* bytes, unsigned numBytes) {
+  memcpy(&esData[esSize], bytes, numBytes);
+  esSize += numBytes;
+}
+
+static void addPayload(unsigned numBytes) {
+  // Random data (with plenty of zero bytes), but containing no "00 00 00", "00 00 01" or "00 00 02",
+  // and not ending with "00":
+  unsigned numZeros = 0;
+  for (unsigned i = 0; i < numBytes; ++i) {
+    u_int8_t b = nextRandom()%8 == 0 ? 0 : (u_int8_t)nextRandom();
+    if (numZeros >= 2 && b <= 2) b = 3;
+    esData[esSize++] = b;
+    numZeros = b == 0 ? numZeros+1 : 0;
+  }
+  if (esData[esSize-1] == 0) esData[esSize++] = 0x80;
+}
+
+static void generateStream(StreamKind kind, unsigned size) {
+  esSize = numUnits = 0;
+  for (unsigned n = 0; esSize < size && numUnits < MAX_NUM_UNITS; ++n) {
+    if (kind == MPEG2) {
+      if (n%15 == 0) {
+	u_int8_t const sequenceHeader[] = { 0,0,1,0xB3, 0x2D,0x01,0xE0, 0x24, 0xFF,0xFF,0xE0,0x18 };
+	addBytes(sequenceHeader, sizeof sequenceHeader);
+	u_int8_t const gopHeader[] = { 0,0,1,0xB8, 0x00,0x08,0x00,0x00 };
+	addBytes(gopHeader, sizeof gopHeader);
+      }
+      unsigned const temporalReference = n%1024;
+      u_int8_t const pictureHeader[] = { 0,0,1,0x00, (u_int8_t)(temporalReference>>2),
+					 (u_int8_t)((temporalReference<<6)|((n%15 == 0 ? 1 : 2)<<3)), 0xFF, 0xF8 };
+      addBytes(pictureHeader, sizeof pictureHeader);
+      for (u_int8_t slice = 1; slice <= 30; ++slice) {
+	u_int8_t const sliceStartCode[] = { 0,0,1,slice };
+	addBytes(sliceStartCode, sizeof sliceStartCode);
+	addPayload(1000 + nextRandom()%4000);
+      }
+    } else {
+      // A NAL unit, with (mostly) a 3-byte start code:
+      u_int8_t const startCode[] = { 0,0,0,1 };
+      if (n%3 == 0) addBytes(startCode, 4); else addBytes(&startCode[1], 3);
+      unitStart[numUnits] = esSize;
+      Boolean const isKeyFrame = n%30 == 0;
+      if (kind == H264) {
+	u_int8_t const header[] = { (u_int8_t)(isKeyFrame ? 0x65 : 0x41), (u_int8_t)(0x88|(nextRandom()%8)) };
+	addBytes(header, sizeof header);
+      } else {
+	u_int8_t const header[] = { (u_int8_t)((isKeyFrame ? 19 : 1)<<1), 1, (u_int8_t)(0x80|(nextRandom()%128)) };
+	addBytes(header, sizeof header);
+      }
+      addPayload(isKeyFrame ? 100000 : 5000 + nextRandom()%60000);
+      unitSize[numUnits] = esSize - unitStart[numUnits];
+    }
+    ++numUnits;
+  }
+
+  // End the stream with a code that the framers won't deliver.  (They never deliver the data that follows the
+  // stream's last start code, because nothing marks where it ends.  For H.264 and H.265, we use a 'filler data'
+  // NAL unit, because it has to be long enough for the framer to look at its header.)
+  if (kind == MPEG2) {
+    u_int8_t const sequenceEndCode[] = { 0,0,1,0xB7 };
+    addBytes(sequenceEndCode, sizeof sequenceEndCode);
+  } else {
+    u_int8_t const fillerData[] = { 0,0,0,1, (u_int8_t)(kind == H264 ? 12 : 38<<1), 1, 0xFF,0xFF,0xFF,0xFF,0x80 };
+    addBytes(fillerData, sizeof fillerData);
+  }
+}
+
+// A source that delivers the elementary stream from memory, "chunkSize" bytes at a time:
+class MemorySource: public FramedSource {
+public:
+  MemorySource(UsageEnvironment& env, unsigned chunkSize)
+    : FramedSource(env), fChunkSize(chunkSize), fPosition(0) {}
+
+private:
+  virtual void doGetNextFrame() {
+    if (fPosition >= esSize) {
+      handleClosure();
+      return;
+    }
+    fFrameSize = fChunkSize < fMaxSize ? fChunkSize : fMaxSize;
+    if (fFrameSize > esSize - fPosition) fFrameSize = esSize - fPosition;
+    memcpy(fTo, &esData[fPosition], fFrameSize);
+    fPosition += fFrameSize;
+    gettimeofday(&fPresentationTime, NULL);
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+  }
+
+private:
+  unsigned fChunkSize;
+  unsigned fPosition;
+};
+
+// A sink that checks each frame that it receives: For H.264 and H.265, each frame should be the next NAL unit
+// (without its start code); for MPEG-1/2, the frames together should be the whole stream (except for its end code):
+class FrameChecker: public MediaSink {
+public:
+  FrameChecker(UsageEnvironment& env, StreamKind kind, Boolean doCheck)
+    : MediaSink(env), fKind(kind), fDoCheck(doCheck), fNumFrames(0), fNumBytes(0), fNumErrors(0) {}
+
+  unsigned numFrames() const { return fNumFrames; }
+  unsigned numErrors() const { return fNumErrors; }
+  Boolean sawWholeStream() const { return fKind == MPEG2 ? fNumBytes == esSize - 4/*end code*/ : fNumFrames == numUnits; }
+
+private:
+  virtual Boolean continuePlaying() {
+    fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+    return True;
+  }
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+    FrameChecker* checker = (FrameChecker*)clientData;
+    checker->afterGettingFrame1(frameSize, numTruncatedBytes);
+  }
+  void afterGettingFrame1(unsigned frameSize, unsigned numTruncatedBytes) {
+    if (fDoCheck) {
+      Boolean ok;
+      if (fKind == MPEG2) {
+	ok = fNumBytes + frameSize <= esSize && memcmp(fBuffer, &esData[fNumBytes], frameSize) == 0;
+      } else {
+	ok = fNumFrames < numUnits && frameSize == unitSize[fNumFrames]
+	  && memcmp(fBuffer, &esData[unitStart[fNumFrames]], frameSize) == 0;
+      }
+      if (!ok || numTruncatedBytes > 0) ++fNumErrors;
+    }
+    ++fNumFrames;
+    fNumBytes += frameSize;
+    continuePlaying();
+  }
+
+private:
+  StreamKind fKind;
+  Boolean fDoCheck;
+  unsigned fNumFrames, fNumBytes, fNumErrors;
+  unsigned char fBuffer[200000];
+};
+
+char doneFlag;
+
+static void afterPlaying(void* /*clientData*/) {
+  doneFlag = 1;
+}
+
+// Parses the current stream (read "chunkSize" bytes at a time), and returns the number of frames that were wrong
+// (or missing).  Also returns the time taken:
+static unsigned parseStream(UsageEnvironment& env, StreamKind kind, unsigned chunkSize, Boolean doCheck,
+			    double& elapsed) {
+  FramedSource* source = new MemorySource(env, chunkSize);
+  FramedSource* framer
+    = kind == H264 ? (FramedSource*)H264VideoStreamFramer::createNew(env, source)
+    : kind == H265 ? (FramedSource*)H265VideoStreamFramer::createNew(env, source)
+    : (FramedSource*)MPEG1or2VideoStreamFramer::createNew(env, source);
+  FrameChecker* checker = new FrameChecker(env, kind, doCheck);
+
+  double const startTime = timeNow();
+  doneFlag = 0;
+  checker->startPlaying(*framer, afterPlaying, NULL);
+  env.taskScheduler().doEventLoop(&doneFlag);
+  elapsed = timeNow() - startTime;
+
+  unsigned numErrors = checker->numErrors();
+  if (!checker->sawWholeStream()) ++numErrors;
+  Medium::close(checker);
+  Medium::close(framer); // also closes "source"
+  return numErrors;
+}
+
+int main(int argc, char** argv) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* env = BasicUsageEnvironment::createNew(*scheduler);
+  esData = new u_int8_t[BENCHMARK_STREAM_SIZE + 200000];
+
+  // First, check each framer's output, for various input chunk sizes (including those that split start codes):
+  unsigned const chunkSizes[] = { 1, 2, 3, 5, 188, 1000, 4096, 150000 };
+  unsigned numFailures = 0;
+  for (unsigned k = H264; k <= MPEG2; ++k) {
+    StreamKind const kind = (StreamKind)k;
+    generateStream(kind, CHECK_STREAM_SIZE);
+    for (unsigned i = 0; i < sizeof chunkSizes/sizeof chunkSizes[0]; ++i) {
+      double elapsed;
+      unsigned const numErrors = parseStream(*env, kind, chunkSizes[i], True, elapsed);
+      if (numErrors > 0) {
+	fprintf(stderr, "FAILED: %s, read %u bytes at a time: %u frames were wrong or missing\n",
+		kindName[kind], chunkSizes[i], numErrors);
+	++numFailures;
+      }
+    }
+  }
+  if (numFailures > 0) return 1;
+  fprintf(stderr, "Each framer gave the right frames, for each input chunk size\n");
+
+  // Finally, measure parsing throughput (if wanted):
+  if (!measurementsAreWanted(argc, argv)) return 0;
+  for (unsigned k = H264; k <= MPEG2; ++k) {
+    StreamKind const kind = (StreamKind)k;
+    generateStream(kind, BENCHMARK_STREAM_SIZE);
+    double elapsed;
+    parseStream(*env, kind, 150000, False, elapsed);
+    fprintf(stderr, "%s:\t%u bytes parsed in %.3f s (%.0f MB/s)\n", kindName[kind], esSize, elapsed, esSize/elapsed/1e6);
+  }
+
+  return 0;
+}